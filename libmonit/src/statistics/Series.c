@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.  
+ */
+
+
+#include "Config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Series.h"
+
+
+/**
+ * Implementation of the Series interface. Every ring is indexed by the
+ * absolute bucket number (time / resolution) modulo the ring size. When the
+ * time advances to a new bucket, the skipped buckets are initialized as
+ * empty buckets carrying the running sum forward, so every bucket in the
+ * ring range is valid and a window average is the difference of the
+ * running sums at the window ends.
+ *
+ * @author http://www.tildeslash.com/
+ * @see http://www.mmonit.com/
+ * @file
+ */
+
+
+/* ------------------------------------------------------------- Definitions */
+
+
+#define T Series_T
+
+
+typedef struct Bucket_T {
+        uint32_t slot;                        // Absolute bucket number
+        uint32_t count;                       // Number of samples in this bucket
+        float minimum;
+        float maximum;
+        double sum;                           // Running sum of all samples up to this bucket
+        uint64_t samples;                     // Running count of all samples up to this bucket
+} Bucket_T;
+
+
+typedef struct Ring_T {
+        int resolution;                       // Bucket length [s]
+        int size;                             // Number of buckets
+        uint32_t current;                     // Last bucket written (0 = none)
+        Bucket_T *bucket;
+} Ring_T;
+
+
+// One bucket more than the covered range, so the window start bucket is still in the ring
+#define MINUTES 61
+#define HOURS   25
+#define DAYS    31
+
+
+struct T {
+        double sum;
+        uint64_t samples;
+        Ring_T ring[3];
+        Bucket_T minutes[MINUTES];
+        Bucket_T hours[HOURS];
+        Bucket_T days[DAYS];
+};
+
+
+/* ----------------------------------------------------------------- Private */
+
+
+static void _advance(Ring_T *R, uint32_t slot, double sum, uint64_t samples) {
+        uint32_t first = R->current && slot - R->current < (uint32_t)R->size ? R->current + 1 : slot - R->size + 1;
+        for (uint32_t i = first; i <= slot; i++)
+                R->bucket[i % R->size] = (Bucket_T){.slot = i, .sum = sum, .samples = samples};
+        R->current = slot;
+}
+
+
+/**
+ * Find the ring which covers the window and the window start and end buckets.
+ * Returns false if the window is empty
+ */
+static boolean_t _window(T S, uint64_t time, int range, Ring_T **ring, uint32_t *start, uint32_t *end) {
+        if (range <= 0 || range > SERIES_MAX_RANGE || ! S->samples)
+                return false;
+        int i = 0;
+        while (i < 2 && range > (S->ring[i].size - 1) * S->ring[i].resolution)
+                i++;
+        Ring_T *R = &(S->ring[i]);
+        uint32_t slot = (uint32_t)(time / 1000 / R->resolution);
+        uint32_t buckets = (range + R->resolution - 1) / R->resolution;
+        if (slot < buckets || slot - buckets >= R->current)
+                return false;
+        *ring = R;
+        *start = slot - buckets; // Exclusive
+        *end = slot < R->current ? slot : R->current;
+        // The start bucket was overwritten already if the window ends long before the last sample
+        return R->bucket[*start % R->size].slot == *start;
+}
+
+
+static boolean_t _extreme(T S, uint64_t time, int range, boolean_t maximum, double *result) {
+        Ring_T *R;
+        uint32_t start, end;
+        if (_window(S, time, range, &R, &start, &end)) {
+                boolean_t found = false;
+                for (uint32_t i = start + 1; i <= end; i++) {
+                        Bucket_T *b = &(R->bucket[i % R->size]);
+                        if (b->slot == i && b->count) {
+                                double value = maximum ? b->maximum : b->minimum;
+                                if (! found || (maximum ? value > *result : value < *result))
+                                        *result = value;
+                                found = true;
+                        }
+                }
+                return found;
+        }
+        return false;
+}
+
+
+/* ------------------------------------------------------------------ Public */
+
+
+T Series_new(void) {
+        T S;
+        NEW(S);
+        S->ring[0] = (Ring_T){.resolution = 60, .size = MINUTES, .bucket = S->minutes};
+        S->ring[1] = (Ring_T){.resolution = 3600, .size = HOURS, .bucket = S->hours};
+        S->ring[2] = (Ring_T){.resolution = 86400, .size = DAYS, .bucket = S->days};
+        return S;
+}
+
+
+void Series_free(T *S) {
+        assert(S && *S);
+        FREE(*S);
+}
+
+
+void Series_add(T S, uint64_t time, double value) {
+        assert(S);
+        double sum = S->sum;
+        uint64_t samples = S->samples;
+        S->sum += value;
+        S->samples++;
+        for (int i = 0; i < 3; i++) {
+                Ring_T *R = &(S->ring[i]);
+                uint32_t slot = (uint32_t)(time / 1000 / R->resolution);
+                if (! R->current || slot > R->current)
+                        _advance(R, slot, sum, samples);
+                // Samples older than the current bucket (time jumped backward) are accounted to the current bucket
+                Bucket_T *b = &(R->bucket[R->current % R->size]);
+                if (! b->count || value < b->minimum)
+                        b->minimum = value;
+                if (! b->count || value > b->maximum)
+                        b->maximum = value;
+                b->count++;
+                b->sum = S->sum;
+                b->samples = S->samples;
+        }
+}
+
+
+uint64_t Series_count(T S, uint64_t time, int range) {
+        assert(S);
+        Ring_T *R;
+        uint32_t start, end;
+        if (_window(S, time, range, &R, &start, &end))
+                return R->bucket[end % R->size].samples - R->bucket[start % R->size].samples;
+        return 0ULL;
+}
+
+
+boolean_t Series_average(T S, uint64_t time, int range, double *result) {
+        assert(S);
+        assert(result);
+        Ring_T *R;
+        uint32_t start, end;
+        if (_window(S, time, range, &R, &start, &end)) {
+                Bucket_T *first = &(R->bucket[start % R->size]);
+                Bucket_T *last = &(R->bucket[end % R->size]);
+                if (last->samples > first->samples) {
+                        *result = (last->sum - first->sum) / (double)(last->samples - first->samples);
+                        return true;
+                }
+        }
+        return false;
+}
+
+
+boolean_t Series_minimum(T S, uint64_t time, int range, double *result) {
+        assert(S);
+        assert(result);
+        return _extreme(S, time, range, false, result);
+}
+
+
+boolean_t Series_maximum(T S, uint64_t time, int range, double *result) {
+        assert(S);
+        assert(result);
+        return _extreme(S, time, range, true, result);
+}
+
+
+void Series_reset(T S) {
+        assert(S);
+        S->sum = 0.;
+        S->samples = 0ULL;
+        for (int i = 0; i < 3; i++)
+                S->ring[i].current = 0;
+}
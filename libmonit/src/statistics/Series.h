@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.  
+ */
+
+
+#ifndef SERIES_INCLUDED
+#define SERIES_INCLUDED
+
+
+/**
+ * A <b>Series</b> is a fixed size time series store for one metric. The
+ * samples are not stored individually, but aggregated into three rings of
+ * buckets with 1 minute, 1 hour and 1 day resolution, covering the last
+ * hour, day and month respectively. Each bucket holds the minimum, maximum
+ * and sample count of the given interval and the running sum of all samples
+ * up to and including the bucket, so the average for any window can be
+ * computed in constant time from two buckets. The minimum and maximum are
+ * computed from the bucket aggregates (at most 60 buckets), the samples are
+ * never rescanned.
+ *
+ * The memory used by a Series object is constant (less than 4kB) regardless
+ * of the sampling frequency.
+ *
+ * This class is reentrant but not thread-safe
+ *
+ * @author http://www.tildeslash.com/
+ * @see http://www.mmonit.com/
+ * @file
+ */
+
+
+#define T Series_T
+typedef struct T *T;
+
+
+/** The longest window supported by the Series [s] */
+#define SERIES_MAX_RANGE (30 * 86400)
+
+
+/**
+ * Create a new Series object.
+ * @return A Series object
+ * @exception MemoryException if allocation failed
+ */
+T Series_new(void);
+
+
+/**
+ * Destroy a Series object and release allocated resources.
+ * @param S A Series object reference
+ */
+void Series_free(T *S);
+
+
+/**
+ * Add a sample to the Series
+ * @param S A Series object
+ * @param time The sample timestamp [ms]
+ * @param value The sample value
+ */
+void Series_add(T S, uint64_t time, double value);
+
+
+/**
+ * Get the number of samples in the given window. The window ends at
+ * <code>time</code> and is rounded up to the resolution of the ring
+ * which covers it (1 minute for windows up to 1 hour, 1 hour for windows
+ * up to 1 day and 1 day for longer windows)
+ * @param S A Series object
+ * @param time The window end [ms]
+ * @param range The window length [s]
+ * @return The number of samples in the window
+ */
+uint64_t Series_count(T S, uint64_t time, int range);
+
+
+/**
+ * Get the average of the samples in the given window
+ * @param S A Series object
+ * @param time The window end [ms]
+ * @param range The window length [s]
+ * @param result The average (output)
+ * @return true if the window contains samples, otherwise false
+ */
+boolean_t Series_average(T S, uint64_t time, int range, double *result);
+
+
+/**
+ * Get the minimum of the samples in the given window
+ * @param S A Series object
+ * @param time The window end [ms]
+ * @param range The window length [s]
+ * @param result The minimum (output)
+ * @return true if the window contains samples, otherwise false
+ */
+boolean_t Series_minimum(T S, uint64_t time, int range, double *result);
+
+
+/**
+ * Get the maximum of the samples in the given window
+ * @param S A Series object
+ * @param time The window end [ms]
+ * @param range The window length [s]
+ * @param result The maximum (output)
+ * @return true if the window contains samples, otherwise false
+ */
+boolean_t Series_maximum(T S, uint64_t time, int range, double *result);
+
+
+/**
+ * Remove all samples from the Series
+ * @param S A Series object
+ */
+void Series_reset(T S);
+
+
+#undef T
+#endif
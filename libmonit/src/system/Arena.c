@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.  
+ */
+
+
+
+#include "Config.h"
+
+#include <string.h>
+
+#include "Arena.h"
+
+
+/**
+ * Implementation of the Arena interface. The arena is a list of chunks,
+ * the allocation is served from the head chunk. Requests which do not fit
+ * in the head chunk get a new head chunk which is at least twice as big
+ * as the previous one.
+ *
+ * @author http://www.tildeslash.com/
+ * @see http://www.mmonit.com/
+ * @file
+ */
+
+
+/* ------------------------------------------------------------- Definitions */
+
+
+#define T Arena_T
+
+
+#define DEFAULT_SIZE 8192
+
+
+// The most restrictive alignment of the basic types
+union align {
+        long l;
+        long long ll;
+        double d;
+        long double ld;
+        void *p;
+        void (*f)(void);
+};
+
+
+#define ALIGNMENT ((long)sizeof(union align))
+#define ALIGN(n) (((n) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+
+
+typedef struct Chunk_T {
+        struct Chunk_T *next;
+        long size;                            // Usable size of the chunk
+        long used;
+        union align data[];
+} *Chunk_T;
+
+
+struct T {
+        long size;                            // Minimum chunk size
+        long used;                            // Bytes used in the previous chunks
+        Chunk_T chunk;                        // Head chunk
+};
+
+
+/* ----------------------------------------------------------------- Private */
+
+
+static Chunk_T _chunk(long size, Chunk_T next) {
+        Chunk_T c = ALLOC(sizeof(struct Chunk_T) + size);
+        c->next = next;
+        c->size = size;
+        c->used = 0;
+        return c;
+}
+
+
+/* ----------------------------------------------------------------- Public */
+
+
+T Arena_new(long size) {
+        assert(size >= 0);
+        T A;
+        NEW(A);
+        A->size = size > 0 ? ALIGN(size) : DEFAULT_SIZE;
+        A->chunk = _chunk(A->size, NULL);
+        return A;
+}
+
+
+void Arena_free(T *A) {
+        assert(A && *A);
+        for (Chunk_T c = (*A)->chunk, next; c; c = next) {
+                next = c->next;
+                FREE(c);
+        }
+        FREE(*A);
+}
+
+
+void *Arena_alloc(T A, long size) {
+        assert(A);
+        assert(size > 0);
+        size = ALIGN(size);
+        Chunk_T c = A->chunk;
+        if (size > c->size - c->used) {
+                long chunk = c->size * 2;
+                A->used += c->used;
+                c = A->chunk = _chunk(chunk > size ? chunk : size, c);
+        }
+        void *p = (char *)c->data + c->used;
+        c->used += size;
+        return p;
+}
+
+
+void *Arena_calloc(T A, long count, long size) {
+        assert(count > 0);
+        assert(size > 0);
+        void *p = Arena_alloc(A, count * size);
+        memset(p, 0, count * size);
+        return p;
+}
+
+
+char *Arena_dup(T A, const char *s) {
+        if (s) {
+                size_t length = strlen(s) + 1;
+                return memcpy(Arena_alloc(A, length), s, length);
+        }
+        return NULL;
+}
+
+
+void Arena_reset(T A) {
+        assert(A);
+        Chunk_T c = A->chunk;
+        if (c->next) {
+                // More chunks were needed: replace them with one chunk which fits the whole content
+                long size = Arena_capacity(A);
+                for (Chunk_T next; c; c = next) {
+                        next = c->next;
+                        FREE(c);
+                }
+                c = A->chunk = _chunk(size, NULL);
+        }
+        c->used = 0;
+        A->used = 0;
+}
+
+
+long Arena_used(T A) {
+        assert(A);
+        return A->used + A->chunk->used;
+}
+
+
+long Arena_capacity(T A) {
+        assert(A);
+        long capacity = 0;
+        for (Chunk_T c = A->chunk; c; c = c->next)
+                capacity += c->size;
+        return capacity;
+}
+
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.  
+ */
+
+
+
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+
+/**
+ * An <b>Arena</b> is a region based allocator for short lived data. Memory
+ * is carved from large chunks by bumping a pointer and is never released
+ * individually, instead the whole arena is recycled at once with
+ * Arena_reset(). This fits data which is created and discarded together,
+ * such as the transient buffers of one poll cycle: the allocation is a few
+ * instructions and after the first cycle the arena's memory is reused, so
+ * no malloc or free is called at all in the steady state.
+ *
+ * When a chunk is exhausted, a new chunk is added. On reset, the chunks are
+ * merged into one chunk large enough for the peak usage seen so far, so the
+ * next cycle with similar usage fits into one chunk.
+ *
+ * Memory returned by the arena is aligned for any type and is valid until
+ * the arena is reset or freed. Pointers into the arena must not be passed
+ * to FREE or RESIZE.
+ *
+ * This class is reentrant but not thread-safe, use one arena per thread.
+ *
+ * @author http://www.tildeslash.com/
+ * @see http://www.mmonit.com/
+ * @file
+ */
+
+
+#define T Arena_T
+typedef struct T *T;
+
+
+/**
+ * Create a new Arena object.
+ * @param size The initial chunk size in bytes. If 0, a default size is used
+ * @return An Arena object
+ * @exception MemoryException if allocation failed
+ */
+T Arena_new(long size);
+
+
+/**
+ * Destroy an Arena object and release all memory allocated from it.
+ * @param A An Arena object reference
+ */
+void Arena_free(T *A);
+
+
+/**
+ * Allocate <code>size</code> bytes from the arena. The memory is not
+ * cleared.
+ * @param A An Arena object
+ * @param size Number of bytes to allocate
+ * @return A pointer to the allocated memory
+ * @exception MemoryException if allocation failed
+ * @exception AssertException if <code>size <= 0</code>
+ */
+void *Arena_alloc(T A, long size);
+
+
+/**
+ * Allocate <code>count</code> objects of <code>size</code> bytes each from
+ * the arena and clear the memory.
+ * @param A An Arena object
+ * @param count Number of objects to allocate
+ * @param size Object size in bytes
+ * @return A pointer to the allocated memory
+ * @exception MemoryException if allocation failed
+ * @exception AssertException if <code>count or size <= 0</code>
+ */
+void *Arena_calloc(T A, long count, long size);
+
+
+/**
+ * Copy the string <code>s</code> into the arena.
+ * @param A An Arena object
+ * @param s The string to copy
+ * @return A copy of <code>s</code> or NULL if <code>s</code> is NULL
+ * @exception MemoryException if allocation failed
+ */
+char *Arena_dup(T A, const char *s);
+
+
+/**
+ * Release all memory allocated from the arena at once. The memory is kept
+ * for reuse, all pointers obtained from the arena before the reset become
+ * invalid.
+ * @param A An Arena object
+ */
+void Arena_reset(T A);
+
+
+/**
+ * Get the number of bytes allocated from the arena since the last reset
+ * (including the alignment padding)
+ * @param A An Arena object
+ * @return The number of used bytes
+ */
+long Arena_used(T A);
+
+
+/**
+ * Get the capacity of the arena, i.e. the number of bytes held in chunks
+ * @param A An Arena object
+ * @return The arena capacity in bytes
+ */
+long Arena_capacity(T A);
+
+
+#undef T
+#endif
@@ -26,8 +26,10 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <errno.h>
 #include <ctype.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -37,6 +39,14 @@
 #include <pwd.h>
 #include <grp.h>
 
+#ifdef HAVE_SPAWN_H
+#include <spawn.h>
+#endif
+
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
 #include "Str.h"
 #include "Dir.h"
 #include "File.h"
@@ -62,6 +72,15 @@
 /* ----------------------------------------------------------- Definitions */
 
 
+#if defined HAVE_POSIX_SPAWN && defined HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP && defined POSIX_SPAWN_SETSID
+#define HAVE_SPAWN 1
+#endif
+
+
+// Interval for polling the sub-process exit if a pidfd is not available [ms]
+#define PROCESS_POLL_INTERVAL 100
+
+
 #define T Command_T
 struct T {
         uid_t uid;
@@ -82,6 +101,9 @@ struct Process_T {
         int stdin_pipe[2];
         int stdout_pipe[2];
         int stderr_pipe[2];
+        int pidfd;
+        boolean_t eof[2];
+        StringBuffer_T output;
         InputStream_T in;
         InputStream_T err;
         OutputStream_T out;
@@ -203,6 +225,38 @@ static void _closeParentPipes(Process_T P) {
 }
 
 
+/* Open a pidfd for the sub-process, it becomes readable when the sub-process
+ exits, so the exit can be waited for with poll() together with the pipes */
+static void _openPidfd(Process_T P) {
+#if defined LINUX && defined SYS_pidfd_open
+        P->pidfd = (int)syscall(SYS_pidfd_open, P->pid, 0);
+#endif
+}
+
+
+/* Read the available output of the sub-process from the given pipe into the
+ output buffer. Output exceeding limit is read and discarded, so the sub-process
+ never blocks on a full pipe */
+static void _readOutput(Process_T P, int pipe, int limit) {
+        ssize_t n;
+        char buf[4096];
+        int fd = pipe ? P->stderr_pipe[0] : P->stdout_pipe[0];
+        while (! P->eof[pipe]) {
+                if ((n = read(fd, buf, sizeof(buf))) > 0) {
+                        if (! P->output)
+                                P->output = StringBuffer_create(STRLEN);
+                        int room = limit - StringBuffer_length(P->output);
+                        if (room > 0)
+                                StringBuffer_appendBytes(P->output, buf, n < room ? (int)n : room);
+                } else if (n == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        P->eof[pipe] = true;
+                } else if (errno != EINTR) {
+                        break;
+                }
+        }
+}
+
+
 /* Close and destroy opened stdio streams */
 static void _closeStreams(Process_T P) {
         if (P->in) InputStream_free(&P->in);
@@ -228,6 +282,7 @@ static Process_T _Process_new(void) {
         Process_T P;
         NEW(P);
         P->status = -1;
+        P->pidfd = -1;
         return P;
 }
 
@@ -241,6 +296,10 @@ void Process_free(Process_T *P) {
         }
         _closeParentPipes(*P);
         _closeStreams(*P);
+        if ((*P)->pidfd >= 0)
+                close((*P)->pidfd);
+        if ((*P)->output)
+                StringBuffer_free(&(*P)->output);
         FREE(*P);
 }
 
@@ -335,6 +394,71 @@ InputStream_T Process_getErrorStream(Process_T P) {
 }
 
 
+boolean_t Process_collect(Process_T P, int limit, int timeout) {
+        assert(P);
+        return Process_collectAll(&P, 1, limit, timeout) > 0;
+}
+
+
+int Process_collectAll(Process_T P[], int count, int limit, int timeout) {
+        assert(P);
+        assert(count > 0);
+        return Process_collectAllOrReadable(P, count, limit, timeout, -1);
+}
+
+
+int Process_collectAllOrReadable(Process_T P[], int count, int limit, int timeout, int fd) {
+        assert(P || count == 0);
+        assert(count >= 0);
+        int exited;
+        long long deadline = Time_milli() + timeout;
+        struct pollfd *fds = CALLOC(count * 3 + 1, sizeof(struct pollfd));
+        while (true) {
+                int n = 0;
+                boolean_t pidfds = true;
+                exited = 0;
+                for (int i = 0; i < count; i++) {
+                        // Test the exit first, so the output written before the exit is read below
+                        boolean_t running = Process_exitStatus(P[i]) < 0;
+                        _readOutput(P[i], 0, limit);
+                        _readOutput(P[i], 1, limit);
+                        if (! running) {
+                                exited++;
+                                continue;
+                        }
+                        if (! P[i]->eof[0])
+                                fds[n++] = (struct pollfd){.fd = P[i]->stdout_pipe[0], .events = POLLIN};
+                        if (! P[i]->eof[1])
+                                fds[n++] = (struct pollfd){.fd = P[i]->stderr_pipe[0], .events = POLLIN};
+                        if (P[i]->pidfd >= 0)
+                                fds[n++] = (struct pollfd){.fd = P[i]->pidfd, .events = POLLIN};
+                        else
+                                pidfds = false;
+                }
+                long long remaining = deadline - Time_milli();
+                if (exited || remaining <= 0)
+                        break;
+                if (! pidfds && remaining > PROCESS_POLL_INTERVAL)
+                        remaining = PROCESS_POLL_INTERVAL;
+                if (fd >= 0)
+                        fds[n++] = (struct pollfd){.fd = fd, .events = POLLIN};
+                int r = poll(fds, n, (int)remaining);
+                if (r < 0 && errno == EINTR)
+                        break; // Interrupted by a signal
+                if (r > 0 && fd >= 0 && fds[n - 1].revents)
+                        break; // The descriptor is readable
+        }
+        FREE(fds);
+        return exited;
+}
+
+
+const char *Process_getOutput(Process_T P) {
+        assert(P);
+        return P->output ? StringBuffer_toString(P->output) : "";
+}
+
+
 void Process_terminate(Process_T P) {
         assert(P);
         kill(P->pid, SIGTERM);
@@ -483,10 +607,65 @@ List_T Command_getCommand(T C) {
 }
 
 
-/* The Execute function. Note that we use vfork() rather than fork. Vfork has
- a special semantic in that the child process runs in the parent address space
- until exec is called in the child. The child also run first and suspend the
- parent process until exec or exit is called */
+#ifdef HAVE_SPAWN
+/* Returns true if the sub-process can be created with posix_spawn() */
+static inline boolean_t _canSpawn(T C) {
+#ifndef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+        if (C->working_directory)
+                return false;
+#endif
+        return ! C->uid && ! C->gid;
+}
+
+
+/* Execute the program with posix_spawn(). Used when the sub-process doesn't
+ switch uid/gid, which posix_spawn cannot do. The file actions setup the stdio
+ pipes and close all other descriptors in one step, the attributes start a new
+ session and reset the signal mask and handlers. The only difference to the
+ vfork() path is that SIGHUP is reset to the default rather than ignored, the
+ sub-process has no controlling terminal after setsid anyway. Returns true if
+ the program was spawned, otherwise false and errno is set */
+static boolean_t _spawn(T C, Process_T P) {
+        int status;
+        posix_spawnattr_t attr;
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawnattr_init(&attr);
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+        if (C->working_directory)
+                posix_spawn_file_actions_addchdir_np(&actions, C->working_directory);
+#endif
+        posix_spawn_file_actions_adddup2(&actions, P->stdin_pipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, P->stdout_pipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, P->stderr_pipe[1], STDERR_FILENO);
+        posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+        sigset_t mask;
+        sigemptyset(&mask);
+        posix_spawnattr_setsigmask(&attr, &mask);
+        int signals[] = {SIGINT, SIGQUIT, SIGABRT, SIGTERM, SIGPIPE, SIGCHLD, SIGUSR1, SIGHUP};
+        for (int i = 0; i < (int)(sizeof(signals) / sizeof(signals[0])); i++)
+                sigaddset(&mask, signals[i]);
+        posix_spawnattr_setsigdefault(&attr, &mask);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+        status = posix_spawn(&P->pid, _args(C)[0], &actions, &attr, _args(C), _env(C));
+        posix_spawnattr_destroy(&attr);
+        posix_spawn_file_actions_destroy(&actions);
+        if (status != 0) {
+                errno = status;
+                return false;
+        }
+        P->uid = getuid();
+        P->gid = getgid();
+        return true;
+}
+#endif
+
+
+/* The Execute function. If the sub-process doesn't switch uid/gid and the
+ system supports it, posix_spawn() is used. Otherwise we use vfork() rather
+ than fork. Vfork has a special semantic in that the child process runs in the
+ parent address space until exec is called in the child. The child also run
+ first and suspend the parent process until exec or exit is called */
 Process_T Command_execute(T C) {
         assert(C);
         assert(_env(C));
@@ -494,6 +673,23 @@ Process_T Command_execute(T C) {
         volatile int exec_error = 0;
         Process_T P = _Process_new();
         _createPipes(P);
+#ifdef HAVE_SPAWN
+        if (_canSpawn(C)) {
+                boolean_t spawned = _spawn(C, P);
+                int error = spawned ? 0 : errno;
+                _setupParentPipes(P);
+                if (spawned) {
+                        _openPidfd(P);
+                } else {
+                        // The failed sub-process was reaped by posix_spawn already, just release the pipes
+                        ERROR("Command: '%s' failed to execute -- %s\n", _args(C)[0], System_getError(error));
+                        _closeParentPipes(P);
+                        FREE(P);
+                }
+                errno = error;
+                return P;
+        }
+#endif
         if ((P->pid = vfork()) < 0) {
                 ERROR("Command: fork failed -- %s\n", System_getLastError());
                 Process_free(&P);
@@ -536,8 +732,7 @@ Process_T Command_execute(T C) {
                 setsid(); // Loose controlling terminal
                 _setupChildPipes(P);
                 // Close all descriptors except stdio
-                for (int i = 3, descriptors = getdtablesize(); i < descriptors; i++)
-                        close(i);
+                System_closeDescriptors(3);
                 // Unblock any signals and reset signal handlers
                 sigset_t mask;
                 sigemptyset(&mask);
@@ -562,6 +757,8 @@ Process_T Command_execute(T C) {
         _setupParentPipes(P);
         if (exec_error != 0)
                 Process_free(&P);
+        else
+                _openPidfd(P);
         errno = exec_error;
         return P;
 }
@@ -343,7 +343,8 @@ int Link_isGetByAddressSupported() {
 
 
 void Link_update(T L) {
-        _updateCache();
+        if (L->resolve == _findInterfaceForAddress)
+                _updateCache(); // The address -> interface mapping is needed only for links created by address
         const char *interface = L->resolve(L->object);
         if (_update(L, interface))
                 _updateHistory(L);
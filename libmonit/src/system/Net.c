@@ -44,6 +44,9 @@
 #include <stdarg.h>
 #include <sys/uio.h>
 #include <sys/stat.h>
+#if defined LINUX && defined HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 #ifdef HAVE_STROPTS_H
 #include <stropts.h>
 #endif
@@ -139,6 +142,64 @@ ssize_t Net_write(int socket, const void *buffer, size_t size, time_t timeout) {
 }
 
 
+ssize_t Net_writev(int socket, const struct iovec *iov, int iovcnt, time_t timeout) {
+	ssize_t n = 0;
+        if (iovcnt > 0) {
+                do {
+                        n = writev(socket, iov, iovcnt);
+                } while (n == -1 && errno == EINTR);
+                if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        if ((timeout == 0) || (Net_canWrite(socket, timeout) == false))
+                                return 0;
+                        do {
+                                n = writev(socket, iov, iovcnt);
+                        } while (n == -1 && errno == EINTR);
+                }
+        }
+	return n;
+}
+
+
+ssize_t Net_sendfile(int socket, int fd, off_t *offset, size_t size, time_t timeout) {
+	ssize_t n = 0;
+        if (size > 0) {
+#if defined LINUX && defined HAVE_SYS_SENDFILE_H
+                do {
+                        n = sendfile(socket, fd, offset, size);
+                } while (n == -1 && errno == EINTR);
+                if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        if ((timeout == 0) || (Net_canWrite(socket, timeout) == false))
+                                return 0;
+                        do {
+                                n = sendfile(socket, fd, offset, size);
+                        } while (n == -1 && errno == EINTR);
+                }
+#else
+                char buffer[8192];
+                do {
+                        n = pread(fd, buffer, size < sizeof(buffer) ? size : sizeof(buffer), *offset);
+                } while (n == -1 && errno == EINTR);
+                if (n > 0) {
+                        // Write the whole block, so the file is not read twice
+                        ssize_t written = 0;
+                        while (written < n) {
+                                ssize_t w = Net_write(socket, buffer + written, n - written, timeout);
+                                if (w <= 0) {
+                                        if (written == 0)
+                                                return w;
+                                        break;
+                                }
+                                written += w;
+                        }
+                        n = written;
+                        *offset += n;
+                }
+#endif
+        }
+	return n;
+}
+
+
 int Net_shutdown(int socket, int how) {
         return (shutdown(socket, how) == 0);
 }
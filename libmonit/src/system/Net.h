@@ -27,6 +27,7 @@
 #define NET_INCLUDED
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 
 /**
@@ -110,6 +111,38 @@ ssize_t Net_read(int socket, void *buffer, size_t size, time_t timeout);
 ssize_t Net_write(int socket, const void *buffer, size_t size, time_t timeout);
 
 
+/**
+ * Write the <code>iovcnt</code> buffers described by <code>iov</code> to
+ * the <code>socket</code> with one system call (gather write). Like
+ * Net_write() a partial write is possible, the caller is responsible for
+ * writing the rest.
+ * @param socket the Socket to write to
+ * @param iov The buffers to write
+ * @param iovcnt Number of buffers in iov
+ * @param timeout Milliseconds to wait for data to be sent
+ * @return The number of bytes sent or -1 if an error occured.
+ */
+ssize_t Net_writev(int socket, const struct iovec *iov, int iovcnt, time_t timeout);
+
+
+/**
+ * Send up to <code>size</code> bytes from the file <code>fd</code>
+ * starting at <code>*offset</code> to the <code>socket</code>. Where
+ * supported, the data is copied by the kernel (sendfile) and never
+ * passes through user space, otherwise the file is read and written in
+ * blocks. The offset is advanced by the number of bytes sent and the
+ * file position of fd is not changed.
+ * @param socket the Socket to write to
+ * @param fd The file descriptor of a regular file to send
+ * @param offset The file offset to start at (updated)
+ * @param size Number of bytes to send
+ * @param timeout Milliseconds to wait for data to be sent
+ * @return The number of bytes sent, 0 at end of file or timeout or -1
+ * if an error occured.
+ */
+ssize_t Net_sendfile(int socket, int fd, off_t *offset, size_t size, time_t timeout);
+
+
 /**
  * Aborts a TCP a connection. That is, TCP discards any data still remaining
  * in the socket send buffer and sends an RST to the peer, not the normal 
@@ -171,6 +171,64 @@ InputStream_T Process_getErrorStream(T P);
 //@}
 
 
+/**
+ * Read the sub-process output and wait for its exit. Both the standard
+ * output and the error output of the sub-process are read continuously into
+ * an internal buffer as the data arrive, so the sub-process won't block on a
+ * full pipe. Output exceeding <code>limit</code> bytes is read and discarded.
+ * The exit is detected without polling where the system supports pidfd.
+ * Don't use this method together with Process_getInputStream() and
+ * Process_getErrorStream(), they read the same pipes.
+ * @param P A Process object
+ * @param limit Maximum size of the collected output in bytes
+ * @param timeout Maximum time to wait for the sub-process exit in
+ * milliseconds. If 0, only the available output is read
+ * @return true if the sub-process exited, false if it is still running
+ * after timeout or the wait was interrupted by a signal
+ * @see Process_getOutput()
+ */
+boolean_t Process_collect(T P, int limit, int timeout);
+
+
+/**
+ * Read the output of several sub-processes and wait until at least one of
+ * them exits. Works like Process_collect() for each of the sub-processes
+ * @param P An array of Process objects
+ * @param count Number of Process objects in the array
+ * @param limit Maximum size of the collected output per sub-process in bytes
+ * @param timeout Maximum time to wait in milliseconds
+ * @return The number of sub-processes which exited or 0 on timeout or if
+ * the wait was interrupted by a signal
+ */
+int Process_collectAll(T P[], int count, int limit, int timeout);
+
+
+/**
+ * Works like Process_collectAll(), but returns also as soon as the given
+ * file descriptor is readable. The descriptor is not read, the caller
+ * drains it. Used to wait for sub-processes and for a wakeup written to a
+ * pipe at the same time
+ * @param P An array of Process objects, may be NULL if count is 0
+ * @param count Number of Process objects in the array, may be 0 to wait
+ * for the descriptor only
+ * @param limit Maximum size of the collected output per sub-process in bytes
+ * @param timeout Maximum time to wait in milliseconds
+ * @param fd The file descriptor to watch or -1
+ * @return The number of sub-processes which exited or 0 on timeout, if
+ * the descriptor is readable or if the wait was interrupted by a signal
+ */
+int Process_collectAllOrReadable(T P[], int count, int limit, int timeout, int fd);
+
+
+/**
+ * Returns the sub-process output read by Process_collect(). The standard
+ * output and the error output are stored in the order they were read
+ * @param P A Process object
+ * @return The collected output or an empty string if there was no output
+ */
+const char *Process_getOutput(T P);
+
+
 /**
  * Destroy the sub-process. The sub-process is destroyed by sending
  * it a termination signal (SIGTERM)
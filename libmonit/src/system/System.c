@@ -29,6 +29,12 @@
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
 
 #include "Str.h"
 #include "system/System.h"
@@ -50,6 +56,45 @@ extern void(*_AbortHandler)(const char *error, va_list ap);
 extern void(*_ErrorHandler)(const char *error, va_list ap);
 
 
+/* ---------------------------------------------------------------- Private */
+
+
+#if ! defined HAVE_CLOSEFROM && defined LINUX && defined SYS_getdents64
+/* Close the descriptors listed in /proc/self/fd. The directory is read with
+ getdents64 into a stack buffer as opendir() would allocate memory. Closing
+ descriptors while reading the directory may skip entries, so the scan is
+ repeated until nothing was closed. Returns false if /proc is not available */
+static boolean_t _closeProcDescriptors(int lowfd) {
+        int dir = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir < 0)
+                return false;
+        boolean_t closed;
+        do {
+                closed = false;
+                long n;
+                char buffer[1024] __attribute__((aligned(8)));
+                while ((n = syscall(SYS_getdents64, dir, buffer, sizeof(buffer))) > 0) {
+                        for (long offset = 0; offset < n;) {
+                                // struct linux_dirent64: d_ino (8), d_off (8), d_reclen (2), d_type (1), d_name
+                                unsigned short reclen = *(unsigned short *)(buffer + offset + 16);
+                                const char *name = buffer + offset + 19;
+                                offset += reclen;
+                                int fd = 0;
+                                for (; *name >= '0' && *name <= '9'; name++)
+                                        fd = fd * 10 + *name - '0';
+                                if (*name || fd < lowfd || fd == dir)
+                                        continue;
+                                close(fd);
+                                closed = true;
+                        }
+                }
+        } while (closed && lseek(dir, 0, SEEK_SET) == 0);
+        close(dir);
+        return true;
+}
+#endif
+
+
 /* ---------------------------------------------------------------- Public */
 
 
@@ -85,3 +130,21 @@ void System_error(const char *e, ...) {
                 vfprintf(stderr, e, ap);
         va_end(ap);
 }
+
+
+void System_closeDescriptors(int lowfd) {
+#ifdef HAVE_CLOSEFROM
+        closefrom(lowfd);
+#else
+#ifdef SYS_close_range
+        if (syscall(SYS_close_range, (unsigned int)lowfd, ~0U, 0) == 0)
+                return;
+#endif
+#if defined LINUX && defined SYS_getdents64
+        if (_closeProcDescriptors(lowfd))
+                return;
+#endif
+        for (int i = lowfd, descriptors = getdtablesize(); i < descriptors; i++)
+                close(i);
+#endif
+}
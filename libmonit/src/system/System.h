@@ -68,4 +68,15 @@ void System_abort(const char *e, ...) __attribute__((format (printf, 1, 2)));
 void System_error(const char *e, ...) __attribute__((format (printf, 1, 2)));
 
 
+/**
+ * Close all descriptors greater or equal to <code>lowfd</code>. Uses
+ * closefrom(2), close_range(2) or the list of open descriptors in
+ * /proc/self/fd where available instead of calling close(2) for every
+ * possible descriptor up to the RLIMIT_NOFILE limit. The function does not
+ * allocate memory and can be called in a child process created with vfork()
+ * @param lowfd The lowest descriptor to close
+ */
+void System_closeDescriptors(int lowfd);
+
+
 #endif
@@ -251,6 +251,21 @@ char *Str_unescape(const char *charset, char *s) {
 }
 
 
+const char *Str_escapeJSON(unsigned char c) {
+        static const char *control[] = {
+                "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+                "\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+                "\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+                "\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"
+        };
+        switch (c) {
+                case '"':  return "\\\"";
+                case '\\': return "\\\\";
+                default:   return c < 0x20 ? control[c] : NULL;
+        }
+}
+
+
 int Str_isEqual(const char *a, const char *b) {
         if (a && b) {
                 while (*a && *b)
@@ -238,6 +238,20 @@ int Str_has(const char *charset, const char *s);
 char *Str_unescape(const char *charset, char *s);
 
 
+/**
+ * Returns the escape sequence of the character <code>c</code> in a JSON
+ * string. The quotation mark, the backslash and the control characters
+ * must be escaped, other characters are used as is. Example:
+ * <pre>
+ * Str_escapeJSON('\n') -> \n
+ * Str_escapeJSON('a') -> NULL
+ * </pre>
+ * @param c The character to escape
+ * @return The escape sequence or NULL if the character need not be escaped
+ */
+const char *Str_escapeJSON(unsigned char c);
+
+
 /**
  * Returns true if <i>a</i> equals <i>b</i>. The test is 
  * <i>case-insensitive</i> but depends on that all characters
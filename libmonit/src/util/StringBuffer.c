@@ -61,6 +61,16 @@ struct T {
 /* ---------------------------------------------------------------- Private */
 
 
+/* Make room for n more bytes plus the terminating NUL. The buffer grows geometrically, so appending is amortized O(1) */
+static inline void _ensure(T S, int n) {
+        if (S->used + n >= S->length) {
+                int length = S->length * 2;
+                S->length = length > S->used + n ? length : S->used + n + 1;
+                RESIZE(S->buffer, S->length);
+        }
+}
+
+
 static inline void _append(T S, const char *s, va_list ap) {
         va_list ap_copy;
         while (true) {
@@ -71,8 +81,54 @@ static inline void _append(T S, const char *s, va_list ap) {
                         S->used += n;
                         break;
                 }
-                S->length += STRLEN + n;
-                RESIZE(S->buffer, S->length);
+                _ensure(S, n);
+        }
+}
+
+
+static inline void _appendBytes(T S, const void *bytes, int length) {
+        _ensure(S, length);
+        memcpy(S->buffer + S->used, bytes, length);
+        S->used += length;
+        S->buffer[S->used] = 0;
+}
+
+
+/* Append the string s, the characters for which escape() returns a non NULL entity are replaced with the entity. Runs of plain characters are copied at once */
+static inline void _appendEscaped(T S, const char *s, const char *(*escape)(unsigned char c)) {
+        const char *start = s;
+        for (; *s; s++) {
+                const char *entity = escape(*s);
+                if (entity) {
+                        if (s > start)
+                                _appendBytes(S, start, (int)(s - start));
+                        _appendBytes(S, entity, (int)strlen(entity));
+                        start = s + 1;
+                }
+        }
+        if (s > start)
+                _appendBytes(S, start, (int)(s - start));
+}
+
+
+static const char *_escapeXML(unsigned char c) {
+        switch (c) {
+                case '<':  return "&lt;";
+                case '>':  return "&gt;";
+                case '&':  return "&amp;";
+                case '"':  return "&quot;";
+                case '\'': return "&apos;";
+                default:   return NULL;
+        }
+}
+
+
+static const char *_escapeHTML(unsigned char c) {
+        switch (c) {
+                case '<': return "&lt;";
+                case '>': return "&gt;";
+                case '&': return "&amp;";
+                default:  return NULL;
         }
 }
 
@@ -135,6 +191,68 @@ T StringBuffer_vappend(T S, const char *s, va_list ap) {
 }
 
 
+T StringBuffer_appendBytes(T S, const void *bytes, int length) {
+        assert(S);
+        assert(length >= 0);
+        if (bytes && length > 0)
+                _appendBytes(S, bytes, length);
+        return S;
+}
+
+
+T StringBuffer_appendString(T S, const char *s) {
+        assert(S);
+        if (STR_DEF(s))
+                _appendBytes(S, s, (int)strlen(s));
+        return S;
+}
+
+
+T StringBuffer_appendChar(T S, char c) {
+        assert(S);
+        _ensure(S, 1);
+        S->buffer[S->used++] = c;
+        S->buffer[S->used] = 0;
+        return S;
+}
+
+
+T StringBuffer_appendUInt(T S, unsigned long long n) {
+        assert(S);
+        char buf[24];
+        char *p = buf + sizeof(buf);
+        do {
+                *--p = '0' + n % 10;
+        } while (n /= 10);
+        _appendBytes(S, p, (int)(buf + sizeof(buf) - p));
+        return S;
+}
+
+
+T StringBuffer_appendEscapedXML(T S, const char *s) {
+        assert(S);
+        if (s)
+                _appendEscaped(S, s, _escapeXML);
+        return S;
+}
+
+
+T StringBuffer_appendEscapedHTML(T S, const char *s) {
+        assert(S);
+        if (s)
+                _appendEscaped(S, s, _escapeHTML);
+        return S;
+}
+
+
+T StringBuffer_appendEscapedJSON(T S, const char *s) {
+        assert(S);
+        if (s)
+                _appendEscaped(S, s, Str_escapeJSON);
+        return S;
+}
+
+
 int StringBuffer_replace(T S, const char *a, const char *b) {
         int n = 0;
         assert(S);
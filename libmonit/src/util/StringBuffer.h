@@ -97,6 +97,95 @@ T StringBuffer_append(T S, const char *s, ...) __attribute__((format (printf, 2,
 T StringBuffer_vappend(T S, const char *s, va_list ap);
 
 
+/**
+ * Append <code>length</code> bytes to the string buffer. Unlike
+ * StringBuffer_append() no format processing is done, so this is the fast
+ * path for constant strings and data of known length.
+ * @param S StringBuffer object
+ * @param bytes The bytes to append
+ * @param length The number of bytes to append
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendBytes(T S, const void *bytes, int length);
+
+
+/**
+ * Append the string <code>s</code> to the string buffer without format
+ * processing.
+ * @param S StringBuffer object
+ * @param s The string to append. If NULL, nothing is appended
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendString(T S, const char *s);
+
+
+/**
+ * Append the character <code>c</code> to the string buffer.
+ * @param S StringBuffer object
+ * @param c The character to append
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendChar(T S, char c);
+
+
+/**
+ * Append the decimal representation of the unsigned number <code>n</code>
+ * to the string buffer.
+ * @param S StringBuffer object
+ * @param n The number to append
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendUInt(T S, unsigned long long n);
+
+
+/**
+ * Append the string <code>s</code> to the string buffer with the XML
+ * special characters replaced with entities. Example:
+ * <pre>
+ * StringBuffer_appendEscapedXML(b, "a<b & 'c'") -> "a&lt;b &amp; &apos;c&apos;"
+ * </pre>
+ * @param S StringBuffer object
+ * @param s The string to append. If NULL, nothing is appended
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendEscapedXML(T S, const char *s);
+
+
+/**
+ * Append the string <code>s</code> to the string buffer with the HTML
+ * special characters <code><>&</code> replaced with entities. Example:
+ * <pre>
+ * StringBuffer_appendEscapedHTML(b, "<b>a & b</b>") -> "&lt;b&gt;a &amp; b&lt;/b&gt;"
+ * </pre>
+ * @param S StringBuffer object
+ * @param s The string to append. If NULL, nothing is appended
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendEscapedHTML(T S, const char *s);
+
+
+/**
+ * Append the string <code>s</code> to the string buffer escaped for use
+ * in a JSON string: the quotation mark, the backslash and the control
+ * characters are replaced with escape sequences. The enclosing quotation
+ * marks are not appended. Example:
+ * <pre>
+ * StringBuffer_appendEscapedJSON(b, "say \"hi\"\n") -> say \"hi\"\n
+ * </pre>
+ * @param S StringBuffer object
+ * @param s The string to append. If NULL, nothing is appended
+ * @return a reference to this StringBuffer
+ * @exception MemoryException if allocation was used and failed
+ */
+T StringBuffer_appendEscapedJSON(T S, const char *s);
+
+
 /**
  * Replace all occurences of <code>a</code> with <code>b</code>. Example: 
  * <pre>
@@ -0,0 +1,113 @@
+#include "Config.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "Bootstrap.h"
+#include "Str.h"
+#include "system/Arena.h"
+
+/**
+ * Arena.c unity tests.
+ */
+
+
+int main(void) {
+        Arena_T A = NULL;
+
+        Bootstrap(); // Need to initialize library
+
+        printf("============> Start Arena Tests\n\n");
+
+        printf("=> Test0: create and free arena\n");
+        {
+                A = Arena_new(0);
+                assert(A);
+                assert(Arena_used(A) == 0);
+                assert(Arena_capacity(A) > 0);
+                Arena_free(&A);
+                assert(A == NULL);
+        }
+        printf("=> Test0: OK\n\n");
+
+        printf("=> Test1: alignment\n");
+        {
+                A = Arena_new(1024);
+                for (int i = 1; i < 64; i++) {
+                        void *p = Arena_alloc(A, i);
+                        assert(((uintptr_t)p % sizeof(long double)) == 0);
+                        assert(((uintptr_t)p % sizeof(void *)) == 0);
+                        memset(p, 'x', i);
+                }
+                Arena_free(&A);
+        }
+        printf("=> Test1: OK\n\n");
+
+        printf("=> Test2: Arena_calloc() and Arena_dup()\n");
+        {
+                A = Arena_new(64);
+                int *n = Arena_calloc(A, 10, sizeof(int));
+                for (int i = 0; i < 10; i++)
+                        assert(n[i] == 0);
+                char *s = Arena_dup(A, "monit");
+                assert(Str_isEqual(s, "monit"));
+                assert(Arena_dup(A, NULL) == NULL);
+                Arena_free(&A);
+        }
+        printf("=> Test2: OK\n\n");
+
+        printf("=> Test3: grow past the chunk size\n");
+        {
+                A = Arena_new(128);
+                char *p[100];
+                for (int i = 0; i < 100; i++) {
+                        p[i] = Arena_alloc(A, 50);
+                        snprintf(p[i], 50, "string %d", i);
+                }
+                // Data in the older chunks must be intact
+                for (int i = 0; i < 100; i++) {
+                        char expected[50];
+                        snprintf(expected, sizeof(expected), "string %d", i);
+                        assert(Str_isEqual(p[i], expected));
+                }
+                assert(Arena_used(A) >= 100 * 50);
+                assert(Arena_capacity(A) >= Arena_used(A));
+                // Allocation bigger than twice the chunk
+                char *big = Arena_alloc(A, 100000);
+                memset(big, 'x', 100000);
+                assert(Arena_capacity(A) >= 100000);
+                Arena_free(&A);
+        }
+        printf("=> Test3: OK\n\n");
+
+        printf("=> Test4: Arena_reset()\n");
+        {
+                A = Arena_new(128);
+                void *first = Arena_alloc(A, 16);
+                Arena_reset(A);
+                assert(Arena_used(A) == 0);
+                // The memory is reused after reset
+                assert(Arena_alloc(A, 16) == first);
+                // Simulate a cycle which needs more chunks
+                for (int i = 0; i < 1000; i++)
+                        Arena_alloc(A, 32);
+                long peak = Arena_used(A);
+                Arena_reset(A);
+                assert(Arena_used(A) == 0);
+                long capacity = Arena_capacity(A);
+                assert(capacity >= peak);
+                // The next cycle with the same usage fits into the merged chunk and no new memory is needed
+                for (int i = 0; i < 1000; i++)
+                        Arena_alloc(A, 32);
+                assert(Arena_capacity(A) == capacity);
+                Arena_free(&A);
+        }
+        printf("=> Test4: OK\n\n");
+
+        printf("============> Arena Tests: OK\n\n");
+
+        return 0;
+}
@@ -4,9 +4,12 @@
 #include <assert.h>
 #include <string.h>
 #include <stdarg.h>
+#include <signal.h>
 #include <sys/wait.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pwd.h>
+#include <sys/resource.h>
 
 #include "Bootstrap.h"
 #include "Str.h"
@@ -23,6 +26,21 @@
 boolean_t timeout_called = false;
 
 
+/* Execute the command count times and return the average latency [us] of Command_execute */
+static long long spawnLatency(Command_T c, int count) {
+        long long total = 0;
+        for (int i = 0; i < count; i++) {
+                long long start = Time_micro();
+                Process_T P = Command_execute(c);
+                total += Time_micro() - start;
+                assert(P);
+                assert(Process_waitFor(P) == 0);
+                Process_free(&P);
+        }
+        return total / count;
+}
+
+
 static void onExec(Process_T P) {
         assert(P);
         char buf[STRLEN];
@@ -279,6 +297,115 @@ int main(void) {
         printf("=> Test12: OK\n\n");
 #endif
 
+        printf("=> Test13: descriptors are closed and spawn latency with a high descriptor limit\n");
+        {
+                struct rlimit limit;
+                assert(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+                if (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > 1048576)
+                        limit.rlim_max = 1048576;
+                limit.rlim_cur = limit.rlim_max;
+                setrlimit(RLIMIT_NOFILE, &limit);
+                int high = getdtablesize() - 1;
+                assert(dup2(STDOUT_FILENO, high) == high);
+                char script[STRLEN];
+                snprintf(script, sizeof(script), "if [ -e /dev/fd/%d ]; then echo open; else echo closed; fi", high);
+                Command_T c = Command_new("/bin/sh", "-c", script, NULL);
+                assert(c);
+                Process_T P = Command_execute(c);
+                assert(P);
+                char buf[STRLEN];
+                assert(InputStream_readLine(Process_getInputStream(P), buf, STRLEN));
+                assert(Str_isEqual(Str_chomp(buf), "closed"));
+                Process_free(&P);
+                Command_free(&c);
+                c = Command_new("/bin/sh", "-c", "exit 0", NULL);
+                printf("\tDescriptor limit %d: average spawn latency %lldus\n", high + 1, spawnLatency(c, 50));
+                struct passwd *nobody = getpwnam("nobody");
+                if (getuid() == 0 && nobody) {
+                        // Switching the uid forces the vfork() path
+                        Command_setUid(c, nobody->pw_uid);
+                        printf("\tDescriptor limit %d: average spawn latency with uid switch %lldus\n", high + 1, spawnLatency(c, 50));
+                }
+                Command_free(&c);
+                close(high);
+        }
+        printf("=> Test13: OK\n\n");
+
+        printf("=> Test14: collect output and wait for exit\n");
+        {
+                // The program writes more than the pipe capacity to both stdout and stderr, so it can exit only if the output is read continuously
+                Command_T c = Command_new("/bin/sh", "-c", "i=0; while [ $i -lt 2000 ]; do echo 0123456789012345678901234567890123456789012345678901234567890123456789; echo error 0123456789012345678901234567890123456789 >&2; i=$((i+1)); done; exit 3", NULL);
+                assert(c);
+                Process_T P = Command_execute(c);
+                assert(P);
+                long long start = Time_milli();
+                assert(Process_collect(P, 1024, 30000));
+                printf("\tProgram with large output exited after %lldms\n", Time_milli() - start);
+                assert(Process_exitStatus(P) == 3);
+                assert(strlen(Process_getOutput(P)) == 1024);
+                Process_free(&P);
+                Command_free(&c);
+                // Timeout
+                c = Command_new("/bin/sh", "-c", "echo hello; exec sleep 30", NULL);
+                assert(c);
+                P = Command_execute(c);
+                assert(P);
+                start = Time_milli();
+                assert(! Process_collect(P, 1024, 200));
+                long long elapsed = Time_milli() - start;
+                assert(elapsed >= 190 && elapsed < 5000);
+                assert(Str_isEqual(Process_getOutput(P), "hello\n"));
+                // Exit is detected as it happens
+                Process_terminate(P);
+                assert(Process_collect(P, 1024, 5000));
+                assert(Process_exitStatus(P) == SIGTERM);
+                Process_free(&P);
+                Command_free(&c);
+                // Several processes
+                Command_T fast = Command_new("/bin/sh", "-c", "echo fast", NULL);
+                Command_T slow = Command_new("/bin/sh", "-c", "exec sleep 30", NULL);
+                Process_T processes[] = {Command_execute(slow), Command_execute(fast)};
+                assert(processes[0] && processes[1]);
+                assert(Process_collectAll(processes, 2, 1024, 5000) == 1);
+                assert(Process_isRunning(processes[0]));
+                assert(Process_exitStatus(processes[1]) == 0);
+                assert(Str_isEqual(Process_getOutput(processes[1]), "fast\n"));
+                Process_free(&processes[0]);
+                Process_free(&processes[1]);
+                Command_free(&fast);
+                Command_free(&slow);
+        }
+        printf("=> Test14: OK\n\n");
+
+        printf("=> Test15: wait for sub-processes or a readable descriptor\n");
+        {
+                int wakeup[2];
+                assert(pipe(wakeup) == 0);
+                // Nothing to wait for but the descriptor: timeout
+                long long start = Time_milli();
+                assert(Process_collectAllOrReadable(NULL, 0, 1024, 200, wakeup[0]) == 0);
+                assert(Time_milli() - start >= 190);
+                // The descriptor interrupts the wait for a running sub-process
+                Command_T slow = Command_new("/bin/sh", "-c", "exec sleep 30", NULL);
+                Process_T P = Command_execute(slow);
+                assert(P);
+                assert(write(wakeup[1], "x", 1) == 1);
+                start = Time_milli();
+                assert(Process_collectAllOrReadable(&P, 1, 1024, 10000, wakeup[0]) == 0);
+                assert(Time_milli() - start < 5000);
+                assert(Process_isRunning(P));
+                char c;
+                assert(read(wakeup[0], &c, 1) == 1);
+                // The exit is still reported
+                Process_terminate(P);
+                assert(Process_collectAllOrReadable(&P, 1, 1024, 5000, wakeup[0]) == 1);
+                Process_free(&P);
+                Command_free(&slow);
+                close(wakeup[0]);
+                close(wakeup[1]);
+        }
+        printf("=> Test15: OK\n\n");
+
         printf("============> Command Tests: OK\n\n");
 
         return 0;
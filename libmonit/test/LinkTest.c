@@ -13,6 +13,7 @@
 #include "Thread.h"
 #include "system/Link.h"
 #include "File.h"
+#include "AssertException.h"
 
 /**
  * Link unit tests.
@@ -25,6 +26,43 @@ int main(int argc, char **argv) {
 
         printf("============> Start Link Tests\n\n");
 
+        printf("=> Test1: update the loopback interface statistics\n");
+        {
+                if (Link_isGetByAddressSupported()) {
+                        Link_T L = Link_createForAddress("127.0.0.1");
+                        Link_update(L);
+                        Link_update(L);
+                        printf("\tState: %d, bytes in: %lld, bytes out: %lld\n", Link_getState(L), Link_getBytesInTotal(L), Link_getBytesOutTotal(L));
+                        assert(Link_getState(L) == 1);
+                        assert(Link_getBytesInTotal(L) >= 0);
+                        assert(Link_getBytesOutTotal(L) >= 0);
+                        assert(Link_getErrorsInPerSecond(L) >= 0);
+                        Link_free(&L);
+                        assert(L == NULL);
+                } else {
+                        printf("\tLink by address is not supported on this platform, skipped\n");
+                }
+        }
+        printf("=> Test1: OK\n\n");
+
+        printf("=> Test2: update non-existent interface\n");
+        {
+                Link_T L = Link_createForInterface("nonexistent0");
+                TRY
+                {
+                        Link_update(L);
+                        printf("\tResult: the update should fail for non-existent interface\n");
+                        exit(1);
+                }
+                ELSE
+                {
+                        printf("\tResult: %s\n", Exception_frame.message);
+                }
+                END_TRY;
+                Link_free(&L);
+        }
+        printf("=> Test2: OK\n\n");
+
 
         printf("============> Link Tests: OK\n\n");
 
@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "Bootstrap.h"
 #include "Str.h"
@@ -25,6 +28,51 @@ int main(int argc, char **argv) {
 
         printf("============> Start Net Tests\n\n");
 
+        printf("=> Test1: gather write\n");
+        {
+                int s[2];
+                char buf[64] = {};
+                assert(socketpair(AF_UNIX, SOCK_STREAM, 0, s) == 0);
+                struct iovec iov[3] = {
+                        {.iov_base = "header\r\n", .iov_len = 8},
+                        {.iov_base = "", .iov_len = 0},
+                        {.iov_base = "body", .iov_len = 4}
+                };
+                assert(Net_writev(s[0], iov, 3, 1000) == 12);
+                assert(Net_read(s[1], buf, sizeof(buf) - 1, 1000) == 12);
+                assert(Str_isEqual(buf, "header\r\nbody"));
+                assert(Net_writev(s[0], iov, 0, 1000) == 0);
+                close(s[0]);
+                close(s[1]);
+        }
+        printf("=> Test1: OK\n\n");
+
+        printf("=> Test2: sendfile\n");
+        {
+                int s[2];
+                char buf[64] = {};
+                char path[] = "/tmp/NetTest.XXXXXX";
+                int fd = mkstemp(path);
+                assert(fd >= 0);
+                unlink(path);
+                assert(write(fd, "0123456789", 10) == 10);
+                assert(socketpair(AF_UNIX, SOCK_STREAM, 0, s) == 0);
+                off_t offset = 2;
+                assert(Net_sendfile(s[0], fd, &offset, 5, 1000) == 5);
+                assert(offset == 7);
+                assert(Net_read(s[1], buf, sizeof(buf) - 1, 1000) == 5);
+                assert(Str_isEqual(buf, "23456"));
+                // End of file
+                assert(Net_sendfile(s[0], fd, &offset, 100, 1000) == 3);
+                assert(Net_sendfile(s[0], fd, &offset, 100, 1000) == 0);
+                // The file position is not changed
+                assert(lseek(fd, 0, SEEK_CUR) == 10);
+                close(fd);
+                close(s[0]);
+                close(s[1]);
+        }
+        printf("=> Test2: OK\n\n");
+
 
         printf("============> Net Tests: OK\n\n");
 
@@ -0,0 +1,145 @@
+#include "Config.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "Bootstrap.h"
+#include "Series.h"
+
+/**
+ * Series.c unity tests.
+ */
+
+
+#define MINUTE 60000ULL
+#define HOUR   (60 * MINUTE)
+#define DAY    (24 * HOUR)
+#define START  (1500000000000ULL / DAY * DAY) // Aligned to a day, so the buckets are predictable
+
+
+int main(void) {
+        Series_T S = NULL;
+        double v;
+
+        Bootstrap(); // Need to initialize library
+
+        printf("============> Start Series Tests\n\n");
+
+        printf("=> Test0: create and empty series\n");
+        {
+                S = Series_new();
+                assert(S);
+                assert(! Series_average(S, START, 600, &v));
+                assert(! Series_minimum(S, START, 600, &v));
+                assert(! Series_maximum(S, START, 600, &v));
+                assert(Series_count(S, START, 600) == 0);
+                Series_free(&S);
+                assert(S == NULL);
+        }
+        printf("=> Test0: OK\n\n");
+
+        printf("=> Test1: one sample per minute, 10 minutes window\n");
+        {
+                S = Series_new();
+                // Values 1..60 in the minutes 0..59
+                for (int i = 0; i < 60; i++)
+                        Series_add(S, START + i * MINUTE, i + 1);
+                uint64_t now = START + 59 * MINUTE;
+                assert(Series_count(S, now, 600) == 10);
+                assert(Series_average(S, now, 600, &v));
+                assert(v == 55.5); // (51 + ... + 60) / 10
+                assert(Series_minimum(S, now, 600, &v) && v == 51.);
+                assert(Series_maximum(S, now, 600, &v) && v == 60.);
+                // Whole hour
+                assert(Series_count(S, now, 3600) == 60);
+                assert(Series_average(S, now, 3600, &v) && v == 30.5);
+                assert(Series_minimum(S, now, 3600, &v) && v == 1.);
+                Series_free(&S);
+        }
+        printf("=> Test1: OK\n\n");
+
+        printf("=> Test2: multiple samples per bucket\n");
+        {
+                S = Series_new();
+                for (int i = 0; i < 6; i++)
+                        Series_add(S, START + i * 10000ULL, i % 2 ? 10. : 20.);
+                assert(Series_count(S, START + 59000ULL, 60) == 6);
+                assert(Series_average(S, START + 59000ULL, 60, &v) && v == 15.);
+                assert(Series_minimum(S, START + 59000ULL, 60, &v) && v == 10.);
+                assert(Series_maximum(S, START + 59000ULL, 60, &v) && v == 20.);
+                Series_free(&S);
+        }
+        printf("=> Test2: OK\n\n");
+
+        printf("=> Test3: window without samples\n");
+        {
+                S = Series_new();
+                Series_add(S, START, 100.);
+                // The sample is 2 hours old, the last 10 minutes are empty
+                assert(! Series_average(S, START + 2 * HOUR, 600, &v));
+                assert(Series_count(S, START + 2 * HOUR, 600) == 0);
+                // ... but it is in the last 3 hours (hour ring)
+                assert(Series_average(S, START + 2 * HOUR, 3 * 3600, &v) && v == 100.);
+                Series_free(&S);
+        }
+        printf("=> Test3: OK\n\n");
+
+        printf("=> Test4: gap in sampling\n");
+        {
+                S = Series_new();
+                for (int i = 0; i < 5; i++)
+                        Series_add(S, START + i * MINUTE, 1.);
+                for (int i = 0; i < 5; i++)
+                        Series_add(S, START + HOUR + 30 * MINUTE + i * MINUTE, 3.);
+                uint64_t now = START + HOUR + 34 * MINUTE;
+                assert(Series_count(S, now, 600) == 5);
+                assert(Series_average(S, now, 600, &v) && v == 3.);
+                assert(Series_minimum(S, now, 3600, &v) && v == 3.);
+                // The hour ring still has both hours
+                assert(Series_count(S, now, 2 * 3600) == 10);
+                assert(Series_average(S, now, 2 * 3600, &v) && v == 2.);
+                assert(Series_minimum(S, now, 2 * 3600, &v) && v == 1.);
+                assert(Series_maximum(S, now, 2 * 3600, &v) && v == 3.);
+                Series_free(&S);
+        }
+        printf("=> Test4: OK\n\n");
+
+        printf("=> Test5: day ring and ring wrap\n");
+        {
+                S = Series_new();
+                // One sample per hour for 40 days, the value is the day number
+                for (int i = 0; i < 40 * 24; i++)
+                        Series_add(S, START + i * HOUR, i / 24);
+                uint64_t now = START + (40 * 24 - 1) * HOUR;
+                assert(Series_count(S, now, 86400) == 24);
+                assert(Series_average(S, now, 86400, &v) && v == 39.);
+                assert(Series_count(S, now, 7 * 86400) == 7 * 24);
+                assert(Series_minimum(S, now, 7 * 86400, &v) && v == 33.);
+                assert(Series_maximum(S, now, 7 * 86400, &v) && v == 39.);
+                assert(Series_count(S, now, 30 * 86400) == 30 * 24);
+                // Longer than supported
+                assert(! Series_average(S, now, SERIES_MAX_RANGE + 1, &v));
+                Series_free(&S);
+        }
+        printf("=> Test5: OK\n\n");
+
+        printf("=> Test6: Series_reset()\n");
+        {
+                S = Series_new();
+                Series_add(S, START, 5.);
+                Series_reset(S);
+                assert(! Series_average(S, START, 60, &v));
+                Series_add(S, START + MINUTE, 7.);
+                assert(Series_count(S, START + MINUTE, 600) == 1);
+                assert(Series_average(S, START + MINUTE, 600, &v) && v == 7.);
+                Series_free(&S);
+        }
+        printf("=> Test6: OK\n\n");
+
+        printf("============> Series Tests: OK\n\n");
+
+        return 0;
+}
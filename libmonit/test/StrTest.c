@@ -460,6 +460,17 @@ int main(void) {
         }
         printf("=> Test25: OK\n\n");
 
+        printf("=> Test26: Str_escapeJSON\n");
+        {
+                assert(Str_isEqual(Str_escapeJSON('"'), "\\\""));
+                assert(Str_isEqual(Str_escapeJSON('\\'), "\\\\"));
+                assert(Str_isEqual(Str_escapeJSON('\n'), "\\n"));
+                assert(Str_isEqual(Str_escapeJSON('\x01'), "\\u0001"));
+                assert(Str_escapeJSON('a') == NULL);
+                assert(Str_escapeJSON(0x80) == NULL);
+        }
+        printf("=> Test26: OK\n\n");
+
         printf("============> Str Tests: OK\n\n");
         return 0;
 }
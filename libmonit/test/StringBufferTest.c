@@ -373,6 +373,62 @@ int main(void) {
         }
         printf("=> Test15: OK\n\n");
 #endif
+
+        printf("=> Test16: append without format\n");
+        {
+                sb = StringBuffer_create(4);
+                StringBuffer_appendBytes(sb, "abcdef", 3);
+                StringBuffer_appendString(sb, "def");
+                StringBuffer_appendString(sb, NULL);
+                StringBuffer_appendString(sb, "");
+                StringBuffer_appendBytes(sb, NULL, 0);
+                StringBuffer_appendChar(sb, '-');
+                assert(Str_isEqual(StringBuffer_toString(sb), "abcdef-"));
+                assert(StringBuffer_length(sb) == 7);
+                StringBuffer_clear(sb);
+                StringBuffer_appendUInt(sb, 0);
+                StringBuffer_appendChar(sb, ' ');
+                StringBuffer_appendUInt(sb, 1234567890);
+                StringBuffer_appendChar(sb, ' ');
+                StringBuffer_appendUInt(sb, 18446744073709551615ULL);
+                assert(Str_isEqual(StringBuffer_toString(sb), "0 1234567890 18446744073709551615"));
+                // Mixed with the formatted append
+                StringBuffer_append(sb, "%s", "!");
+                StringBuffer_appendChar(sb, '?');
+                assert(Str_isEqual(StringBuffer_substring(sb, 33), "!?"));
+                StringBuffer_free(&sb);
+                // Geometric growth: many small appends
+                sb = StringBuffer_create(1);
+                for (int i = 0; i < 100000; i++)
+                        StringBuffer_appendChar(sb, 'a' + i % 26);
+                assert(StringBuffer_length(sb) == 100000);
+                assert(StringBuffer_toString(sb)[99999] == 'a' + 99999 % 26);
+                assert(StringBuffer_toString(sb)[100000] == 0);
+                StringBuffer_free(&sb);
+        }
+        printf("=> Test16: OK\n\n");
+
+        printf("=> Test17: append escaped\n");
+        {
+                sb = StringBuffer_create(8);
+                StringBuffer_appendEscapedXML(sb, "a<b & 'c' \"d\">");
+                assert(Str_isEqual(StringBuffer_toString(sb), "a&lt;b &amp; &apos;c&apos; &quot;d&quot;&gt;"));
+                StringBuffer_clear(sb);
+                StringBuffer_appendEscapedHTML(sb, "<b>a & 'b'</b>");
+                assert(Str_isEqual(StringBuffer_toString(sb), "&lt;b&gt;a &amp; 'b'&lt;/b&gt;"));
+                StringBuffer_clear(sb);
+                StringBuffer_appendEscapedHTML(sb, "plain");
+                StringBuffer_appendEscapedXML(sb, NULL);
+                StringBuffer_appendEscapedXML(sb, "&");
+                assert(Str_isEqual(StringBuffer_toString(sb), "plain&amp;"));
+                StringBuffer_clear(sb);
+                StringBuffer_appendEscapedJSON(sb, "a \"b\" \\ c\n\t\x01");
+                StringBuffer_appendEscapedJSON(sb, NULL);
+                assert(Str_isEqual(StringBuffer_toString(sb), "a \\\"b\\\" \\\\ c\\n\\t\\u0001"));
+                StringBuffer_free(&sb);
+        }
+        printf("=> Test17: OK\n\n");
+
         printf("============> StringBuffer Tests: OK\n\n");
 
         return 0;
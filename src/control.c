@@ -40,6 +40,10 @@
 #include <stdlib.h>
 #endif
 
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
@@ -75,29 +79,79 @@
 
 
 typedef enum {
-        Process_Stopped = 0,
-        Process_Started
-} __attribute__((__packed__)) Process_Status;
+        Job_Pending = 0,                   /**< Waiting for the required jobs */
+        Job_Execute,            /**< The start, stop or restart program runs */
+        Job_WaitStart,                    /**< Waiting for the process start */
+        Job_WaitStop,                      /**< Waiting for the process stop */
+        Job_Done
+} __attribute__((__packed__)) Job_Phase;
 
 
-#define RETRY_INTERVAL 100000 // 100ms
+/**
+ * Start, stop or restart of one service. The jobs of an action form a DAG
+ * following the service dependencies: a job runs as soon as the jobs it
+ * requires are done, so independent branches run in parallel. The jobs are
+ * advanced by the validation thread without blocking, while other services
+ * are validated
+ */
+typedef struct Job_T {
+        Service_T service;
+        Action_Type action;    /**< Action_Start, Action_Stop or Action_Restart */
+        Job_Phase phase;                                   /**< Job execution phase */
+        boolean_t unmonitor;       /**< Stop: disable monitoring when stopped */
+        boolean_t dependant;  /**< Stop: the service depends on the target, skip if not monitored */
+        boolean_t check;     /**< Start: check the started service (required by other service) */
+        boolean_t succeeded;                                        /**< Job result */
+        pid_t pid;                                /**< Stop: the process to wait for */
+        int interval;                    /**< Process start/stop test interval [ms] */
+        long long retry;                            /**< Next process start/stop test [ms] */
+        long long deadline;           /**< The program and process wait timeout [ms] */
+        command_t command;                           /**< The program to execute */
+        Process_T P;                                     /**< The running program */
+        struct Job_T *after;    /**< Job which must succeed first (e.g. parent start) */
+        struct Job_T **requires;        /**< Jobs which have to be done first */
+        int requiresCount;
+        struct Task_T *task;                      /**< The action task of the job */
+        struct Job_T *next;
+        char msg[STRLEN];                           /**< Program output or error */
+} *Job_T;
+
+
+/** A control action task: the jobs planned for one action request */
+typedef struct Task_T {
+        Service_T service;                               /**< The action target */
+        Action_Type action;
+        boolean_t report;     /**< Post the action event with the result when done */
+        boolean_t detached;        /**< Nobody waits for the result, free when done */
+        boolean_t conflict;   /**< Some service has an action of other task in flight */
+        boolean_t done;
+        boolean_t succeeded;
+        int pending;                                    /**< Number of unfinished jobs */
+        Job_T result;                      /**< The job whose result is the action result */
+        struct Task_T *next;
+} *Task_T;
+
+
+static struct {
+        Job_T jobs;                                              /**< Jobs in flight */
+        Task_T tasks;                                     /**< Tasks in flight */
+        boolean_t progress;  /**< The jobs are being advanced (actions triggered by events are only queued) */
+} executor;
+
+
+#define RETRY_INTERVAL 100      // Initial process start/stop test interval [ms]
+#define RETRY_INTERVAL_MAX 1000 // Maximum process start test interval [ms]
 
 
 /* ----------------------------------------------------------------- Private */
 
 
-static int _getOutput(InputStream_T in, char *buf, int buflen) {
-        InputStream_setTimeout(in, 0);
-        return InputStream_readBytes(in, buf, buflen - 1);
-}
-
-
-static int _commandExecute(Service_T S, command_t c, char *msg, int msglen, int64_t *timeout) {
+static Process_T _commandExecute(Service_T S, command_t c, char *msg, int msglen) {
         ASSERT(S);
         ASSERT(c);
         ASSERT(msg);
         msg[0] = 0;
-        int status = -1;
+        Process_T P = NULL;
         Command_T C = NULL;
         TRY
         {
@@ -110,7 +164,6 @@ static int _commandExecute(Service_T S, command_t c, char *msg, int msglen, int6
         }
         END_TRY;
         if (C) {
-                int64_t _timeoutMilli = *timeout / 1000.;
                 for (int i = 1; i < c->length; i++)
                         Command_appendArgument(C, c->arg[i]);
                 if (c->has_uid)
@@ -135,61 +188,29 @@ static int _commandExecute(Service_T S, command_t c, char *msg, int msglen, int6
                         default:
                                 break;
                 }
-                Process_T P = Command_execute(C);
+                if (! (P = Command_execute(C)))
+                        snprintf(msg, msglen, "Program %s failed: %s", c->arg[0], STRERROR);
                 Command_free(&C);
-                if (P) {
-                        do {
-                                Time_usleep(RETRY_INTERVAL);
-                                *timeout -= RETRY_INTERVAL;
-                        } while ((status = Process_exitStatus(P)) < 0 && *timeout > 0 && ! (Run.flags & Run_Stopped));
-                        if (*timeout <= 0)
-                                snprintf(msg, msglen, "Program '%s' timed out after %s", Util_commandDescription(c, (char[STRLEN]){}), Str_milliToTime(_timeoutMilli, (char[23]){}));
-                        int n, total = 0;
-                        char buf[STRLEN];
-                        do {
-                                if ((n = _getOutput(Process_getErrorStream(P), buf, sizeof(buf))) <= 0)
-                                        n = _getOutput(Process_getInputStream(P), buf, sizeof(buf));
-                                if (n > 0) {
-                                        buf[n] = 0;
-                                        DEBUG("%s", buf);
-                                        // Report the first message (override existing plain timeout message if some program output is available)
-                                        if (! total)
-                                                snprintf(msg, msglen, "'%s': %s%s", Util_commandDescription(c, (char[STRLEN]){}), *timeout <= 0 ? "Program timed out -- " : "", buf);
-                                        total += n;
-                                }
-                        } while (n > 0 && Run.debug && total < 2048); // Limit the debug output (if the program will have endless output, such as 'yes' utility, we have to stop at some point to not spin here forever)
-                        Process_free(&P); // Will kill the program if still running
-                }
         }
-        return status;
-}
-
-
-static Process_Status _waitProcessStart(Service_T s, int64_t *timeout) {
-        long wait = RETRY_INTERVAL;
-        do {
-                Time_usleep(wait);
-                pid_t pid = ProcessTree_findProcess(s);
-                if (pid) {
-                        ProcessTree_init(ProcessEngine_None);
-                        ProcessTree_updateProcess(s, pid);
-                        return Process_Started;
-                }
-                *timeout -= wait;
-                wait = wait < 1000000 ? wait * 2 : 1000000; // double the wait during each cycle until 1s is reached (ProcessTree_findProcess can be heavy and we don't want to drain power every 100ms on mobile devices)
-        } while (*timeout > 0 && ! (Run.flags & Run_Stopped));
-        return Process_Stopped;
+        return P;
 }
 
 
-static Process_Status _waitProcessStop(int pid, int64_t *timeout) {
-        do {
-                Time_usleep(RETRY_INTERVAL);
-                if (! pid || (getpgid(pid) == -1 && errno != EPERM))
-                        return Process_Stopped;
-                *timeout -= RETRY_INTERVAL;
-        } while (*timeout > 0 && ! (Run.flags & Run_Stopped));
-        return Process_Started;
+/* Collect the program result: returns the exit status or -1 if the program timed out, the program output is stored in the job message */
+static int _commandResult(Job_T job, boolean_t exited) {
+        int status = -1;
+        if (exited)
+                status = Process_exitStatus(job->P);
+        else
+                snprintf(job->msg, sizeof(job->msg), "Program '%s' timed out after %s", Util_commandDescription(job->command, (char[STRLEN]){}), Str_milliToTime(job->command->timeout, (char[23]){}));
+        const char *output = Process_getOutput(job->P);
+        if (*output) {
+                DEBUG("%s", output);
+                // Report the output (override existing plain timeout message if some program output is available)
+                snprintf(job->msg, sizeof(job->msg), "'%s': %s%s", Util_commandDescription(job->command, (char[STRLEN]){}), exited ? "" : "Program timed out -- ", output);
+        }
+        Process_free(&job->P); // Will kill the program if still running
+        return status;
 }
 
 
@@ -202,11 +223,7 @@ static State_Type _check(Service_T s) {
         rv = s->check(s);
         if (s->type == Service_Program && s->program->P) {
                 // check program executes the program and needs to be called again to collect the exit value and evaluate the status
-                int64_t timeout = s->program->timeout * USEC_PER_MSEC;
-                do {
-                        Time_usleep(RETRY_INTERVAL);
-                        timeout -= RETRY_INTERVAL;
-                } while (Process_exitStatus(s->program->P) < 0 && timeout > 0LL && ! (Run.flags & Run_Stopped));
+                Process_collect(s->program->P, Run.limits.programOutput, s->program->timeout);
                 rv = s->check(s);
         }
         s->mode = original;
@@ -214,135 +231,488 @@ static State_Type _check(Service_T s) {
 }
 
 
+/* ------------------------------------------------------------------ Jobs */
+
+
+/* Find the job of the service in the task. If the service has a job of other task in flight, the task is marked as conflicting */
+static Job_T _findJob(Task_T t, Service_T s, Action_Type action) {
+        for (Job_T job = executor.jobs; job; job = job->next) {
+                if (job->service == s) {
+                        if (job->task != t) {
+                                t->conflict = true;
+                                return NULL;
+                        }
+                        if (job->action == action || (action == Action_Start && job->action == Action_Restart))
+                                return job;
+                }
+        }
+        return NULL;
+}
+
+
+static Job_T _newJob(Task_T t, Service_T s, Action_Type action) {
+        Job_T job;
+        NEW(job);
+        job->service = s;
+        job->action = action;
+        job->task = t;
+        job->succeeded = true;
+        // Append: the jobs are started in the order of planning
+        Job_T *tail = &executor.jobs;
+        while (*tail)
+                tail = &(*tail)->next;
+        *tail = job;
+        t->pending++;
+        s->busy = true;
+        return job;
+}
+
+
+static void _require(Job_T job, Job_T required) {
+        if (job && required) {
+                RESIZE(job->requires, (job->requiresCount + 1) * sizeof(Job_T));
+                job->requires[job->requiresCount++] = required;
+        }
+}
+
+
+/* Release the jobs of the task */
+static void _freeJobs(Task_T t) {
+        for (Job_T *j = &executor.jobs; *j;) {
+                Job_T job = *j;
+                if (job->task == t) {
+                        *j = job->next;
+                        if (job->P)
+                                Process_free(&job->P);
+                        if (job->phase != Job_Done)
+                                job->service->busy = false;
+                        FREE(job->requires);
+                        FREE(job);
+                } else {
+                        j = &job->next;
+                }
+        }
+}
+
+
 /*
- * This is a post-fix recursive function for starting every service
- * that s depends on before starting s.
- * @param s A Service_T object
- * @return true if the service was started otherwise false
+ * Plan the start of the service and every service that s depends on which
+ * is not running. The start of s requires the start of the services it
+ * depends on.
  */
-static boolean_t _doStart(Service_T s) {
+static Job_T _planStart(Task_T t, Service_T s, boolean_t check) {
         ASSERT(s);
-        boolean_t rv = true;
-        StringBuffer_T sb = StringBuffer_create(64);
-        for (Dependant_T d = s->dependantlist; d; d = d->next ) {
-                Service_T parent = Util_getService(d->dependant);
-                ASSERT(parent);
-                if (parent->monitor != Monitor_Yes || parent->error) {
-                        if (_doStart(parent)) {
-                                State_Type state = _check(parent);
-                                if (state != State_Failed && state != State_Init)
-                                        continue;
+        Job_T job = _findJob(t, s, Action_Start);
+        if (! job && ! t->conflict) {
+                job = _newJob(t, s, Action_Start);
+                job->check = check;
+                for (Dependant_T d = s->dependantlist; d; d = d->next) {
+                        Service_T parent = d->service;
+                        ASSERT(parent);
+                        if (parent->monitor != Monitor_Yes || parent->error)
+                                _require(job, _planStart(t, parent, true));
+                }
+        }
+        return job;
+}
+
+
+/*
+ * Plan the stop of the services which depend on s (recursively): the given
+ * job requires the stop of all children, a child is stopped after its own
+ * children.
+ */
+static void _planStopDependants(Task_T t, Service_T s, Job_T job, boolean_t unmonitor) {
+        for (Service_T child = servicelist; child; child = child->next) {
+                for (Dependant_T d = child->dependantlist; d; d = d->next) {
+                        if (d->service == s) {
+                                child->doaction = Action_Ignored;
+                                Job_T stop = _findJob(t, child, Action_Stop);
+                                if (! stop && ! t->conflict) {
+                                        stop = _newJob(t, child, Action_Stop);
+                                        stop->unmonitor = unmonitor;
+                                        stop->dependant = true;
+                                        _planStopDependants(t, child, stop, unmonitor);
+                                }
+                                _require(job, stop);
+                                break;
                         }
-                        rv = false;
-                        StringBuffer_append(sb, "%s%s", StringBuffer_length(sb) ? ", " : "", parent->name);
                 }
         }
-        if (rv) {
-                if (s->start) {
-                        if (s->type != Service_Process || ! ProcessTree_findProcess(s)) {
-                                LogInfo("'%s' start: '%s'\n", s->name, Util_commandDescription(s->start, (char[STRLEN]){}));
-                                char msg[STRLEN];
-                                int64_t timeout = s->start->timeout * USEC_PER_MSEC;
-                                int status = _commandExecute(s, s->start, msg, sizeof(msg), &timeout);
-                                if (status < 0 || (s->type == Service_Process && _waitProcessStart(s, &timeout) != Process_Started)) {
-                                        Event_post(s, Event_Exec, State_Failed, s->action_EXEC, "failed to start (exit status %d) -- %s", status, *msg ? msg : "no output");
-                                        rv = false;
+}
+
+
+/*
+ * Plan the start of the services which depend on s (recursively) after the
+ * given job succeeded. Only monitored children are started (we keep the
+ * monitoring flag during restart, allowing to restore the original
+ * pre-restart configuration).
+ */
+static void _planStartDependants(Task_T t, Service_T s, Job_T job) {
+        for (Service_T child = servicelist; child; child = child->next) {
+                for (Dependant_T d = child->dependantlist; d; d = d->next) {
+                        if (d->service == s) {
+                                child->doaction = Action_Ignored;
+                                if (child->monitor == Monitor_Not) {
+                                        _planStartDependants(t, child, job);
                                 } else {
-                                        Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, "started");
+                                        Job_T start = _findJob(t, child, Action_Start);
+                                        if (start) {
+                                                _require(start, job);
+                                        } else if ((start = _planStart(t, child, false))) {
+                                                start->after = job;
+                                                _planStartDependants(t, child, start);
+                                        }
                                 }
+                                break;
                         }
-                } else {
-                        LogDebug("'%s' start method not defined\n", s->name);
-                        Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, "monitoring enabled");
                 }
-        } else {
-                Event_post(s, Event_Exec, State_Failed, s->action_EXEC, "failed to start -- could not start required services: '%s'", StringBuffer_toString(sb));
-                s->doaction = Action_Start; // Retry the start next cycle
         }
-        Util_monitorSet(s);
-        StringBuffer_free(&sb);
-        return rv;
 }
 
 
-static int _executeStop(Service_T s, char *msg, int msglen, int64_t *timeout) {
-        LogInfo("'%s' stop: '%s'\n", s->name, Util_commandDescription(s->stop, (char[STRLEN]){}));
-        return _commandExecute(s, s->stop, msg, msglen, timeout);
+static void _done(Job_T job, boolean_t succeeded) {
+        if (job->P)
+                Process_free(&job->P);
+        job->phase = Job_Done;
+        job->succeeded = succeeded;
+        job->service->busy = false;
+        job->task->pending--;
+}
+
+
+static void _execute(Job_T job, command_t command) {
+        job->command = command;
+        job->deadline = Time_milli() + command->timeout;
+        job->interval = RETRY_INTERVAL;
+        if ((job->P = _commandExecute(job->service, command, job->msg, sizeof(job->msg))))
+                job->phase = Job_Execute;
 }
 
 
-static void _evaluateStop(Service_T s, boolean_t succeeded, int exitStatus, char *msg) {
-        if (succeeded)
-                Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, "stopped");
+static void _startFailed(Job_T job, int status) {
+        if (job->action == Action_Restart)
+                Event_post(job->service, Event_Exec, State_Failed, job->service->action_EXEC, "failed to restart (exit status %d) -- %s", status, job->msg);
         else
-                Event_post(s, Event_Exec, State_Failed, s->action_EXEC, "failed to stop (exit status %d) -- %s", exitStatus, *msg ? msg : "no output");
+                Event_post(job->service, Event_Exec, State_Failed, job->service->action_EXEC, "failed to start (exit status %d) -- %s", status, *job->msg ? job->msg : "no output");
+        Util_monitorSet(job->service);
+        _done(job, false);
 }
 
 
-/*
- * This function simply stops the service s.
- * @param s A Service_T object
- * @param unmonitor true if the monitoring should be disabled or false if monitoring should continue (when stop is part of restart)
- * @return true if the service was stopped otherwise false
- */
-static boolean_t _doStop(Service_T s, boolean_t unmonitor) {
-        ASSERT(s);
-        boolean_t rv = true;
-        if (s->stop) {
-                if (s->monitor != Monitor_Not) {
-                        int exitStatus;
-                        char msg[STRLEN];
-                        int64_t timeout = s->stop->timeout * USEC_PER_MSEC;
-                        if (s->type == Service_Process) {
-                                int pid = ProcessTree_findProcess(s);
-                                if (pid) {
-                                        exitStatus = _executeStop(s, msg, sizeof(msg), &timeout);
-                                        rv = _waitProcessStop(pid, &timeout) == Process_Stopped ? true : false;
-                                        _evaluateStop(s, rv, exitStatus, msg);
-                                }
-                        } else {
-                                exitStatus = _executeStop(s, msg, sizeof(msg), &timeout);
-                                rv = exitStatus >= 0 ? true : false;
-                                _evaluateStop(s, rv, exitStatus, msg);
-                        }
-                }
-        } else {
-                LogDebug("'%s' stop skipped -- method not defined\n", s->name);
+static void _started(Job_T job) {
+        Service_T s = job->service;
+        Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, job->action == Action_Restart ? "restarted" : "started");
+        Util_monitorSet(s);
+        boolean_t succeeded = true;
+        if (job->check) {
+                // The service is required by other service: it must pass the check
+                State_Type state = _check(s);
+                succeeded = state != State_Failed && state != State_Init;
         }
-        if (unmonitor) {
+        _done(job, succeeded);
+}
+
+
+static void _stopped(Job_T job, boolean_t succeeded, boolean_t report, int exitStatus) {
+        Service_T s = job->service;
+        if (report) {
+                if (succeeded)
+                        Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, "stopped");
+                else
+                        Event_post(s, Event_Exec, State_Failed, s->action_EXEC, "failed to stop (exit status %d) -- %s", exitStatus, *job->msg ? job->msg : "no output");
+        }
+        if (job->unmonitor) {
                 Util_monitorUnset(s);
         } else {
                 Util_resetInfo(s);
                 s->monitor = Monitor_Init;
         }
-        return rv;
+        _done(job, succeeded);
 }
 
 
-/*
- * This function simply restarts the service s.
- * @param s A Service_T object
- */
-static boolean_t _doRestart(Service_T s) {
-        ASSERT(s);
-        boolean_t rv = true;
-        if (s->restart) {
-                LogInfo("'%s' restart: '%s'\n", s->name, Util_commandDescription(s->restart, (char[STRLEN]){}));
-                Util_resetInfo(s);
-                char msg[STRLEN];
-                int64_t timeout = s->restart->timeout * USEC_PER_MSEC;
-                int status = _commandExecute(s, s->restart, msg, sizeof(msg), &timeout);
-                if (status < 0 || (s->type == Service_Process && _waitProcessStart(s, &timeout) != Process_Started)) {
-                        rv = false;
-                        Event_post(s, Event_Exec, State_Failed, s->action_EXEC, "failed to restart (exit status %d) -- %s", status, msg);
+/* Start the job: the required jobs are done */
+static void _run(Job_T job) {
+        Service_T s = job->service;
+        switch (job->action) {
+                case Action_Start:
+                        if (! s->start) {
+                                LogDebug("'%s' start method not defined\n", s->name);
+                                Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, "monitoring enabled");
+                                Util_monitorSet(s);
+                                _done(job, true);
+                        } else if (s->type == Service_Process && ProcessTree_findProcess(s)) {
+                                Util_monitorSet(s);
+                                _done(job, true);
+                        } else {
+                                LogInfo("'%s' start: '%s'\n", s->name, Util_commandDescription(s->start, (char[STRLEN]){}));
+                                _execute(job, s->start);
+                                if (! job->P)
+                                        _startFailed(job, -1);
+                        }
+                        break;
+                case Action_Restart:
+                        LogInfo("'%s' restart: '%s'\n", s->name, Util_commandDescription(s->restart, (char[STRLEN]){}));
+                        Util_resetInfo(s);
+                        _execute(job, s->restart);
+                        if (! job->P)
+                                _startFailed(job, -1);
+                        break;
+                case Action_Stop:
+                        if (job->dependant && s->monitor == Monitor_Not) {
+                                _done(job, true);
+                        } else if (! s->stop) {
+                                LogDebug("'%s' stop skipped -- method not defined\n", s->name);
+                                _stopped(job, true, false, 0);
+                        } else if (s->monitor == Monitor_Not) {
+                                _stopped(job, true, false, 0);
+                        } else {
+                                if (s->type == Service_Process && ! (job->pid = ProcessTree_findProcess(s))) {
+                                        _stopped(job, true, false, 0);
+                                        break;
+                                }
+                                LogInfo("'%s' stop: '%s'\n", s->name, Util_commandDescription(s->stop, (char[STRLEN]){}));
+                                _execute(job, s->stop);
+                                if (! job->P)
+                                        _stopped(job, false, true, -1);
+                        }
+                        break;
+                default:
+                        _done(job, false);
+                        break;
+        }
+}
+
+
+/* Test if the pending job can run: returns true if the job was started or cancelled */
+static boolean_t _schedule(Job_T job) {
+        if (job->after && job->after->phase != Job_Done)
+                return false;
+        for (int i = 0; i < job->requiresCount; i++)
+                if (job->requires[i]->phase != Job_Done)
+                        return false;
+        if (job->after && ! job->after->succeeded) {
+                // We can start children (2nd+ dependency level) only if the parent itself started; restart: enable monitoring of the service again to allow the restart retry in the next cycle up to timeout limit
+                if (job->after->service == job->service)
+                        Util_monitorSet(job->service);
+                _done(job, false);
+                return true;
+        }
+        StringBuffer_T failed = NULL;
+        for (int i = 0; i < job->requiresCount; i++) {
+                if (! job->requires[i]->succeeded) {
+                        if (! failed)
+                                failed = StringBuffer_create(64);
+                        StringBuffer_append(failed, "%s%s", StringBuffer_length(failed) ? ", " : "", job->requires[i]->service->name);
+                }
+        }
+        if (failed) {
+                if (job->action == Action_Start) {
+                        Event_post(job->service, Event_Exec, State_Failed, job->service->action_EXEC, "failed to start -- could not start required services: '%s'", StringBuffer_toString(failed));
+                        job->service->doaction = Action_Start; // Retry the start next cycle
+                        Util_monitorSet(job->service);
+                }
+                // Stop/restart this service only if all children which depend on it were stopped
+                _done(job, false);
+                StringBuffer_free(&failed);
+                return true;
+        }
+        _run(job);
+        return true;
+}
+
+
+/* The program of the job finished or timed out */
+static void _executed(Job_T job, boolean_t exited) {
+        int status = _commandResult(job, exited);
+        if (job->action == Action_Stop) {
+                if (job->service->type == Service_Process) {
+                        job->phase = Job_WaitStop;
+                        job->retry = Time_milli();
                 } else {
-                        Event_post(s, Event_Exec, State_Succeeded, s->action_EXEC, "restarted");
+                        _stopped(job, status >= 0, true, status);
                 }
+        } else if (status < 0) {
+                _startFailed(job, status);
+        } else if (job->service->type == Service_Process) {
+                job->phase = Job_WaitStart;
+                job->retry = Time_milli() + job->interval;
         } else {
-                LogDebug("'%s' restart skipped -- method not defined\n", s->name);
+                _started(job);
+        }
+}
+
+
+/* Test the processes of the jobs which wait for a process start or stop. The process of all services is looked up in one pass, so the process tree is built at most once */
+static void _testProcesses(long long now) {
+        int count = 0;
+        for (Job_T job = executor.jobs; job; job = job->next)
+                if (job->phase == Job_WaitStart && job->retry <= now)
+                        count++;
+        if (count) {
+                Job_T *jobs = CALLOC(count, sizeof(Job_T));
+                Service_T *services = CALLOC(count, sizeof(Service_T));
+                pid_t *pids = CALLOC(count, sizeof(pid_t));
+                count = 0;
+                for (Job_T job = executor.jobs; job; job = job->next) {
+                        if (job->phase == Job_WaitStart && job->retry <= now) {
+                                jobs[count] = job;
+                                services[count++] = job->service;
+                        }
+                }
+                ProcessTree_findProcesses(services, pids, count);
+                boolean_t updated = false;
+                for (int i = 0; i < count; i++) {
+                        if (pids[i]) {
+                                if (! updated) {
+                                        ProcessTree_init(ProcessEngine_None);
+                                        updated = true;
+                                }
+                                ProcessTree_updateProcess(services[i], pids[i]);
+                                _started(jobs[i]);
+                        } else if (now >= jobs[i]->deadline || (Run.flags & Run_Stopped)) {
+                                _startFailed(jobs[i], 0);
+                        } else {
+                                // Double the wait during each test until 1s is reached (ProcessTree_findProcess can be heavy and we don't want to drain power every 100ms on mobile devices)
+                                jobs[i]->interval = jobs[i]->interval < RETRY_INTERVAL_MAX ? jobs[i]->interval * 2 : RETRY_INTERVAL_MAX;
+                                jobs[i]->retry = now + jobs[i]->interval < jobs[i]->deadline ? now + jobs[i]->interval : jobs[i]->deadline;
+                        }
+                }
+                FREE(pids);
+                FREE(services);
+                FREE(jobs);
+        }
+        for (Job_T job = executor.jobs; job; job = job->next) {
+                if (job->phase == Job_WaitStop && job->retry <= now) {
+                        if (getpgid(job->pid) == -1 && errno != EPERM)
+                                _stopped(job, true, true, 0);
+                        else if (now >= job->deadline || (Run.flags & Run_Stopped))
+                                _stopped(job, false, true, 0);
+                        else
+                                job->retry = now + RETRY_INTERVAL;
+                }
         }
-        Util_monitorSet(s);
-        return rv;
+}
+
+
+static void _complete(Task_T t) {
+        t->done = true;
+        t->succeeded = t->result && t->result->succeeded;
+        _freeJobs(t);
+        for (Task_T *q = &executor.tasks; *q; q = &(*q)->next) {
+                if (*q == t) {
+                        *q = t->next;
+                        break;
+                }
+        }
+        if (t->report) {
+                Event_post(t->service, Event_Action, State_Changed, t->service->action_ACTION, "%s action %s", actionnames[t->action], t->succeeded ? "done" : "failed");
+                FREE(t->service->token);
+        }
+        if (t->detached)
+                FREE(t);
+}
+
+
+/* Advance the jobs in flight without blocking */
+static void _progress() {
+        if (executor.progress)
+                return;
+        executor.progress = true;
+        boolean_t changed;
+        do {
+                changed = false;
+                long long now = Time_milli();
+                for (Job_T job = executor.jobs; job; job = job->next) {
+                        if (job->phase == Job_Pending) {
+                                changed |= _schedule(job);
+                        } else if (job->phase == Job_Execute) {
+                                if (Process_collect(job->P, Run.debug ? 2048 : (int)sizeof(job->msg), 0)) {
+                                        _executed(job, true);
+                                        changed = true;
+                                } else if (now >= job->deadline || (Run.flags & Run_Stopped)) {
+                                        _executed(job, false);
+                                        changed = true;
+                                }
+                        }
+                }
+                _testProcesses(now);
+                for (Task_T t = executor.tasks, next; t; t = next) {
+                        next = t->next;
+                        if (! t->pending) {
+                                _complete(t);
+                                changed = true;
+                        }
+                }
+        } while (changed);
+        executor.progress = false;
+}
+
+
+/* Wait up to timeout milliseconds for an event of the jobs in flight */
+static void _wait(int timeout) {
+        int interval = control_interval();
+        if (interval >= 0 && interval < timeout)
+                timeout = interval;
+        int count = control_programs(NULL, 0);
+        if (count) {
+                Process_T *P = CALLOC(count, sizeof(Process_T));
+                control_programs(P, count);
+                Process_collectAll(P, count, Run.debug ? 2048 : STRLEN, timeout);
+                FREE(P);
+        } else if (timeout > 0) {
+                Time_usleep(timeout * 1000L);
+        }
+}
+
+
+static Task_T _submit(Service_T s, Action_Type A, boolean_t report) {
+        Task_T t;
+        NEW(t);
+        t->service = s;
+        t->action = A;
+        t->report = report;
+        t->next = executor.tasks;
+        executor.tasks = t;
+        if (s->busy) {
+                t->conflict = true;
+        } else {
+                switch (A) {
+                        case Action_Start:
+                                t->result = _planStart(t, s, false);
+                                break;
+                        case Action_Stop:
+                                // Stop this service only if all children which depend on it were stopped
+                                t->result = _newJob(t, s, Action_Stop);
+                                t->result->unmonitor = true;
+                                _planStopDependants(t, s, t->result, true);
+                                break;
+                        case Action_Restart:
+                                LogInfo("'%s' trying to restart\n", s->name);
+                                // Restart this service only if all children that depend on it were stopped, start the children only if we successfully restarted
+                                if (s->restart) {
+                                        t->result = _newJob(t, s, Action_Restart);
+                                        _planStopDependants(t, s, t->result, false);
+                                } else {
+                                        Job_T stop = _newJob(t, s, Action_Stop);
+                                        _planStopDependants(t, s, stop, false);
+                                        if ((t->result = _planStart(t, s, false)))
+                                                t->result->after = stop;
+                                }
+                                _planStartDependants(t, s, t->result);
+                                break;
+                        default:
+                                break;
+                }
+        }
+        if (t->conflict) {
+                LogError("'%s' %s action skipped -- another action is in progress\n", s->name, actionnames[A]);
+                _freeJobs(t);
+                t->pending = 0;
+                t->result = NULL;
+        }
+        return t;
 }
 
 
@@ -354,7 +724,7 @@ static boolean_t _doRestart(Service_T s) {
 static void _doMonitor(Service_T s) {
         ASSERT(s);
         for (Dependant_T d = s->dependantlist; d; d = d->next ) {
-                Service_T parent = Util_getService(d->dependant);
+                Service_T parent = d->service;
                 ASSERT(parent);
                 _doMonitor(parent);
         }
@@ -363,66 +733,30 @@ static void _doMonitor(Service_T s) {
 
 
 /*
- * This is a function for disabling monitoring
+ * This is a function for disabling monitoring of s and all services which depend on s
  * @param s A Service_T object
  */
 static void _doUnmonitor(Service_T s) {
         ASSERT(s);
-        Util_monitorUnset(s);
-}
-
-
-/*
- * This is an in-fix recursive function for control of services that depend on s
- * @param s A Service_T object
- * @param action An action for the dependant services
- * @param unmonitor Disable service monitoring: used for stop action only to differentiate hard/soft stop - see _doStop()
- * @return true if all depending services were started/stopped otherwise false
- */
-static boolean_t _doDepend(Service_T s, Action_Type action, boolean_t unmonitor) {
-        ASSERT(s);
-        boolean_t rv = true;
         for (Service_T child = servicelist; child; child = child->next) {
                 for (Dependant_T d = child->dependantlist; d; d = d->next) {
-                        if (IS(d->dependant, s->name)) {
+                        if (d->service == s) {
                                 child->doaction = Action_Ignored;
-                                if (action == Action_Start) {
-                                        // (re)start children only if it's monitoring is enabled (we keep monitoring flag during restart, allowing to restore original pre-restart configuration)
-                                        if (child->monitor != Monitor_Not && ! _doStart(child))
-                                                rv = false;
-                                } else if (action == Action_Monitor) {
-                                        _doMonitor(child);
-                                }
-                                // We can start children of current child (2nd+ dependency level) only if the child itself started
-                                if (rv) {
-                                        if (! _doDepend(child, action, unmonitor)) {
-                                                rv = false;
-                                        } else {
-                                                // Stop this service only if all children stopped
-                                                if (action == Action_Stop && child->monitor != Monitor_Not) {
-                                                        if (! _doStop(child, unmonitor))
-                                                                rv = false;
-                                                } else if (action == Action_Unmonitor) {
-                                                        _doUnmonitor(child);
-                                                }
-                                        }
-                                }
+                                _doUnmonitor(child);
                                 break;
                         }
                 }
         }
-        return rv;
+        Util_monitorUnset(s);
 }
 
 
-
-
 /* ------------------------------------------------------------------ Public */
 
 
 /**
  * Apply given action to the services list.
- * @param services A services list
+ * @param services A services list (service names or wildcard patterns)
  * @param action A string describing the action to execute
  * @return number of errors
  */
@@ -435,9 +769,25 @@ boolean_t control_service_string(List_T services, const char *action) {
                 return 1;
         }
         int errors = 0;
-        for (list_t s = services->head; s; s = s->next)
-                if (control_service(s->e, a) == false)
+        for (list_t s = services->head; s; s = s->next) {
+                const char *name = s->e;
+                if (strpbrk(name, "*?[")) {
+                        int found = 0;
+                        for (Service_T q = servicelist; q; q = q->next) {
+                                if (Util_matchService(q, name)) {
+                                        found++;
+                                        if (control_service(q->name, a) == false)
+                                                errors++;
+                                }
+                        }
+                        if (! found) {
+                                LogError("Service '%s' -- doesn't exist\n", name);
+                                errors++;
+                        }
+                } else if (control_service(name, a) == false) {
                         errors++;
+                }
+        }
         return errors;
 }
 
@@ -450,7 +800,6 @@ boolean_t control_service_string(List_T services, const char *action) {
  */
 boolean_t control_service(const char *S, Action_Type A) {
         Service_T s = NULL;
-        boolean_t rv = true;
         ASSERT(S);
         if (! (s = Util_getService(S))) {
                 LogError("Service '%s' -- doesn't exist\n", S);
@@ -459,33 +808,19 @@ boolean_t control_service(const char *S, Action_Type A) {
         s->doaction = Action_Ignored;
         switch (A) {
                 case Action_Start:
-                        rv = _doStart(s);
-                        break;
-
                 case Action_Stop:
-                        // Stop this service only if all children which depend on it were stopped
-                        if (_doDepend(s, Action_Stop, true))
-                                rv = _doStop(s, true);
-                        break;
-
                 case Action_Restart:
-                        LogInfo("'%s' trying to restart\n", s->name);
-                        // Restart this service only if all children that depend on it were stopped
-                        if (_doDepend(s, Action_Stop, false)) {
-                                if (s->restart) {
-                                        if ((rv = _doRestart(s)))
-                                                _doDepend(s, Action_Start, false); // Start children only if we successfully restarted
-                                } else {
-                                        if (_doStop(s, false)) {
-                                                if ((rv = _doStart(s))) // Only start if we successfully stopped
-                                                        _doDepend(s, Action_Start, false); // Start children only if we successfully started
-                                        } else {
-                                                /* enable monitoring of this service again to allow the restart retry in the next cycle up to timeout limit */
-                                                Util_monitorSet(s);
-                                        }
+                        {
+                                Task_T t = _submit(s, A, false);
+                                _progress();
+                                while (! t->done) {
+                                        _wait(RETRY_INTERVAL_MAX);
+                                        _progress();
                                 }
+                                boolean_t rv = t->succeeded;
+                                FREE(t);
+                                return rv;
                         }
-                        break;
 
                 case Action_Monitor:
                         /* We only enable monitoring of this service and all prerequisite services. Chain of services which depends on this service keeps its state */
@@ -494,7 +829,6 @@ boolean_t control_service(const char *S, Action_Type A) {
 
                 case Action_Unmonitor:
                         /* We disable monitoring of this service and all services which depends on it */
-                        _doDepend(s, Action_Unmonitor, false);
                         _doUnmonitor(s);
                         break;
 
@@ -502,6 +836,97 @@ boolean_t control_service(const char *S, Action_Type A) {
                         LogError("Service '%s' -- invalid action %d\n", S, A);
                         return false;
         }
-        return rv;
+        return true;
+}
+
+
+/**
+ * Schedule the action for the service. The start, stop and restart actions
+ * are executed in the background by control_progress(), other actions are
+ * executed immediately
+ * @param s A Service_T object
+ * @param A An action id describing the action to execute
+ * @param report true if the action event with the result should be posted
+ * when done (action requested by CLI or GUI)
+ */
+void control_schedule(Service_T s, Action_Type A, boolean_t report) {
+        ASSERT(s);
+        s->doaction = Action_Ignored;
+        switch (A) {
+                case Action_Start:
+                case Action_Stop:
+                case Action_Restart:
+                        _submit(s, A, report)->detached = true;
+                        _progress();
+                        break;
+
+                default:
+                        {
+                                boolean_t rv = control_service(s->name, A);
+                                if (report) {
+                                        Event_post(s, Event_Action, State_Changed, s->action_ACTION, "%s action %s", actionnames[A], rv ? "done" : "failed");
+                                        FREE(s->token);
+                                }
+                        }
+                        break;
+        }
+}
+
+
+/**
+ * Advance the start, stop and restart actions in progress without blocking
+ */
+void control_progress() {
+        _progress();
+}
+
+
+/**
+ * Get the start, stop and restart programs which are running
+ * @param P The array for the programs (output)
+ * @param size The array size
+ * @return The number of running programs (may be larger than size)
+ */
+int control_programs(Process_T P[], int size) {
+        int count = 0;
+        for (Job_T job = executor.jobs; job; job = job->next) {
+                if (job->phase == Job_Execute) {
+                        if (count < size)
+                                P[count] = job->P;
+                        count++;
+                }
+        }
+        return count;
+}
+
+
+/**
+ * Get the time until the actions in progress need control_progress() call,
+ * even if no program exits (process start/stop test or timeout)
+ * @return The time in milliseconds or -1 if no action waits
+ */
+int control_interval() {
+        long long retry = -1;
+        for (Job_T job = executor.jobs; job; job = job->next) {
+                long long next = job->phase == Job_Execute ? job->deadline : (job->phase == Job_WaitStart || job->phase == Job_WaitStop) ? job->retry : -1;
+                if (next >= 0 && (retry < 0 || next < retry))
+                        retry = next;
+        }
+        if (retry < 0)
+                return -1;
+        long long now = Time_milli();
+        return retry > now ? (int)(retry - now) : 0;
+}
+
+
+/**
+ * Wait for all actions in progress
+ */
+void control_finish() {
+        _progress();
+        while (executor.tasks) {
+                _wait(RETRY_INTERVAL_MAX);
+                _progress();
+        }
 }
 
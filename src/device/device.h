@@ -31,5 +31,14 @@ boolean_t Filesystem_getByMountpoint(Info_T inf, const char *path);
 boolean_t Filesystem_getByDevice(Info_T inf, const char *path);
 
 
+/**
+ * Get the type of the mounted filesystem with the given device id
+ * @param device The device id (st_dev of any file on the filesystem)
+ * @return The filesystem type or NULL if not found or not supported on
+ * this platform. The string is valid until the mount table changes
+ */
+const char *Filesystem_getTypeByDeviceId(dev_t device);
+
+
 #endif
 
@@ -270,3 +270,8 @@ boolean_t Filesystem_getByDevice(Info_T inf, const char *path) {
         return _getDevice(inf, path, _compareDevice);
 }
 
+
+const char *Filesystem_getTypeByDeviceId(dev_t device) {
+        return NULL;
+}
+
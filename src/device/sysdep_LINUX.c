@@ -70,6 +70,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_SYSMACROS_H
+#include <sys/sysmacros.h>
+#endif
+
 #include "monit.h"
 
 // libmonit
@@ -81,20 +85,102 @@
 /* ------------------------------------------------------------- Definitions */
 
 
-#define MOUNTS   "/proc/self/mounts"
-#define CIFSSTAT "/proc/fs/cifs/Stats"
-#define DISKSTAT "/proc/diskstats"
-#define NFSSTAT  "/proc/self/mountstats"
+#define MOUNTS    "/proc/self/mounts"
+#define MOUNTINFO "/proc/self/mountinfo"
+#define CIFSSTAT  "/proc/fs/cifs/Stats"
+#define DISKSTAT  "/proc/diskstats"
+#define NFSSTAT   "/proc/self/mountstats"
+
+
+/**
+ * Open addressing hash index with linear probing. The slots hold the index
+ * of the entry in the indexed table, the table is passed to the match
+ * callback
+ */
+typedef struct Index_T {
+        int size;                                            // Number of slots (power of 2)
+        int *slot;                        // Index to the entry table or -1 if empty
+} Index_T;
+
+
+/**
+ * The mount table is parsed once per mount table change and shared by all
+ * filesystem and file checks. The entries are indexed by mountpoint, device
+ * (both the name as listed in the mount table and the resolved path for
+ * device mapper symlinks) and device id (st_dev).
+ */
+typedef struct MountEntry_T {
+        char *device;                                   // Device as listed in the mount table
+        char *realDevice;                 // Device with resolved symlinks or NULL
+        char *mountpoint;
+        char *type;
+        char *options;
+        dev_t id;                          // Device id from mountinfo, 0 if unknown
+} MountEntry_T;
+
+
+/**
+ * The I/O statistics are read once per cycle for all devices of the given
+ * kind (block devices from /proc/diskstats, NFS mounts from
+ * /proc/self/mountstats and CIFS shares from /proc/fs/cifs/Stats) and
+ * shared by all filesystem checks. The times are in milliseconds, the
+ * fields which are not provided by the given source are false in flags.
+ */
+typedef struct DiskEntry_T {
+        char *name;                        // Block device name, NFS device or CIFS share
+        uint64_t readOperations;
+        uint64_t readBytes;
+        uint64_t readTime;
+        uint64_t writeOperations;
+        uint64_t writeBytes;
+        uint64_t writeTime;
+        uint64_t waitTime;
+        uint64_t runTime;
+        boolean_t hasTime;
+} DiskEntry_T;
+
+
+typedef struct DiskTable_T {
+        const char *path;
+        boolean_t (*parse)(struct DiskTable_T *table, FILE *f);
+        struct timeval cycle;      // Cycle for which the table was read (systeminfo.collected)
+        uint64_t timestamp;                              // When the table was read [ms]
+        int count;
+        int capacity;
+        DiskEntry_T *entries;
+        Index_T index;
+} DiskTable_T;
 
 
 static struct {
         int fd;                                    // /proc/self/mounts filedescriptor (needed for mount/unmount notification)
         int generation;                            // Increment each time the mount table is changed
-        boolean_t (*getBlockDiskActivity)(void *); // Disk activity callback: _getProcfsBlockDiskActivity (old kernels), _getSysfsBlockDiskActivity (new kernels)
-        boolean_t (*getCifsDiskActivity)(void *);  // Disk activity callback: _getCifsDiskActivity if /proc/fs/cifs/Stats is present, otherwise _getDummyDiskActivity
+        boolean_t cifs;                            // True if /proc/fs/cifs/Stats is present
 } _statistics = {};
 
 
+static struct {
+        int generation;                       // Mount table generation of this cache
+        uint64_t timestamp;       // When was the cache created (if notification is not available)
+        int count;
+        int capacity;
+        MountEntry_T *entries;
+        Index_T mountpoints;
+        Index_T devices;
+        Index_T ids;
+} _mounts = {};
+
+
+static boolean_t _parseBlockStatistics(DiskTable_T *table, FILE *f);
+static boolean_t _parseNfsStatistics(DiskTable_T *table, FILE *f);
+static boolean_t _parseCifsStatistics(DiskTable_T *table, FILE *f);
+
+
+static DiskTable_T _block = {.path = DISKSTAT, .parse = _parseBlockStatistics};
+static DiskTable_T _nfs = {.path = NFSSTAT, .parse = _parseNfsStatistics};
+static DiskTable_T _cifs = {.path = CIFSSTAT, .parse = _parseCifsStatistics};
+
+
 /* ----------------------------------------------------------------- Private */
 
 
@@ -120,210 +206,368 @@ static boolean_t _getDummyDiskActivity(void *_inf) {
 }
 
 
-static boolean_t _getCifsDiskActivity(void *_inf) {
-        Info_T inf = _inf;
-        FILE *f = fopen(CIFSSTAT, "r");
-        if (! f) {
-                LogError("Cannot open %s\n", CIFSSTAT);
-                return false;
+static unsigned int _hashDeviceId(dev_t id) {
+        uint64_t h = (uint64_t)id;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return (unsigned int)h;
+}
+
+
+static void _indexReset(Index_T *index, int count) {
+        int size = 16;
+        while (size < count * 2)
+                size <<= 1;
+        if (size != index->size) {
+                index->size = size;
+                RESIZE(index->slot, size * sizeof(int));
+        }
+        memset(index->slot, -1, size * sizeof(int));
+}
+
+
+/**
+ * Add the entry to the index unless an entry with the same key exists already
+ * (the first entry in the table wins, same as sequential lookup would)
+ */
+static void _indexAdd(Index_T *index, unsigned int hash, void *table, int entry, boolean_t (*match)(void *table, int entry, const void *key), const void *key) {
+        for (unsigned int i = hash & (index->size - 1); ; i = (i + 1) & (index->size - 1)) {
+                if (index->slot[i] == -1) {
+                        index->slot[i] = entry;
+                        return;
+                } else if (match(table, index->slot[i], key)) {
+                        return;
+                }
+        }
+}
+
+
+static int _indexFind(Index_T *index, unsigned int hash, void *table, boolean_t (*match)(void *table, int entry, const void *key), const void *key) {
+        if (index->size) {
+                for (unsigned int i = hash & (index->size - 1); index->slot[i] != -1; i = (i + 1) & (index->size - 1))
+                        if (match(table, index->slot[i], key))
+                                return index->slot[i];
+        }
+        return -1;
+}
+
+
+static boolean_t _matchMountpoint(void *table, int entry, const void *key) {
+        return IS(((MountEntry_T *)table)[entry].mountpoint, key);
+}
+
+
+static boolean_t _matchDevice(void *table, int entry, const void *key) {
+        MountEntry_T *e = &(((MountEntry_T *)table)[entry]);
+        // The device listed in the mount table can be a device mapper symlink (e.g. /dev/mapper/centos-root -> /dev/dm-1) ... match the device as is (support for NFS/CIFS/SSHFS/etc.) and the resolved path
+        return IS(e->device, key) || (e->realDevice && IS(e->realDevice, key));
+}
+
+
+static boolean_t _matchDeviceId(void *table, int entry, const void *key) {
+        return ((MountEntry_T *)table)[entry].id == *(const dev_t *)key;
+}
+
+
+static boolean_t _matchDiskName(void *table, int entry, const void *key) {
+        return IS(((DiskEntry_T *)table)[entry].name, key);
+}
+
+
+static MountEntry_T *_findMount(Index_T *index, unsigned int hash, boolean_t (*match)(void *table, int entry, const void *key), const void *key) {
+        int entry = _indexFind(index, hash, _mounts.entries, match, key);
+        return entry >= 0 ? &(_mounts.entries[entry]) : NULL;
+}
+
+
+static DiskEntry_T *_addDisk(DiskTable_T *table, const char *name) {
+        if (table->count == table->capacity) {
+                table->capacity = table->capacity ? table->capacity * 2 : 32;
+                RESIZE(table->entries, table->capacity * sizeof(DiskEntry_T));
         }
-        uint64_t now = Time_milli();
+        DiskEntry_T *e = &(table->entries[table->count++]);
+        *e = (DiskEntry_T){.name = Str_dup(name)};
+        return e;
+}
+
+
+static void _freeDisks(DiskTable_T *table) {
+        for (int i = 0; i < table->count; i++)
+                FREE(table->entries[i].name);
+        table->count = 0;
+}
+
+
+static boolean_t _parseBlockStatistics(DiskTable_T *table, FILE *f) {
         char line[PATH_MAX];
-        boolean_t found = false;
         while (fgets(line, sizeof(line), f)) {
-                if (! found) {
-                        int index;
-                        char name[PATH_MAX];
-                        if (sscanf(line, "%d) %1023s", &index, name) == 2 && IS(name, inf->filesystem->object.key)) {
-                                found = true;
-                        }
-                } else if (found) {
-                        char label1[256];
-                        char label2[256];
-                        uint64_t operations;
-                        uint64_t bytes;
-                        if (sscanf(line, "%255[^:]: %"PRIu64" %255[^:]: %"PRIu64, label1, &operations, label2, &bytes) == 4) {
-                                if (IS(label1, "Reads") && IS(label2, "Bytes")) {
-                                        Statistics_update(&(inf->filesystem->read.bytes), now, bytes);
-                                        Statistics_update(&(inf->filesystem->read.operations), now, operations);
-                                } else if (IS(label1, "Writes") && IS(label2, "Bytes")) {
-                                        Statistics_update(&(inf->filesystem->write.bytes), now, bytes);
-                                        Statistics_update(&(inf->filesystem->write.operations), now, operations);
-                                        break;
-                                }
-                        }
+                char name[256];
+                uint64_t v[11] = {};
+                // Kernels >= 2.6.25 list 11 statistics for all devices (kernels >= 4.18 and >= 5.5 append discard and flush statistics, which we don't use). Older kernels list only 4 statistics for partitions
+                int n = sscanf(line, " %*u %*u %255s %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64, name, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10]);
+                if (n == 12) {
+                        DiskEntry_T *e = _addDisk(table, name);
+                        e->readOperations = v[0];
+                        e->readBytes = v[2] * 512;
+                        e->readTime = v[3];
+                        e->writeOperations = v[4];
+                        e->writeBytes = v[6] * 512;
+                        e->writeTime = v[7];
+                        e->runTime = v[9];   // Time the device was busy
+                        e->waitTime = v[10]; // Time weighted by the number of requests in flight (includes the queue)
+                        e->hasTime = true;
+                } else if (n == 5) {
+                        DiskEntry_T *e = _addDisk(table, name);
+                        e->readOperations = v[0];
+                        e->readBytes = v[1] * 512;
+                        e->writeOperations = v[2];
+                        e->writeBytes = v[3] * 512;
                 }
         }
-        fclose(f);
         return true;
 }
 
 
-static boolean_t _getNfsDiskActivity(void *_inf) {
-        Info_T inf = _inf;
-        FILE *f = fopen(NFSSTAT, "r");
-        if (! f) {
-                LogError("Cannot open %s\n", NFSSTAT);
-                return false;
-        }
-        uint64_t now = Time_milli();
+static boolean_t _parseNfsStatistics(DiskTable_T *table, FILE *f) {
         char line[PATH_MAX];
-        char pattern[PATH_MAX];
-        boolean_t found = false;
-        snprintf(pattern, sizeof(pattern), "device %s ", inf->filesystem->object.device);
+        DiskEntry_T *e = NULL;
         while (fgets(line, sizeof(line), f)) {
-                if (! found && Str_startsWith(line, pattern)) {
-                        found = true;
-                } else if (found) {
+                char device[PATH_MAX];
+                char type[256];
+                if (Str_startsWith(line, "device ")) {
+                        e = (sscanf(line, "device %4095s mounted on %*s with fstype %255s", device, type) == 2 && Str_startsWith(type, "nfs")) ? _addDisk(table, device) : NULL;
+                } else if (e) {
                         char name[256];
                         uint64_t operations;
                         uint64_t bytesSent;
                         uint64_t bytesReceived;
+                        uint64_t queue;
+                        uint64_t rtt;
                         uint64_t time;
-                        if (sscanf(line, " %255[^:]: %"PRIu64" %*u %*u %"PRIu64 " %"PRIu64" %*u %*u %"PRIu64, name, &operations, &bytesSent, &bytesReceived, &time) == 5) {
+                        if (sscanf(line, " %255[^:]: %"PRIu64" %*u %*u %"PRIu64 " %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64, name, &operations, &bytesSent, &bytesReceived, &queue, &rtt, &time) == 7) {
                                 if (IS(name, "READ")) {
-                                        Statistics_update(&(inf->filesystem->time.read), now, time / 1000.); // us -> ms
-                                        Statistics_update(&(inf->filesystem->read.bytes), now, bytesReceived);
-                                        Statistics_update(&(inf->filesystem->read.operations), now, operations);
+                                        e->readOperations = operations;
+                                        e->readBytes = bytesReceived;
+                                        e->readTime = time / 1000; // us -> ms
+                                        e->waitTime += queue / 1000;
+                                        e->runTime += rtt / 1000;
+                                        e->hasTime = true;
                                 } else if (IS(name, "WRITE")) {
-                                        Statistics_update(&(inf->filesystem->time.write), now, time / 1000.); // us -> ms
-                                        Statistics_update(&(inf->filesystem->write.bytes), now, bytesSent);
-                                        Statistics_update(&(inf->filesystem->write.operations), now, operations);
-                                        break;
+                                        e->writeOperations = operations;
+                                        e->writeBytes = bytesSent;
+                                        e->writeTime = time / 1000; // us -> ms
+                                        e->waitTime += queue / 1000;
+                                        e->runTime += rtt / 1000;
+                                        e->hasTime = true;
                                 }
                         }
                 }
         }
-        fclose(f);
         return true;
 }
 
 
-static boolean_t _getSysfsBlockDiskActivity(void *_inf) {
-        Info_T inf = _inf;
-        char path[PATH_MAX];
-        snprintf(path, sizeof(path), "/sys/class/block/%s/stat", inf->filesystem->object.key);
-        FILE *f = fopen(path, "r");
-        if (f) {
-                uint64_t now = Time_milli();
-                uint64_t readOperations = 0ULL, readSectors = 0ULL, readTime = 0ULL;
-                uint64_t writeOperations = 0ULL, writeSectors = 0ULL, writeTime = 0ULL;
-                if (fscanf(f, "%"PRIu64" %*u %"PRIu64" %"PRIu64" %"PRIu64" %*u %"PRIu64" %"PRIu64" %*u %*u %*u", &readOperations, &readSectors, &readTime, &writeOperations, &writeSectors, &writeTime) != 6) {
-                        fclose(f);
-                        LogError("filesystem statistic error: cannot parse %s -- %s\n", path, STRERROR);
-                        return false;
+static boolean_t _parseCifsStatistics(DiskTable_T *table, FILE *f) {
+        char line[PATH_MAX];
+        DiskEntry_T *e = NULL;
+        while (fgets(line, sizeof(line), f)) {
+                int index;
+                char name[PATH_MAX];
+                char label1[256];
+                char label2[256];
+                uint64_t operations;
+                uint64_t bytes;
+                if (sscanf(line, "%d) %4095s", &index, name) == 2) {
+                        e = _addDisk(table, name);
+                } else if (e && sscanf(line, "%255[^:]: %"PRIu64" %255[^:]: %"PRIu64, label1, &operations, label2, &bytes) == 4) {
+                        if (IS(label1, "Reads") && IS(label2, "Bytes")) {
+                                e->readOperations = operations;
+                                e->readBytes = bytes;
+                        } else if (IS(label1, "Writes") && IS(label2, "Bytes")) {
+                                e->writeOperations = operations;
+                                e->writeBytes = bytes;
+                        }
                 }
-                Statistics_update(&(inf->filesystem->time.read), now, readTime);
-                Statistics_update(&(inf->filesystem->read.bytes), now, readSectors * 512);
-                Statistics_update(&(inf->filesystem->read.operations), now, readOperations);
-                Statistics_update(&(inf->filesystem->time.write), now, writeTime);
-                Statistics_update(&(inf->filesystem->write.bytes), now, writeSectors * 512);
-                Statistics_update(&(inf->filesystem->write.operations), now, writeOperations);
-                fclose(f);
+        }
+        return true;
+}
+
+
+/**
+ * Read the statistics table if it wasn't read in this cycle yet
+ */
+static boolean_t _updateDisks(DiskTable_T *table) {
+        if (table->timestamp && table->cycle.tv_sec == systeminfo.collected.tv_sec && table->cycle.tv_usec == systeminfo.collected.tv_usec)
                 return true;
+        FILE *f = fopen(table->path, "r");
+        if (! f) {
+                LogError("filesystem statistic error: cannot read %s -- %s\n", table->path, STRERROR);
+                return false;
         }
-        LogError("filesystem statistic error: cannot read %s -- %s\n", path, STRERROR);
-        return false;
+        _freeDisks(table);
+        table->timestamp = Time_milli();
+        table->cycle = systeminfo.collected;
+        boolean_t rv = table->parse(table, f);
+        fclose(f);
+        _indexReset(&(table->index), table->count);
+        for (int i = 0; i < table->count; i++)
+                _indexAdd(&(table->index), Str_hash(table->entries[i].name), table->entries, i, _matchDiskName, table->entries[i].name);
+        return rv;
 }
 
 
-static boolean_t _getProcfsBlockDiskActivity(void *_inf) {
-        Info_T inf = _inf;
-        FILE *f = fopen(DISKSTAT, "r");
-        if (f) {
-                uint64_t now = Time_milli();
-                uint64_t readOperations = 0ULL, readSectors = 0ULL;
-                uint64_t writeOperations = 0ULL, writeSectors = 0ULL;
-                char line[PATH_MAX];
-                while (fgets(line, sizeof(line), f)) {
-                        char name[256] = {};
-                        // Fallback for kernels < 2.6.25: the /proc/diskstats used to have just 4 statistics, the file is present on >= 2.6.25 too and has 11 fields (same format as /sys/class/block/<NAME>/stat), but we use sysfs for it
-                        // as we read the given partition directly instead of traversing the whole filesystems list. In this function we expect the old 4-statistics format - if it should be ever used as main data collector, it needs to
-                        // be modified to support >= 2.6.25 format too.
-                        if (fscanf(f, " %*d %*d %255s %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64, name, &readOperations, &readSectors, &writeOperations, &writeSectors) == 5 && IS(name, inf->filesystem->object.key)) {
-                                Statistics_update(&(inf->filesystem->read.bytes), now, readSectors * 512);
-                                Statistics_update(&(inf->filesystem->read.operations), now, readOperations);
-                                Statistics_update(&(inf->filesystem->write.bytes), now, writeSectors * 512);
-                                Statistics_update(&(inf->filesystem->write.operations), now, writeOperations);
-                                fclose(f);
-                                return true;
-                        }
-                }
-        } else {
-                LogError("filesystem statistic error: cannot read %s -- %s\n", DISKSTAT, STRERROR);
+static DiskEntry_T *_findDisk(DiskTable_T *table, const char *name) {
+        if (_updateDisks(table)) {
+                int entry = _indexFind(&(table->index), Str_hash(name), table->entries, _matchDiskName, name);
+                if (entry >= 0)
+                        return &(table->entries[entry]);
+        }
+        return NULL;
+}
+
+
+static boolean_t _getDiskActivity(Info_T inf, DiskTable_T *table, const char *name) {
+        DiskEntry_T *e = _findDisk(table, name);
+        if (! e) {
+                LogError("filesystem statistic error: '%s' not found in %s\n", name, table->path);
                 return false;
         }
+        Statistics_update(&(inf->filesystem->read.bytes), table->timestamp, e->readBytes);
+        Statistics_update(&(inf->filesystem->read.operations), table->timestamp, e->readOperations);
+        Statistics_update(&(inf->filesystem->write.bytes), table->timestamp, e->writeBytes);
+        Statistics_update(&(inf->filesystem->write.operations), table->timestamp, e->writeOperations);
+        if (e->hasTime) {
+                Statistics_update(&(inf->filesystem->time.read), table->timestamp, e->readTime);
+                Statistics_update(&(inf->filesystem->time.write), table->timestamp, e->writeTime);
+                Statistics_update(&(inf->filesystem->time.wait), table->timestamp, e->waitTime);
+                Statistics_update(&(inf->filesystem->time.run), table->timestamp, e->runTime);
+        }
         return true;
 }
 
 
-static boolean_t _compareMountpoint(const char *mountpoint, struct mntent *mnt) {
-        return IS(mountpoint, mnt->mnt_dir) && ! IS(mnt->mnt_fsname, "rootfs");
+static boolean_t _getBlockDiskActivity(void *_inf) {
+        Info_T inf = _inf;
+        return _getDiskActivity(inf, &_block, inf->filesystem->object.key);
 }
 
 
-static boolean_t _compareDevice(const char *device, struct mntent *mnt) {
-        char target[PATH_MAX] = {};
-        // The device listed in /etc/mtab can be a device mapper symlink (e.g. /dev/mapper/centos-root -> /dev/dm-1) ... lookup the device as is first (support for NFS/CIFS/SSHFS/etc.) and fallback to realpath if it didn't match
-        return (IS(device, mnt->mnt_fsname) || (realpath(mnt->mnt_fsname, target) && IS(device, target)));
+static boolean_t _getNfsDiskActivity(void *_inf) {
+        Info_T inf = _inf;
+        return _getDiskActivity(inf, &_nfs, inf->filesystem->object.device);
 }
 
 
-static boolean_t _setDevice(Info_T inf, const char *path, boolean_t (*compare)(const char *path, struct mntent *mnt)) {
+static boolean_t _getCifsDiskActivity(void *_inf) {
+        Info_T inf = _inf;
+        return _getDiskActivity(inf, &_cifs, inf->filesystem->object.key);
+}
+
+
+static void _freeMounts() {
+        for (int i = 0; i < _mounts.count; i++) {
+                FREE(_mounts.entries[i].device);
+                FREE(_mounts.entries[i].realDevice);
+                FREE(_mounts.entries[i].mountpoint);
+                FREE(_mounts.entries[i].type);
+                FREE(_mounts.entries[i].options);
+        }
+        _mounts.count = 0;
+}
+
+
+/**
+ * Decode the octal escapes (e.g. "\040" for space) used in the mountinfo paths
+ */
+static char *_unescape(char *s) {
+        char *d = s;
+        for (char *p = s; *p; p++) {
+                if (p[0] == '\\' && p[1] >= '0' && p[1] <= '3' && p[2] >= '0' && p[2] <= '7' && p[3] >= '0' && p[3] <= '7') {
+                        *d++ = (p[1] - '0') * 64 + (p[2] - '0') * 8 + (p[3] - '0');
+                        p += 3;
+                } else {
+                        *d++ = *p;
+                }
+        }
+        *d = 0;
+        return s;
+}
+
+
+/**
+ * Set the device id of the mount entries from /proc/self/mountinfo. The mountinfo lists the mounts in the same order as the mount table,
+ * so we pair the lines by position and fallback to the mountpoint lookup if the tables changed in between
+ */
+static void _readMountIds() {
+        FILE *f = fopen(MOUNTINFO, "r");
+        if (! f) {
+                DEBUG("Cannot open %s -- %s\n", MOUNTINFO, STRERROR);
+                return;
+        }
+        char line[PATH_MAX * 2];
+        for (int i = 0; fgets(line, sizeof(line), f); i++) {
+                unsigned int major, minor;
+                char mountpoint[PATH_MAX];
+                if (sscanf(line, "%*d %*d %u:%u %*s %4095s", &major, &minor, mountpoint) == 3) {
+                        _unescape(mountpoint);
+                        MountEntry_T *e = (i < _mounts.count && IS(_mounts.entries[i].mountpoint, mountpoint)) ? &(_mounts.entries[i]) : _findMount(&(_mounts.mountpoints), Str_hash(mountpoint), _matchMountpoint, mountpoint);
+                        if (e)
+                                e->id = makedev(major, minor);
+                }
+        }
+        fclose(f);
+}
+
+
+static boolean_t _readMounts() {
         FILE *f = setmntent(MOUNTS, "r");
         if (! f) {
                 LogError("Cannot open %s\n", MOUNTS);
                 return false;
         }
-        inf->filesystem->object.generation = _statistics.generation;
+        _freeMounts();
         struct mntent *mnt;
         while ((mnt = getmntent(f))) {
-                if (compare(path, mnt)) {
-                        strncpy(inf->filesystem->object.device, mnt->mnt_fsname, sizeof(inf->filesystem->object.device) - 1);
-                        strncpy(inf->filesystem->object.mountpoint, mnt->mnt_dir, sizeof(inf->filesystem->object.mountpoint) - 1);
-                        strncpy(inf->filesystem->object.type, mnt->mnt_type, sizeof(inf->filesystem->object.type) - 1);
-                        if (! IS(mnt->mnt_opts, inf->filesystem->flags)) {
-                                if (*(inf->filesystem->flags)) {
-                                        inf->filesystem->flagsChanged = true;
-                                }
-                                snprintf(inf->filesystem->flags, sizeof(inf->filesystem->flags), "%s", mnt->mnt_opts);
-                        }
-                        inf->filesystem->object.getDiskUsage = _getDiskUsage; // The disk usage method is common for all filesystem types
-                        inf->filesystem->object.getDiskActivity = _getDummyDiskActivity; // Set to dummy IO statistics method by default (can be overriden bellow if statistics method is available for this filesystem)
-                        if (Str_startsWith(mnt->mnt_type, "nfs")) {
-                                // NFS
-                                inf->filesystem->object.getDiskActivity = _getNfsDiskActivity;
-                        } else if (IS(mnt->mnt_type, "cifs")) {
-                                // CIFS
-                                inf->filesystem->object.getDiskActivity = _statistics.getCifsDiskActivity;
-                                // Need Windows style name - replace '/' with '\' so we can lookup the filesystem activity in /proc/fs/cifs/Stats
-                                strncpy(inf->filesystem->object.key, inf->filesystem->object.device, sizeof(inf->filesystem->object.key) - 1);
-                                Str_replaceChar(inf->filesystem->object.key, '/', '\\');
-                        } else {
-                                if (realpath(mnt->mnt_fsname, inf->filesystem->object.key)) {
-                                        // Need base name for /sys/class/block/<NAME>/stat or /proc/diskstats lookup:
-                                        snprintf(inf->filesystem->object.key, sizeof(inf->filesystem->object.key), "%s", File_basename(inf->filesystem->object.key));
-                                        // Test if block device statistics are available for the given filesystem
-                                        if (_statistics.getBlockDiskActivity(inf)) {
-                                                // Block device
-                                                inf->filesystem->object.getDiskActivity = _statistics.getBlockDiskActivity;
-                                        }
-                                }
-                        }
-                        endmntent(f);
-                        inf->filesystem->object.mounted = true;
-                        return true;
+                if (_mounts.count == _mounts.capacity) {
+                        _mounts.capacity = _mounts.capacity ? _mounts.capacity * 2 : 64;
+                        RESIZE(_mounts.entries, _mounts.capacity * sizeof(MountEntry_T));
                 }
+                MountEntry_T *e = &(_mounts.entries[_mounts.count++]);
+                char target[PATH_MAX] = {};
+                e->device = Str_dup(mnt->mnt_fsname);
+                // Resolve only absolute device paths (pseudo filesystems such as overlay or tmpfs have no device)
+                e->realDevice = (*mnt->mnt_fsname == '/' && realpath(mnt->mnt_fsname, target) && ! IS(target, mnt->mnt_fsname)) ? Str_dup(target) : NULL;
+                e->mountpoint = Str_dup(mnt->mnt_dir);
+                e->type = Str_dup(mnt->mnt_type);
+                e->options = Str_dup(mnt->mnt_opts);
+                e->id = 0;
         }
-        LogError("Lookup for '%s' filesystem failed  -- not found in %s\n", path, MOUNTS);
-error:
         endmntent(f);
-        inf->filesystem->object.mounted = false;
-        return false;
+        _indexReset(&(_mounts.mountpoints), _mounts.count);
+        _indexReset(&(_mounts.devices), _mounts.count * 2);
+        _indexReset(&(_mounts.ids), _mounts.count);
+        for (int i = 0; i < _mounts.count; i++) {
+                MountEntry_T *e = &(_mounts.entries[i]);
+                if (! IS(e->device, "rootfs"))
+                        _indexAdd(&(_mounts.mountpoints), Str_hash(e->mountpoint), _mounts.entries, i, _matchMountpoint, e->mountpoint);
+                _indexAdd(&(_mounts.devices), Str_hash(e->device), _mounts.entries, i, _matchDevice, e->device);
+                if (e->realDevice)
+                        _indexAdd(&(_mounts.devices), Str_hash(e->realDevice), _mounts.entries, i, _matchDevice, e->realDevice);
+        }
+        _readMountIds();
+        for (int i = 0; i < _mounts.count; i++)
+                if (_mounts.entries[i].id)
+                        _indexAdd(&(_mounts.ids), _hashDeviceId(_mounts.entries[i].id), _mounts.entries, i, _matchDeviceId, &(_mounts.entries[i].id));
+        DEBUG("Mount table loaded: %d entries\n", _mounts.count);
+        return true;
 }
 
 
-static boolean_t _getDevice(Info_T inf, const char *path, boolean_t (*compare)(const char *path, struct mntent *mnt)) {
+/**
+ * Check for mount table changes and reload the shared mount table if needed
+ */
+static boolean_t _updateMounts() {
         // Mount/unmount notification: open the /proc/self/mounts file if we're in daemon mode and keep it open until monit
         // stops, so we can poll for mount table changes
         // FIXME: when libev is added register the mount table handler in libev and stop polling here
@@ -340,10 +584,84 @@ static boolean_t _getDevice(Info_T inf, const char *path, boolean_t (*compare)(c
                 } else {
                         LogError("Mount table polling failed -- %s\n", STRERROR);
                 }
+        } else {
+                // No notification available: reload the mount table if it is older then 1 second (handle also backward time jumps)
+                uint64_t now = Time_milli();
+                if (now < _mounts.timestamp || now - _mounts.timestamp >= 1000) {
+                        _mounts.timestamp = now;
+                        _statistics.generation++;
+                }
+        }
+        if (_mounts.generation != _statistics.generation) {
+                if (! _readMounts())
+                        return false;
+                _mounts.generation = _statistics.generation;
+        }
+        return true;
+}
+
+
+static boolean_t _setDevice(Info_T inf, const char *path, MountEntry_T *(*find)(const char *path)) {
+        inf->filesystem->object.generation = _statistics.generation;
+        MountEntry_T *mnt = find(path);
+        if (mnt) {
+                strncpy(inf->filesystem->object.device, mnt->device, sizeof(inf->filesystem->object.device) - 1);
+                strncpy(inf->filesystem->object.mountpoint, mnt->mountpoint, sizeof(inf->filesystem->object.mountpoint) - 1);
+                strncpy(inf->filesystem->object.type, mnt->type, sizeof(inf->filesystem->object.type) - 1);
+                if (! IS(mnt->options, inf->filesystem->flags)) {
+                        if (*(inf->filesystem->flags)) {
+                                inf->filesystem->flagsChanged = true;
+                        }
+                        snprintf(inf->filesystem->flags, sizeof(inf->filesystem->flags), "%s", mnt->options);
+                }
+                inf->filesystem->object.getDiskUsage = _getDiskUsage; // The disk usage method is common for all filesystem types
+                inf->filesystem->object.getDiskActivity = _getDummyDiskActivity; // Set to dummy IO statistics method by default (can be overriden bellow if statistics method is available for this filesystem)
+                if (Str_startsWith(mnt->type, "nfs")) {
+                        // NFS
+                        inf->filesystem->object.getDiskActivity = _getNfsDiskActivity;
+                } else if (IS(mnt->type, "cifs")) {
+                        // CIFS
+                        if (_statistics.cifs)
+                                inf->filesystem->object.getDiskActivity = _getCifsDiskActivity;
+                        // Need Windows style name - replace '/' with '\' so we can lookup the filesystem activity in /proc/fs/cifs/Stats
+                        strncpy(inf->filesystem->object.key, inf->filesystem->object.device, sizeof(inf->filesystem->object.key) - 1);
+                        Str_replaceChar(inf->filesystem->object.key, '/', '\\');
+                } else if (*mnt->device == '/') {
+                        // Need base name for /sys/class/block/<NAME>/stat or /proc/diskstats lookup:
+                        snprintf(inf->filesystem->object.key, sizeof(inf->filesystem->object.key), "%s", File_basename(mnt->realDevice ? mnt->realDevice : mnt->device));
+                        // Test if block device statistics are available for the given filesystem
+                        if (_findDisk(&_block, inf->filesystem->object.key)) {
+                                // Block device
+                                inf->filesystem->object.getDiskActivity = _getBlockDiskActivity;
+                        }
+                }
+                inf->filesystem->object.mounted = true;
+                return true;
+        }
+        LogError("Lookup for '%s' filesystem failed  -- not found in %s\n", path, MOUNTS);
+        inf->filesystem->object.mounted = false;
+        return false;
+}
+
+
+static MountEntry_T *_findByMountpoint(const char *mountpoint) {
+        return _findMount(&(_mounts.mountpoints), Str_hash(mountpoint), _matchMountpoint, mountpoint);
+}
+
+
+static MountEntry_T *_findByDevice(const char *device) {
+        return _findMount(&(_mounts.devices), Str_hash(device), _matchDevice, device);
+}
+
+
+static boolean_t _getDevice(Info_T inf, const char *path, MountEntry_T *(*find)(const char *path)) {
+        if (! _updateMounts()) {
+                inf->filesystem->object.mounted = false;
+                return false;
         }
-        if (inf->filesystem->object.generation != _statistics.generation || _statistics.fd == -1) {
+        if (inf->filesystem->object.generation != _statistics.generation) {
                 DEBUG("Reloading mount informations for filesystem '%s'\n", path);
-                _setDevice(inf, path, compare);
+                _setDevice(inf, path, find);
         }
         if (inf->filesystem->object.mounted) {
                 return (inf->filesystem->object.getDiskUsage(inf) && inf->filesystem->object.getDiskActivity(inf));
@@ -359,8 +677,7 @@ static void __attribute__ ((constructor)) _constructor() {
         struct stat sb;
         _statistics.fd = -1;
         _statistics.generation++; // First generation
-        _statistics.getBlockDiskActivity = stat("/sys/class/block", &sb) == 0 ? _getSysfsBlockDiskActivity : _getProcfsBlockDiskActivity;
-        _statistics.getCifsDiskActivity = stat(CIFSSTAT, &sb) == 0 ? _getCifsDiskActivity : _getDummyDiskActivity;
+        _statistics.cifs = stat(CIFSSTAT, &sb) == 0;
 }
 
 
@@ -368,6 +685,17 @@ static void __attribute__ ((destructor)) _destructor() {
         if (_statistics.fd > -1) {
                   close(_statistics.fd);
         }
+        _freeMounts();
+        FREE(_mounts.entries);
+        FREE(_mounts.mountpoints.slot);
+        FREE(_mounts.devices.slot);
+        FREE(_mounts.ids.slot);
+        DiskTable_T *tables[] = {&_block, &_nfs, &_cifs};
+        for (int i = 0; i < 3; i++) {
+                _freeDisks(tables[i]);
+                FREE(tables[i]->entries);
+                FREE(tables[i]->index.slot);
+        }
 }
 
 
@@ -377,13 +705,23 @@ static void __attribute__ ((destructor)) _destructor() {
 boolean_t Filesystem_getByMountpoint(Info_T inf, const char *path) {
         ASSERT(inf);
         ASSERT(path);
-        return _getDevice(inf, path, _compareMountpoint);
+        return _getDevice(inf, path, _findByMountpoint);
 }
 
 
 boolean_t Filesystem_getByDevice(Info_T inf, const char *path) {
         ASSERT(inf);
         ASSERT(path);
-        return _getDevice(inf, path, _compareDevice);
+        return _getDevice(inf, path, _findByDevice);
+}
+
+
+const char *Filesystem_getTypeByDeviceId(dev_t id) {
+        if (_updateMounts()) {
+                MountEntry_T *mnt = _findMount(&(_mounts.ids), _hashDeviceId(id), _matchDeviceId, &id);
+                if (mnt)
+                        return mnt->type;
+        }
+        return NULL;
 }
 
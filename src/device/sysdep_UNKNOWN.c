@@ -51,3 +51,8 @@ boolean_t Filesystem_getByDevice(Info_T inf, const char *path) {
         return false;
 }
 
+
+const char *Filesystem_getTypeByDeviceId(dev_t device) {
+        return NULL;
+}
+
@@ -309,7 +309,7 @@ static void _handleAction(Event_T E, Action_T A) {
                                 E->source->nstart++;
                         if (E->source->mode == Monitor_Passive && (A->id == Action_Start || A->id == Action_Stop  || A->id == Action_Restart))
                                 return;
-                        control_service(E->source->name, A->id);
+                        control_schedule(E->source, A->id, false);
                 }
         }
 }
@@ -336,9 +336,9 @@ static void _handleEvent(Service_T S, Event_T E) {
                  * info. */
                 if (E->state != State_Init || E->state_map & 0x1) {
                         if (E->state == State_Succeeded || E->state == State_ChangedNot || E->id == Event_Instance || E->id == Event_Action)
-                                LogInfo("'%s' %s\n", S->name, E->message);
+                                LogEvent(LOG_INFO, E);
                         else
-                                LogError("'%s' %s\n", S->name, E->message);
+                                LogEvent(LOG_ERR, E);
                 }
                 if (E->state == State_Init)
                         return;
@@ -677,7 +677,7 @@ void Event_queue_process() {
         error1:
                 de = readdir(dir);
         }
-        Run.flags &= ~Run_HandlerInit;
+        RUN_CLEAR(Run_HandlerInit);
         closedir(dir);
         FREE(a);
         FREE(ea);
@@ -32,6 +32,10 @@
 #include <stdlib.h>
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 // libmonit
 #include "util/List.h"
 
@@ -41,8 +45,40 @@
 #include "engine.h"
 
 
+/* ------------------------------------------------------------- Definitions */
+
+
+/* Rule chains without runtime data, which can be shared by services */
+typedef enum {
+        Shared_Resource = 0,
+        Shared_ActionRate,
+        Shared_Pid,
+        Shared_PPid,
+        Shared_FsFlag,
+        Shared_NonExist,
+        Shared_Exist,
+        Shared_Mail
+} Shared_Type;
+
+
+typedef struct Shared_T {
+        Shared_Type type;                                     /**< Rule chain type */
+        unsigned int hash;                              /**< Rule chain content hash */
+        int references;                       /**< Number of services using the chain */
+        void *chain;                                   /**< The shared rule chain */
+        struct Shared_T *next;                              /**< Next entry in bucket */
+} *Shared_T;
+
+
+static struct {
+        int size;                                /**< Number of buckets (power of 2) */
+        int count;                                   /**< Number of shared chains */
+        Shared_T *bucket;
+} shared;
+
+
 /* Private prototypes */
-static void _gc_service_list(Service_T *);
+static void _gc_run(struct Run_T *);
 static void _gc_service(Service_T *);
 static void _gc_servicegroup(ServiceGroup_T *);
 static void _gc_mail_server(MailServer_T *);
@@ -77,6 +113,9 @@ static void _gc_mmonit(Mmonit_T *);
 static void _gc_url(URL_T *);
 static void _gc_request(Request_T *);
 static void _gcssloptions(SslOptions_T o);
+static boolean_t _isStateless(Resource_T);
+static void *_share(Shared_Type, void *);
+static boolean_t _release(Shared_Type, void *);
 
 
 /**
@@ -90,36 +129,41 @@ static void _gcssloptions(SslOptions_T o);
 
 
 void gc() {
-        Engine_destroyAllow();
         if (Run.flags & Run_ProcessEngineEnabled)
                 ProcessTree_delete();
+        gc_configuration();
         if (servicelist)
-                _gc_service_list(&servicelist);
+                gc_service_list(&servicelist);
+}
+
+
+void gc_configuration() {
+        Engine_destroyAllow();
+        Util_resetServiceIndex();
         if (servicegrouplist)
                 _gc_servicegroup(&servicegrouplist);
-        if (Run.httpd.credentials)
-                _gcath(&Run.httpd.credentials);
-        if (Run.maillist)
-                gc_mail_list(&Run.maillist);
-        if (Run.mailservers)
-                _gc_mail_server(&Run.mailservers);
-        if (Run.mmonits)
-                _gc_mmonit(&Run.mmonits);
-        FREE(Run.eventlist_dir);
+        _gc_run(&Run);
         FREE(Run.mygroup);
-        if (Run.httpd.flags & Httpd_Net) {
-                FREE(Run.httpd.socket.net.address);
-                _gcssloptions(&(Run.httpd.socket.net.ssl));
-        }
-        if (Run.httpd.flags & Httpd_Unix)
-                FREE(Run.httpd.socket.unix.path);
-        if (Run.MailFormat.from)
-                Address_free(&(Run.MailFormat.from));
-        if (Run.MailFormat.replyto)
-                Address_free(&(Run.MailFormat.replyto));
-        FREE(Run.MailFormat.subject);
-        FREE(Run.MailFormat.message);
-        FREE(Run.mail_hostname);
+}
+
+
+void gc_configuration_detached(Configuration_T config) {
+        ASSERT(config);
+        if (config->servicelist)
+                gc_service_list(&config->servicelist);
+        if (config->servicegrouplist)
+                _gc_servicegroup(&config->servicegrouplist);
+        _gc_run(&config->run);
+        FREE(config->run.files.log);
+        FREE(config->run.files.pid);
+}
+
+
+void gc_service_list(Service_T *s) {
+        ASSERT(s&&*s);
+        if ((*s)->next)
+                gc_service_list(&(*s)->next);
+        _gc_service(&(*s));
 }
 
 
@@ -138,6 +182,20 @@ void gc_mail_list(Mail_T *m) {
 }
 
 
+void gc_share_rules(Service_T s) {
+        ASSERT(s);
+        if (_isStateless(s->resourcelist))
+                s->resourcelist = _share(Shared_Resource, s->resourcelist);
+        s->actionratelist = _share(Shared_ActionRate, s->actionratelist);
+        s->pidlist = _share(Shared_Pid, s->pidlist);
+        s->ppidlist = _share(Shared_PPid, s->ppidlist);
+        s->fsflaglist = _share(Shared_FsFlag, s->fsflaglist);
+        s->nonexistlist = _share(Shared_NonExist, s->nonexistlist);
+        s->existlist = _share(Shared_Exist, s->existlist);
+        s->maillist = _share(Shared_Mail, s->maillist);
+}
+
+
 void gccmd(command_t *c) {
         ASSERT(c && *c);
         for (int i = 0; (*c)->arg[i]; i++)
@@ -159,6 +217,32 @@ void gc_event(Event_T *e) {
 /* ----------------------------------------------------------------- Private */
 
 
+static void _gc_run(struct Run_T *run) {
+        if (run->httpd.credentials)
+                _gcath(&run->httpd.credentials);
+        if (run->maillist)
+                gc_mail_list(&run->maillist);
+        if (run->mailservers)
+                _gc_mail_server(&run->mailservers);
+        if (run->mmonits)
+                _gc_mmonit(&run->mmonits);
+        FREE(run->eventlist_dir);
+        if (run->httpd.flags & Httpd_Net) {
+                FREE(run->httpd.socket.net.address);
+                _gcssloptions(&(run->httpd.socket.net.ssl));
+        }
+        if (run->httpd.flags & Httpd_Unix)
+                FREE(run->httpd.socket.unix.path);
+        if (run->MailFormat.from)
+                Address_free(&(run->MailFormat.from));
+        if (run->MailFormat.replyto)
+                Address_free(&(run->MailFormat.replyto));
+        FREE(run->MailFormat.subject);
+        FREE(run->MailFormat.message);
+        FREE(run->mail_hostname);
+}
+
+
 static void _gcssloptions(SslOptions_T o) {
         FREE(o->checksum);
         FREE(o->pemfile);
@@ -169,14 +253,6 @@ static void _gcssloptions(SslOptions_T o) {
 }
 
 
-static void _gc_service_list(Service_T *s) {
-        ASSERT(s&&*s);
-        if ((*s)->next)
-                _gc_service_list(&(*s)->next);
-        _gc_service(&(*s));
-}
-
-
 static void _gc_service(Service_T *s) {
         ASSERT(s&&*s);
         if ((*s)->program) {
@@ -197,13 +273,13 @@ static void _gc_service(Service_T *s) {
                 _gcfilesystem(&(*s)->filesystemlist);
         if ((*s)->icmplist)
                 _gcicmp(&(*s)->icmplist);
-        if ((*s)->maillist)
+        if ((*s)->maillist && _release(Shared_Mail, (*s)->maillist))
                 gc_mail_list(&(*s)->maillist);
-        if ((*s)->resourcelist)
+        if ((*s)->resourcelist && _release(Shared_Resource, (*s)->resourcelist))
                 _gcpql(&(*s)->resourcelist);
         if ((*s)->timestamplist)
                 _gcptl(&(*s)->timestamplist);
-        if ((*s)->actionratelist)
+        if ((*s)->actionratelist && _release(Shared_ActionRate, (*s)->actionratelist))
                 _gcparl(&(*s)->actionratelist);
         if ((*s)->sizelist)
                 _gcso(&(*s)->sizelist);
@@ -239,15 +315,15 @@ static void _gc_service(Service_T *s) {
                 _gcuid(&(*s)->euid);
         if ((*s)->gid)
                 _gcgid(&(*s)->gid);
-        if ((*s)->pidlist)
+        if ((*s)->pidlist && _release(Shared_Pid, (*s)->pidlist))
                 _gcpid(&(*s)->pidlist);
-        if ((*s)->ppidlist)
+        if ((*s)->ppidlist && _release(Shared_PPid, (*s)->ppidlist))
                 _gcppid(&(*s)->ppidlist);
-        if ((*s)->fsflaglist)
+        if ((*s)->fsflaglist && _release(Shared_FsFlag, (*s)->fsflaglist))
                 _gcfsflag(&(*s)->fsflaglist);
-        if ((*s)->nonexistlist)
+        if ((*s)->nonexistlist && _release(Shared_NonExist, (*s)->nonexistlist))
                 _gcnonexist(&(*s)->nonexistlist);
-        if ((*s)->existlist)
+        if ((*s)->existlist && _release(Shared_Exist, (*s)->existlist))
                 _gcexist(&(*s)->existlist);
         if ((*s)->dependantlist)
                 _gcpdl(&(*s)->dependantlist);
@@ -292,6 +368,9 @@ static void _gc_service(Service_T *s) {
                 default:
                         break;
         }
+        // The published copy of the check result shares the referenced objects (network link statistics) with the service
+        FREE((*s)->published.inf.directory);
+        FREE((*s)->published.output);
         FREE((*s)->name);
         FREE((*s)->path);
         (*s)->next = NULL;
@@ -421,6 +500,8 @@ static void _gcfilesystem(FileSystem_T *d) {
                 _gcfilesystem(&(*d)->next);
         if ((*d)->action)
                 _gc_eventaction(&(*d)->action);
+        if ((*d)->aggregate.series)
+                Series_free(&(*d)->aggregate.series);
         FREE(*d);
 }
 
@@ -442,6 +523,8 @@ static void _gcpql(Resource_T *q) {
                 _gcpql(&(*q)->next);
         if ((*q)->action)
                 _gc_eventaction(&(*q)->action);
+        if ((*q)->aggregate.series)
+                Series_free(&(*q)->aggregate.series);
         FREE(*q);
 }
 
@@ -659,8 +742,330 @@ static void _gc_mmonit(Mmonit_T *recv) {
         ASSERT(recv);
         if ((*recv)->next)
                 _gc_mmonit(&(*recv)->next);
+        if ((*recv)->socket)
+                Socket_free(&(*recv)->socket);
         _gc_url(&(*recv)->url);
         _gcssloptions(&((*recv)->ssl));
         FREE(*recv);
 }
 
+
+
+/* --------------------------------------------------------- Shared rules */
+
+
+static unsigned int _hashBytes(unsigned int h, const void *data, size_t length) {
+        const unsigned char *b = data;
+        for (size_t i = 0; i < length; i++)
+                h = (h ^ b[i]) * 16777619U; // FNV-1a
+        return h;
+}
+
+
+static unsigned int _hashNumber(unsigned int h, long long n) {
+        return _hashBytes(h, &n, sizeof(n));
+}
+
+
+static unsigned int _hashString(unsigned int h, const char *s) {
+        return s ? _hashBytes(h, s, strlen(s) + 1) : _hashNumber(h, -1);
+}
+
+
+static unsigned int _hashAction(unsigned int h, Action_T a) {
+        h = _hashNumber(h, a->id);
+        h = _hashNumber(h, a->count);
+        h = _hashNumber(h, a->cycles);
+        h = _hashNumber(h, a->repeat);
+        if (a->exec)
+                for (int i = 0; a->exec->arg[i]; i++)
+                        h = _hashString(h, a->exec->arg[i]);
+        return h;
+}
+
+
+static unsigned int _hashEventAction(unsigned int h, EventAction_T e) {
+        return _hashAction(_hashAction(h, e->failed), e->succeeded);
+}
+
+
+static unsigned int _hashAddress(unsigned int h, Address_T a) {
+        return a ? _hashString(_hashString(h, a->name), a->address) : _hashNumber(h, 0);
+}
+
+
+static boolean_t _isEqualString(const char *a, const char *b) {
+        return a == b || Str_isByteEqual(a, b); // Byte exact, like the hash
+}
+
+
+static boolean_t _isEqualCommand(command_t a, command_t b) {
+        if (a == b)
+                return true;
+        if (! a || ! b || a->length != b->length || a->has_uid != b->has_uid || a->has_gid != b->has_gid || a->uid != b->uid || a->gid != b->gid || a->timeout != b->timeout)
+                return false;
+        for (int i = 0; i < a->length; i++)
+                if (! _isEqualString(a->arg[i], b->arg[i]))
+                        return false;
+        return true;
+}
+
+
+static boolean_t _isEqualAction(Action_T a, Action_T b) {
+        return a->id == b->id && a->count == b->count && a->cycles == b->cycles && a->repeat == b->repeat && _isEqualCommand(a->exec, b->exec);
+}
+
+
+static boolean_t _isEqualEventAction(EventAction_T a, EventAction_T b) {
+        return _isEqualAction(a->failed, b->failed) && _isEqualAction(a->succeeded, b->succeeded);
+}
+
+
+static boolean_t _isEqualAddress(Address_T a, Address_T b) {
+        if (a == b)
+                return true;
+        return a && b && _isEqualString(a->name, b->name) && _isEqualString(a->address, b->address);
+}
+
+
+/* Chains of rules which have the EventAction as the only attribute */
+#define _HASH_ACTIONS(type, chain) for (type r = chain; r; r = r->next) h = _hashEventAction(h, r->action)
+#define _EQUAL_ACTIONS(type, chain1, chain2) do { \
+        type a = chain1, b = chain2; \
+        for (; a && b; a = a->next, b = b->next) \
+                if (! _isEqualEventAction(a->action, b->action)) \
+                        return false; \
+        return ! a && ! b; \
+} while (0)
+
+
+static unsigned int _hash(Shared_Type type, void *chain) {
+        unsigned int h = _hashNumber(2166136261U, type);
+        switch (type) {
+                case Shared_Resource:
+                        for (Resource_T r = chain; r; r = r->next) {
+                                h = _hashNumber(h, r->resource_id);
+                                h = _hashNumber(h, r->operator);
+                                h = _hashBytes(h, &r->limit, sizeof(r->limit));
+                                h = _hashEventAction(h, r->action);
+                        }
+                        break;
+                case Shared_ActionRate:
+                        for (ActionRate_T r = chain; r; r = r->next) {
+                                h = _hashNumber(h, r->count);
+                                h = _hashNumber(h, r->cycle);
+                                h = _hashEventAction(h, r->action);
+                        }
+                        break;
+                case Shared_Pid:
+                case Shared_PPid:
+                        _HASH_ACTIONS(Pid_T, chain);
+                        break;
+                case Shared_FsFlag:
+                        _HASH_ACTIONS(FsFlag_T, chain);
+                        break;
+                case Shared_NonExist:
+                        _HASH_ACTIONS(NonExist_T, chain);
+                        break;
+                case Shared_Exist:
+                        _HASH_ACTIONS(Exist_T, chain);
+                        break;
+                case Shared_Mail:
+                        for (Mail_T m = chain; m; m = m->next) {
+                                h = _hashString(h, m->to);
+                                h = _hashAddress(h, m->from);
+                                h = _hashAddress(h, m->replyto);
+                                h = _hashString(h, m->subject);
+                                h = _hashString(h, m->message);
+                                h = _hashString(h, m->host);
+                                h = _hashNumber(h, m->events);
+                                h = _hashNumber(h, m->reminder);
+                        }
+                        break;
+        }
+        return h;
+}
+
+
+static boolean_t _isEqual(Shared_Type type, void *chain1, void *chain2) {
+        switch (type) {
+                case Shared_Resource:
+                        {
+                                Resource_T a = chain1, b = chain2;
+                                for (; a && b; a = a->next, b = b->next)
+                                        if (a->resource_id != b->resource_id || a->operator != b->operator || a->limit != b->limit || ! _isEqualEventAction(a->action, b->action))
+                                                return false;
+                                return ! a && ! b;
+                        }
+                case Shared_ActionRate:
+                        {
+                                ActionRate_T a = chain1, b = chain2;
+                                for (; a && b; a = a->next, b = b->next)
+                                        if (a->count != b->count || a->cycle != b->cycle || ! _isEqualEventAction(a->action, b->action))
+                                                return false;
+                                return ! a && ! b;
+                        }
+                case Shared_Pid:
+                case Shared_PPid:
+                        _EQUAL_ACTIONS(Pid_T, chain1, chain2);
+                case Shared_FsFlag:
+                        _EQUAL_ACTIONS(FsFlag_T, chain1, chain2);
+                case Shared_NonExist:
+                        _EQUAL_ACTIONS(NonExist_T, chain1, chain2);
+                case Shared_Exist:
+                        _EQUAL_ACTIONS(Exist_T, chain1, chain2);
+                case Shared_Mail:
+                        {
+                                Mail_T a = chain1, b = chain2;
+                                for (; a && b; a = a->next, b = b->next)
+                                        if (! _isEqualString(a->to, b->to) || ! _isEqualAddress(a->from, b->from) || ! _isEqualAddress(a->replyto, b->replyto) || ! _isEqualString(a->subject, b->subject) || ! _isEqualString(a->message, b->message) || ! _isEqualString(a->host, b->host) || a->events != b->events || a->reminder != b->reminder)
+                                                return false;
+                                return ! a && ! b;
+                        }
+        }
+        return false;
+}
+
+
+static void _free(Shared_Type type, void *chain) {
+        switch (type) {
+                case Shared_Resource:
+                        {
+                                Resource_T r = chain;
+                                _gcpql(&r);
+                        }
+                        break;
+                case Shared_ActionRate:
+                        {
+                                ActionRate_T r = chain;
+                                _gcparl(&r);
+                        }
+                        break;
+                case Shared_Pid:
+                        {
+                                Pid_T r = chain;
+                                _gcpid(&r);
+                        }
+                        break;
+                case Shared_PPid:
+                        {
+                                Pid_T r = chain;
+                                _gcppid(&r);
+                        }
+                        break;
+                case Shared_FsFlag:
+                        {
+                                FsFlag_T r = chain;
+                                _gcfsflag(&r);
+                        }
+                        break;
+                case Shared_NonExist:
+                        {
+                                NonExist_T r = chain;
+                                _gcnonexist(&r);
+                        }
+                        break;
+                case Shared_Exist:
+                        {
+                                Exist_T r = chain;
+                                _gcexist(&r);
+                        }
+                        break;
+                case Shared_Mail:
+                        {
+                                Mail_T r = chain;
+                                gc_mail_list(&r);
+                        }
+                        break;
+        }
+}
+
+
+static boolean_t _isStateless(Resource_T r) {
+        for (; r; r = r->next)
+                if (r->aggregate.type != Aggregate_None)
+                        return false; // The aggregate series is runtime data
+        return true;
+}
+
+
+static void _resize() {
+        int size = shared.size ? shared.size * 2 : 64;
+        Shared_T *bucket = CALLOC(size, sizeof(Shared_T));
+        for (int i = 0; i < shared.size; i++) {
+                for (Shared_T e = shared.bucket[i], next; e; e = next) {
+                        next = e->next;
+                        e->next = bucket[e->hash & (size - 1)];
+                        bucket[e->hash & (size - 1)] = e;
+                }
+        }
+        FREE(shared.bucket);
+        shared.bucket = bucket;
+        shared.size = size;
+}
+
+
+/**
+ * Replace the rule chain with an equal chain which is already used by other
+ * service if it exists (the duplicate is released), otherwise register the
+ * chain for sharing
+ * @param type The rule chain type
+ * @param chain The rule chain
+ * @return The rule chain which the service should use
+ */
+static void *_share(Shared_Type type, void *chain) {
+        if (! chain)
+                return NULL;
+        unsigned int hash = _hash(type, chain);
+        if (shared.size) {
+                for (Shared_T e = shared.bucket[hash & (shared.size - 1)]; e; e = e->next) {
+                        if (e->type == type && e->hash == hash && _isEqual(type, e->chain, chain)) {
+                                if (e->chain != chain)
+                                        _free(type, chain);
+                                e->references++;
+                                return e->chain;
+                        }
+                }
+        }
+        if (shared.count >= shared.size)
+                _resize();
+        Shared_T e;
+        NEW(e);
+        e->type = type;
+        e->hash = hash;
+        e->references = 1;
+        e->chain = chain;
+        e->next = shared.bucket[hash & (shared.size - 1)];
+        shared.bucket[hash & (shared.size - 1)] = e;
+        shared.count++;
+        return chain;
+}
+
+
+/**
+ * Drop the service reference to the rule chain
+ * @param type The rule chain type
+ * @param chain The rule chain
+ * @return true if the chain is no longer used and should be freed, otherwise false
+ */
+static boolean_t _release(Shared_Type type, void *chain) {
+        if (! shared.size)
+                return true;
+        unsigned int hash = _hash(type, chain);
+        for (Shared_T *e = &shared.bucket[hash & (shared.size - 1)]; *e; e = &(*e)->next) {
+                if ((*e)->chain == chain) {
+                        if (--(*e)->references > 0)
+                                return false;
+                        Shared_T unused = *e;
+                        *e = unused->next;
+                        FREE(unused);
+                        if (--shared.count == 0) {
+                                FREE(shared.bucket);
+                                shared.size = 0;
+                        }
+                        return true;
+                }
+        }
+        return true;
+}
+
@@ -118,6 +118,8 @@ void monit_http(Httpd_Action action) {
                         running = false;
                         break;
                 case Httpd_Start:
+                        if (running)
+                                break;
                         if (Run.httpd.flags & Httpd_Net)
                                 LogDebug("Starting Monit HTTP server at [%s]:%d\n", Run.httpd.socket.net.address ? Run.httpd.socket.net.address : "*", Run.httpd.socket.net.port);
                         else if (Run.httpd.flags & Httpd_Unix)
@@ -60,6 +60,14 @@
 #include <sys/stat.h>
 #endif
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
@@ -82,6 +90,8 @@
 #include "ProcessTree.h"
 #include "device.h"
 #include "protocol.h"
+#include "profile.h"
+#include "snapshot.h"
 #include "Color.h"
 #include "Box.h"
 
@@ -102,6 +112,7 @@
 #define RUNTIME     "/_runtime"
 #define VIEWLOG     "/_viewlog"
 #define DOACTION    "/_doaction"
+#define CHECK       "/_check"
 #define FAVICON     "/favicon.ico"
 
 
@@ -136,11 +147,13 @@ static void do_viewlog(HttpRequest, HttpResponse);
 static void handle_service(HttpRequest, HttpResponse);
 static void handle_service_action(HttpRequest, HttpResponse);
 static void handle_doaction(HttpRequest, HttpResponse);
+static void handle_check(HttpRequest, HttpResponse);
 static void handle_runtime(HttpRequest, HttpResponse);
 static void handle_runtime_action(HttpRequest, HttpResponse);
 static void is_monit_running(HttpResponse);
 static void do_service(HttpRequest, HttpResponse, Service_T);
 static void print_alerts(HttpResponse, Mail_T);
+static void print_profile(HttpResponse);
 static void print_buttons(HttpRequest, HttpResponse, Service_T);
 static void print_service_rules_timeout(HttpResponse, Service_T);
 static void print_service_rules_nonexistence(HttpResponse, Service_T);
@@ -171,6 +184,8 @@ static void print_service_rules_ppid(HttpResponse, Service_T);
 static void print_service_rules_program(HttpResponse, Service_T);
 static void print_service_rules_resource(HttpResponse, Service_T);
 static void print_status(HttpRequest, HttpResponse, int);
+static void print_status_json(HttpRequest, HttpResponse);
+static void _appendJsonString(StringBuffer_T, const char *);
 static void print_summary(HttpRequest, HttpResponse);
 static void _printReport(HttpRequest req, HttpResponse res);
 static void status_service_txt(Service_T, HttpResponse);
@@ -237,22 +252,22 @@ static void _formatStatus(const char *name, Event_Type errorType, Output_Type ty
                 StringBuffer_append(res->outputbuffer, "  %-28s ", name);
         }
         if (! validValue) {
-                StringBuffer_append(res->outputbuffer, type == HTML ? "<td class='gray-text'>-</td>" : COLOR_DARKGRAY "-" COLOR_RESET);
+                StringBuffer_appendString(res->outputbuffer, type == HTML ? "<td class='gray-text'>-</td>" : COLOR_DARKGRAY "-" COLOR_RESET);
         } else {
                 va_list ap;
                 va_start(ap, value);
                 char *_value = Str_vcat(value, ap);
                 va_end(ap);
                 if (errorType != Event_Null && s->error & errorType)
-                        StringBuffer_append(res->outputbuffer, type == HTML ? "<td class='red-text'>" : COLOR_LIGHTRED);
+                        StringBuffer_appendString(res->outputbuffer, type == HTML ? "<td class='red-text'>" : COLOR_LIGHTRED);
                 else
-                        StringBuffer_append(res->outputbuffer, type == HTML ? "<td>" : COLOR_DEFAULT);
+                        StringBuffer_appendString(res->outputbuffer, type == HTML ? "<td>" : COLOR_DEFAULT);
                 if (type == HTML) {
                         // If the output contains multiple line, wrap use <pre>, otherwise keep as is
                         int multiline = strrchr(_value, '\n') > 0;
                         if (multiline)
-                                StringBuffer_append(res->outputbuffer, "<pre>");
-                        escapeHTML(res->outputbuffer, _value);
+                                StringBuffer_appendString(res->outputbuffer, "<pre>");
+                        StringBuffer_appendEscapedHTML(res->outputbuffer, _value);
                         StringBuffer_append(res->outputbuffer, "%s</td>", multiline ? "</pre>" : "");
                 } else {
                         int column = 0;
@@ -263,19 +278,19 @@ static void _formatStatus(const char *name, Event_Type errorType, Output_Type ty
                                 } else if (_value[i] == '\n') {
                                         // Indent 2nd+ line
                                         if (_value[i + 1])
-                                        StringBuffer_append(res->outputbuffer, "\n                               ");
+                                        StringBuffer_appendString(res->outputbuffer, "\n                               ");
                                         column = 0;
                                         continue;
                                 } else if (column <= 200) {
-                                        StringBuffer_append(res->outputbuffer, "%c", _value[i]);
+                                        StringBuffer_appendChar(res->outputbuffer, _value[i]);
                                         column++;
                                 }
                         }
-                        StringBuffer_append(res->outputbuffer, COLOR_RESET);
+                        StringBuffer_appendString(res->outputbuffer, COLOR_RESET);
                 }
                 FREE(_value);
         }
-        StringBuffer_append(res->outputbuffer, type == HTML ? "</tr>" : "\n");
+        StringBuffer_appendString(res->outputbuffer, type == HTML ? "</tr>" : "\n");
 }
 
 
@@ -296,24 +311,40 @@ static void _printIOStatistics(Output_Type type, HttpResponse res, Service_T s,
 }
 
 
-static void _printStatus(Output_Type type, HttpResponse res, Service_T s) {
-        if (Util_hasServiceStatus(s)) {
-                switch (s->type) {
-                        case Service_System:
-                                _formatStatus("load average", Event_Resource, type, res, s, true, "[%.2f] [%.2f] [%.2f]", systeminfo.loadavg[0], systeminfo.loadavg[1], systeminfo.loadavg[2]);
-                                _formatStatus("cpu", Event_Resource, type, res, s, true, "%.1f%%us %.1f%%sy"
+static void _printSystemStatus(Output_Type type, HttpResponse res, Service_T s) {
+        SystemInfo_T info;
+        Snapshot_getSystem(&info);
+        _formatStatus("load average", Event_Resource, type, res, s, true, "[%.2f] [%.2f] [%.2f]", info.loadavg[0], info.loadavg[1], info.loadavg[2]);
+        _formatStatus("cpu", Event_Resource, type, res, s, true, "%.1f%%us %.1f%%sy"
 #ifdef HAVE_CPU_WAIT
-                                        " %.1f%%wa"
+                " %.1f%%wa"
 #endif
-                                        , systeminfo.cpu.usage.user > 0. ? systeminfo.cpu.usage.user : 0., systeminfo.cpu.usage.system > 0. ? systeminfo.cpu.usage.system : 0.
+                , info.cpu.usage.user > 0. ? info.cpu.usage.user : 0., info.cpu.usage.system > 0. ? info.cpu.usage.system : 0.
 #ifdef HAVE_CPU_WAIT
-                                        , systeminfo.cpu.usage.wait > 0. ? systeminfo.cpu.usage.wait : 0.
+                , info.cpu.usage.wait > 0. ? info.cpu.usage.wait : 0.
 #endif
-                                );
-                                _formatStatus("memory usage", Event_Resource, type, res, s, true, "%s [%.1f%%]", Str_bytesToSize(systeminfo.memory.usage.bytes, (char[10]){}), systeminfo.memory.usage.percent);
-                                _formatStatus("swap usage", Event_Resource, type, res, s, true, "%s [%.1f%%]", Str_bytesToSize(systeminfo.swap.usage.bytes, (char[10]){}), systeminfo.swap.usage.percent);
-                                _formatStatus("uptime", Event_Uptime, type, res, s, systeminfo.booted > 0, "%s", _getUptime(Time_now() - systeminfo.booted, (char[256]){}));
-                                _formatStatus("boot time", Event_Null, type, res, s, true, "%s", Time_string(systeminfo.booted, (char[32]){}));
+        );
+        _formatStatus("memory usage", Event_Resource, type, res, s, true, "%s [%.1f%%]", Str_bytesToSize(info.memory.usage.bytes, (char[10]){}), info.memory.usage.percent);
+        _formatStatus("swap usage", Event_Resource, type, res, s, true, "%s [%.1f%%]", Str_bytesToSize(info.swap.usage.bytes, (char[10]){}), info.swap.usage.percent);
+        if (info.memory.extended) {
+                _formatStatus("memory available", Event_Resource, type, res, s, true, "%s [%.1f%%]", Str_bytesToSize(info.memory.available.bytes, (char[10]){}), info.memory.available.percent);
+                _formatStatus("memory dirty", Event_Resource, type, res, s, true, "%s (writeback %s)", Str_bytesToSize(info.memory.dirty, (char[10]){}), Str_bytesToSize(info.memory.writeback, (char[10]){}));
+                _formatStatus("unreclaimable slab", Event_Resource, type, res, s, true, "%s", Str_bytesToSize(info.memory.slabUnreclaimable, (char[10]){}));
+                if (info.memory.hugepages.size > 0)
+                        _formatStatus("huge pages usage", Event_Resource, type, res, s, true, "%s of %s [%.1f%%]", Str_bytesToSize(info.memory.hugepages.bytes, (char[10]){}), Str_bytesToSize(info.memory.hugepages.size, (char[10]){}), info.memory.hugepages.percent);
+        }
+        _formatStatus("uptime", Event_Uptime, type, res, s, info.booted > 0, "%s", _getUptime(Time_now() - info.booted, (char[256]){}));
+        _formatStatus("boot time", Event_Null, type, res, s, true, "%s", Time_string(info.booted, (char[32]){}));
+}
+
+
+static void _printStatus(Output_Type type, HttpResponse res, Service_T service) {
+        struct Snapshot_T snapshot = {};
+        Service_T s = Snapshot_get(service, &snapshot);
+        if (Util_hasServiceStatus(s)) {
+                switch (s->type) {
+                        case Service_System:
+                                _printSystemStatus(type, res, s);
                                 break;
 
                         case Service_File:
@@ -458,7 +489,9 @@ static void _printStatus(Output_Type type, HttpResponse res, Service_T s) {
                         }
                 }
         }
+        _formatStatus("check duration", Event_Null, type, res, s, s->timing.count > 0, "%s (average %s, max %s)", Str_milliToTime(s->timing.last / 1000., (char[23]){}), Str_milliToTime(Profile_average(&(s->timing)) / 1000., (char[23]){}), Str_milliToTime(s->timing.max / 1000., (char[23]){}));
         _formatStatus("data collected", Event_Null, type, res, s, true, "%s", Time_string(s->collected.tv_sec, (char[32]){}));
+        Snapshot_free(&snapshot);
 }
 
 
@@ -482,6 +515,8 @@ static void doPost(HttpRequest req, HttpResponse res) {
                 _printReport(req, res);
         else if (ACTION(DOACTION))
                 handle_doaction(req, res);
+        else if (ACTION(CHECK))
+                handle_check(req, res);
         else
                 handle_service_action(req, res);
 }
@@ -494,9 +529,7 @@ static void doPost(HttpRequest req, HttpResponse res) {
 static void doGet(HttpRequest req, HttpResponse res) {
         set_content_type(res, "text/html");
         if (ACTION(HOME)) {
-                LOCK(Run.mutex)
                 do_home(res);
-                END_LOCK;
         } else if (ACTION(RUNTIME)) {
                 handle_runtime(req, res);
         } else if (ACTION(TEST)) {
@@ -542,6 +575,7 @@ static void printFavicon(HttpResponse res) {
         }
         if (l) {
                 res->is_committed = true;
+                res->keepalive = false;
                 Socket_print(S, "HTTP/1.0 200 OK\r\n");
                 Socket_print(S, "Content-length: %lu\r\n", (unsigned long)l);
                 Socket_print(S, "Content-Type: image/x-icon\r\n");
@@ -666,7 +700,7 @@ static void do_about(HttpResponse res) {
                             "<li style='padding-bottom:10px;'>Copyright &copy; 2001-2017 <a "
                             "href='http://tildeslash.com/'>Tildeslash Ltd"
                             "</a>. All Rights Reserved.</li></ul>");
-        StringBuffer_append(res->outputbuffer, "<hr size='1'>");
+        StringBuffer_appendString(res->outputbuffer, "<hr size='1'>");
         StringBuffer_append(res->outputbuffer,
                             "<p>This program is free software; you can redistribute it and/or "
                             "modify it under the terms of the GNU Affero General Public License version 3</p>"
@@ -681,7 +715,7 @@ static void do_about(HttpResponse res) {
 
 
 static void do_ping(HttpResponse res) {
-        StringBuffer_append(res->outputbuffer, "pong");
+        StringBuffer_appendString(res->outputbuffer, "pong");
 }
 
 
@@ -742,13 +776,13 @@ static void do_runtime(HttpRequest req, HttpResponse res) {
         }
 #endif
         if (Run.mmonits) {
-                StringBuffer_append(res->outputbuffer, "<tr><td>M/Monit server(s)</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr><td>M/Monit server(s)</td><td>");
                 for (Mmonit_T c = Run.mmonits; c; c = c->next)
                 {
                         StringBuffer_append(res->outputbuffer, "%s with timeout %s", c->url->url, Str_milliToTime(c->timeout, (char[23]){}));
 #ifdef HAVE_OPENSSL
                         if (c->ssl.flags) {
-                                StringBuffer_append(res->outputbuffer, " using TLS");
+                                StringBuffer_appendString(res->outputbuffer, " using TLS");
                                 const char *options = Ssl_printOptions(&c->ssl, (char[STRLEN]){}, STRLEN);
                                 if (options && *options)
                                         StringBuffer_append(res->outputbuffer, " with options {%s}", options);
@@ -757,19 +791,19 @@ static void do_runtime(HttpRequest req, HttpResponse res) {
                         }
 #endif
                         if (Run.flags & Run_MmonitCredentials && c->url->user)
-                                StringBuffer_append(res->outputbuffer, " with credentials");
+                                StringBuffer_appendString(res->outputbuffer, " with credentials");
                         if (c->next)
-                                StringBuffer_append(res->outputbuffer, "</td></tr><tr><td>&nbsp;</td><td>");
+                                StringBuffer_appendString(res->outputbuffer, "</td></tr><tr><td>&nbsp;</td><td>");
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (Run.mailservers) {
-                StringBuffer_append(res->outputbuffer, "<tr><td>Mail server(s)</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr><td>Mail server(s)</td><td>");
                 for (MailServer_T mta = Run.mailservers; mta; mta = mta->next) {
                         StringBuffer_append(res->outputbuffer, "%s:%d", mta->host, mta->port);
 #ifdef HAVE_OPENSSL
                         if (mta->ssl.flags) {
-                                StringBuffer_append(res->outputbuffer, " using TLS");
+                                StringBuffer_appendString(res->outputbuffer, " using TLS");
                                 const char *options = Ssl_printOptions(&mta->ssl, (char[STRLEN]){}, STRLEN);
                                 if (options && *options)
                                         StringBuffer_append(res->outputbuffer, " with options {%s}", options);
@@ -778,25 +812,25 @@ static void do_runtime(HttpRequest req, HttpResponse res) {
                         }
 #endif
                         if (mta->next)
-                                StringBuffer_append(res->outputbuffer, "</td></tr><tr><td>&nbsp;</td><td>");
+                                StringBuffer_appendString(res->outputbuffer, "</td></tr><tr><td>&nbsp;</td><td>");
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (Run.MailFormat.from) {
-                StringBuffer_append(res->outputbuffer, "<tr><td>Default mail from</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr><td>Default mail from</td><td>");
                 if (Run.MailFormat.from->name)
                         StringBuffer_append(res->outputbuffer, "%s &lt;%s&gt;", Run.MailFormat.from->name, Run.MailFormat.from->address);
                 else
                         StringBuffer_append(res->outputbuffer, "%s", Run.MailFormat.from->address);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (Run.MailFormat.replyto) {
-                StringBuffer_append(res->outputbuffer, "<tr><td>Default mail reply to</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr><td>Default mail reply to</td><td>");
                 if (Run.MailFormat.replyto->name)
                         StringBuffer_append(res->outputbuffer, "%s &lt;%s&gt;", Run.MailFormat.replyto->name, Run.MailFormat.replyto->address);
                 else
                         StringBuffer_append(res->outputbuffer, "%s", Run.MailFormat.replyto->address);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (Run.MailFormat.subject)
                 StringBuffer_append(res->outputbuffer, "<tr><td>Default mail subject</td><td>%s</td></tr>", Run.MailFormat.subject);
@@ -840,7 +874,8 @@ static void do_runtime(HttpRequest req, HttpResponse res) {
                             "<tr><td>httpd auth. style</td><td>%s</td></tr>",
                             Run.httpd.credentials && Engine_hasAllow() ? "Basic Authentication and Host/Net allow list" : Run.httpd.credentials ? "Basic Authentication" : Engine_hasAllow() ? "Host/Net allow list" : "No authentication");
         print_alerts(res, Run.maillist);
-        StringBuffer_append(res->outputbuffer, "</table>");
+        StringBuffer_appendString(res->outputbuffer, "</table>");
+        print_profile(res);
         if (! is_readonly(req)) {
                 StringBuffer_append(res->outputbuffer,
                                     "<table id='buttons'><tr>");
@@ -880,41 +915,189 @@ static void do_runtime(HttpRequest req, HttpResponse res) {
 }
 
 
+// Read the log backwards in windows of this size when looking for the tail lines
+#define VIEWLOG_WINDOW   (1024 * 1024)
+// The default number of lines shown by the log view page
+#define VIEWLOG_LINES    1000
+// Maximum page size of the log view page
+#define VIEWLOG_MAXBYTES (4 * 1024 * 1024)
+
+
+/**
+ * Parse the non-negative number parameter, return the default value if the parameter is not set or invalid
+ */
+static long long _getNumberParameter(HttpRequest req, const char *name, long long defaultValue) {
+        const char *value = get_parameter(req, name);
+        if (STR_DEF(value)) {
+                char *end;
+                long long n = strtoll(value, &end, 10);
+                if (! *end && n >= 0)
+                        return n;
+        }
+        return defaultValue;
+}
+
+
+/**
+ * Find the start of the last lines lines of the file region [0, end). The file is mapped in windows from
+ * the end backwards, so only the tail is touched regardless of the file size. Returns -1 on error
+ */
+static off_t _getLogTail(int fd, off_t end, long long lines) {
+        long page = sysconf(_SC_PAGESIZE);
+        off_t position = end;
+        while (lines > 0 && position > 0) {
+                off_t start = position > VIEWLOG_WINDOW ? position - VIEWLOG_WINDOW : 0;
+                start -= start % page;
+                size_t length = (size_t)(position - start);
+                unsigned char *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, start);
+                if (map == MAP_FAILED)
+                        return -1;
+                for (size_t i = length; i > 0; i--) {
+                        // The newline which terminates the last line doesn't start a new line
+                        if (map[i - 1] == '\n' && start + (off_t)i < end && --lines == 0) {
+                                munmap(map, length);
+                                return start + i;
+                        }
+                }
+                munmap(map, length);
+                position = start;
+        }
+        return lines > 0 ? 0 : end;
+}
+
+
+/**
+ * Parse the byte range header ("bytes=first-last", "bytes=first-" or "bytes=-suffix"), only one range is supported.
+ * Returns false if the range is not satisfiable
+ */
+static boolean_t _getRange(const char *range, off_t size, off_t *start, off_t *end) {
+        long long first = -1, last = -1;
+        if (sscanf(range, "bytes=%lld-%lld", &first, &last) >= 1 && first >= 0) {
+                if (first >= size || (last >= 0 && last < first))
+                        return false;
+                *start = first;
+                *end = last >= 0 && last < size ? last + 1 : size;
+        } else if (sscanf(range, "bytes=-%lld", &last) == 1 && last > 0) {
+                *start = last < size ? size - last : 0;
+                *end = size;
+        } else {
+                return false;
+        }
+        return true;
+}
+
+
+/**
+ * Print the log page navigation button
+ */
+static void _printLogButton(HttpResponse res, const char *label, long long lines, off_t end) {
+        StringBuffer_append(res->outputbuffer,
+                            "<form method=POST action='_viewlog' style='display:inline'>"
+                            "<input type=hidden name='securitytoken' value='%s'>"
+                            "<input type=hidden name='tail' value='%lld'>",
+                            res->token, lines);
+        if (end >= 0)
+                StringBuffer_append(res->outputbuffer, "<input type=hidden name='end' value='%lld'>", (long long)end);
+        StringBuffer_append(res->outputbuffer, "<input type=submit value='%s'></form> ", label);
+}
+
+
+/**
+ * Serve the Monit log. The request selects a part of the log, so the log is never read whole:
+ *   tail=N                   the last N lines before the end (default: the end of the file)
+ *   end=B                    the end offset of the selected region
+ *   offset=B and length=B    the byte range [offset, offset + length)
+ * The format=text variant sends the selected region (or the whole log) as plain text with sendfile and
+ * supports the Range header. A client can follow the log by polling with offset set to the previous size
+ */
 static void do_viewlog(HttpRequest req, HttpResponse res) {
         if (is_readonly(req)) {
                 send_error(req, res, SC_FORBIDDEN, "You do not have sufficient privileges to access this page");
                 return;
         }
-        do_head(res, "_viewlog", "View log", 100);
-        if ((Run.flags & Run_Log) && ! (Run.flags & Run_UseSyslog)) {
-                struct stat sb;
-                if (! stat(Run.files.log, &sb)) {
-                        FILE *f = fopen(Run.files.log, "r");
-                        if (f) {
-#define BUFSIZE 512
-                                size_t n;
-                                char buf[BUFSIZE+1];
-                                StringBuffer_append(res->outputbuffer, "<br><p><form><textarea cols=120 rows=30 readonly>");
-                                while ((n = fread(buf, sizeof(char), BUFSIZE, f)) > 0) {
-                                        buf[n] = 0;
-                                        StringBuffer_append(res->outputbuffer, "%s", buf);
-                                }
-                                fclose(f);
-                                StringBuffer_append(res->outputbuffer, "</textarea></form>");
-                        } else {
-                                StringBuffer_append(res->outputbuffer, "Error opening logfile: %s", STRERROR);
-                        }
-                } else {
-                        StringBuffer_append(res->outputbuffer, "Error stating logfile: %s", STRERROR);
-                }
-        } else {
-                StringBuffer_append(res->outputbuffer,
-                                    "<b>Cannot view logfile:</b><br>");
+        if (! (Run.flags & Run_Log) || (Run.flags & Run_UseSyslog)) {
+                do_head(res, "_viewlog", "View log", 100);
+                StringBuffer_appendString(res->outputbuffer, "<b>Cannot view logfile:</b><br>");
                 if (! (Run.flags & Run_Log))
-                        StringBuffer_append(res->outputbuffer, "Monit was started without logging");
+                        StringBuffer_appendString(res->outputbuffer, "Monit was started without logging");
                 else
-                        StringBuffer_append(res->outputbuffer, "Monit uses syslog");
+                        StringBuffer_appendString(res->outputbuffer, "Monit uses syslog");
+                do_foot(res);
+                return;
+        }
+        boolean_t text = Str_isEqual(get_parameter(req, "format"), "text");
+        struct stat sb;
+        int fd = open(Run.files.log, O_RDONLY);
+        if (fd < 0 || fstat(fd, &sb)) {
+                send_error(req, res, SC_INTERNAL_SERVER_ERROR, "Cannot open logfile: %s", STRERROR);
+                if (fd >= 0)
+                        close(fd);
+                return;
+        }
+        // Select the region
+        off_t size = sb.st_size;
+        off_t end = (off_t)_getNumberParameter(req, "end", size);
+        if (end > size)
+                end = size;
+        off_t start = 0;
+        long long lines = _getNumberParameter(req, "tail", text ? 0 : VIEWLOG_LINES);
+        long long offset = _getNumberParameter(req, "offset", -1);
+        if (offset >= 0) {
+                start = offset < size ? (off_t)offset : size;
+                long long length = _getNumberParameter(req, "length", -1);
+                end = length >= 0 && length < size - start ? start + (off_t)length : size;
+        } else if (lines > 0 && (start = _getLogTail(fd, end, lines)) < 0) {
+                send_error(req, res, SC_INTERNAL_SERVER_ERROR, "Cannot read logfile: %s", STRERROR);
+                close(fd);
+                return;
+        }
+        if (text) {
+                const char *range = get_header(req, "Range");
+                set_content_type(res, "text/plain");
+                set_header(res, "Accept-Ranges", "bytes");
+                set_header(res, "X-Log-Size", "%lld", (long long)size);
+                if (range) {
+                        if (! _getRange(range, size, &start, &end)) {
+                                send_error(req, res, SC_RANGE_NOT_SATISFIABLE, "Invalid range");
+                                set_header(res, "Content-Range", "bytes */%lld", (long long)size);
+                                close(fd);
+                                return;
+                        }
+                        set_status(res, SC_PARTIAL_CONTENT);
+                        set_header(res, "Content-Range", "bytes %lld-%lld/%lld", (long long)start, (long long)end - 1, (long long)size);
+                }
+                // The region is sent by the kernel, without copying it to the output buffer
+                set_file(res, fd, start, end - start);
+                return;
         }
+        if (end - start > VIEWLOG_MAXBYTES)
+                start = end - VIEWLOG_MAXBYTES;
+        do_head(res, "_viewlog", "View log", 100);
+        StringBuffer_append(res->outputbuffer, "<br><p>Showing bytes %lld-%lld of %lld<form><textarea cols=120 rows=30 readonly>", (long long)start, (long long)end, (long long)size);
+        char buf[8193];
+        for (off_t position = start; position < end;) {
+                ssize_t n = pread(fd, buf, end - position < 8192 ? end - position : 8192, position);
+                if (n <= 0)
+                        break;
+                buf[n] = 0;
+                StringBuffer_appendEscapedHTML(res->outputbuffer, buf);
+                position += n;
+        }
+        close(fd);
+        StringBuffer_appendString(res->outputbuffer, "</textarea></form>");
+        if (lines <= 0)
+                lines = VIEWLOG_LINES;
+        if (start > 0)
+                _printLogButton(res, "Older", lines, start);
+        if (end < size)
+                _printLogButton(res, "Latest", lines, -1);
+        StringBuffer_append(res->outputbuffer,
+                            "<form method=POST action='_viewlog' style='display:inline'>"
+                            "<input type=hidden name='securitytoken' value='%s'>"
+                            "<input type=hidden name='format' value='text'>"
+                            "<input type=submit value='Download as text'>"
+                            "</form>",
+                            res->token);
         do_foot(res);
 }
 
@@ -948,14 +1131,15 @@ static void handle_service_action(HttpRequest req, HttpResponse res) {
                         send_error(req, res, SC_BAD_REQUEST, "Invalid action \"%s\"", action);
                         return;
                 }
-                s->doaction = doaction;
                 const char *token = get_parameter(req, "token");
                 if (token) {
                         FREE(s->token);
                         s->token = Str_dup(token);
                 }
+                // The validator may pick the action up immediately, publish it after the token
+                __atomic_store_n(&s->doaction, doaction, __ATOMIC_RELEASE);
                 LogInfo("'%s' %s on user request\n", s->name, action);
-                Run.flags |= Run_ActionPending; /* set the global flag */
+                RUN_SET(Run_ActionPending); /* set the global flag */
                 do_wakeupcall();
         }
         do_service(req, res, s);
@@ -976,38 +1160,111 @@ static void handle_doaction(HttpRequest req, HttpResponse res) {
                         send_error(req, res, SC_BAD_REQUEST, "Invalid action \"%s\"", action);
                         return;
                 }
+                int count = 0;
+                List_T services = List_new();
+                StringBuffer_T json = StringBuffer_create(64);
                 for (HttpParameter p = req->params; p; p = p->next) {
                         if (IS(p->name, "service")) {
-                                s  = Util_getService(p->value);
-                                if (! s) {
+                                // The service name or wildcard pattern
+                                int found = count;
+                                boolean_t pattern = p->value && strpbrk(p->value, "*?[");
+                                for (s = pattern ? servicelist : Util_getService(NVLSTR(p->value)); s; s = pattern ? s->next : NULL) {
+                                        if (! pattern || Util_matchService(s, p->value)) {
+                                                List_append(services, s);
+                                                LogInfo("'%s' %s on user request\n", s->name, action);
+                                                StringBuffer_append(json, "%s", count++ ? "," : "");
+                                                _appendJsonString(json, s->name);
+                                        }
+                                }
+                                if (found == count) {
+                                        List_free(&services);
+                                        StringBuffer_free(&json);
                                         send_error(req, res, SC_BAD_REQUEST, "There is no service named \"%s\"", p->value ? p->value : "");
                                         return;
                                 }
-                                s->doaction = doaction;
-                                LogInfo("'%s' %s on user request\n", s->name, action);
                         }
                 }
                 /* Set token for last service only so we'll get it back after all services were handled */
-                if (token) {
-                        Service_T q = NULL;
-                        for (s = servicelist; s; s = s->next)
-                                if (s->doaction == doaction)
-                                        q = s;
-                        if (q) {
-                                FREE(q->token);
-                                q->token = Str_dup(token);
-                        }
+                if (token && services->tail) {
+                        Service_T q = services->tail->e;
+                        FREE(q->token);
+                        q->token = Str_dup(token);
                 }
-                Run.flags |= Run_ActionPending;
+                // The validator may pick the actions up immediately, publish them after the token
+                for (list_t m = services->head; m; m = m->next)
+                        __atomic_store_n(&((Service_T)m->e)->doaction, doaction, __ATOMIC_RELEASE);
+                List_free(&services);
+                RUN_SET(Run_ActionPending);
                 do_wakeupcall();
+                const char *stringFormat = get_parameter(req, "format");
+                if (stringFormat && Str_startsWith(stringFormat, "json")) {
+                        set_content_type(res, "application/json");
+                        StringBuffer_append(res->outputbuffer, "{\"action\":");
+                        _appendJsonString(res->outputbuffer, action);
+                        StringBuffer_append(res->outputbuffer, ",\"services\":[%s]}\n", StringBuffer_toString(json));
+                }
+                StringBuffer_free(&json);
         }
 }
 
 
+/**
+ * Check the requested services now and respond with their status when done.
+ * The number of the services which did not pass is sent in the
+ * X-Monit-Failed header
+ */
+static void handle_check(HttpRequest req, HttpResponse res) {
+        if (is_readonly(req)) {
+                send_error(req, res, SC_FORBIDDEN, "You do not have sufficient privileges to access this page");
+                return;
+        }
+        List_T services = List_new();
+        const char *group = get_parameter(req, "group");
+        if (group) {
+                ServiceGroup_T sg = Util_getServiceGroup(group);
+                if (! sg) {
+                        List_free(&services);
+                        send_error(req, res, SC_BAD_REQUEST, "Service group '%s' not found", group);
+                        return;
+                }
+                for (list_t m = sg->members->head; m; m = m->next)
+                        List_append(services, m->e);
+        }
+        for (HttpParameter p = req->params; p; p = p->next) {
+                if (IS(p->name, "service")) {
+                        // The service name or wildcard pattern
+                        int found = List_length(services);
+                        boolean_t pattern = p->value && strpbrk(p->value, "*?[");
+                        for (Service_T s = pattern ? servicelist : Util_getService(NVLSTR(p->value)); s; s = pattern ? s->next : NULL)
+                                if (! pattern || Util_matchService(s, p->value))
+                                        List_append(services, s);
+                        if (found == List_length(services)) {
+                                List_free(&services);
+                                send_error(req, res, SC_BAD_REQUEST, "There is no service named \"%s\"", p->value ? p->value : "");
+                                return;
+                        }
+                }
+        }
+        if (List_length(services) == 0) {
+                List_free(&services);
+                send_error(req, res, SC_BAD_REQUEST, "Please specify a service name or group to check");
+                return;
+        }
+        for (list_t m = services->head; m; m = m->next)
+                LogInfo("'%s' check on user request\n", ((Service_T)m->e)->name);
+        int failed = validate_services(services);
+        List_free(&services);
+        if (failed < 0) {
+                send_error(req, res, SC_SERVICE_UNAVAILABLE, "The check was cancelled -- Monit is reloading or stopping");
+                return;
+        }
+        set_header(res, "X-Monit-Failed", "%d", failed);
+        print_status(req, res, 1);
+}
+
+
 static void handle_runtime(HttpRequest req, HttpResponse res) {
-        LOCK(Run.mutex)
         do_runtime(req, res);
-        END_LOCK;
 }
 
 
@@ -1084,7 +1341,7 @@ static void do_service(HttpRequest req, HttpResponse res, Service_T s) {
                 if (s->start->has_gid)
                         StringBuffer_append(res->outputbuffer, " as gid %d", s->start->gid);
                 StringBuffer_append(res->outputbuffer, " timeout %s", Str_milliToTime(s->start->timeout, (char[23]){}));
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (s->stop) {
                 StringBuffer_append(res->outputbuffer, "<tr><td>Stop program</td><td>'%s'", Util_commandDescription(s->stop, (char[STRLEN]){}));
@@ -1093,7 +1350,7 @@ static void do_service(HttpRequest req, HttpResponse res, Service_T s) {
                 if (s->stop->has_gid)
                         StringBuffer_append(res->outputbuffer, " as gid %d", s->stop->gid);
                 StringBuffer_append(res->outputbuffer, " timeout %s", Str_milliToTime(s->stop->timeout, (char[23]){}));
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (s->restart) {
                 StringBuffer_append(res->outputbuffer, "<tr><td>Restart program</td><td>'%s'", Util_commandDescription(s->restart, (char[STRLEN]){}));
@@ -1102,17 +1359,17 @@ static void do_service(HttpRequest req, HttpResponse res, Service_T s) {
                 if (s->restart->has_gid)
                         StringBuffer_append(res->outputbuffer, " as gid %d", s->restart->gid);
                 StringBuffer_append(res->outputbuffer, " timeout %s", Str_milliToTime(s->restart->timeout, (char[23]){}));
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         if (s->every.type != Every_Cycle) {
-                StringBuffer_append(res->outputbuffer, "<tr><td>Check service</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr><td>Check service</td><td>");
                 if (s->every.type == Every_SkipCycles)
                         StringBuffer_append(res->outputbuffer, "every %d cycle", s->every.spec.cycle.number);
                 else if (s->every.type == Every_Cron)
                         StringBuffer_append(res->outputbuffer, "every <code>\"%s\"</code>", s->every.spec.cron);
                 else if (s->every.type == Every_NotInCron)
                         StringBuffer_append(res->outputbuffer, "not every <code>\"%s\"</code>", s->every.spec.cron);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
         _printStatus(HTML, res, s);
         // Rules
@@ -1145,7 +1402,7 @@ static void do_service(HttpRequest req, HttpResponse res, Service_T s) {
         print_service_rules_program(res, s);
         print_service_rules_resource(res, s);
         print_alerts(res, s->maillist);
-        StringBuffer_append(res->outputbuffer, "</table>");
+        StringBuffer_appendString(res->outputbuffer, "</table>");
         print_buttons(req, res, s);
         do_foot(res);
 }
@@ -1154,6 +1411,7 @@ static void do_service(HttpRequest req, HttpResponse res, Service_T s) {
 static void do_home_system(HttpResponse res) {
         Service_T s = Run.system;
         char buf[STRLEN];
+        SystemInfo_T info;
 
         StringBuffer_append(res->outputbuffer,
                             "<table id='header-row'>"
@@ -1176,6 +1434,7 @@ static void do_home_system(HttpResponse res) {
                             s->name, s->name,
                             get_service_status(HTML, s, buf, sizeof(buf)));
         if (Run.flags & Run_ProcessEngineEnabled) {
+                Snapshot_getSystem(&info);
                 StringBuffer_append(res->outputbuffer,
                                     "<td class='right column'>[%.2f]&nbsp;[%.2f]&nbsp;[%.2f]</td>"
                                     "<td class='right column'>"
@@ -1184,19 +1443,19 @@ static void do_home_system(HttpResponse res) {
                                     ",&nbsp;%.1f%%wa"
 #endif
                                     "</td>",
-                                    systeminfo.loadavg[0], systeminfo.loadavg[1], systeminfo.loadavg[2],
-                                    systeminfo.cpu.usage.user > 0. ? systeminfo.cpu.usage.user : 0.,
-                                    systeminfo.cpu.usage.system > 0. ? systeminfo.cpu.usage.system : 0.
+                                    info.loadavg[0], info.loadavg[1], info.loadavg[2],
+                                    info.cpu.usage.user > 0. ? info.cpu.usage.user : 0.,
+                                    info.cpu.usage.system > 0. ? info.cpu.usage.system : 0.
 #ifdef HAVE_CPU_WAIT
-                                    , systeminfo.cpu.usage.wait > 0. ? systeminfo.cpu.usage.wait : 0.
+                                    , info.cpu.usage.wait > 0. ? info.cpu.usage.wait : 0.
 #endif
                                     );
                 StringBuffer_append(res->outputbuffer,
                                     "<td class='right column'>%.1f%% [%s]</td>",
-                                    systeminfo.memory.usage.percent, Str_bytesToSize(systeminfo.memory.usage.bytes, buf));
+                                    info.memory.usage.percent, Str_bytesToSize(info.memory.usage.bytes, buf));
                 StringBuffer_append(res->outputbuffer,
                                     "<td class='right column'>%.1f%% [%s]</td>",
-                                    systeminfo.swap.usage.percent, Str_bytesToSize(systeminfo.swap.usage.bytes, buf));
+                                    info.swap.usage.percent, Str_bytesToSize(info.swap.usage.bytes, buf));
         }
         StringBuffer_append(res->outputbuffer,
                             "</tr>"
@@ -1208,10 +1467,12 @@ static void do_home_process(HttpResponse res) {
         char      buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_Process)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_Process)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1234,24 +1495,24 @@ static void do_home_process(HttpResponse res) {
                                     s->name, s->name,
                                     get_service_status(HTML, s, buf, sizeof(buf)));
                 if (! (Run.flags & Run_ProcessEngineEnabled) || ! Util_hasServiceStatus(s) || s->inf.process->uptime < 0) {
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 } else {
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%s</td>", _getUptime(s->inf.process->uptime, (char[256]){}));
                 }
                 if (! (Run.flags & Run_ProcessEngineEnabled) || ! Util_hasServiceStatus(s) || s->inf.process->total_cpu_percent < 0) {
-                                StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                                StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 } else {
                         StringBuffer_append(res->outputbuffer, "<td class='right%s'>%.1f%%</td>", (s->error & Event_Resource) ? " red-text" : "", s->inf.process->total_cpu_percent);
                 }
                 if (! (Run.flags & Run_ProcessEngineEnabled) || ! Util_hasServiceStatus(s) || s->inf.process->total_mem_percent < 0) {
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 } else {
                         StringBuffer_append(res->outputbuffer, "<td class='right%s'>%.1f%% [%s]</td>", (s->error & Event_Resource) ? " red-text" : "", s->inf.process->total_mem_percent, Str_bytesToSize(s->inf.process->total_mem, buf));
                 }
                 boolean_t hasReadBytes = Statistics_initialized(&(s->inf.process->read.bytes));
                 boolean_t hasReadOperations = Statistics_initialized(&(s->inf.process->read.operations));
                 if (! (Run.flags & Run_ProcessEngineEnabled) || ! Util_hasServiceStatus(s) || (! hasReadBytes && ! hasReadOperations)) {
-                        StringBuffer_append(res->outputbuffer, "<td class='right column'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right column'>-</td>");
                 } else if (hasReadBytes) {
                         StringBuffer_append(res->outputbuffer, "<td class='right column%s'>%s/s</td>", (s->error & Event_Resource) ? " red-text" : "", Str_bytesToSize(Statistics_deltaNormalize(&(s->inf.process->read.bytes)), (char[10]){}));
                 } else if (hasReadOperations) {
@@ -1260,17 +1521,18 @@ static void do_home_process(HttpResponse res) {
                 boolean_t hasWriteBytes = Statistics_initialized(&(s->inf.process->write.bytes));
                 boolean_t hasWriteOperations = Statistics_initialized(&(s->inf.process->write.operations));
                 if (! (Run.flags & Run_ProcessEngineEnabled) || ! Util_hasServiceStatus(s) || (! hasWriteBytes && ! hasWriteOperations)) {
-                        StringBuffer_append(res->outputbuffer, "<td class='right column'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right column'>-</td>");
                 } else if (hasWriteBytes) {
                         StringBuffer_append(res->outputbuffer, "<td class='right column%s'>%s/s</td>", (s->error & Event_Resource) ? " red-text" : "", Str_bytesToSize(Statistics_deltaNormalize(&(s->inf.process->write.bytes)), (char[10]){}));
                 } else if (hasWriteOperations) {
                         StringBuffer_append(res->outputbuffer, "<td class='right column%s'>%.1f/s</td>", (s->error & Event_Resource) ? " red-text" : "", Statistics_deltaNormalize(&(s->inf.process->write.operations)));
                 }
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1278,10 +1540,12 @@ static void do_home_program(HttpResponse res) {
         char buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_Program)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_Program)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1302,44 +1566,41 @@ static void do_home_program(HttpResponse res) {
                                     s->name, s->name,
                                     get_service_status(HTML, s, buf, sizeof(buf)));
                 if (! Util_hasServiceStatus(s)) {
-                        StringBuffer_append(res->outputbuffer, "<td class='left'>-</td>");
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='left'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 } else {
                         if (s->program->started) {
-                                StringBuffer_append(res->outputbuffer, "<td class='left short'>");
+                                StringBuffer_appendString(res->outputbuffer, "<td class='left short'>");
                                 if (StringBuffer_length(s->program->output)) {
                                         // Print first line only (escape HTML characters if any)
                                         const char *output = StringBuffer_toString(s->program->output);
-                                        for (int i = 0; output[i]; i++) {
-                                                if (output[i] == '<')
-                                                        StringBuffer_append(res->outputbuffer, "&lt;");
-                                                else if (output[i] == '>')
-                                                        StringBuffer_append(res->outputbuffer, "&gt;");
-                                                else if (output[i] == '&')
-                                                        StringBuffer_append(res->outputbuffer, "&amp;");
-                                                else if (output[i] == '\r' || output[i] == '\n')
-                                                        break;
-                                                else
-                                                        StringBuffer_append(res->outputbuffer, "%c", output[i]);
+                                        size_t length = strcspn(output, "\r\n");
+                                        if (output[length]) {
+                                                char *line = Str_ndup(output, (long)length);
+                                                StringBuffer_appendEscapedHTML(res->outputbuffer, line);
+                                                FREE(line);
+                                        } else {
+                                                StringBuffer_appendEscapedHTML(res->outputbuffer, output);
                                         }
                                 } else {
-                                        StringBuffer_append(res->outputbuffer, "no output");
+                                        StringBuffer_appendString(res->outputbuffer, "no output");
                                 }
-                                StringBuffer_append(res->outputbuffer, "</td>");
+                                StringBuffer_appendString(res->outputbuffer, "</td>");
                                 StringBuffer_append(res->outputbuffer, "<td class='right'>%s</td>", Time_fmt((char[32]){}, 32, "%d %b %Y %H:%M:%S", s->program->started));
                                 StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->program->exitStatus);
                         } else {
-                                StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
-                                StringBuffer_append(res->outputbuffer, "<td class='right'>Not yet started</td>");
-                                StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                                StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
+                                StringBuffer_appendString(res->outputbuffer, "<td class='right'>Not yet started</td>");
+                                StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                         }
                 }
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 
 }
 
@@ -1348,10 +1609,12 @@ static void do_home_net(HttpResponse res) {
         char buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_Net)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_Net)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1371,17 +1634,18 @@ static void do_home_net(HttpResponse res) {
                                     s->name, s->name,
                                     get_service_status(HTML, s, buf, sizeof(buf)));
                 if (! Util_hasServiceStatus(s) || Link_getState(s->inf.net->stats) != 1) {
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 } else {
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%s&#47;s</td>", Str_bytesToSize(Link_getBytesOutPerSecond(s->inf.net->stats), buf));
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%s&#47;s</td>", Str_bytesToSize(Link_getBytesInPerSecond(s->inf.net->stats), buf));
                 }
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1389,10 +1653,12 @@ static void do_home_filesystem(HttpResponse res) {
         char buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_Filesystem)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_Filesystem)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1443,11 +1709,12 @@ static void do_home_filesystem(HttpResponse res) {
                                             (s->error & Event_Resource) ? " red-text" : "",
                                             Str_bytesToSize(Statistics_deltaNormalize(&(s->inf.filesystem->write.bytes)), (char[10]){}));
                 }
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1455,10 +1722,12 @@ static void do_home_file(HttpResponse res) {
         char buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_File)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_File)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1481,26 +1750,27 @@ static void do_home_file(HttpResponse res) {
                                     s->name, s->name,
                                     get_service_status(HTML, s, buf, sizeof(buf)));
                 if (! Util_hasServiceStatus(s) || s->inf.file->size < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%s</td>", Str_bytesToSize(s->inf.file->size, (char[10]){}));
                 if (! Util_hasServiceStatus(s) || s->inf.file->mode < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%04o</td>", s->inf.file->mode & 07777);
                 if (! Util_hasServiceStatus(s) || s->inf.file->uid < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->inf.file->uid);
                 if (! Util_hasServiceStatus(s) || s->inf.file->gid < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->inf.file->gid);
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1508,10 +1778,12 @@ static void do_home_fifo(HttpResponse res) {
         char buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_Fifo)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_Fifo)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1532,22 +1804,23 @@ static void do_home_fifo(HttpResponse res) {
                                     s->name, s->name,
                                     get_service_status(HTML, s, buf, sizeof(buf)));
                 if (! Util_hasServiceStatus(s) || s->inf.fifo->mode < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%04o</td>", s->inf.fifo->mode & 07777);
                 if (! Util_hasServiceStatus(s) || s->inf.fifo->uid < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->inf.fifo->uid);
                 if (! Util_hasServiceStatus(s) || s->inf.fifo->gid < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->inf.fifo->gid);
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1555,10 +1828,12 @@ static void do_home_directory(HttpResponse res) {
         char buf[STRLEN];
         boolean_t on = true;
         boolean_t header = true;
+        struct Snapshot_T snapshot = {};
 
-        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                if (s->type != Service_Directory)
+        for (Service_T service = servicelist_conf; service; service = service->next_conf) {
+                if (service->type != Service_Directory)
                         continue;
+                Service_T s = Snapshot_get(service, &snapshot);
                 if (header) {
                         StringBuffer_append(res->outputbuffer,
                                             "<table id='header-row'>"
@@ -1579,22 +1854,23 @@ static void do_home_directory(HttpResponse res) {
                                     s->name, s->name,
                                     get_service_status(HTML, s, buf, sizeof(buf)));
                 if (! Util_hasServiceStatus(s) || s->inf.directory->mode < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%04o</td>", s->inf.directory->mode & 07777);
                 if (! Util_hasServiceStatus(s) || s->inf.directory->uid < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->inf.directory->uid);
                 if (! Util_hasServiceStatus(s) || s->inf.directory->gid < 0)
-                        StringBuffer_append(res->outputbuffer, "<td class='right'>-</td>");
+                        StringBuffer_appendString(res->outputbuffer, "<td class='right'>-</td>");
                 else
                         StringBuffer_append(res->outputbuffer, "<td class='right'>%d</td>", s->inf.directory->gid);
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
+        Snapshot_free(&snapshot);
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1631,24 +1907,24 @@ static void do_home_host(HttpResponse res) {
                                             "<td class='right'>");
                         for (Icmp_T icmp = s->icmplist; icmp; icmp = icmp->next) {
                                 if (icmp != s->icmplist)
-                                        StringBuffer_append(res->outputbuffer, "&nbsp;&nbsp;<b>|</b>&nbsp;&nbsp;");
+                                        StringBuffer_appendString(res->outputbuffer, "&nbsp;&nbsp;<b>|</b>&nbsp;&nbsp;");
                                 switch (icmp->is_available) {
                                         case Connection_Init:
-                                                StringBuffer_append(res->outputbuffer, "<span class='gray-text'>[Ping]</span>");
+                                                StringBuffer_appendString(res->outputbuffer, "<span class='gray-text'>[Ping]</span>");
                                                 break;
                                         case Connection_Failed:
-                                                StringBuffer_append(res->outputbuffer, "<span class='red-text'>[Ping]</span>");
+                                                StringBuffer_appendString(res->outputbuffer, "<span class='red-text'>[Ping]</span>");
                                                 break;
                                         default:
-                                                StringBuffer_append(res->outputbuffer, "<span>[Ping]</span>");
+                                                StringBuffer_appendString(res->outputbuffer, "<span>[Ping]</span>");
                                                 break;
                                 }
                         }
                         if (s->icmplist && s->portlist)
-                                StringBuffer_append(res->outputbuffer, "&nbsp;&nbsp;<b>|</b>&nbsp;&nbsp;");
+                                StringBuffer_appendString(res->outputbuffer, "&nbsp;&nbsp;<b>|</b>&nbsp;&nbsp;");
                         for (Port_T port = s->portlist; port; port = port->next) {
                                 if (port != s->portlist)
-                                        StringBuffer_append(res->outputbuffer, "&nbsp;&nbsp;<b>|</b>&nbsp;&nbsp;");
+                                        StringBuffer_appendString(res->outputbuffer, "&nbsp;&nbsp;<b>|</b>&nbsp;&nbsp;");
                                 switch (port->is_available) {
                                         case Connection_Init:
                                                 StringBuffer_append(res->outputbuffer, "<span class='gray-text'>[%s] at port %d</span>", port->protocol->name, port->target.net.port);
@@ -1664,13 +1940,13 @@ static void do_home_host(HttpResponse res) {
                                                 break;
                                 }
                         }
-                        StringBuffer_append(res->outputbuffer, "</td>");
+                        StringBuffer_appendString(res->outputbuffer, "</td>");
                 }
-                StringBuffer_append(res->outputbuffer, "</tr>");
+                StringBuffer_appendString(res->outputbuffer, "</tr>");
                 on = ! on;
         }
         if (! header)
-                StringBuffer_append(res->outputbuffer, "</table>");
+                StringBuffer_appendString(res->outputbuffer, "</table>");
 }
 
 
@@ -1682,74 +1958,74 @@ static void print_alerts(HttpResponse res, Mail_T s) {
                 StringBuffer_append(res->outputbuffer,
                                     "<tr class='stripe'><td>Alert mail to</td>"
                                     "<td>%s</td></tr>", r->to ? r->to : "");
-                StringBuffer_append(res->outputbuffer, "<tr><td>Alert on</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr><td>Alert on</td><td>");
                 if (r->events == Event_Null) {
-                        StringBuffer_append(res->outputbuffer, "No events");
+                        StringBuffer_appendString(res->outputbuffer, "No events");
                 } else if (r->events == Event_All) {
-                        StringBuffer_append(res->outputbuffer, "All events");
+                        StringBuffer_appendString(res->outputbuffer, "All events");
                 } else {
                         if (IS_EVENT_SET(r->events, Event_Action))
-                                StringBuffer_append(res->outputbuffer, "Action ");
+                                StringBuffer_appendString(res->outputbuffer, "Action ");
                         if (IS_EVENT_SET(r->events, Event_ByteIn))
-                                StringBuffer_append(res->outputbuffer, "ByteIn ");
+                                StringBuffer_appendString(res->outputbuffer, "ByteIn ");
                         if (IS_EVENT_SET(r->events, Event_ByteOut))
-                                StringBuffer_append(res->outputbuffer, "ByteOut ");
+                                StringBuffer_appendString(res->outputbuffer, "ByteOut ");
                         if (IS_EVENT_SET(r->events, Event_Checksum))
-                                StringBuffer_append(res->outputbuffer, "Checksum ");
+                                StringBuffer_appendString(res->outputbuffer, "Checksum ");
                         if (IS_EVENT_SET(r->events, Event_Connection))
-                                StringBuffer_append(res->outputbuffer, "Connection ");
+                                StringBuffer_appendString(res->outputbuffer, "Connection ");
                         if (IS_EVENT_SET(r->events, Event_Content))
-                                StringBuffer_append(res->outputbuffer, "Content ");
+                                StringBuffer_appendString(res->outputbuffer, "Content ");
                         if (IS_EVENT_SET(r->events, Event_Data))
-                                StringBuffer_append(res->outputbuffer, "Data ");
+                                StringBuffer_appendString(res->outputbuffer, "Data ");
                         if (IS_EVENT_SET(r->events, Event_Exec))
-                                StringBuffer_append(res->outputbuffer, "Exec ");
+                                StringBuffer_appendString(res->outputbuffer, "Exec ");
                         if (IS_EVENT_SET(r->events, Event_Exist))
-                                StringBuffer_append(res->outputbuffer, "Exist ");
+                                StringBuffer_appendString(res->outputbuffer, "Exist ");
                         if (IS_EVENT_SET(r->events, Event_FsFlag))
-                                StringBuffer_append(res->outputbuffer, "Fsflags ");
+                                StringBuffer_appendString(res->outputbuffer, "Fsflags ");
                         if (IS_EVENT_SET(r->events, Event_Gid))
-                                StringBuffer_append(res->outputbuffer, "Gid ");
+                                StringBuffer_appendString(res->outputbuffer, "Gid ");
                         if (IS_EVENT_SET(r->events, Event_Instance))
-                                StringBuffer_append(res->outputbuffer, "Instance ");
+                                StringBuffer_appendString(res->outputbuffer, "Instance ");
                         if (IS_EVENT_SET(r->events, Event_Invalid))
-                                StringBuffer_append(res->outputbuffer, "Invalid ");
+                                StringBuffer_appendString(res->outputbuffer, "Invalid ");
                         if (IS_EVENT_SET(r->events, Event_Link))
-                                StringBuffer_append(res->outputbuffer, "Link ");
+                                StringBuffer_appendString(res->outputbuffer, "Link ");
                         if (IS_EVENT_SET(r->events, Event_NonExist))
-                                StringBuffer_append(res->outputbuffer, "Nonexist ");
+                                StringBuffer_appendString(res->outputbuffer, "Nonexist ");
                         if (IS_EVENT_SET(r->events, Event_Permission))
-                                StringBuffer_append(res->outputbuffer, "Permission ");
+                                StringBuffer_appendString(res->outputbuffer, "Permission ");
                         if (IS_EVENT_SET(r->events, Event_PacketIn))
-                                StringBuffer_append(res->outputbuffer, "PacketIn ");
+                                StringBuffer_appendString(res->outputbuffer, "PacketIn ");
                         if (IS_EVENT_SET(r->events, Event_PacketOut))
-                                StringBuffer_append(res->outputbuffer, "PacketOut ");
+                                StringBuffer_appendString(res->outputbuffer, "PacketOut ");
                         if (IS_EVENT_SET(r->events, Event_Pid))
-                                StringBuffer_append(res->outputbuffer, "PID ");
+                                StringBuffer_appendString(res->outputbuffer, "PID ");
                         if (IS_EVENT_SET(r->events, Event_Icmp))
-                                StringBuffer_append(res->outputbuffer, "Ping ");
+                                StringBuffer_appendString(res->outputbuffer, "Ping ");
                         if (IS_EVENT_SET(r->events, Event_PPid))
-                                StringBuffer_append(res->outputbuffer, "PPID ");
+                                StringBuffer_appendString(res->outputbuffer, "PPID ");
                         if (IS_EVENT_SET(r->events, Event_Resource))
-                                StringBuffer_append(res->outputbuffer, "Resource ");
+                                StringBuffer_appendString(res->outputbuffer, "Resource ");
                         if (IS_EVENT_SET(r->events, Event_Saturation))
-                                StringBuffer_append(res->outputbuffer, "Saturation ");
+                                StringBuffer_appendString(res->outputbuffer, "Saturation ");
                         if (IS_EVENT_SET(r->events, Event_Size))
-                                StringBuffer_append(res->outputbuffer, "Size ");
+                                StringBuffer_appendString(res->outputbuffer, "Size ");
                         if (IS_EVENT_SET(r->events, Event_Speed))
-                                StringBuffer_append(res->outputbuffer, "Speed ");
+                                StringBuffer_appendString(res->outputbuffer, "Speed ");
                         if (IS_EVENT_SET(r->events, Event_Status))
-                                StringBuffer_append(res->outputbuffer, "Status ");
+                                StringBuffer_appendString(res->outputbuffer, "Status ");
                         if (IS_EVENT_SET(r->events, Event_Timeout))
-                                StringBuffer_append(res->outputbuffer, "Timeout ");
+                                StringBuffer_appendString(res->outputbuffer, "Timeout ");
                         if (IS_EVENT_SET(r->events, Event_Timestamp))
-                                StringBuffer_append(res->outputbuffer, "Timestamp ");
+                                StringBuffer_appendString(res->outputbuffer, "Timestamp ");
                         if (IS_EVENT_SET(r->events, Event_Uid))
-                                StringBuffer_append(res->outputbuffer, "Uid ");
+                                StringBuffer_appendString(res->outputbuffer, "Uid ");
                         if (IS_EVENT_SET(r->events, Event_Uptime))
-                                StringBuffer_append(res->outputbuffer, "Uptime ");
+                                StringBuffer_appendString(res->outputbuffer, "Uptime ");
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 if (r->reminder) {
                         StringBuffer_append(res->outputbuffer,
                                             "<tr><td>Alert reminder</td><td>%u cycles</td></tr>",
@@ -1759,12 +2035,54 @@ static void print_alerts(HttpResponse res, Mail_T s) {
 }
 
 
+static void print_profile(HttpResponse res) {
+        char last[23], average[23], max[23];
+        StringBuffer_append(res->outputbuffer,
+                            "<h2>Monit cycle profile</h2>"
+                            "<table id='status-table'><tr>"
+                            "<th width='40%%'>Parameter</th>"
+                            "<th width='60%%'>Value</th></tr>");
+        StringBuffer_append(res->outputbuffer, "<tr><td>Cycles</td><td>%llu (%llu exceeded the poll time)</td></tr>", profile.cycle.count, profile.overruns);
+        if (profile.cycle.count) {
+                StringBuffer_append(res->outputbuffer, "<tr><td>Cycle duration</td><td>last %s, average %s, max %s</td></tr>",
+                                    Str_milliToTime(profile.cycle.last / 1000., last), Str_milliToTime(Profile_average(&(profile.cycle)) / 1000., average), Str_milliToTime(profile.cycle.max / 1000., max));
+                for (int i = 0; i < Phase_Count; i++)
+                        StringBuffer_append(res->outputbuffer, "<tr><td>Phase %s</td><td>last %s, average %s, max %s</td></tr>",
+                                            phasenames[i], Str_milliToTime(profile.phase[i].last / 1000., last), Str_milliToTime(Profile_average(&(profile.phase[i])) / 1000., average), Str_milliToTime(profile.phase[i].max / 1000., max));
+                int buckets[PROFILE_BUCKETS];
+                int count = Profile_histogram(buckets);
+                StringBuffer_append(res->outputbuffer, "<tr><td>Last %d cycles histogram</td><td>&lt;10ms: %d, &lt;100ms: %d, &lt;1s: %d, &lt;10s: %d, &ge;10s: %d</td></tr>", count, buckets[0], buckets[1], buckets[2], buckets[3], buckets[4]);
+                StringBuffer_append(res->outputbuffer, "<tr><td>Last cycle services</td><td>%u checked, %u skipped</td></tr>", profile.counters.checked, profile.counters.skipped);
+                StringBuffer_append(res->outputbuffer, "<tr><td>Last cycle CPU usage</td><td>user %s, system %s</td></tr>",
+                                    Str_milliToTime(profile.counters.cpuUser / 1000., last), Str_milliToTime(profile.counters.cpuSystem / 1000., average));
+                StringBuffer_append(res->outputbuffer, "<tr><td>Last cycle page faults</td><td>%ld minor, %ld major</td></tr>", profile.counters.minorFaults, profile.counters.majorFaults);
+                StringBuffer_append(res->outputbuffer, "<tr><td>Last cycle context switches</td><td>%ld voluntary, %ld involuntary</td></tr>", profile.counters.contextSwitches, profile.counters.preemptions);
+                // List the most expensive services by average check duration
+                uint64_t limit = UINT64_MAX;
+                for (int i = 0; i < 10; i++) {
+                        Service_T top = NULL;
+                        for (Service_T s = servicelist_conf; s; s = s->next_conf) {
+                                uint64_t avg = Profile_average(&(s->timing));
+                                if (s->timing.count && avg < limit && (! top || avg > Profile_average(&(top->timing))))
+                                        top = s;
+                        }
+                        if (! top)
+                                break;
+                        limit = Profile_average(&(top->timing));
+                        StringBuffer_append(res->outputbuffer, "<tr><td>%s</td><td><a href='%s'>%s</a>: average %s, last %s, max %s</td></tr>",
+                                            i == 0 ? "Slowest service checks" : "&nbsp;", top->name, top->name, Str_milliToTime(limit / 1000., average), Str_milliToTime(top->timing.last / 1000., last), Str_milliToTime(top->timing.max / 1000., max));
+                }
+        }
+        StringBuffer_appendString(res->outputbuffer, "</table>");
+}
+
+
 static void print_buttons(HttpRequest req, HttpResponse res, Service_T s) {
         if (is_readonly(req)) {
                  // A read-only REMOTE_USER does not get access to these buttons
                 return;
         }
-        StringBuffer_append(res->outputbuffer, "<table id='buttons'><tr>");
+        StringBuffer_appendString(res->outputbuffer, "<table id='buttons'><tr>");
         /* Start program */
         if (s->start)
                 StringBuffer_append(res->outputbuffer,
@@ -1808,7 +2126,7 @@ static void print_buttons(HttpRequest req, HttpResponse res, Service_T s) {
                                     res->token,
                                     s->monitor ? "unmonitor" : "monitor",
                                     s->monitor ? "Disable monitoring" : "Enable monitoring");
-        StringBuffer_append(res->outputbuffer, "</tr></table>");
+        StringBuffer_appendString(res->outputbuffer, "</tr></table>");
 }
 
 
@@ -1816,32 +2134,32 @@ static void print_service_rules_timeout(HttpResponse res, Service_T s) {
         for (ActionRate_T ar = s->actionratelist; ar; ar = ar->next) {
                 StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Timeout</td><td>If restarted %d times within %d cycle(s) then ", ar->count, ar->cycle);
                 Util_printAction(ar->action->failed, res->outputbuffer);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_nonexistence(HttpResponse res, Service_T s) {
         for (NonExist_T l = s->nonexistlist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Existence</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Existence</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If doesn't exist");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_existence(HttpResponse res, Service_T s) {
         for (Exist_T l = s->existlist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Non-Existence</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Non-Existence</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If exist");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_port(HttpResponse res, Service_T s) {
         for (Port_T p = s->portlist; p; p = p->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Port</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Port</td><td>");
                 StringBuffer_T buf = StringBuffer_create(64);
                 StringBuffer_append(buf, "If failed [%s]:%d%s",
                         p->hostname, p->target.net.port, Util_portRequestDescription(p));
@@ -1853,7 +2171,7 @@ static void print_service_rules_port(HttpResponse res, Service_T s) {
                         StringBuffer_append(buf, " and retry %d times", p->retry);
 #ifdef HAVE_OPENSSL
                 if (p->target.net.ssl.options.flags) {
-                        StringBuffer_append(buf, " using TLS");
+                        StringBuffer_appendString(buf, " using TLS");
                         const char *options = Ssl_printOptions(&p->target.net.ssl.options, (char[STRLEN]){}, STRLEN);
                         if (options && *options)
                                 StringBuffer_append(buf, " with options {%s}", options);
@@ -1865,19 +2183,19 @@ static void print_service_rules_port(HttpResponse res, Service_T s) {
 #endif
                 Util_printRule(res->outputbuffer, p->action, "%s", StringBuffer_toString(buf));
                 StringBuffer_free(&buf);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_socket(HttpResponse res, Service_T s) {
         for (Port_T p = s->socketlist; p; p = p->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Unix Socket</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Unix Socket</td><td>");
                 if (p->retry > 1)
                         Util_printRule(res->outputbuffer, p->action, "If failed %s type %s protocol %s with timeout %s and retry %d time(s)", p->target.unix.pathname, Util_portTypeDescription(p), p->protocol->name, Str_milliToTime(p->timeout, (char[23]){}), p->retry);
                 else
                         Util_printRule(res->outputbuffer, p->action, "If failed %s type %s protocol %s with timeout %s", p->target.unix.pathname, Util_portTypeDescription(p), p->protocol->name, Str_milliToTime(p->timeout, (char[23]){}));
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -1886,139 +2204,146 @@ static void print_service_rules_icmp(HttpResponse res, Service_T s) {
         for (Icmp_T i = s->icmplist; i; i = i->next) {
                 switch (i->family) {
                         case Socket_Ip4:
-                                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Ping4</td><td>");
+                                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Ping4</td><td>");
                                 break;
                         case Socket_Ip6:
-                                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Ping6</td><td>");
+                                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Ping6</td><td>");
                                 break;
                         default:
-                                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Ping</td><td>");
+                                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Ping</td><td>");
                                 break;
                 }
                 Util_printRule(res->outputbuffer, i->action, "If failed [count %d size %d with timeout %s%s%s]", i->count, i->size, Str_milliToTime(i->timeout, (char[23]){}), i->outgoing.ip ? " via address " : "", i->outgoing.ip ? i->outgoing.ip : "");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_perm(HttpResponse res, Service_T s) {
         if (s->perm) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Permissions</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Permissions</td><td>");
                 if (s->perm->test_changes)
                         Util_printRule(res->outputbuffer, s->perm->action, "If changed");
                 else
                         Util_printRule(res->outputbuffer, s->perm->action, "If failed %o", s->perm->perm);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_uid(HttpResponse res, Service_T s) {
         if (s->uid) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>UID</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>UID</td><td>");
                 Util_printRule(res->outputbuffer, s->uid->action, "If failed %d", s->uid->uid);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_euid(HttpResponse res, Service_T s) {
         if (s->euid) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>EUID</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>EUID</td><td>");
                 Util_printRule(res->outputbuffer, s->euid->action, "If failed %d", s->euid->uid);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_gid(HttpResponse res, Service_T s) {
         if (s->gid) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>GID</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>GID</td><td>");
                 Util_printRule(res->outputbuffer, s->gid->action, "If failed %d", s->gid->gid);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_timestamp(HttpResponse res, Service_T s) {
         for (Timestamp_T t = s->timestamplist; t; t = t->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Timestamp</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Timestamp</td><td>");
                 if (t->test_changes)
                         Util_printRule(res->outputbuffer, t->action, "If changed");
                 else
                         Util_printRule(res->outputbuffer, t->action, "If %s %d second(s)", operatornames[t->operator], t->time);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_fsflags(HttpResponse res, Service_T s) {
         for (FsFlag_T l = s->fsflaglist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Filesystem flags</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Filesystem flags</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If changed");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
+static void _printFilesystemPercentRule(HttpResponse res, FileSystem_T dl) {
+        if (dl->aggregate.type != Aggregate_None)
+                StringBuffer_append(res->outputbuffer, "%s: ", Util_aggregateToString(&(dl->aggregate), (char[STRLEN]){}, STRLEN));
+        Util_printRule(res->outputbuffer, dl->action, "If %s %.1f%%", operatornames[dl->operator], dl->limit_percent);
+}
+
+
 static void print_service_rules_filesystem(HttpResponse res, Service_T s) {
         for (FileSystem_T dl = s->filesystemlist; dl; dl = dl->next) {
                 if (dl->resource == Resource_Inode) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Inodes usage limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Inodes usage limit</td><td>");
                         if (dl->limit_absolute > -1)
                                 Util_printRule(res->outputbuffer, dl->action, "If %s %lld", operatornames[dl->operator], dl->limit_absolute);
                         else
-                                Util_printRule(res->outputbuffer, dl->action, "If %s %.1f%%", operatornames[dl->operator], dl->limit_percent);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                                _printFilesystemPercentRule(res, dl);
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_InodeFree) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Inodes free limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Inodes free limit</td><td>");
                         if (dl->limit_absolute > -1)
                                 Util_printRule(res->outputbuffer, dl->action, "If %s %lld", operatornames[dl->operator], dl->limit_absolute);
                         else
-                                Util_printRule(res->outputbuffer, dl->action, "If %s %.1f%%", operatornames[dl->operator], dl->limit_percent);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                                _printFilesystemPercentRule(res, dl);
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_Space) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Space usage limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Space usage limit</td><td>");
                         if (dl->limit_absolute > -1) {
                                 if (s->inf.filesystem->f_bsize > 0)
                                         Util_printRule(res->outputbuffer, dl->action, "If %s %s", operatornames[dl->operator], Str_bytesToSize(dl->limit_absolute * s->inf.filesystem->f_bsize, (char[10]){}));
                                 else
                                         Util_printRule(res->outputbuffer, dl->action, "If %s %lld blocks", operatornames[dl->operator], dl->limit_absolute);
                         } else {
-                                Util_printRule(res->outputbuffer, dl->action, "If %s %.1f%%", operatornames[dl->operator], dl->limit_percent);
+                                _printFilesystemPercentRule(res, dl);
                         }
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_SpaceFree) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Space free limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Space free limit</td><td>");
                         if (dl->limit_absolute > -1) {
                                 if (s->inf.filesystem->f_bsize > 0)
                                         Util_printRule(res->outputbuffer, dl->action, "If %s %s", operatornames[dl->operator], Str_bytesToSize(dl->limit_absolute * s->inf.filesystem->f_bsize, (char[10]){}));
                                 else
                                         Util_printRule(res->outputbuffer, dl->action, "If %s %lld blocks", operatornames[dl->operator], dl->limit_absolute);
                         } else {
-                                Util_printRule(res->outputbuffer, dl->action, "If %s %.1f%%", operatornames[dl->operator], dl->limit_percent);
+                                _printFilesystemPercentRule(res, dl);
                         }
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_ReadBytes) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Read limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Read limit</td><td>");
                         Util_printRule(res->outputbuffer, dl->action, "If read %s %s/s", operatornames[dl->operator], Str_bytesToSize(dl->limit_absolute, (char[10]){}));
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_ReadOperations) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Read limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Read limit</td><td>");
                         Util_printRule(res->outputbuffer, dl->action, "If read %s %llu operations/s", operatornames[dl->operator], dl->limit_absolute);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_WriteBytes) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Write limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Write limit</td><td>");
                         Util_printRule(res->outputbuffer, dl->action, "If write %s %s/s", operatornames[dl->operator], Str_bytesToSize(dl->limit_absolute, (char[10]){}));
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_WriteOperations) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Write limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Write limit</td><td>");
                         Util_printRule(res->outputbuffer, dl->action, "If write %s %llu operations/s", operatornames[dl->operator], dl->limit_absolute);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 } else if (dl->resource == Resource_ServiceTime) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Service time limit</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Service time limit</td><td>");
                         Util_printRule(res->outputbuffer, dl->action, "If service time %s %s/operation", operatornames[dl->operator], Str_milliToTime(dl->limit_absolute, (char[23]){}));
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 }
         }
 }
@@ -2026,39 +2351,39 @@ static void print_service_rules_filesystem(HttpResponse res, Service_T s) {
 
 static void print_service_rules_size(HttpResponse res, Service_T s) {
         for (Size_T sl = s->sizelist; sl; sl = sl->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Size</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Size</td><td>");
                 if (sl->test_changes)
                         Util_printRule(res->outputbuffer, sl->action, "If changed");
                 else
                         Util_printRule(res->outputbuffer, sl->action, "If %s %llu byte(s)", operatornames[sl->operator], sl->size);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_linkstatus(HttpResponse res, Service_T s) {
         for (LinkStatus_T l = s->linkstatuslist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Link status</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Link status</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If failed");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_linkspeed(HttpResponse res, Service_T s) {
         for (LinkSpeed_T l = s->linkspeedlist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Link capacity</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Link capacity</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If changed");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_linksaturation(HttpResponse res, Service_T s) {
         for (LinkSaturation_T l = s->linksaturationlist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Link saturation</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Link saturation</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If %s %.1f%%", operatornames[l->operator], l->limit);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -2066,13 +2391,13 @@ static void print_service_rules_linksaturation(HttpResponse res, Service_T s) {
 static void print_service_rules_uploadbytes(HttpResponse res, Service_T s) {
         for (Bandwidth_T bl = s->uploadbyteslist; bl; bl = bl->next) {
                 if (bl->range == Time_Second) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Upload bytes</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Upload bytes</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %s/s", operatornames[bl->operator], Str_bytesToSize(bl->limit, (char[10]){}));
                 } else {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Total upload bytes</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Total upload bytes</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %s in last %d %s(s)", operatornames[bl->operator], Str_bytesToSize(bl->limit, (char[10]){}), bl->rangecount, Util_timestr(bl->range));
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -2080,13 +2405,13 @@ static void print_service_rules_uploadbytes(HttpResponse res, Service_T s) {
 static void print_service_rules_uploadpackets(HttpResponse res, Service_T s) {
         for (Bandwidth_T bl = s->uploadpacketslist; bl; bl = bl->next) {
                 if (bl->range == Time_Second) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Upload packets</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Upload packets</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %lld packets/s", operatornames[bl->operator], bl->limit);
                 } else {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Total upload packets</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Total upload packets</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %lld packets in last %d %s(s)", operatornames[bl->operator], bl->limit, bl->rangecount, Util_timestr(bl->range));
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -2094,13 +2419,13 @@ static void print_service_rules_uploadpackets(HttpResponse res, Service_T s) {
 static void print_service_rules_downloadbytes(HttpResponse res, Service_T s) {
         for (Bandwidth_T bl = s->downloadbyteslist; bl; bl = bl->next) {
                 if (bl->range == Time_Second) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Download bytes</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Download bytes</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %s/s", operatornames[bl->operator], Str_bytesToSize(bl->limit, (char[10]){}));
                 } else {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Total download bytes</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Total download bytes</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %s in last %d %s(s)", operatornames[bl->operator], Str_bytesToSize(bl->limit, (char[10]){}), bl->rangecount, Util_timestr(bl->range));
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -2108,36 +2433,36 @@ static void print_service_rules_downloadbytes(HttpResponse res, Service_T s) {
 static void print_service_rules_downloadpackets(HttpResponse res, Service_T s) {
         for (Bandwidth_T bl = s->downloadpacketslist; bl; bl = bl->next) {
                 if (bl->range == Time_Second) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Download packets</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Download packets</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %lld packets/s", operatornames[bl->operator], bl->limit);
                 } else {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Total download packets</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Total download packets</td><td>");
                         Util_printRule(res->outputbuffer, bl->action, "If %s %lld packets in last %d %s(s)", operatornames[bl->operator], bl->limit, bl->rangecount, Util_timestr(bl->range));
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_uptime(HttpResponse res, Service_T s) {
         for (Uptime_T ul = s->uptimelist; ul; ul = ul->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Uptime</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Uptime</td><td>");
                 Util_printRule(res->outputbuffer, ul->action, "If %s %s", operatornames[ul->operator], _getUptime(ul->uptime, (char[256]){}));
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 static void print_service_rules_content(HttpResponse res, Service_T s) {
         if (s->type != Service_Process) {
                 for (Match_T ml = s->matchignorelist; ml; ml = ml->next) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Ignore content</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Ignore content</td><td>");
                         Util_printRule(res->outputbuffer, ml->action, "If content %s \"%s\"", ml->not ? "!=" : "=", ml->match_string);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 }
                 for (Match_T ml = s->matchlist; ml; ml = ml->next) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Content match</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Content match</td><td>");
                         Util_printRule(res->outputbuffer, ml->action, "If content %s \"%s\"", ml->not ? "!=" : "=", ml->match_string);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 }
         }
 }
@@ -2145,30 +2470,30 @@ static void print_service_rules_content(HttpResponse res, Service_T s) {
 
 static void print_service_rules_checksum(HttpResponse res, Service_T s) {
         if (s->checksum) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Checksum</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Checksum</td><td>");
                 if (s->checksum->test_changes)
                         Util_printRule(res->outputbuffer, s->checksum->action, "If changed %s", checksumnames[s->checksum->type]);
                 else
                         Util_printRule(res->outputbuffer, s->checksum->action, "If failed %s(%s)", s->checksum->hash, checksumnames[s->checksum->type]);
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_pid(HttpResponse res, Service_T s) {
         for (Pid_T l = s->pidlist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>PID</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>PID</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If changed");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
 
 static void print_service_rules_ppid(HttpResponse res, Service_T s) {
         for (Pid_T l = s->ppidlist; l; l = l->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>PPID</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>PPID</td><td>");
                 Util_printRule(res->outputbuffer, l->action, "If changed");
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -2177,12 +2502,12 @@ static void print_service_rules_program(HttpResponse res, Service_T s) {
         if (s->type == Service_Program) {
                 StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Program timeout</td><td>Terminate the program if not finished within %s</td></tr>", Str_milliToTime(s->program->timeout, (char[23]){}));
                 for (Status_T status = s->statuslist; status; status = status->next) {
-                        StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>Test Exit value</td><td>");
+                        StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>Test Exit value</td><td>");
                         if (status->operator == Operator_Changed)
                                 Util_printRule(res->outputbuffer, status->action, "If exit value changed");
                         else
                                 Util_printRule(res->outputbuffer, status->action, "If exit value %s %d", operatorshortnames[status->operator], status->return_value);
-                        StringBuffer_append(res->outputbuffer, "</td></tr>");
+                        StringBuffer_appendString(res->outputbuffer, "</td></tr>");
                 }
         }
 }
@@ -2191,92 +2516,122 @@ static void print_service_rules_program(HttpResponse res, Service_T s) {
 static void print_service_rules_resource(HttpResponse res, Service_T s) {
         char buf[STRLEN];
         for (Resource_T q = s->resourcelist; q; q = q->next) {
-                StringBuffer_append(res->outputbuffer, "<tr class='rule'><td>");
+                StringBuffer_appendString(res->outputbuffer, "<tr class='rule'><td>");
                 switch (q->resource_id) {
                         case Resource_CpuPercent:
-                                StringBuffer_append(res->outputbuffer, "CPU usage limit");
+                                StringBuffer_appendString(res->outputbuffer, "CPU usage limit");
                                 break;
 
                         case Resource_CpuPercentTotal:
-                                StringBuffer_append(res->outputbuffer, "CPU usage limit (incl. children)");
+                                StringBuffer_appendString(res->outputbuffer, "CPU usage limit (incl. children)");
                                 break;
 
                         case Resource_CpuUser:
-                                StringBuffer_append(res->outputbuffer, "CPU user limit");
+                                StringBuffer_appendString(res->outputbuffer, "CPU user limit");
                                 break;
 
                         case Resource_CpuSystem:
-                                StringBuffer_append(res->outputbuffer, "CPU system limit");
+                                StringBuffer_appendString(res->outputbuffer, "CPU system limit");
                                 break;
 
                         case Resource_CpuWait:
-                                StringBuffer_append(res->outputbuffer, "CPU wait limit");
+                                StringBuffer_appendString(res->outputbuffer, "CPU wait limit");
                                 break;
 
                         case Resource_MemoryPercent:
-                                StringBuffer_append(res->outputbuffer, "Memory usage limit");
+                                StringBuffer_appendString(res->outputbuffer, "Memory usage limit");
                                 break;
 
                         case Resource_MemoryKbyte:
-                                StringBuffer_append(res->outputbuffer, "Memory amount limit");
+                                StringBuffer_appendString(res->outputbuffer, "Memory amount limit");
                                 break;
 
                         case Resource_SwapPercent:
-                                StringBuffer_append(res->outputbuffer, "Swap usage limit");
+                                StringBuffer_appendString(res->outputbuffer, "Swap usage limit");
                                 break;
 
                         case Resource_SwapKbyte:
-                                StringBuffer_append(res->outputbuffer, "Swap amount limit");
+                                StringBuffer_appendString(res->outputbuffer, "Swap amount limit");
                                 break;
 
                         case Resource_LoadAverage1m:
-                                StringBuffer_append(res->outputbuffer, "Load average (1min)");
+                                StringBuffer_appendString(res->outputbuffer, "Load average (1min)");
                                 break;
 
                         case Resource_LoadAverage5m:
-                                StringBuffer_append(res->outputbuffer, "Load average (5min)");
+                                StringBuffer_appendString(res->outputbuffer, "Load average (5min)");
                                 break;
 
                         case Resource_LoadAverage15m:
-                                StringBuffer_append(res->outputbuffer, "Load average (15min)");
+                                StringBuffer_appendString(res->outputbuffer, "Load average (15min)");
                                 break;
 
                         case Resource_Threads:
-                                StringBuffer_append(res->outputbuffer, "Threads");
+                                StringBuffer_appendString(res->outputbuffer, "Threads");
                                 break;
 
                         case Resource_Children:
-                                StringBuffer_append(res->outputbuffer, "Children");
+                                StringBuffer_appendString(res->outputbuffer, "Children");
                                 break;
 
                         case Resource_MemoryKbyteTotal:
-                                StringBuffer_append(res->outputbuffer, "Memory amount limit (incl. children)");
+                                StringBuffer_appendString(res->outputbuffer, "Memory amount limit (incl. children)");
                                 break;
 
                         case Resource_MemoryPercentTotal:
-                                StringBuffer_append(res->outputbuffer, "Memory usage limit (incl. children)");
+                                StringBuffer_appendString(res->outputbuffer, "Memory usage limit (incl. children)");
                                 break;
 
                         case Resource_ReadBytes:
-                                StringBuffer_append(res->outputbuffer, "Disk read limit");
+                                StringBuffer_appendString(res->outputbuffer, "Disk read limit");
                                 break;
 
                         case Resource_ReadOperations:
-                                StringBuffer_append(res->outputbuffer, "Disk read limit");
+                                StringBuffer_appendString(res->outputbuffer, "Disk read limit");
                                 break;
 
                         case Resource_WriteBytes:
-                                StringBuffer_append(res->outputbuffer, "Disk write limit");
+                                StringBuffer_appendString(res->outputbuffer, "Disk write limit");
                                 break;
 
                         case Resource_WriteOperations:
-                                StringBuffer_append(res->outputbuffer, "Disk write limit");
+                                StringBuffer_appendString(res->outputbuffer, "Disk write limit");
+                                break;
+
+                        case Resource_MemoryAvailablePercent:
+                                StringBuffer_appendString(res->outputbuffer, "Available memory limit");
+                                break;
+
+                        case Resource_MemoryAvailableKbyte:
+                                StringBuffer_appendString(res->outputbuffer, "Available memory limit");
+                                break;
+
+                        case Resource_MemoryDirty:
+                                StringBuffer_appendString(res->outputbuffer, "Dirty memory limit");
+                                break;
+
+                        case Resource_MemoryWriteback:
+                                StringBuffer_appendString(res->outputbuffer, "Writeback memory limit");
+                                break;
+
+                        case Resource_SlabUnreclaimable:
+                                StringBuffer_appendString(res->outputbuffer, "Unreclaimable slab limit");
+                                break;
+
+                        case Resource_HugePagesPercent:
+                                StringBuffer_appendString(res->outputbuffer, "Huge pages usage limit");
+                                break;
+
+                        case Resource_HugePagesKbyte:
+                                StringBuffer_appendString(res->outputbuffer, "Huge pages amount limit");
                                 break;
 
                         default:
                                 break;
                 }
-                StringBuffer_append(res->outputbuffer, "</td><td>");
+                StringBuffer_appendString(res->outputbuffer, "</td><td>");
+                if (q->aggregate.type != Aggregate_None)
+                        StringBuffer_append(res->outputbuffer, "%s: ", Util_aggregateToString(&(q->aggregate), buf, sizeof(buf)));
                 switch (q->resource_id) {
                         case Resource_CpuPercent:
                         case Resource_CpuPercentTotal:
@@ -2286,12 +2641,19 @@ static void print_service_rules_resource(HttpResponse res, Service_T s) {
                         case Resource_CpuWait:
                         case Resource_MemoryPercent:
                         case Resource_SwapPercent:
+                        case Resource_MemoryAvailablePercent:
+                        case Resource_HugePagesPercent:
                                 Util_printRule(res->outputbuffer, q->action, "If %s %.1f%%", operatornames[q->operator], q->limit);
                                 break;
 
                         case Resource_MemoryKbyte:
                         case Resource_SwapKbyte:
                         case Resource_MemoryKbyteTotal:
+                        case Resource_MemoryAvailableKbyte:
+                        case Resource_MemoryDirty:
+                        case Resource_MemoryWriteback:
+                        case Resource_SlabUnreclaimable:
+                        case Resource_HugePagesKbyte:
                                 Util_printRule(res->outputbuffer, q->action, "If %s %s", operatornames[q->operator], Str_bytesToSize(q->limit, buf));
                                 break;
 
@@ -2319,7 +2681,7 @@ static void print_service_rules_resource(HttpResponse res, Service_T s) {
                         default:
                                 break;
                 }
-                StringBuffer_append(res->outputbuffer, "</td></tr>");
+                StringBuffer_appendString(res->outputbuffer, "</td></tr>");
         }
 }
 
@@ -2336,10 +2698,75 @@ static boolean_t is_readonly(HttpRequest req) {
 /* ----------------------------------------------------------- Status output */
 
 
+/* Test if the service matches some "service" request parameter (name or wildcard pattern) */
+static boolean_t _isServiceRequested(HttpRequest req, Service_T s) {
+        for (HttpParameter p = req->params; p; p = p->next)
+                if (IS(p->name, "service") && p->value && Util_matchService(s, p->value))
+                        return true;
+        return false;
+}
+
+
+static void _appendJsonString(StringBuffer_T sb, const char *s) {
+        StringBuffer_appendChar(sb, '"');
+        StringBuffer_appendEscapedJSON(sb, s);
+        StringBuffer_appendChar(sb, '"');
+}
+
+
+static void _printServiceJson(StringBuffer_T sb, Service_T s, boolean_t first) {
+        StringBuffer_append(sb, "%s{\"name\":", first ? "" : ",");
+        _appendJsonString(sb, s->name);
+        StringBuffer_append(sb, ",\"type\":");
+        _appendJsonString(sb, servicetypes[s->type]);
+        StringBuffer_append(sb, ",\"status\":");
+        _appendJsonString(sb, Color_strip(get_service_status(TXT, s, (char[STRLEN]){}, STRLEN)));
+        StringBuffer_append(sb, ",\"monitor\":");
+        _appendJsonString(sb, Color_strip(get_monitoring_status(TXT, s, (char[STRLEN]){}, STRLEN)));
+        StringBuffer_append(sb, ",\"error\":%d,\"collected\":%lld", s->error, (long long)s->collected.tv_sec);
+        if (s->type == Service_Process && s->inf.process->pid > 0)
+                StringBuffer_append(sb, ",\"pid\":%d", s->inf.process->pid);
+        StringBuffer_append(sb, "}");
+}
+
+
+/* Print the status of the requested services (all by default) as one compact JSON object */
+static void print_status_json(HttpRequest req, HttpResponse res) {
+        int found = 0;
+        const char *stringGroup = get_parameter(req, "group");
+        boolean_t filter = get_parameter(req, "service") ? true : false;
+        set_content_type(res, "application/json");
+        StringBuffer_append(res->outputbuffer, "{\"version\":\"%s\",\"uptime\":%lld,\"services\":[", VERSION, (long long)ProcessTree_getProcessUptime(getpid()));
+        if (stringGroup) {
+                ServiceGroup_T sg = Util_getServiceGroup(stringGroup);
+                if (sg) {
+                        for (list_t m = sg->members->head; m; m = m->next)
+                                if (! filter || _isServiceRequested(req, m->e))
+                                        _printServiceJson(res->outputbuffer, m->e, found++ == 0);
+                }
+        } else {
+                for (Service_T s = servicelist_conf; s; s = s->next_conf)
+                        if (! filter || _isServiceRequested(req, s))
+                                _printServiceJson(res->outputbuffer, s, found++ == 0);
+        }
+        StringBuffer_append(res->outputbuffer, "]}\n");
+        if (found == 0) {
+                if (stringGroup)
+                        send_error(req, res, SC_BAD_REQUEST, "Service group '%s' not found", stringGroup);
+                else if (filter)
+                        send_error(req, res, SC_BAD_REQUEST, "Service '%s' not found", get_parameter(req, "service"));
+                else
+                        send_error(req, res, SC_BAD_REQUEST, "No service found");
+        }
+}
+
+
 /* Print status in the given format. Text status is default. */
 static void print_status(HttpRequest req, HttpResponse res, int version) {
         const char *stringFormat = get_parameter(req, "format");
-        if (stringFormat && Str_startsWith(stringFormat, "xml")) {
+        if (stringFormat && Str_startsWith(stringFormat, "json")) {
+                print_status_json(req, res);
+        } else if (stringFormat && Str_startsWith(stringFormat, "xml")) {
                 char buf[STRLEN];
                 StringBuffer_T sb = StringBuffer_create(256);
                 status_xml(sb, NULL, version, Socket_getLocalHost(req->S, buf, sizeof(buf)));
@@ -2355,18 +2782,16 @@ static void print_status(HttpRequest req, HttpResponse res, int version) {
                 const char *stringGroup = Util_urlDecode((char *)get_parameter(req, "group"));
                 const char *stringService = Util_urlDecode((char *)get_parameter(req, "service"));
                 if (stringGroup) {
-                        for (ServiceGroup_T sg = servicegrouplist; sg; sg = sg->next) {
-                                if (IS(stringGroup, sg->name)) {
-                                        for (list_t m = sg->members->head; m; m = m->next) {
-                                                status_service_txt(m->e, res);
-                                                found++;
-                                        }
-                                        break;
+                        ServiceGroup_T sg = Util_getServiceGroup(stringGroup);
+                        if (sg) {
+                                for (list_t m = sg->members->head; m; m = m->next) {
+                                        status_service_txt(m->e, res);
+                                        found++;
                                 }
                         }
                 } else {
                         for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                                if (! stringService || IS(stringService, s->name)) {
+                                if (! stringService || _isServiceRequested(req, s)) {
                                         status_service_txt(s, res);
                                         found++;
                                 }
@@ -2405,6 +2830,11 @@ static int _printServiceSummaryByType(Box_T t, Service_Type type) {
 
 
 static void print_summary(HttpRequest req, HttpResponse res) {
+        const char *stringFormat = get_parameter(req, "format");
+        if (stringFormat && Str_startsWith(stringFormat, "json")) {
+                print_status_json(req, res);
+                return;
+        }
         set_content_type(res, "text/plain");
 
         StringBuffer_append(res->outputbuffer, "Monit %s uptime: %s\n", VERSION, _getUptime(ProcessTree_getProcessUptime(getpid()), (char[256]){}));
@@ -2418,18 +2848,16 @@ static void print_summary(HttpRequest req, HttpResponse res) {
                         {.name = "Type",         .width = 13, .wrap = false, .align = BoxAlign_Left}
                   }, true);
         if (stringGroup) {
-                for (ServiceGroup_T sg = servicegrouplist; sg; sg = sg->next) {
-                        if (IS(stringGroup, sg->name)) {
-                                for (list_t m = sg->members->head; m; m = m->next) {
-                                        _printServiceSummary(t, m->e);
-                                        found++;
-                                }
-                                break;
+                ServiceGroup_T sg = Util_getServiceGroup(stringGroup);
+                if (sg) {
+                        for (list_t m = sg->members->head; m; m = m->next) {
+                                _printServiceSummary(t, m->e);
+                                found++;
                         }
                 }
         } else if (stringService) {
                 for (Service_T s = servicelist_conf; s; s = s->next_conf) {
-                        if (IS(stringService, s->name)) {
+                        if (_isServiceRequested(req, s)) {
                                 _printServiceSummary(t, s);
                                 found++;
                         }
@@ -2532,7 +2960,7 @@ static void status_service_txt(Service_T s, HttpResponse res) {
                 "  %-28s %s\n",
                 "on reboot", onrebootnames[s->onreboot]);
         _printStatus(TXT, res, s);
-        StringBuffer_append(res->outputbuffer, "\n");
+        StringBuffer_appendString(res->outputbuffer, "\n");
 }
 
 
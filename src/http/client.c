@@ -59,6 +59,7 @@
 #include "device.h"
 #include "Color.h"
 #include "Box.h"
+#include "client.h"
 
 // libmonit
 #include "exceptions/AssertException.h"
@@ -74,6 +75,10 @@
 /* ----------------------------------------------------------------- Private */
 
 
+/* The connection to the daemon, it is kept open for subsequent commands (batch mode) */
+static Socket_T _session = NULL;
+
+
 static void _argument(StringBuffer_T data, const char *name, const char *value) {
         char *_value = Util_urlEncode((char *)value, true);
         StringBuffer_append(data, "%s%s=%s", StringBuffer_length(data) ? "&" : "", name, _value);
@@ -95,111 +100,174 @@ static char *_getBasicAuthHeader() {
 }
 
 
-static void _parseHttpResponse(Socket_T S) {
+static Socket_T _connect() {
+        if (! _session) {
+                // Prefer the unix socket if enabled: local connection without the TCP and TLS overhead
+                if (Run.httpd.flags & Httpd_Unix)
+                        _session = Socket_createUnix(Run.httpd.socket.unix.path, Socket_Tcp, Run.limits.networkTimeout);
+                if (! _session && Run.httpd.flags & Httpd_Net)
+                        _session = Socket_create(Run.httpd.socket.net.address ? Run.httpd.socket.net.address : "localhost", Run.httpd.socket.net.port, Socket_Tcp, Socket_Ip, &(Run.httpd.socket.net.ssl), Run.limits.networkTimeout);
+        }
+        return _session;
+}
+
+
+/* Get the error message from the HTML error page */
+static const char *_parseError(char *body) {
+        char token[] = "</h2>";
+        char *message = body ? strstr(body, token) : NULL;
+        if (message && strlen(message) > strlen(token)) {
+                message += strlen(token);
+                char *footer = NULL;
+                if ((footer = strstr(message, "<p>")) || (footer = strstr(message, "<hr>")))
+                        *footer = 0;
+                return message;
+        }
+        return NULL;
+}
+
+
+/* Read the response. The body is read using the Content-Length, so the connection can be reused for the next request if the daemon keeps it open. The number of the services which did not pass a requested check is read from the X-Monit-Failed header */
+static char *_parseHttpResponse(Socket_T S, int *status, int *failed) {
         char buf[1024];
         if (! Socket_readLine(S, buf, sizeof(buf)))
                 THROW(IOException, "Error receiving data -- %s", STRERROR);
         Str_chomp(buf);
-        int status;
-        if (! sscanf(buf, "%*s %d", &status))
+        if (sscanf(buf, "%*s %d", status) != 1)
                 THROW(IOException, "Cannot parse status in response: %s", buf);
-        if (status >= 300) {
-                int content_length = 0;
-                // Read HTTP headers
-                while (Socket_readLine(S, buf, sizeof(buf))) {
-                        if (! strncmp(buf, "\r\n", sizeof(buf)))
-                                break;
-                        if (Str_startsWith(buf, "Content-Length") && ! sscanf(buf, "%*s%*[: ]%d", &content_length))
-                                THROW(IOException, "Invalid Content-Length header: %s", buf);
-                }
-                // Parse error response
-                char *message = NULL;
-                if (content_length > 0 && content_length < 1024 && Socket_readLine(S, buf, sizeof(buf))) {
-                        char token[] = "</h2>";
-                        message = strstr(buf, token);
-                        if (strlen(message) > strlen(token)) {
-                                message += strlen(token);
-                                char *footer = NULL;
-                                if ((footer = strstr(message, "<p>")) || (footer = strstr(message, "<hr>")))
-                                        *footer = 0;
-                        }
+        int content_length = -1;
+        boolean_t keepalive = false;
+        while (Socket_readLine(S, buf, sizeof(buf))) {
+                if (! strncmp(buf, "\r\n", sizeof(buf)))
+                        break;
+                if (Str_startsWith(buf, "Content-Length") && ! sscanf(buf, "%*s%*[: ]%d", &content_length))
+                        THROW(IOException, "Invalid Content-Length header: %s", buf);
+                else if (Str_startsWith(buf, "Connection") && Str_sub(buf, "keep-alive"))
+                        keepalive = true;
+                else if (Str_startsWith(buf, "X-Monit-Failed") && ! sscanf(buf, "%*s%*[: ]%d", failed))
+                        THROW(IOException, "Invalid X-Monit-Failed header: %s", buf);
+        }
+        char *body = NULL;
+        if (content_length >= 0) {
+                body = ALLOC(content_length + 1);
+                if (Socket_read(S, body, content_length) != content_length) {
+                        FREE(body);
+                        THROW(IOException, "Error receiving data -- %s", STRERROR);
                 }
-                THROW(AssertException, "%s", message ? message : "cannot parse response");
+                body[content_length] = 0;
         } else {
-                // Skip HTTP headers
-                while (Socket_readLine(S, buf, sizeof(buf))) {
-                         if (! strncmp(buf, "\r\n", sizeof(buf)))
-                                break;
-                }
+                // No Content-Length: the body ends with the connection
+                StringBuffer_T sb = StringBuffer_create(1024);
+                while (Socket_readLine(S, buf, sizeof(buf)))
+                        StringBuffer_append(sb, "%s", buf);
+                body = Str_dup(StringBuffer_toString(sb));
+                StringBuffer_free(&sb);
+                keepalive = false;
         }
+        if (! keepalive && _session)
+                Socket_free(&_session);
+        return body;
 }
 
 
 static void _send(Socket_T S, const char *request, StringBuffer_T data) {
-        _argument(data, "format", "text");
         char *_auth = _getBasicAuthHeader();
         MD_T token;
-        StringBuffer_append(data, "%ssecuritytoken=%s", StringBuffer_length(data) > 0 ? "&" : "", Util_getToken(token));
+        Util_getToken(token);
         int rv = Socket_print(S,
                 "POST %s HTTP/1.0\r\n"
                 "Content-Type: application/x-www-form-urlencoded\r\n"
                 "Cookie: securitytoken=%s\r\n"
+                "Connection: keep-alive\r\n"
                 "Content-Length: %d\r\n"
                  "%s"
                  "\r\n"
-                 "%s",
+                 "%s%ssecuritytoken=%s",
                 request,
                 token,
-                StringBuffer_length(data),
+                StringBuffer_length(data) + (StringBuffer_length(data) > 0 ? 1 : 0) + (int)strlen("securitytoken=") + (int)strlen(token),
                 _auth ? _auth : "",
-                StringBuffer_toString(data));
+                StringBuffer_toString(data),
+                StringBuffer_length(data) > 0 ? "&" : "",
+                token);
         FREE(_auth);
         if (rv < 0)
                 THROW(IOException, "Monit: cannot send command to the monit daemon -- %s", STRERROR);
 }
 
 
-static void _receive(Socket_T S) {
-        char buf[1024];
-        _parseHttpResponse(S);
-        boolean_t strip = (Run.flags & Run_Batch || ! Color_support()) ? true : false;
-        while (Socket_readLine(S, buf, sizeof(buf))) {
-                if (strip)
-                        Color_strip(Box_strip(buf));
-                printf("%s", buf);
+static void _receive(Socket_T S, int *failed) {
+        int status = 0;
+        char *body = _parseHttpResponse(S, &status, failed);
+        if (status >= 300) {
+                char message[STRLEN];
+                const char *error = _parseError(body);
+                snprintf(message, sizeof(message), "%s", error ? error : "cannot parse response");
+                FREE(body);
+                THROW(AssertException, "%s", message);
         }
+        if (Run.flags & Run_Batch || ! Color_support())
+                Color_strip(Box_strip(body));
+        printf("%s", body);
+        FREE(body);
 }
 
 
-static boolean_t _client(const char *request, StringBuffer_T data) {
-        boolean_t status = false;
+/* Send the request and print the response, the timeout is the time to wait for the response in milliseconds. If retry is false, the request is not sent again when it failed on a reused connection: the daemon may have received it already */
+static boolean_t _request(const char *request, StringBuffer_T data, int timeout, boolean_t retry) {
         if (! exist_daemon()) {
                 LogError("Monit: the monit daemon is not running\n");
-                return status;
+                return false;
         }
-        Socket_T S = NULL;
-        if (Run.httpd.flags & Httpd_Net) {
-                S = Socket_create(Run.httpd.socket.net.address ? Run.httpd.socket.net.address : "localhost", Run.httpd.socket.net.port, Socket_Tcp, Socket_Ip, &(Run.httpd.socket.net.ssl), Run.limits.networkTimeout);
-        } else if (Run.httpd.flags & Httpd_Unix) {
-                S = Socket_createUnix(Run.httpd.socket.unix.path, Socket_Tcp, Run.limits.networkTimeout);
-        } else {
+        if (! (Run.httpd.flags & (Httpd_Net | Httpd_Unix))) {
                 LogError("Monit: the monit HTTP interface is not enabled, please add the 'set httpd' statement and use the 'allow' option to allow monit to connect\n");
+                return false;
         }
-        if (S) {
+        _argument(data, "format", Run.flags & Run_Json ? "json" : "text");
+        boolean_t status = false;
+        int failed = 0;
+        // The daemon may close an idle persistent connection meanwhile: retry once with a new connection
+        for (int attempt = 0; attempt < 2 && ! status; attempt++) {
+                boolean_t reused = _session ? true : false;
+                Socket_T S = _connect();
+                if (! S)
+                        break;
+                Socket_setTimeout(S, timeout);
                 TRY
                 {
                         _send(S, request, data);
-                        _receive(S);
+                        _receive(S, &failed);
                         status = true;
                 }
+                CATCH(IOException)
+                {
+                        if (_session)
+                                Socket_free(&_session);
+                        if (! reused || ! retry) {
+                                LogError("%s\n", Exception_frame.message);
+                                attempt++;
+                        }
+                }
                 ELSE
                 {
                         LogError("%s\n", Exception_frame.message);
+                        attempt++;
                 }
                 END_TRY;
-                Socket_free(&S);
         }
-        return status;
+        return status && ! failed;
+}
+
+
+static boolean_t _client(const char *request, StringBuffer_T data) {
+        return _request(request, data, Run.limits.networkTimeout, true);
+}
+
+
+static void _services(StringBuffer_T data, List_T services) {
+        if (services)
+                for (list_t s = services->head; s; s = s->next)
+                        _argument(data, "service", s->e);
 }
 
 
@@ -215,8 +283,7 @@ boolean_t HttpClient_action(const char *action, List_T services) {
         }
         StringBuffer_T data = StringBuffer_create(64);
         _argument(data, "action", action);
-        for (list_t s = services->head; s; s = s->next)
-                _argument(data, "service", s->e);
+        _services(data, services);
         boolean_t rv = _client("/_doaction", data);
         StringBuffer_free(&data);
         return rv;
@@ -233,10 +300,9 @@ boolean_t HttpClient_report(const char *type) {
 }
 
 
-boolean_t HttpClient_status(const char *group, const char *service) {
+boolean_t HttpClient_status(const char *group, List_T services) {
         StringBuffer_T data = StringBuffer_create(64);
-        if (STR_DEF(service))
-                _argument(data, "service", service);
+        _services(data, services);
         if (STR_DEF(group))
                 _argument(data, "group", group);
         boolean_t rv = _client("/_status", data);
@@ -245,10 +311,9 @@ boolean_t HttpClient_status(const char *group, const char *service) {
 }
 
 
-boolean_t HttpClient_summary(const char *group, const char *service) {
+boolean_t HttpClient_summary(const char *group, List_T services) {
         StringBuffer_T data = StringBuffer_create(64);
-        if (STR_DEF(service))
-                _argument(data, "service", service);
+        _services(data, services);
         if (STR_DEF(group))
                 _argument(data, "group", group);
         boolean_t rv = _client("/_summary", data);
@@ -256,3 +321,55 @@ boolean_t HttpClient_summary(const char *group, const char *service) {
         return rv;
 }
 
+
+boolean_t HttpClient_check(const char *group, List_T services) {
+        StringBuffer_T data = StringBuffer_create(64);
+        _services(data, services);
+        if (STR_DEF(group))
+                _argument(data, "group", group);
+        // The daemon responds when the checks finished, allow for one poll cycle. A failure after the daemon accepted the request must not run the checks again
+        boolean_t rv = _request("/_check", data, Run.limits.networkTimeout + Run.polltime * 1000, false);
+        StringBuffer_free(&data);
+        return rv;
+}
+
+
+boolean_t HttpClient_batch(FILE *input) {
+        ASSERT(input);
+        int errors = 0;
+        char line[1024];
+        while (fgets(line, sizeof(line), input)) {
+                char *save = NULL;
+                char *command = strtok_r(line, " \t\r\n", &save);
+                if (! command || *command == '#')
+                        continue;
+                List_T args = List_new();
+                for (char *arg = strtok_r(NULL, " \t\r\n", &save); arg; arg = strtok_r(NULL, " \t\r\n", &save))
+                        List_append(args, arg);
+                boolean_t rv;
+                if (IS(command, "status")) {
+                        rv = HttpClient_status(Run.mygroup, args);
+                } else if (IS(command, "summary")) {
+                        rv = HttpClient_summary(Run.mygroup, args);
+                } else if (IS(command, "report")) {
+                        rv = HttpClient_report(List_length(args) ? args->head->e : NULL);
+                } else if (List_length(args)) {
+                        rv = HttpClient_action(command, args);
+                } else {
+                        LogError("Invalid batch command '%s' -- please specify a service name or pattern\n", command);
+                        rv = false;
+                }
+                if (! rv)
+                        errors++;
+                List_free(&args);
+        }
+        HttpClient_close();
+        return errors ? false : true;
+}
+
+
+void HttpClient_close() {
+        if (_session)
+                Socket_free(&_session);
+}
+
@@ -29,7 +29,7 @@
 /**
  * Do service action
  * @param action A string representation of Action_Type
- * @param services List of services
+ * @param services List of service names or wildcard patterns
  * @return true if succeeded otherwise false
  */
 boolean_t HttpClient_action(const char *action, List_T services);
@@ -46,19 +46,45 @@ boolean_t HttpClient_report(const char *type);
 /**
  * Print service status
  * @param group Service group or NULL
- * @param service Service name or NULL
+ * @param services List of service names or wildcard patterns, NULL or empty for all services
  * @return true if succeeded otherwise false
  */
-boolean_t HttpClient_status(const char *group, const char *service);
+boolean_t HttpClient_status(const char *group, List_T services);
 
 
 /**
  * Print service summary
  * @param group Service group or NULL
- * @param service Service name or NULL
+ * @param services List of service names or wildcard patterns, NULL or empty for all services
  * @return true if succeeded otherwise false
  */
-boolean_t HttpClient_summary(const char *group, const char *service);
+boolean_t HttpClient_summary(const char *group, List_T services);
+
+
+/**
+ * Check the services now and print their status when done. The services
+ * they depend on are checked as well
+ * @param group Service group or NULL
+ * @param services List of service names or wildcard patterns
+ * @return true if all services passed the check otherwise false
+ */
+boolean_t HttpClient_check(const char *group, List_T services);
+
+
+/**
+ * Execute commands read from the input, one command per line (e.g. "start
+ * web*" or "status db"). All commands are sent over one connection to the
+ * daemon, which is closed when done
+ * @param input The command stream
+ * @return true if all commands succeeded otherwise false
+ */
+boolean_t HttpClient_batch(FILE *input);
+
+
+/**
+ * Close the connection to the daemon kept open for subsequent commands
+ */
+void HttpClient_close();
 
 
 #endif
@@ -150,13 +150,16 @@ static volatile boolean_t stopped = false;
 static int myServerSocketsCount = 0;
 static struct pollfd myServerSockets[3] = {};
 static HostsAllow_T allowlist = NULL;
+static HostsAllow_T parsedAllowlist = NULL; // The allow list of the configuration being parsed on reload
+static HostsAllow_T *allowTarget = &allowlist; // The list which Engine_addAllow() fills
+static char *unixSocket = NULL; // The unix socket path the server is bound to (the configuration may change on reload)
 
 
 /* ----------------------------------------------------------------- Private */
 
 
 static boolean_t _hasAllow(HostsAllow_T host) {
-        for (HostsAllow_T p = allowlist; p; p = p->next)
+        for (HostsAllow_T p = *allowTarget; p; p = p->next)
                 if (memcmp(p->address, &(host->address), 16) == 0 && memcmp(p->mask, &(host->mask), 16) == 0)
                         return true;
         return false;
@@ -178,8 +181,8 @@ static void _pushAllow(HostsAllow_T h, const char *pattern) {
                         DEBUG("Adding 'allow %s' -- host resolved to [%s]\n", pattern, buf);
                 else
                         DEBUG("Adding 'allow %s'\n", pattern);
-                h->next = allowlist;
-                allowlist = h;
+                h->next = *allowTarget;
+                *allowTarget = h;
         }
 }
 
@@ -193,13 +196,18 @@ static boolean_t _matchAllow(uint32_t address1[4], uint32_t address2[4], uint32_
 
 
 static boolean_t _isAllowed(uint32_t address[4]) {
-        if (allowlist) {
-                for (HostsAllow_T p = allowlist; p; p = p->next)
-                        if (_matchAllow(p->address, address, p->mask))
-                                return true;
-                return false;
+        boolean_t allowed = true;
+        // The allow list is rebuilt by reload while the server is running
+        LOCK(Run.mutex)
+        {
+                if (allowlist) {
+                        allowed = false;
+                        for (HostsAllow_T p = allowlist; p && ! allowed; p = p->next)
+                                allowed = _matchAllow(p->address, address, p->mask);
+                }
         }
-        return true;
+        END_LOCK;
+        return allowed;
 }
 
 
@@ -211,6 +219,15 @@ static HostsAllow_T _copyAllow(HostsAllow_T source) {
 }
 
 
+static void _destroyAllow(HostsAllow_T *list) {
+        for (HostsAllow_T current = *list, next = NULL; current; current = next) {
+                next = current->next;
+                FREE(current);
+        }
+        *list = NULL;
+}
+
+
 static void _mapIPv4toIPv6(uint32_t *address4, uint32_t *address6) {
         // Map IPv4 address to IPv6 "::ffff:x.x.x.x" notation, so we can compare IPv4 address in IPv6 namespace
         *(address6 + 0) = 0x00000000;
@@ -449,6 +466,7 @@ static void _createTcpServer(Socket_Family family, char error[STRLEN]) {
 static void _createUnixServer(char error[STRLEN]) {
         myServerSockets[myServerSocketsCount].fd = create_server_socket_unix(Run.httpd.socket.unix.path, 1024, error);
         if (myServerSockets[myServerSocketsCount].fd != -1) {
+                unixSocket = Str_dup(Run.httpd.socket.unix.path);
                 data[myServerSocketsCount].family = Socket_Unix;
                 data[myServerSocketsCount].addr = (struct sockaddr *)&(data[myServerSocketsCount]._addr.addr_un);
                 data[myServerSocketsCount].addrlen = sizeof(struct sockaddr_un);
@@ -503,6 +521,10 @@ void Engine_stop() {
 
 void Engine_cleanup() {
         myServerSocketsCount = 0;
+        if (unixSocket) {
+                unlink(unixSocket);
+                FREE(unixSocket);
+        }
         if (Run.httpd.flags & Httpd_Unix)
                 unlink(Run.httpd.socket.unix.path);
 }
@@ -522,10 +544,20 @@ boolean_t Engine_hasAllow() {
 
 
 void Engine_destroyAllow() {
-        for (HostsAllow_T current = allowlist, next = NULL; current; current = next) {
-                next = current->next;
-                FREE(current);
-        }
-        allowlist = NULL;
+        _destroyAllow(&allowlist);
+}
+
+
+void Engine_detachAllow() {
+        _destroyAllow(&parsedAllowlist);
+        allowTarget = &parsedAllowlist;
+}
+
+
+void Engine_commitAllow() {
+        _destroyAllow(&allowlist);
+        allowlist = parsedAllowlist;
+        parsedAllowlist = NULL;
+        allowTarget = &allowlist;
 }
 
@@ -66,4 +66,18 @@ boolean_t Engine_hasAllow();
 void Engine_destroyAllow();
 
 
+/**
+ * Let Engine_addAllow() fill a new allow list, the current list stays in
+ * use until Engine_commitAllow() (reload)
+ */
+void Engine_detachAllow();
+
+
+/**
+ * Replace the allow list with the list filled since Engine_detachAllow().
+ * Must be called with Run.mutex locked
+ */
+void Engine_commitAllow();
+
+
 #endif
@@ -68,6 +68,10 @@
 #include <limits.h>
 #endif
 
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
 #include "monit.h"
 #include "processor.h"
 #include "base64.h"
@@ -106,7 +110,7 @@ static int _httpPostLimit;
 /* -------------------------------------------------------------- Prototypes */
 
 
-static void do_service(Socket_T);
+static boolean_t do_service(Socket_T, boolean_t);
 static void destroy_entry(void *);
 static char *get_date(char *, int);
 static char *get_server(char *, int);
@@ -147,10 +151,14 @@ struct  ServiceImpl {
  * @param s A Socket_T representing the client connection
  */
 void *http_processor(Socket_T s) {
-        if (! Net_canRead(Socket_getSocket(s), REQUEST_TIMEOUT * 1000))
+        if (! Net_canRead(Socket_getSocket(s), REQUEST_TIMEOUT * 1000)) {
                 internal_error(s, SC_REQUEST_TIMEOUT, "Time out when handling the Request");
-        else
-                do_service(s);
+        } else {
+                // Serve subsequent requests of a persistent connection (CLI batch). The server is single-threaded and doesn't accept other clients while it waits for the next request, so the connection is kept open only for the local CLI on the unix socket, with the idle wait and the number of requests limited
+                boolean_t persistent = Socket_getFamily(s) == Socket_Unix;
+                for (int requests = 1; do_service(s, persistent && requests < KEEPALIVE_REQUESTS) && Net_canRead(Socket_getSocket(s), KEEPALIVE_TIMEOUT * 1000); requests++)
+                        ;
+        }
         Socket_free(&s);
         return NULL;
 }
@@ -176,20 +184,6 @@ void Processor_setHttpPostLimit() {
 }
 
 
-void escapeHTML(StringBuffer_T sb, const char *s) {
-        for (int i = 0; s[i]; i++) {
-                if (s[i] == '<')
-                        StringBuffer_append(sb, "&lt;");
-                else if (s[i] == '>')
-                        StringBuffer_append(sb, "&gt;");
-                else if (s[i] == '&')
-                        StringBuffer_append(sb, "&amp;");
-                else
-                        StringBuffer_append(sb, "%c", s[i]);
-        }
-}
-
-
 /**
  * Send an error message
  * @param res HttpResponse object
@@ -216,7 +210,7 @@ void send_error(HttpRequest req, HttpResponse res, int code, const char *msg, ..
         va_start(ap, msg);
         message = Str_vcat(msg, ap);
         va_end(ap);
-        escapeHTML(res->outputbuffer, message);
+        StringBuffer_appendEscapedHTML(res->outputbuffer, message);
         if (code != SC_UNAUTHORIZED) // We log details in basic_authenticate() already, no need to log generic error sent to client here
                 LogError("HttpRequest: error -- client [%s]: %s %d %s\n", NVLSTR(Socket_getRemoteHost(req->S)), SERVER_PROTOCOL, code, message);
         FREE(message);
@@ -293,6 +287,25 @@ void set_content_type(HttpResponse res, const char *mime) {
 }
 
 
+/**
+ * Send the given file region as the response body instead of the output
+ * buffer. The file is sent without copying it to user space where
+ * possible. The response takes ownership of the file descriptor
+ * @param res HttpResponse object
+ * @param fd File descriptor of a regular file
+ * @param offset The start of the region
+ * @param length The length of the region
+ */
+void set_file(HttpResponse res, int fd, off_t offset, size_t length) {
+        ASSERT(fd >= 0);
+        if (res->file.fd >= 0)
+                close(res->file.fd);
+        res->file.fd = fd;
+        res->file.offset = offset;
+        res->file.length = length;
+}
+
+
 /**
  * Returns the value of the specified header
  * @param req HttpRequest object
@@ -437,26 +450,36 @@ const char *get_status_string(int status) {
 
 /**
  * Receives standard HTTP requests from a client socket and dispatches
- * them to the doXXX methods defined in a cervlet module.
+ * them to the doXXX methods defined in a cervlet module. Returns true if
+ * the client asked to keep the connection open and it is allowed
  */
-static void do_service(Socket_T s) {
+static boolean_t do_service(Socket_T s, boolean_t canKeepAlive) {
+        boolean_t keepalive = false;
         volatile HttpResponse res = create_HttpResponse(s);
         volatile HttpRequest req = create_HttpRequest(s);
         if (res && req) {
-                if (Run.httpd.socket.net.ssl.flags & SSL_Enabled)
-                        set_header(res, "Strict-Transport-Security", "max-age=63072000; includeSubdomains; preload");
-                if (is_authenticated(req, res)) {
-                        set_header(res, "Set-Cookie", "securitytoken=%s; Max-Age=600; HttpOnly; SameSite=strict%s", res->token, (Run.httpd.socket.net.ssl.flags & SSL_Enabled) ? "; Secure" : "");
-                        if (IS(req->method, METHOD_GET))
-                                Impl.doGet(req, res);
-                        else if (IS(req->method, METHOD_POST))
-                                Impl.doPost(req, res);
-                        else
-                                send_error(req, res, SC_NOT_IMPLEMENTED, "Method not implemented");
+                res->keepalive = canKeepAlive && IS(get_header(req, "Connection"), "keep-alive");
+                // The configuration and the service list may be replaced by reload while the server is running, the request is handled under the runtime lock
+                LOCK(Run.mutex)
+                {
+                        if (Run.httpd.socket.net.ssl.flags & SSL_Enabled)
+                                set_header(res, "Strict-Transport-Security", "max-age=63072000; includeSubdomains; preload");
+                        if (is_authenticated(req, res)) {
+                                set_header(res, "Set-Cookie", "securitytoken=%s; Max-Age=600; HttpOnly; SameSite=strict%s", res->token, (Run.httpd.socket.net.ssl.flags & SSL_Enabled) ? "; Secure" : "");
+                                if (IS(req->method, METHOD_GET))
+                                        Impl.doGet(req, res);
+                                else if (IS(req->method, METHOD_POST))
+                                        Impl.doPost(req, res);
+                                else
+                                        send_error(req, res, SC_NOT_IMPLEMENTED, "Method not implemented");
+                        }
                 }
+                END_LOCK;
                 send_response(req, res);
+                keepalive = res->keepalive;
         }
         done(req, res);
+        return keepalive;
 }
 
 
@@ -499,7 +522,9 @@ static void send_response(HttpRequest req, HttpResponse res) {
 #endif
                 const void *body = NULL;
                 size_t bodyLength = 0;
-                if (canCompress && StringBuffer_length(res->outputbuffer) > 0) {
+                if (res->file.fd >= 0) {
+                        bodyLength = res->file.length;
+                } else if (canCompress && StringBuffer_length(res->outputbuffer) > 0) {
                         body = StringBuffer_toCompressed(res->outputbuffer, 6, &bodyLength);
                         set_header(res, "Content-Encoding", "gzip");
                 } else {
@@ -510,16 +535,24 @@ static void send_response(HttpRequest req, HttpResponse res) {
                 res->is_committed = true;
                 get_date(date, STRLEN);
                 get_server(server, STRLEN);
-                Socket_print(S, "%s %d %s\r\n", res->protocol, res->status, res->status_msg);
-                Socket_print(S, "Date: %s\r\n", date);
-                Socket_print(S, "Server: %s\r\n", server);
-                Socket_print(S, "Content-Length: %zu\r\n", bodyLength);
-                Socket_print(S, "Connection: close\r\n");
-                if (headers)
-                        Socket_print(S, "%s", headers);
-                Socket_print(S, "\r\n");
-                if (bodyLength)
-                        Socket_write(S, (unsigned char *)body, bodyLength);
+                // Format the whole header block at once and send it together with the body in one gather write
+                StringBuffer_T head = StringBuffer_create(RES_STRLEN);
+                StringBuffer_append(head,
+                                    "%s %d %s\r\n"
+                                    "Date: %s\r\n"
+                                    "Server: %s\r\n"
+                                    "Content-Length: %zu\r\n"
+                                    "Connection: %s\r\n"
+                                    "%s"
+                                    "\r\n",
+                                    res->protocol, res->status, res->status_msg, date, server, bodyLength, res->keepalive ? "keep-alive" : "close", headers ? headers : "");
+                struct iovec iov[2] = {
+                        {.iov_base = (void *)StringBuffer_toString(head), .iov_len = StringBuffer_length(head)},
+                        {.iov_base = (void *)body, .iov_len = body ? bodyLength : 0}
+                };
+                if (Socket_writev(S, iov, 2) >= 0 && res->file.fd >= 0 && bodyLength)
+                        Socket_sendfile(S, res->file.fd, res->file.offset, bodyLength);
+                StringBuffer_free(&head);
                 FREE(headers);
         }
 }
@@ -576,6 +609,7 @@ static HttpResponse create_HttpResponse(Socket_T S) {
         res->S = S;
         res->status = SC_OK;
         res->outputbuffer = StringBuffer_create(256);
+        res->file.fd = -1;
         res->is_committed = false;
         res->protocol = SERVER_PROTOCOL;
         res->status_msg = get_status_string(SC_OK);
@@ -660,6 +694,10 @@ static void reset_response(HttpResponse res) {
                 res->headers = NULL; /* Release Pragma */
         }
         StringBuffer_clear(res->outputbuffer);
+        if (res->file.fd >= 0) {
+                close(res->file.fd);
+                res->file.fd = -1;
+        }
 }
 
 
@@ -697,6 +735,8 @@ static void destroy_HttpRequest(HttpRequest req) {
 static void destroy_HttpResponse(HttpResponse res) {
         if (res) {
                 StringBuffer_free(&(res->outputbuffer));
+                if (res->file.fd >= 0)
+                        close(res->file.fd);
                 if (res->headers)
                         destroy_entry(res->headers);
                 FREE(res);
@@ -55,6 +55,10 @@
 /* Request timeout in seconds */
 #define REQUEST_TIMEOUT    30
 
+/* Persistent connection: idle timeout in seconds and maximum requests per connection */
+#define KEEPALIVE_TIMEOUT  2
+#define KEEPALIVE_REQUESTS 1000
+
 struct entry {
         char *name;
         char *value;
@@ -86,9 +90,15 @@ typedef struct response {
         Socket_T S;
         const char *protocol;
         boolean_t is_committed;
+        boolean_t keepalive;  /**< Keep the connection open for the next request */
         HttpHeader headers;
         const char *status_msg;
         StringBuffer_T outputbuffer;
+        struct {
+                int fd;                 /**< File sent as the body or -1 */
+                off_t offset;
+                size_t length;
+        } file;
         MD_T token;
         Ssl_T ssl;
 } *HttpResponse;
@@ -101,8 +111,8 @@ void set_status(HttpResponse res, int status);
 const char *get_status_string(int status_code);
 void add_Impl(void(*doGet)(HttpRequest, HttpResponse), void(*doPost)(HttpRequest, HttpResponse));
 void set_content_type(HttpResponse res, const char *mime);
+void set_file(HttpResponse res, int fd, off_t offset, size_t length);
 const char *get_header(HttpRequest req, const char *header_name);
-void escapeHTML(StringBuffer_T sb, const char *s);
 void send_error(HttpRequest, HttpResponse, int status, const char *message, ...) __attribute__((format (printf, 4, 5)));
 const char *get_parameter(HttpRequest req, const char *parameter_name);
 void set_header(HttpResponse res, const char *name, const char *value, ...) __attribute__((format (printf, 3, 4)));
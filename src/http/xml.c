@@ -56,6 +56,8 @@
 #include "event.h"
 #include "ProcessTree.h"
 #include "protocol.h"
+#include "profile.h"
+#include "snapshot.h"
 
 
 /**
@@ -74,12 +76,11 @@
  * @param buf String to escape
  */
 static void _escapeCDATA(StringBuffer_T B, const char *buf) {
-        for (int i = 0; buf[i]; i++) {
-                if (buf[i] == '>' && i > 1 && (buf[i - 1] == ']' && buf[i - 2] == ']'))
-                        StringBuffer_append(B, "&gt;");
-                else
-                        StringBuffer_append(B, "%c", buf[i]);
+        for (const char *stop; (stop = strstr(buf, "]]>")); buf = stop + 3) {
+                StringBuffer_appendBytes(B, buf, (int)(stop - buf) + 2);
+                StringBuffer_appendString(B, "&gt;");
         }
+        StringBuffer_appendString(B, buf);
 }
 
 
@@ -90,7 +91,7 @@ static void _escapeCDATA(StringBuffer_T B, const char *buf) {
  * @param myip The client-side IP address
  */
 static void document_head(StringBuffer_T B, int V, const char *myip) {
-        StringBuffer_append(B, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>");
+        StringBuffer_appendString(B, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>");
         if (V == 2)
                 StringBuffer_append(B, "<monit id=\"%s\" incarnation=\"%lld\" version=\"%s\"><server>", Run.id, (long long)Run.incarnation, VERSION);
         else
@@ -125,6 +126,40 @@ static void document_head(StringBuffer_T B, int V, const char *myip) {
                         StringBuffer_append(B, "<credentials><username>%s</username><password>%s</password></credentials>", Run.mmonitcredentials->uname, Run.mmonitcredentials->passwd);
         }
 
+        if (profile.cycle.count) {
+                int buckets[PROFILE_BUCKETS];
+                Profile_histogram(buckets);
+                StringBuffer_append(B,
+                                    "<profile>"
+                                    "<cycles>%llu</cycles>"
+                                    "<overruns>%llu</overruns>"
+                                    "<cycle><last>%"PRIu64"</last><average>%"PRIu64"</average><max>%"PRIu64"</max></cycle>",
+                                    profile.cycle.count,
+                                    profile.overruns,
+                                    profile.cycle.last,
+                                    Profile_average(&(profile.cycle)),
+                                    profile.cycle.max);
+                for (int i = 0; i < Phase_Count; i++)
+                        StringBuffer_append(B, "<phase name=\"%s\"><last>%"PRIu64"</last><average>%"PRIu64"</average><max>%"PRIu64"</max></phase>", phasenames[i], profile.phase[i].last, Profile_average(&(profile.phase[i])), profile.phase[i].max);
+                StringBuffer_append(B,
+                                    "<histogram>%d %d %d %d %d</histogram>"
+                                    "<checked>%u</checked>"
+                                    "<skipped>%u</skipped>"
+                                    "<cpu><user>%"PRIu64"</user><system>%"PRIu64"</system></cpu>"
+                                    "<faults><minor>%ld</minor><major>%ld</major></faults>"
+                                    "<contextswitches><voluntary>%ld</voluntary><involuntary>%ld</involuntary></contextswitches>"
+                                    "</profile>",
+                                    buckets[0], buckets[1], buckets[2], buckets[3], buckets[4],
+                                    profile.counters.checked,
+                                    profile.counters.skipped,
+                                    profile.counters.cpuUser,
+                                    profile.counters.cpuSystem,
+                                    profile.counters.minorFaults,
+                                    profile.counters.majorFaults,
+                                    profile.counters.contextSwitches,
+                                    profile.counters.preemptions);
+        }
+
         StringBuffer_append(B,
                             "</server>"
                             "<platform>"
@@ -151,7 +186,7 @@ static void document_head(StringBuffer_T B, int V, const char *myip) {
  * @param B StringBuffer object
  */
 static void document_foot(StringBuffer_T B) {
-        StringBuffer_append(B, "</monit>");
+        StringBuffer_appendString(B, "</monit>");
 }
 
 
@@ -186,10 +221,19 @@ static void _ioStatistics(StringBuffer_T B, const char *name, IOStatistics_T sta
  * @param V Format version
  */
 static void status_service(Service_T S, StringBuffer_T B, int V) {
-        if (V == 2)
-                StringBuffer_append(B, "<service name=\"%s\"><type>%d</type>", S->name ? S->name : "", S->type);
-        else
-                StringBuffer_append(B, "<service type=\"%d\"><name>%s</name>", S->type, S->name ? S->name : "");
+        if (V == 2) {
+                StringBuffer_appendString(B, "<service name=\"");
+                StringBuffer_appendEscapedXML(B, S->name);
+                StringBuffer_appendString(B, "\"><type>");
+                StringBuffer_appendUInt(B, S->type);
+                StringBuffer_appendString(B, "</type>");
+        } else {
+                StringBuffer_appendString(B, "<service type=\"");
+                StringBuffer_appendUInt(B, S->type);
+                StringBuffer_appendString(B, "\"><name>");
+                StringBuffer_appendEscapedXML(B, S->name);
+                StringBuffer_appendString(B, "</name>");
+        }
         StringBuffer_append(B,
                             "<collected_sec>%lld</collected_sec>"
                             "<collected_usec>%ld</collected_usec>"
@@ -213,8 +257,10 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
                         StringBuffer_append(B, "<counter>%d</counter><number>%d</number>", S->every.spec.cycle.counter, S->every.spec.cycle.number);
                 else
                         StringBuffer_append(B, "<cron>%s</cron>", S->every.spec.cron);
-                StringBuffer_append(B, "</every>");
+                StringBuffer_appendString(B, "</every>");
         }
+        if (S->timing.count)
+                StringBuffer_append(B, "<checktime><last>%"PRIu64"</last><average>%"PRIu64"</average><max>%"PRIu64"</max></checktime>", S->timing.last, Profile_average(&(S->timing)), S->timing.max);
         if (Util_hasServiceStatus(S)) {
                 switch (S->type) {
                         case Service_File:
@@ -295,7 +341,7 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
                                 boolean_t hasWaitTime = Statistics_initialized(&(S->inf.filesystem->time.wait));
                                 boolean_t hasRunTime = Statistics_initialized(&(S->inf.filesystem->time.run));
                                 if (hasReadTime || hasWriteTime || hasWaitTime || hasRunTime) {
-                                        StringBuffer_append(B, "<servicetime>");
+                                        StringBuffer_appendString(B, "<servicetime>");
                                         if (hasReadTime)
                                                 StringBuffer_append(B, "<read>%.3f</read>", Statistics_deltaNormalize(&(S->inf.filesystem->time.read)));
                                         if (hasWriteTime)
@@ -304,7 +350,7 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
                                                 StringBuffer_append(B, "<wait>%.3f</wait>", Statistics_deltaNormalize(&(S->inf.filesystem->time.wait)));
                                         if (hasRunTime)
                                                 StringBuffer_append(B, "<run>%.3f</run>", Statistics_deltaNormalize(&(S->inf.filesystem->time.run)));
-                                        StringBuffer_append(B, "</servicetime>");
+                                        StringBuffer_appendString(B, "</servicetime>");
                                 }
                                 break;
 
@@ -449,6 +495,8 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
                                             p->is_available == Connection_Ok ? p->response / 1000. : -1.); // We send the response time in [s] for backward compatibility (with microseconds precision)
                 }
                 if (S->type == Service_System && (Run.flags & Run_ProcessEngineEnabled)) {
+                        SystemInfo_T info;
+                        Snapshot_getSystem(&info);
                         StringBuffer_append(B,
                                             "<system>"
                                             "<load>"
@@ -470,20 +518,42 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
                                             "<swap>"
                                             "<percent>%.1f</percent>"
                                             "<kilobyte>%llu</kilobyte>"
-                                            "</swap>"
-                                            "</system>",
-                                            systeminfo.loadavg[0],
-                                            systeminfo.loadavg[1],
-                                            systeminfo.loadavg[2],
-                                            systeminfo.cpu.usage.user > 0. ? systeminfo.cpu.usage.user : 0.,
-                                            systeminfo.cpu.usage.system > 0. ? systeminfo.cpu.usage.system : 0.,
+                                            "</swap>",
+                                            info.loadavg[0],
+                                            info.loadavg[1],
+                                            info.loadavg[2],
+                                            info.cpu.usage.user > 0. ? info.cpu.usage.user : 0.,
+                                            info.cpu.usage.system > 0. ? info.cpu.usage.system : 0.,
 #ifdef HAVE_CPU_WAIT
-                                            systeminfo.cpu.usage.wait > 0. ? systeminfo.cpu.usage.wait : 0.,
+                                            info.cpu.usage.wait > 0. ? info.cpu.usage.wait : 0.,
 #endif
-                                            systeminfo.memory.usage.percent,
-                                            (unsigned long long)((double)systeminfo.memory.usage.bytes / 1024.),               // Send as kB for backward compatibility
-                                            systeminfo.swap.usage.percent,
-                                            (unsigned long long)((double)systeminfo.swap.usage.bytes / 1024.));             // Send as kB for backward compatibility
+                                            info.memory.usage.percent,
+                                            (unsigned long long)((double)info.memory.usage.bytes / 1024.),               // Send as kB for backward compatibility
+                                            info.swap.usage.percent,
+                                            (unsigned long long)((double)info.swap.usage.bytes / 1024.));             // Send as kB for backward compatibility
+                        if (info.memory.extended)
+                                StringBuffer_append(B,
+                                                    "<memoryavailable>"
+                                                    "<percent>%.1f</percent>"
+                                                    "<kilobyte>%llu</kilobyte>"
+                                                    "</memoryavailable>"
+                                                    "<memorydirty><kilobyte>%llu</kilobyte></memorydirty>"
+                                                    "<memorywriteback><kilobyte>%llu</kilobyte></memorywriteback>"
+                                                    "<slabunreclaimable><kilobyte>%llu</kilobyte></slabunreclaimable>"
+                                                    "<hugepages>"
+                                                    "<percent>%.1f</percent>"
+                                                    "<kilobyte>%llu</kilobyte>"
+                                                    "<total>%llu</total>"
+                                                    "</hugepages>",
+                                                    info.memory.available.percent,
+                                                    (unsigned long long)(info.memory.available.bytes / 1024),
+                                                    (unsigned long long)(info.memory.dirty / 1024),
+                                                    (unsigned long long)(info.memory.writeback / 1024),
+                                                    (unsigned long long)(info.memory.slabUnreclaimable / 1024),
+                                                    info.memory.hugepages.percent,
+                                                    (unsigned long long)(info.memory.hugepages.bytes / 1024),
+                                                    (unsigned long long)(info.memory.hugepages.size / 1024));
+                        StringBuffer_appendString(B, "</system>");
                 }
                 if (S->type == Service_Program && S->program->started) {
                         StringBuffer_append(B,
@@ -499,7 +569,7 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
                                             "</program>");
                 }
         }
-        StringBuffer_append(B, "</service>");
+        StringBuffer_appendString(B, "</service>");
 }
 
 
@@ -509,12 +579,16 @@ static void status_service(Service_T S, StringBuffer_T B, int V) {
  * @param B StringBuffer object
  */
 static void status_servicegroup(ServiceGroup_T SG, StringBuffer_T B) {
-        StringBuffer_append(B, "<servicegroup name=\"%s\">", SG->name);
+        StringBuffer_appendString(B, "<servicegroup name=\"");
+        StringBuffer_appendEscapedXML(B, SG->name);
+        StringBuffer_appendString(B, "\">");
         for (list_t m = SG->members->head; m; m = m->next) {
                 Service_T s = m->e;
-                StringBuffer_append(B, "<service>%s</service>", s->name);
+                StringBuffer_appendString(B, "<service>");
+                StringBuffer_appendEscapedXML(B, s->name);
+                StringBuffer_appendString(B, "</service>");
         }
-        StringBuffer_append(B, "</servicegroup>");
+        StringBuffer_appendString(B, "</servicegroup>");
 }
 
 
@@ -542,10 +616,10 @@ static void status_event(Event_T E, StringBuffer_T B) {
                             E->state,
                             Event_get_action(E));
         _escapeCDATA(B, E->message);
-        StringBuffer_append(B, "]]></message>");
+        StringBuffer_appendString(B, "]]></message>");
         if (E->source->token)
                 StringBuffer_append(B, "<token>%s</token>", E->source->token);
-        StringBuffer_append(B, "</event>");
+        StringBuffer_appendString(B, "</event>");
 }
 
 
@@ -562,17 +636,20 @@ static void status_event(Event_T E, StringBuffer_T B) {
 void status_xml(StringBuffer_T B, Event_T E, int V, const char *myip) {
         Service_T S;
         ServiceGroup_T SG;
+        struct Snapshot_T snapshot = {};
 
         document_head(B, V, myip);
         if (V == 2)
-                StringBuffer_append(B, "<services>");
+                StringBuffer_appendString(B, "<services>");
+        // The event is sent by the validator which owns the live data, other threads read the published copy
         for (S = servicelist_conf; S; S = S->next_conf)
-                status_service(S, B, V);
+                status_service(E ? S : Snapshot_get(S, &snapshot), B, V);
+        Snapshot_free(&snapshot);
         if (V == 2) {
-                StringBuffer_append(B, "</services><servicegroups>");
+                StringBuffer_appendString(B, "</services><servicegroups>");
                 for (SG = servicegrouplist; SG; SG = SG->next)
                         status_servicegroup(SG, B);
-                StringBuffer_append(B, "</servicegroups>");
+                StringBuffer_appendString(B, "</servicegroups>");
         }
         if (E)
                 status_event(E, B);
@@ -68,10 +68,16 @@
 #include <sys/stat.h>
 #endif
 
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
 #include "monit.h"
+#include "event.h"
 
 // libmonit
 #include "system/Time.h"
+#include "exceptions/AssertException.h"
 
 
 /**
@@ -79,6 +85,18 @@
  *  with a preceding timestamp. Methods support both syslog or own
  *  logfile.
  *
+ *  Messages are formatted once, outside of the log mutex. If the log
+ *  file is buffered ("set log <path> buffered"), the daemon appends the
+ *  messages to a memory buffer and a writer thread flushes the buffer to
+ *  the file periodically. Errors and more severe messages are flushed
+ *  immediately.
+ *
+ *  If the JSON log format is set ("set log <path|syslog> format json"),
+ *  each log file or syslog record is a single line JSON object. Event
+ *  messages carry also the service name and type, event, state, action
+ *  and event time fields taken directly from the event object. The JSON
+ *  record is serialized into a preallocated buffer.
+ *
  *  @file
  */
 
@@ -86,10 +104,55 @@
 /* ------------------------------------------------------------- Definitions */
 
 
+#define LOG_LINE_SIZE   1024
+#define LOG_BUFFER_SIZE 65536
+
+
+typedef struct LogBuffer_T {
+        size_t length;
+        size_t capacity;
+        char *data;
+} LogBuffer_T;
+
+
 static FILE *LOG = NULL;
 static Mutex_T log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 
+/* Buffered log file writer */
+static struct {
+        boolean_t running;             /**< true if the writer thread is running */
+        boolean_t stop;                      /**< Request the writer thread stop */
+        boolean_t pending;               /**< Request the writer flush the buffer now */
+        boolean_t taken;                    /**< The writer took the buffer to write */
+        pid_t owner;                /**< The process where the writer thread runs */
+        Thread_T thread;
+        Sem_T flush;                      /**< Signalled to flush the buffer now */
+        Sem_T drained;          /**< Signalled when the writer took the buffer */
+        LogBuffer_T front;               /**< Messages waiting to be written */
+        LogBuffer_T back;                    /**< Messages being written to file */
+} writer;
+
+
+/* JSON record serializer, uses the preallocated stack buffer until the record outgrows it */
+typedef struct JsonWriter_T {
+        size_t length;
+        size_t capacity;
+        char *data;
+        char *preallocated;
+} *JsonWriter_T;
+
+
+static const char *statenames[] = {"succeeded", "failed", "changed", "changed not", "init"};
+
+
+/* The log file timestamp is formatted once per second */
+static struct {
+        time_t second;
+        char string[STRLEN];
+} timestamp = {.second = -1};
+
+
 static struct mylogpriority {
         int  priority;
         char *description;
@@ -111,8 +174,10 @@ static struct mylogpriority {
 
 static boolean_t open_log();
 static const char *logPriorityDescription(int p);
-static void log_log(int priority, const char *s, va_list ap);
+static void log_log(int priority, Event_T E, const char *s, va_list ap);
 static void log_backtrace();
+static void *log_writer(void *args);
+static void _logEvent(int priority, Event_T E, const char *s, ...);
 
 
 /* ------------------------------------------------------------------ Public */
@@ -141,7 +206,7 @@ void LogEmergency(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_EMERG, s, ap);
+        log_log(LOG_EMERG, NULL, s, ap);
         va_end(ap);
         log_backtrace();
 }
@@ -155,7 +220,7 @@ void LogAlert(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_ALERT, s, ap);
+        log_log(LOG_ALERT, NULL, s, ap);
         va_end(ap);
         log_backtrace();
 }
@@ -169,7 +234,7 @@ void LogCritical(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_CRIT, s, ap);
+        log_log(LOG_CRIT, NULL, s, ap);
         va_end(ap);
         log_backtrace();
 }
@@ -182,7 +247,7 @@ void vLogAbortHandler(const char *s, va_list ap) {
         ASSERT(s);
         va_list ap_copy;
         va_copy(ap_copy, ap);
-        log_log(LOG_CRIT, s, ap);
+        log_log(LOG_CRIT, NULL, s, ap);
         va_end(ap_copy);
         if (Run.debug)
                 abort();
@@ -198,7 +263,7 @@ void LogError(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_ERR, s, ap);
+        log_log(LOG_ERR, NULL, s, ap);
         va_end(ap);
         log_backtrace();
 }
@@ -212,7 +277,7 @@ void vLogError(const char *s, va_list ap) {
         ASSERT(s);
         va_list ap_copy;
         va_copy(ap_copy, ap);
-        log_log(LOG_ERR, s, ap);
+        log_log(LOG_ERR, NULL, s, ap);
         va_end(ap_copy);
         log_backtrace();
 }
@@ -226,7 +291,7 @@ void LogWarning(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_WARNING, s, ap);
+        log_log(LOG_WARNING, NULL, s, ap);
         va_end(ap);
 }
 
@@ -239,7 +304,7 @@ void LogNotice(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_NOTICE, s, ap);
+        log_log(LOG_NOTICE, NULL, s, ap);
         va_end(ap);
 }
 
@@ -252,7 +317,7 @@ void LogInfo(const char *s, ...) {
         ASSERT(s);
         va_list ap;
         va_start(ap, s);
-        log_log(LOG_INFO, s, ap);
+        log_log(LOG_INFO, NULL, s, ap);
         va_end(ap);
 }
 
@@ -266,16 +331,80 @@ void LogDebug(const char *s, ...) {
         if (Run.debug) {
                 va_list ap;
                 va_start(ap, s);
-                log_log(LOG_DEBUG, s, ap);
+                log_log(LOG_DEBUG, NULL, s, ap);
                 va_end(ap);
         }
 }
 
 
+/**
+ * Log the event message. The message is logged as "'<service>' <message>",
+ * in the JSON log format the record contains also the event fields
+ * @param priority A message priority
+ * @param E An event object
+ */
+void LogEvent(int priority, Event_T E) {
+        ASSERT(E);
+        ASSERT(E->source);
+        if (priority < LOG_DEBUG || Run.debug) {
+                char *s = "'%s' %s\n";
+                _logEvent(priority, E, s, E->source->name, NVLSTR(E->message));
+                if (priority <= LOG_ERR)
+                        log_backtrace();
+        }
+}
+
+
+/**
+ * Start the buffered log file writer thread if the log file is buffered. The
+ * daemon calls this method after it forked into the background, as threads
+ * don't survive fork
+ */
+void log_start_writer() {
+        if (! (Run.flags & Run_Log) || (Run.flags & Run_UseSyslog) || ! LOG || Run.log.flush <= 0 || writer.running)
+                return;
+        LOCK(log_mutex)
+        {
+                writer.stop = false;
+                writer.owner = getpid();
+                if (! writer.front.data) {
+                        Sem_init(writer.flush);
+                        Sem_init(writer.drained);
+                        writer.front.capacity = writer.back.capacity = LOG_BUFFER_SIZE;
+                        writer.front.data = CALLOC(1, writer.front.capacity);
+                        writer.back.data = CALLOC(1, writer.back.capacity);
+                }
+                Thread_create(writer.thread, log_writer, NULL);
+                writer.running = true;
+        }
+        END_LOCK;
+}
+
+
+/**
+ * Flush buffered log messages and stop the log file writer thread
+ */
+static void log_stop_writer() {
+        boolean_t running = false;
+        LOCK(log_mutex)
+        {
+                if (writer.running && writer.owner == getpid()) {
+                        writer.stop = true;
+                        Sem_signal(writer.flush);
+                        running = true;
+                }
+        }
+        END_LOCK;
+        if (running)
+                Thread_join(writer.thread);
+}
+
+
 /**
  * Close the log file or syslog
  */
 void log_close() {
+        log_stop_writer();
         if (Run.flags & Run_UseSyslog) {
                 closelog();
         }
@@ -337,52 +466,276 @@ static const char *logPriorityDescription(int p) {
 }
 
 
+/**
+ * Get the log file timestamp. The string is formatted only when the second
+ * changed. Must be called with log_mutex locked
+ */
+static const char *log_timestamp() {
+        time_t now = time(NULL);
+        if (now != timestamp.second) {
+                timestamp.second = now;
+                Time_fmt(timestamp.string, sizeof(timestamp.string), TIMEFORMAT, now);
+        }
+        return timestamp.string;
+}
+
+
+/**
+ * Append the string to the buffered log file writer. Must be called with
+ * log_mutex locked
+ */
+static void log_append(const char *s, size_t length) {
+        // If the buffer is full, wake up the writer and wait until it takes the buffer
+        while (writer.front.length && writer.front.length + length > writer.front.capacity) {
+                writer.taken = false;
+                writer.pending = true;
+                Sem_signal(writer.flush);
+                while (! writer.taken)
+                        Sem_wait(writer.drained, log_mutex);
+        }
+        if (length > writer.front.capacity) {
+                writer.front.capacity = length;
+                RESIZE(writer.front.data, writer.front.capacity);
+        }
+        memcpy(writer.front.data + writer.front.length, s, length);
+        writer.front.length += length;
+}
+
+
+/**
+ * Write the record to the log file: either immediately or using the
+ * buffered writer. Must be called with log_mutex locked
+ */
+static void log_write(int priority, const char *record, size_t length) {
+        if (writer.running && writer.owner == getpid()) {
+                log_append(record, length);
+                if (priority <= LOG_ERR) {
+                        writer.pending = true;
+                        Sem_signal(writer.flush);
+                }
+        } else {
+                fwrite(record, 1, length, LOG);
+        }
+}
+
+
+/**
+ * Write the message to the log file with the "[date] priority : " prefix.
+ * Must be called with log_mutex locked
+ */
+static void log_file(int priority, const char *message) {
+        char record[LOG_LINE_SIZE];
+        int length = snprintf(record, sizeof(record), "[%s] %-8s : %s", log_timestamp(), logPriorityDescription(priority), message);
+        if (length >= (int)sizeof(record)) {
+                char *r = Str_cat("[%s] %-8s : %s", log_timestamp(), logPriorityDescription(priority), message);
+                log_write(priority, r, length);
+                FREE(r);
+        } else if (length > 0) {
+                log_write(priority, record, length);
+        }
+}
+
+
+static void _jsonReserve(JsonWriter_T J, size_t n) {
+        if (J->length + n > J->capacity) {
+                size_t capacity = MAX(J->capacity * 2, J->length + n);
+                if (J->data == J->preallocated) {
+                        J->data = ALLOC(capacity);
+                        memcpy(J->data, J->preallocated, J->length);
+                } else {
+                        RESIZE(J->data, capacity);
+                }
+                J->capacity = capacity;
+        }
+}
+
+
+static void _jsonRaw(JsonWriter_T J, const char *s, size_t length) {
+        _jsonReserve(J, length);
+        memcpy(J->data + J->length, s, length);
+        J->length += length;
+}
+
+
+static void _jsonString(JsonWriter_T J, const char *s, size_t length) {
+        _jsonRaw(J, "\"", 1);
+        const char *run = s;
+        for (const char *p = s, *end = s + length; p < end; p++) {
+                const char *escape = Str_escapeJSON(*p);
+                if (escape) {
+                        _jsonRaw(J, run, p - run);
+                        _jsonRaw(J, escape, strlen(escape));
+                        run = p + 1;
+                }
+        }
+        _jsonRaw(J, run, s + length - run);
+        _jsonRaw(J, "\"", 1);
+}
+
+
+static void _jsonField(JsonWriter_T J, const char *name, const char *value) {
+        _jsonRaw(J, ",\"", 2);
+        _jsonRaw(J, name, strlen(name));
+        _jsonRaw(J, "\":", 2);
+        value = NVLSTR(value);
+        _jsonString(J, value, strlen(value));
+}
+
+
+static void _jsonNumber(JsonWriter_T J, const char *name, const char *format, ...) __attribute__((format (printf, 3, 4)));
+static void _jsonNumber(JsonWriter_T J, const char *name, const char *format, ...) {
+        char number[64];
+        va_list ap;
+        va_start(ap, format);
+        int length = vsnprintf(number, sizeof(number), format, ap);
+        va_end(ap);
+        _jsonRaw(J, ",\"", 2);
+        _jsonRaw(J, name, strlen(name));
+        _jsonRaw(J, "\":", 2);
+        _jsonRaw(J, number, MIN(length, (int)sizeof(number) - 1));
+}
+
+
+/**
+ * Serialize the log record as a single line JSON object
+ * @param J A JSON writer
+ * @param priority A message priority
+ * @param E An optional event object
+ * @param message The formatted message
+ */
+static void _jsonRecord(JsonWriter_T J, int priority, Event_T E, const char *message) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        _jsonRaw(J, "{", 1);
+        _jsonRaw(J, "\"time\":", 7);
+        char number[64];
+        int length = snprintf(number, sizeof(number), "%lld.%03ld", (long long)now.tv_sec, (long)now.tv_usec / 1000);
+        _jsonRaw(J, number, length);
+        _jsonField(J, "priority", logPriorityDescription(priority));
+        if (E) {
+                _jsonField(J, "service", E->source->name);
+                _jsonField(J, "type", servicetypes[E->type]);
+                _jsonNumber(J, "id", "%ld", E->id);
+                _jsonField(J, "event", Event_get_description(E));
+                _jsonField(J, "state", statenames[E->state]);
+                _jsonField(J, "action", Event_get_action_description(E));
+                _jsonField(J, "mode", modenames[E->mode]);
+                _jsonNumber(J, "count", "%u", E->count);
+                _jsonNumber(J, "collected", "%lld.%03ld", (long long)E->collected.tv_sec, (long)E->collected.tv_usec / 1000);
+                _jsonField(J, "message", E->message);
+        } else {
+                // Strip the trailing newline from the free-form message
+                size_t length = strlen(message);
+                while (length && (message[length - 1] == '\n' || message[length - 1] == '\r'))
+                        length--;
+                _jsonRaw(J, ",\"message\":", 11);
+                _jsonString(J, message, length);
+        }
+        _jsonRaw(J, "}\n", 2);
+        _jsonReserve(J, 1);
+        J->data[J->length] = 0;
+}
+
+
 /**
  * Log a message to monits logfile or syslog.
  * @param priority A message priority
+ * @param E An optional event object for the JSON log format
  * @param s A formated (printf-style) string to log
  */
-static void log_log(int priority, const char *s, va_list ap) {
+static void log_log(int priority, Event_T E, const char *s, va_list ap) {
         ASSERT(s);
-#ifdef HAVE_VA_COPY
+        // Format the message just once and outside of the lock
+        char buffer[LOG_LINE_SIZE];
+        char *message = buffer;
         va_list ap_copy;
-#endif
+        va_copy(ap_copy, ap);
+        int length = vsnprintf(buffer, sizeof(buffer), s, ap_copy);
+        va_end(ap_copy);
+        if (length >= (int)sizeof(buffer)) {
+                va_copy(ap_copy, ap);
+                message = Str_vcat(s, ap_copy);
+                va_end(ap_copy);
+        } else if (length < 0) {
+                *buffer = 0;
+        }
+        char preallocated[LOG_LINE_SIZE * 2];
+        struct JsonWriter_T json = {.length = 0, .capacity = sizeof(preallocated), .data = preallocated, .preallocated = preallocated};
+        boolean_t structured = (Run.flags & Run_Log) && Run.log.format == LogFormat_Json;
+        if (structured)
+                _jsonRecord(&json, priority, E, message);
         LOCK(log_mutex)
         {
-
                 FILE *output = priority < LOG_INFO ? stderr : stdout;
-#ifdef HAVE_VA_COPY
-                va_copy(ap_copy, ap);
-                vfprintf(output, s, ap_copy);
-                va_end(ap_copy);
-#else
-                vfprintf(output, s, ap);
-#endif
+                fputs(message, output);
                 fflush(output);
                 if (Run.flags & Run_Log) {
                         if (Run.flags & Run_UseSyslog) {
-#ifdef HAVE_VA_COPY
-                                va_copy(ap_copy, ap);
-                                vsyslog(priority, s, ap_copy);
-                                va_end(ap_copy);
-#else
-                                vsyslog(priority, s, ap);
-#endif
+                                if (structured)
+                                        json.data[--json.length] = 0; // syslog record without the trailing newline
+                                syslog(priority, "%s", structured ? json.data : message);
                         } else if (LOG) {
-                                char datetime[STRLEN];
-                                fprintf(LOG, "[%s] %-8s : ", Time_fmt(datetime, sizeof(datetime), TIMEFORMAT, time(NULL)), logPriorityDescription(priority));
-#ifdef HAVE_VA_COPY
-                                va_copy(ap_copy, ap);
-                                vfprintf(LOG, s, ap_copy);
-                                va_end(ap_copy);
-#else
-                                vfprintf(LOG, s, ap);
-#endif
+                                if (structured)
+                                        log_write(priority, json.data, json.length);
+                                else
+                                        log_file(priority, message);
+                        }
+                }
+        }
+        END_LOCK;
+        if (message != buffer)
+                FREE(message);
+        if (json.data != json.preallocated)
+                FREE(json.data);
+}
+
+
+static void _logEvent(int priority, Event_T E, const char *s, ...) {
+        va_list ap;
+        va_start(ap, s);
+        log_log(priority, E, s, ap);
+        va_end(ap);
+}
 
+
+/**
+ * Buffered log file writer thread. Write the buffered messages to the log
+ * file each Run.log.flush milliseconds or when requested
+ */
+static void *log_writer(void *args) {
+        set_signal_block();
+        LOCK(log_mutex)
+        {
+                while (true) {
+                        if (! writer.stop && ! writer.pending) {
+                                long long deadline = Time_milli() + Run.log.flush;
+                                struct timespec wait = {.tv_sec = (time_t)(deadline / 1000LL), .tv_nsec = (long)(deadline % 1000LL) * 1000000L};
+                                // The condition wakeup may be spurious, wait for the request or the timeout
+                                do {
+                                        Sem_timeWait(writer.flush, log_mutex, wait);
+                                } while (! writer.stop && ! writer.pending && Time_milli() < deadline);
+                        }
+                        writer.pending = false;
+                        if (writer.front.length) {
+                                // Swap the buffers, so the producers can continue while we write
+                                LogBuffer_T pending = writer.front;
+                                writer.front = writer.back;
+                                writer.back = pending;
+                                writer.taken = true;
+                                Sem_broadcast(writer.drained);
+                                Mutex_unlock(log_mutex);
+                                if (fwrite(writer.back.data, 1, writer.back.length, LOG) != writer.back.length)
+                                        fprintf(stderr, "Error writing the log file -- %s\n", STRERROR);
+                                Mutex_lock(log_mutex);
+                                writer.back.length = 0;
+                        } else if (writer.stop) {
+                                writer.running = false;
+                                break;
                         }
                 }
         }
         END_LOCK;
+        return NULL;
 }
 
 
@@ -74,6 +74,8 @@
 #include "net.h"
 #include "ProcessTree.h"
 #include "state.h"
+#include "profile.h"
+#include "snapshot.h"
 #include "event.h"
 #include "engine.h"
 #include "client.h"
@@ -139,6 +141,7 @@ char *onrebootnames[] = {"start", "nostart", "laststate"};
 char *checksumnames[] = {"UNKNOWN", "MD5", "SHA1"};
 char *operatornames[] = {"less than", "less than or equal to", "greater than", "greater than or equal to", "equal to", "not equal to", "changed"};
 char *operatorshortnames[] = {"<", "<=", ">", ">=", "=", "!=", "<>"};
+char *aggregatenames[] = {"", "average", "minimum", "maximum"};
 char *servicetypes[] = {"Filesystem", "Directory", "File", "Process", "Remote Host", "System", "Fifo", "Program", "Network"};
 char *pathnames[] = {"Path", "Path", "Path", "Pid file", "Path", "", "Path"};
 char *icmpnames[] = {"Reply", "", "", "Destination Unreachable", "Source Quench", "Redirect", "", "", "Ping", "", "", "Time Exceeded", "Parameter Problem", "Timestamp Request", "Timestamp Reply", "Information Request", "Information Reply", "Address Mask Request", "Address Mask Reply"};
@@ -194,13 +197,40 @@ boolean_t do_wakeupcall() {
 static void _validateOnce() {
         if (State_open()) {
                 State_restore();
+                Profile_start();
                 validate();
+                control_finish();
                 State_save();
+                Profile_phase(Phase_State);
+                Profile_stop();
                 State_close();
         }
 }
 
 
+/**
+ * Get the http interface setup fingerprint. The http server is restarted on
+ * reload only if the setup changed
+ */
+static char *_httpdSignature() {
+        SslOptions_T ssl = &(Run.httpd.socket.net.ssl);
+        return Str_cat("%d|%d|%s|%s|%d|%d|%d|%d|%s|%s|%s|%s|%s",
+                       Run.httpd.flags & (Httpd_Net | Httpd_Unix),
+                       Run.httpd.socket.net.port,
+                       NVLSTR(Run.httpd.socket.net.address),
+                       NVLSTR(Run.httpd.socket.unix.path),
+                       ssl->flags,
+                       ssl->verify,
+                       ssl->allowSelfSigned,
+                       ssl->version,
+                       NVLSTR(ssl->pemfile),
+                       NVLSTR(ssl->clientpemfile),
+                       NVLSTR(ssl->ciphers),
+                       NVLSTR(ssl->CACertificateFile),
+                       NVLSTR(ssl->CACertificatePath));
+}
+
+
 /**
  * Initialize this application - Register signal handlers,
  * Parse the control file and initialize the program's
@@ -277,6 +307,7 @@ static void do_init() {
          */
         if (! parse(Run.files.control))
                 exit(1);
+        Snapshot_publishAll();
 
         /*
          * Initialize the log system
@@ -327,29 +358,38 @@ static void do_reinit() {
          globale process table which a sigchld handler can check */
         waitforchildren();
 
-        if (Run.mmonits && heartbeatRunning) {
-                Sem_signal(heartbeatCond);
-                Thread_join(heartbeatThread);
-                heartbeatRunning = false;
-        }
+        RUN_CLEAR(Run_DoReload);
 
-        Run.flags &= ~Run_DoReload;
+        /* The services are replaced, don't let the http thread wait for their checks */
+        validate_cancel();
 
-        /* Stop http interface */
-        if (Run.httpd.flags & Httpd_Net || Run.httpd.flags & Httpd_Unix)
-                monit_http(Httpd_Stop);
+        /* Wait for the start/stop/restart actions in progress */
+        control_finish();
 
-        /* Save the current state (no changes are possible now since the http thread is stopped) */
         State_save();
         State_close();
 
-        /* Run the garbage collector */
-        gc();
-
-        if (! parse(Run.files.control)) {
+        /* Parse the new configuration aside, the http interface and the heartbeat keep using the current one meanwhile */
+        char *httpd = _httpdSignature();
+        struct Configuration_T config;
+        if (! parse_detached(Run.files.control, &config)) {
                 LogError("%s stopped -- error parsing configuration file\n", prog);
                 exit(1);
         }
+        LOCK(Run.mutex)
+        {
+                // The heartbeat sends to the collectors without the runtime lock, it must not see the collector list while it is replaced
+                MMonit_lock();
+                parse_commit(&config);
+                MMonit_unlock();
+                /* Keep the runtime data of the services which are present in the new configuration, the process tree is kept as well */
+                if (config.servicelist)
+                        State_transfer(config.servicelist);
+                Snapshot_publishAll();
+        }
+        END_LOCK;
+        /* Release the previous configuration, nothing refers to it after the swap */
+        gc_configuration_detached(&config);
 
         /* Close the current log */
         log_close();
@@ -357,6 +397,7 @@ static void do_reinit() {
         /* Reinstall the log system */
         if (! log_init())
                 exit(1);
+        log_start_writer();
 
         /* Did we find any services ?  */
         if (! servicelist) {
@@ -377,16 +418,26 @@ static void do_reinit() {
                 exit(1);
         State_restore();
 
-        /* Start http interface */
-        if (can_http())
+        /* Restart the http interface only if its setup changed */
+        boolean_t http = can_http();
+        char *current = _httpdSignature();
+        if (! http || ! Str_isByteEqual(httpd, current))
+                monit_http(Httpd_Stop);
+        if (http)
                 monit_http(Httpd_Start);
+        FREE(current);
+        FREE(httpd);
 
         /* send the monit startup notification */
         Event_post(Run.system, Event_Instance, State_Changed, Run.system->action_MONIT_START, "Monit reloaded");
 
-        if (Run.mmonits) {
+        if (Run.mmonits && ! heartbeatRunning) {
                 Thread_create(heartbeatThread, heartbeat, NULL);
                 heartbeatRunning = true;
+        } else if (! Run.mmonits && heartbeatRunning) {
+                Sem_signal(heartbeatCond);
+                Thread_join(heartbeatThread);
+                heartbeatRunning = false;
         }
 }
 
@@ -411,13 +462,11 @@ static void do_action(char **args) {
                         int errors = 0;
                         List_T services = List_new();
                         if (Run.mygroup) {
-                                for (ServiceGroup_T sg = servicegrouplist; sg; sg = sg->next) {
-                                        if (IS(Run.mygroup, sg->name)) {
-                                                for (list_t m = sg->members->head; m; m = m->next) {
-                                                        Service_T s = m->e;
-                                                        List_append(services, s->name);
-                                                }
-                                                break;
+                                ServiceGroup_T sg = Util_getServiceGroup(Run.mygroup);
+                                if (sg) {
+                                        for (list_t m = sg->members->head; m; m = m->next) {
+                                                Service_T s = m->e;
+                                                List_append(services, s->name);
                                         }
                                 }
                                 if (List_length(services) == 0) {
@@ -429,7 +478,9 @@ static void do_action(char **args) {
                                 for (Service_T s = servicelist; s; s = s->next)
                                         List_append(services, s->name);
                         } else {
-                                List_append(services, service);
+                                // One or more service names or wildcard patterns
+                                for (; args[optind]; optind++)
+                                        List_append(services, args[optind]);
                         }
                         errors = exist_daemon() ? (HttpClient_action(action, services) ? 0 : 1) : control_service_string(services, action);
                         List_free(&services);
@@ -442,13 +493,16 @@ static void do_action(char **args) {
         } else if (IS(action, "reload")) {
                 LogInfo("Reinitializing %s daemon\n", prog);
                 kill_daemon(SIGHUP);
-        } else if (IS(action, "status")) {
-                char *service = args[++optind];
-                if (! HttpClient_status(Run.mygroup, service))
+        } else if (IS(action, "status") || IS(action, "summary")) {
+                List_T services = List_new();
+                while (args[++optind])
+                        List_append(services, args[optind]);
+                boolean_t rv = IS(action, "status") ? HttpClient_status(Run.mygroup, services) : HttpClient_summary(Run.mygroup, services);
+                List_free(&services);
+                if (! rv)
                         exit(1);
-        } else if (IS(action, "summary")) {
-                char *service = args[++optind];
-                if (! HttpClient_summary(Run.mygroup, service))
+        } else if (IS(action, "batch")) {
+                if (! HttpClient_batch(stdin))
                         exit(1);
         } else if (IS(action, "report")) {
                 char *type = args[++optind];
@@ -464,9 +518,20 @@ static void do_action(char **args) {
         } else if (IS(action, "quit")) {
                 kill_daemon(SIGTERM);
         } else if (IS(action, "validate")) {
-                if (do_wakeupcall()) {
-                        char *service = args[++optind];
-                        HttpClient_status(Run.mygroup, service);
+                if (exist_daemon() && (args[optind + 1] || Run.mygroup)) {
+                        // Check only the given services (names or wildcard patterns) or group now and wait for the result
+                        List_T services = List_new();
+                        while (args[++optind])
+                                List_append(services, args[optind]);
+                        boolean_t rv = HttpClient_check(Run.mygroup, services);
+                        List_free(&services);
+                        exit(rv ? 0 : 1);
+                } else if (do_wakeupcall()) {
+                        List_T services = List_new();
+                        if (args[++optind])
+                                List_append(services, args[optind]);
+                        HttpClient_status(Run.mygroup, services);
+                        List_free(&services);
                 } else {
                         _validateOnce();
                 }
@@ -483,7 +548,8 @@ static void do_action(char **args) {
  */
 static void do_exit() {
         set_signal_block();
-        Run.flags |= Run_Stopped;
+        RUN_SET(Run_Stopped);
+        validate_cancel();
         if ((Run.flags & Run_Daemon) && ! (Run.flags & Run_Once)) {
                 if (can_http())
                         monit_http(Httpd_Stop);
@@ -499,6 +565,7 @@ static void do_exit() {
                 /* send the monit stop notification */
                 Event_post(Run.system, Event_Instance, State_Changed, Run.system->action_MONIT_STOP, "Monit %s stopped", VERSION);
         }
+        control_finish();
         gc();
 #ifdef HAVE_OPENSSL
         Ssl_stop();
@@ -557,6 +624,9 @@ static void do_default() {
                         }
                 }
 
+                /* Threads don't survive fork, so the buffered log writer can be started only now */
+                log_start_writer();
+
                 if (can_http())
                         monit_http(Httpd_Start);
 
@@ -569,15 +639,18 @@ static void do_default() {
                 }
 
                 while (true) {
+                        Profile_start();
                         validate();
                         State_save();
+                        Profile_phase(Phase_State);
+                        Profile_stop();
 
                         /* In the case that there is no pending action then sleep */
                         if (! (Run.flags & Run_ActionPending) && ! (Run.flags & Run_Stopped))
-                                sleep(Run.polltime);
+                                validate_sleep(Run.polltime);
 
                         if (Run.flags & Run_DoWakeup) {
-                                Run.flags &= ~Run_DoWakeup;
+                                RUN_CLEAR(Run_DoWakeup);
                                 LogInfo("Awakened by User defined signal 1\n");
                         }
 
@@ -601,7 +674,7 @@ static void handle_options(int argc, char **argv) {
         int deferred_opt = 0;
         opterr = 0;
         Run.mygroup = NULL;
-        const char *shortopts = "c:d:g:l:p:s:HIirtvVhB";
+        const char *shortopts = "c:d:g:l:p:s:HIirtvVhBj";
 #ifdef HAVE_GETOPT_LONG
         struct option longopts[] = {
                 {"conf",        required_argument,      NULL,   'c'},
@@ -617,6 +690,8 @@ static void handle_options(int argc, char **argv) {
                 {"test",        no_argument,            NULL,   't'},
                 {"verbose",     no_argument,            NULL,   'v'},
                 {"batch",       no_argument,            NULL,   'B'},
+                {"json",        no_argument,            NULL,   'j'},
+                {"timings",     no_argument,            NULL,   'T'},
                 {"interactive", no_argument,            NULL,   'I'},
                 {"version",     no_argument,            NULL,   'V'},
                 {0}
@@ -726,6 +801,16 @@ static void handle_options(int argc, char **argv) {
                                         Run.flags |= Run_Batch;
                                         break;
                                 }
+                                case 'j':
+                                {
+                                        Run.flags |= Run_Json;
+                                        break;
+                                }
+                                case 'T':
+                                {
+                                        Run.flags |= Run_Timings;
+                                        break;
+                                }
                                 case '?':
                                 {
                                         switch (optopt) {
@@ -758,6 +843,8 @@ static void handle_options(int argc, char **argv) {
                 {
                         do_init(); // Parses control file and initialize program, exit on error
                         printf("Control file syntax OK\n");
+                        if (Run.flags & Run_Timings)
+                                parse_printTimings();
                         exit(0);
                         break;
                 }
@@ -803,7 +890,9 @@ static void help() {
                " --id          Print Monit's unique ID\n"
                " --resetid     Reset Monit's unique ID. Use with caution\n"
                " -B            Batch command line mode (do not output tables or colors)\n"
+               " -j            Print status, summary and action results as JSON\n"
                " -t            Run syntax check for the control file\n"
+               " --timings     With -t print the control file parse timings\n"
                " -v            Verbose mode, work noisy (diagnostic output)\n"
                " -vv           Very verbose mode, same as -v plus log stacktrace on error\n"
                " -H [filename] Print SHA1 and MD5 hashes of the file or of stdin if the\n"
@@ -822,11 +911,13 @@ static void help() {
                " unmonitor all         - Disable monitoring of all services\n"
                " unmonitor <name>      - Only disable monitoring of the named service\n"
                " reload                - Reinitialize monit\n"
-               " status [name]         - Print full status information for service(s)\n"
-               " summary [name]        - Print short status information for service(s)\n"
+               " status [name ...]     - Print full status information for service(s)\n"
+               " summary [name ...]    - Print short status information for service(s)\n"
+               " batch                 - Execute commands read from stdin, one per line\n"
                " report [up|down|..]   - Report state of services. See manual for options\n"
                " quit                  - Kill the monit daemon process\n"
                " validate              - Check all services and start if not running\n"
+               " validate <name>       - Check the named service(s) now and wait for the result\n"
                " procmatch <pattern>   - Test process matching pattern\n",
                prog);
 }
@@ -869,10 +960,12 @@ static void *heartbeat(void *args) {
         LogInfo("M/Monit heartbeat started\n");
         LOCK(heartbeatMutex)
         {
-                while (! (Run.flags & Run_Stopped) && ! (Run.flags & Run_DoReload)) {
-                        MMonit_send(NULL);
-                        struct timespec wait = {.tv_sec = Time_now() + Run.polltime, .tv_nsec = 0};
-                        Sem_timeWait(heartbeatCond, heartbeatMutex, wait);
+                // The heartbeat keeps running during reload, it stops when M/Monit was removed from the configuration
+                for (boolean_t enabled = true; enabled && ! (Run.flags & Run_Stopped);) {
+                        if ((enabled = MMonit_heartbeat())) {
+                                struct timespec wait = {.tv_sec = Time_now() + Run.polltime, .tv_nsec = 0};
+                                Sem_timeWait(heartbeatCond, heartbeatMutex, wait);
+                        }
                 }
         }
         END_LOCK;
@@ -888,7 +981,7 @@ static void *heartbeat(void *args) {
  * Signalhandler for a daemon reload call
  */
 static RETSIGTYPE do_reload(int sig) {
-        Run.flags |= Run_DoReload;
+        RUN_SET(Run_DoReload);
 }
 
 
@@ -896,7 +989,7 @@ static RETSIGTYPE do_reload(int sig) {
  * Signalhandler for monit finalization
  */
 static RETSIGTYPE do_destroy(int sig) {
-        Run.flags |= Run_Stopped;
+        RUN_SET(Run_Stopped);
 }
 
 
@@ -904,7 +997,7 @@ static RETSIGTYPE do_destroy(int sig) {
  * Signalhandler for a daemon wakeup call
  */
 static RETSIGTYPE do_wakeup(int sig) {
-        Run.flags |= Run_DoWakeup;
+        RUN_SET(Run_DoWakeup);
 }
 
 
@@ -130,6 +130,7 @@ typedef enum {
 #include "util/StringBuffer.h"
 #include "system/Link.h"
 #include "statistics/Statistics.h"
+#include "statistics/Series.h"
 #include "thread/Thread.h"
 
 
@@ -177,7 +178,10 @@ typedef enum {
         Run_Stopped              = 0x400,                          /**< Stop Monit */
         Run_DoReload             = 0x800,                        /**< Reload Monit */
         Run_DoWakeup             = 0x1000,                       /**< Wakeup Monit */
-        Run_Batch                = 0x2000                      /**< CLI batch mode */
+        Run_Batch                = 0x2000,                     /**< CLI batch mode */
+        Run_Json                 = 0x4000,               /**< CLI JSON output format */
+        Run_Timings              = 0x8000,        /**< Print the parse timings with -t */
+        Run_CheckPending         = 0x10000        /**< Out of band check pending */
 } __attribute__((__packed__)) Run_Flags;
 
 
@@ -193,6 +197,12 @@ typedef enum {
 } __attribute__((__packed__)) Httpd_Action;
 
 
+typedef enum {
+        LogFormat_Text = 0,
+        LogFormat_Json
+} __attribute__((__packed__)) LogFormat_Type;
+
+
 typedef enum {
         Every_Cycle = 0,
         Every_SkipCycles,
@@ -238,6 +248,14 @@ typedef enum {
 } __attribute__((__packed__)) Time_Type;
 
 
+typedef enum {
+        Aggregate_None = 0,
+        Aggregate_Average,
+        Aggregate_Minimum,
+        Aggregate_Maximum
+} __attribute__((__packed__)) Aggregate_Type;
+
+
 typedef enum {
         Action_Ignored = 0,
         Action_Alert,
@@ -317,7 +335,14 @@ typedef enum {
         Resource_ReadOperations,
         Resource_WriteBytes,
         Resource_WriteOperations,
-        Resource_ServiceTime
+        Resource_ServiceTime,
+        Resource_MemoryAvailablePercent,
+        Resource_MemoryAvailableKbyte,
+        Resource_MemoryDirty,
+        Resource_MemoryWriteback,
+        Resource_SlabUnreclaimable,
+        Resource_HugePagesPercent,
+        Resource_HugePagesKbyte
 } __attribute__((__packed__)) Resource_Type;
 
 
@@ -380,6 +405,7 @@ typedef enum {
 #define LIMIT_STOPTIMEOUT       30000
 #define LIMIT_STARTTIMEOUT      30000
 #define LIMIT_RESTARTTIMEOUT    30000
+#define LIMIT_LOGFLUSH          1000
 
 
 #include "socket.h"
@@ -397,6 +423,12 @@ Sigfunc *signal(int signo, Sigfunc * func);
 #endif
 
 
+/* The runtime flags are changed by the signal handlers and by the http
+ * thread while the main thread runs, so they are updated atomically */
+#define RUN_SET(f)   __atomic_or_fetch(&Run.flags, (f), __ATOMIC_SEQ_CST)
+#define RUN_CLEAR(f) __atomic_and_fetch(&Run.flags, ~(f), __ATOMIC_SEQ_CST)
+
+
 /** ------------------------------------------------- General purpose macros */
 
 
@@ -405,7 +437,7 @@ Sigfunc *signal(int signo, Sigfunc * func);
 #undef MIN
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 #define IS(a,b)  ((a && b) ? Str_isEqual(a, b) : false)
-#define DEBUG LogDebug
+#define DEBUG(...) do { if (Run.debug) LogDebug(__VA_ARGS__); } while (0)
 #define FLAG(x, y) (x & y) == y
 #define NVLSTR(x) (x ? x : "")
 
@@ -504,6 +536,7 @@ typedef struct Mmonit_T {
         MmonitCompress_Type compress;                        /**< Compression flag */
 
         /** For internal use */
+        Socket_T socket;                       /**< Persistent (keep-alive) connection */
         struct Mmonit_T *next;                         /**< next receiver in chain */
 } *Mmonit_T;
 
@@ -548,6 +581,15 @@ typedef struct Auth_T {
 } *Auth_T;
 
 
+/** Defines duration statistics of one measured item (see profile.h) */
+typedef struct Timing_T {
+        uint64_t last;                                /**< Last duration [us] */
+        uint64_t max;                              /**< Maximum duration [us] */
+        uint64_t total;                       /**< Sum of all durations [us] */
+        unsigned long long count;                /**< Number of measurements */
+} Timing_T;
+
+
 /** Defines data for systemwide statistic */
 typedef struct SystemInfo_T {
         struct {
@@ -564,6 +606,19 @@ typedef struct SystemInfo_T {
                         float percent;  /**< Total real memory in use in the system */
                         uint64_t bytes; /**< Total real memory in use in the system */
                 } usage;
+                struct {
+                        float percent; /**< Memory available without swapping [%] */
+                        uint64_t bytes;  /**< Memory available without swapping [B] */
+                } available;
+                uint64_t dirty;        /**< Memory waiting to be written to disk [B] */
+                uint64_t writeback;   /**< Memory being written back to disk [B] */
+                uint64_t slabUnreclaimable; /**< Unreclaimable kernel slab memory [B] */
+                struct {
+                        uint64_t size;                /**< Total huge pages size [B] */
+                        float percent;                   /**< Huge pages in use [%] */
+                        uint64_t bytes;                  /**< Huge pages in use [B] */
+                } hugepages;
+                boolean_t extended; /**< true if the extended memory statistics are available */
         } memory;
         struct {
                 uint64_t size;                                       /**< Swap size */
@@ -721,17 +776,27 @@ typedef struct Icmp_T {
 
 typedef struct Dependant_T {
         char *dependant;                            /**< name of dependant service */
+        struct Service_T *service;     /**< The dependant service (set by parser) */
 
         /** For internal use */
         struct Dependant_T *next;             /**< next dependant service in chain */
 } *Dependant_T;
 
 
+/** Defines a windowed aggregate of the resource value */
+typedef struct Aggregate_T {
+        Aggregate_Type type;                  /**< Aggregate function or none */
+        int range;                                       /**< Window length [s] */
+        Series_T series;       /**< Samples of the resource (allocated on demand) */
+} Aggregate_T;
+
+
 /** Defines resource data */
 typedef struct Resource_T {
         Resource_Type resource_id;                     /**< Which value is checked */
         Operator_Type operator;                           /**< Comparison operator */
         double limit;                                   /**< Limit of the resource */
+        Aggregate_T aggregate;          /**< Windowed aggregate instead of current value */
         EventAction_T action;  /**< Description of the action upon event occurence */
 
         /** For internal use */
@@ -952,6 +1017,7 @@ typedef struct FileSystem_T {
         //FIXME: union
         long long limit_absolute;                          /**< Watermark - blocks */
         float limit_percent;                              /**< Watermark - percent */
+        Aggregate_T aggregate;          /**< Windowed aggregate instead of current value */
         EventAction_T action;  /**< Description of the action upon event occurence */
 
         /** For internal use */
@@ -1018,6 +1084,7 @@ typedef struct FileInfo_T {
         off_t readpos;                        /**< Position for regex matching */
         ino_t inode;                                                /**< Inode */
         ino_t inode_prev;               /**< Previous inode for regex matching */
+        dev_t device;                           /**< Device id of the filesystem */
         MD_T  cs_sum;                                            /**< Checksum */ //FIXME: allocate dynamically only when necessary
 } *FileInfo_T;
 
@@ -1082,28 +1149,39 @@ typedef union Info_T {
 //FIXME: use union for type-specific rules
 typedef struct Service_T {
 
-        /** Common parameters */
-        char *name;                                  /**< Service descriptive name */
+        /** Scheduling state read by validate() for every service in every
+         *  cycle, kept together at the head of the structure so the walk of
+         *  the service list touches as few cache lines as possible */
+        struct Service_T *next;                         /**< next service in chain */
         State_Type (*check)(struct Service_T *);/**< Service verification function */
-        boolean_t visited; /**< Service visited flag, set if dependencies are used */
         Service_Type type;                             /**< Monitored service type */
         Monitor_State monitor;                             /**< Monitor state flag */
+        Action_Type doaction;                 /**< Action scheduled by http thread */
+        boolean_t busy;          /**< Start/stop/restart action is in progress */
         Monitor_Mode mode;                    /**< Monitoring mode for the service */
         Onreboot_Type onreboot;                                /**< On reboot mode */
-        Action_Type doaction;                 /**< Action scheduled by http thread */
+        boolean_t visited; /**< Service visited flag, set if dependencies are used */
+        boolean_t checkRequested;    /**< Out of band check requested by http */
+        int                error;                          /**< Error flags bitmap */
+        int                error_hint;   /**< Failed/Changed hint for error bitmap */
+        Every_T every;              /**< Timespec for when to run check of service */
+        Dependant_T dependantlist;                     /**< Dependant service list */
+        ActionRate_T actionratelist;                    /**< ActionRate check list */
         int  ncycle;                          /**< The number of the current cycle */
         int  nstart;           /**< The number of current starts with this service */
-        Every_T every;              /**< Timespec for when to run check of service */
+        Timing_T           timing;                   /**< Service check duration */
+        struct timeval     collected;                /**< When were data collected */ //FIXME: replace with uint64_t? (all places where timeval is used) ... Time_milli()?
+
+        /** Common parameters */
+        char *name;                                  /**< Service descriptive name */
         command_t start;                    /**< The start command for the service */
         command_t stop;                      /**< The stop command for the service */
         command_t restart;                /**< The restart command for the service */
         Program_T program;                            /**< Program execution check */
 
-        Dependant_T dependantlist;                     /**< Dependant service list */
         Mail_T maillist;                       /**< Alert notification mailinglist */
 
         /** Test rules and event handlers */
-        ActionRate_T actionratelist;                    /**< ActionRate check list */
         Checksum_T  checksum;                                  /**< Checksum check */
         FileSystem_T filesystemlist;                    /**< Filesystem check list */
         Icmp_T      icmplist;                                 /**< ICMP check list */
@@ -1144,12 +1222,20 @@ typedef struct Service_T {
         EventAction_T action_ACTION;           /**< Action requested by CLI or GUI */
 
         /** Runtime parameters */
-        int                error;                          /**< Error flags bitmap */
-        int                error_hint;   /**< Failed/Changed hint for error bitmap */
         union Info_T       inf;                          /**< Service check result */
-        struct timeval     collected;                /**< When were data collected */ //FIXME: replace with uint64_t? (all places where timeval is used) ... Time_milli()?
         char              *token;                                /**< Action token */
 
+        /** Copy of the check results for the http thread (see snapshot.h) */
+        struct {
+                volatile unsigned int sequence; /**< Sequence lock, odd while written */
+                union Info_T inf;                        /**< Service check result */
+                Timing_T timing;                       /**< Service check duration */
+                struct timeval collected;            /**< When were data collected */
+                time_t started;                    /**< When the program was started */
+                int exitStatus;                            /**< Program exit status */
+                char *output;                                /**< Last program output */
+        } published;
+
         /** Events */
         struct myevent {
                 #define           EVENT_VERSION  4      /**< The event structure version */
@@ -1174,7 +1260,6 @@ typedef struct Service_T {
 
         /** For internal use */
         Mutex_T mutex;                  /**< Mutex used for action synchronization */
-        struct Service_T *next;                         /**< next service in chain */
         struct Service_T *next_conf;      /**< next service according to conf file */
         struct Service_T *next_depend;           /**< next depend service in chain */
 } *Service_T;
@@ -1205,6 +1290,10 @@ struct Run_T {
                 char *id;                       /**< The file with unique monit id */
                 char *state;            /**< The file with the saved runtime state */
         } files;
+        struct {
+                int flush;  /**< Buffered log file flush interval [ms], 0 = unbuffered */
+                LogFormat_Type format;                       /**< Log record format */
+        } log;
         char *mygroup;                              /**< Group Name of the Service */
         MD_T id;                                              /**< Unique monit id */
         Limits_T limits;                                       /**< Default limits */
@@ -1259,6 +1348,15 @@ struct Run_T {
 };
 
 
+/** A configuration parsed on reload while the runtime configuration stays in use, see parse_detached() */
+typedef struct Configuration_T {
+        struct Run_T run;                        /**< The parsed runtime setup */
+        Service_T servicelist;                               /**< The service list */
+        Service_T servicelist_conf;          /**< The service list in conf file order */
+        ServiceGroup_T servicegrouplist;               /**< The service group list */
+} *Configuration_T;
+
+
 /* -------------------------------------------------------- Global variables */
 
 
@@ -1275,6 +1373,7 @@ extern char *onrebootnames[];
 extern char *checksumnames[];
 extern char *operatornames[];
 extern char *operatorshortnames[];
+extern char *aggregatenames[];
 extern char *servicetypes[];
 extern char *pathnames[];
 extern char *icmpnames[];
@@ -1294,10 +1393,19 @@ extern char *socketnames[];
 /* FIXME: move remaining prototypes into seperate header-files */
 
 boolean_t parse(char *);
+boolean_t parse_detached(char *, Configuration_T);
+void  parse_commit(Configuration_T);
+void  parse_printTimings();
 boolean_t control_service(const char *, Action_Type);
 boolean_t control_service_string(List_T, const char *);
+void  control_schedule(Service_T, Action_Type, boolean_t);
+void  control_progress();
+int   control_programs(Process_T [], int);
+int   control_interval();
+void  control_finish();
 void  spawn(Service_T, command_t, Event_T);
 boolean_t log_init();
+void  log_start_writer();
 void  LogEmergency(const char *, ...) __attribute__((format (printf, 1, 2)));
 void  LogAlert(const char *, ...) __attribute__((format (printf, 1, 2)));
 void  LogCritical(const char *, ...) __attribute__((format (printf, 1, 2)));
@@ -1306,6 +1414,7 @@ void  LogWarning(const char *, ...) __attribute__((format (printf, 1, 2)));
 void  LogNotice(const char *, ...) __attribute__((format (printf, 1, 2)));
 void  LogInfo(const char *, ...) __attribute__((format (printf, 1, 2)));
 void  LogDebug(const char *, ...) __attribute__((format (printf, 1, 2)));
+void  LogEvent(int, Event_T);
 void  vLogError(const char *s, va_list ap);
 void  vLogAbortHandler(const char *s, va_list ap);
 void  log_close();
@@ -1315,9 +1424,16 @@ void vsyslog (int, const char *, va_list);
 #endif /* HAVE_SYSLOG */
 #endif /* HAVE_VSYSLOG */
 int   validate();
+void  validate_sleep(int);
+int   validate_services(List_T);
+void  validate_cancel();
 void  daemonize();
 void  gc();
+void  gc_configuration();
+void  gc_configuration_detached(Configuration_T);
+void  gc_service_list(Service_T *);
 void  gc_mail_list(Mail_T *);
+void  gc_share_rules(Service_T);
 void  gccmd(command_t *);
 void  gc_event(Event_T *e);
 boolean_t kill_daemon(int);
@@ -46,10 +46,19 @@
 #include "event.h"
 #include "MMonit.h"
 
+// libmonit
+#include "system/Net.h"
+#include "exceptions/AssertException.h"
+
 
 /**
  *  Connect to a data collector servlet and send the event or status message.
  *
+ *  The connection to each collector is kept open between messages (HTTP/1.1
+ *  keep-alive), so heartbeats and events reuse the same socket and TLS session
+ *  instead of connecting for every message. The connection is dropped if the
+ *  collector closes it, asks for it to be closed or if an I/O error occurs.
+ *
  *  @file
  */
 
@@ -59,17 +68,56 @@
 
 #define MMONIT_SERVER_HEADER "Server: mmonit/"
 
+/* Stands for the local address of the connection in the status message rendered before connecting */
+#define MMONIT_LOCALHOST "@@mmonit-localhost@@"
+
+
+/* ------------------------------------------------------------- Private data */
+
+
+// Serialize the heartbeat thread and the validation thread on the shared collector connections. The collector list is replaced on reload under this lock too, so the heartbeat can use it without the runtime lock
+static Mutex_T mutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /* ----------------------------------------------------------------- Private */
 
 
+static void _disconnect(Mmonit_T C) {
+        if (C->socket)
+                Socket_free(&C->socket);
+}
+
+
+/**
+ * Get a connection to the collector. An idle keep-alive connection is
+ * reused unless it became readable, which means the collector closed it
+ * @param C An mmonit object
+ * @param reused Set to true if an existing connection was returned
+ * @return A connected socket or NULL if the connection failed
+ */
+static Socket_T _connect(Mmonit_T C, boolean_t *reused) {
+        *reused = false;
+        if (C->socket) {
+                if (! Net_canRead(Socket_getSocket(C->socket), 0)) {
+                        *reused = true;
+                        return C->socket;
+                }
+                DEBUG("M/Monit: connection to %s closed by peer, reconnecting\n", C->url->url);
+                _disconnect(C);
+        }
+        C->socket = Socket_create(C->url->hostname, C->url->port, Socket_Tcp, Socket_Ip, &(C->ssl), C->timeout);
+        return C->socket;
+}
+
+
 /**
  * Send message to the server
  * @param C An mmonit object
  * @param D Data to send
+ * @param started Set to true if some part of the request may have reached the server
  * @return true if the message sending succeeded otherwise false
  */
-static boolean_t _send(Socket_T socket, Mmonit_T C, StringBuffer_T sb) {
+static boolean_t _send(Socket_T socket, Mmonit_T C, StringBuffer_T sb, boolean_t *started) {
         char *auth = Util_getBasicAuthHeader(C->url->user, C->url->password);
         const void *body = NULL;
         size_t bodyLength = 0;
@@ -79,11 +127,13 @@ static boolean_t _send(Socket_T socket, Mmonit_T C, StringBuffer_T sb) {
                 body = StringBuffer_toString(sb);
                 bodyLength = StringBuffer_length(sb);
         }
+        *started = false;
         int rv = Socket_print(socket,
                               "POST %s HTTP/1.1\r\n"
                               "Host: %s%s%s:%d\r\n"
                               "Content-Type: text/xml\r\n"
                               "Content-Length: %zu\r\n"
+                              "Connection: keep-alive\r\n"
                               "Pragma: no-cache\r\n"
                               "Accept: */*\r\n"
                               "User-Agent: Monit/%s\r\n"
@@ -97,6 +147,9 @@ static boolean_t _send(Socket_T socket, Mmonit_T C, StringBuffer_T sb) {
                               C->compress == MmonitCompress_Yes ? "Content-Encoding: gzip\r\n" : "",
                               auth ? auth : "");
         FREE(auth);
+        // The header is small and written by a single write call: if it failed, nothing was sent
+        if (rv >= 0)
+                *started = true;
         if (rv < 0 || Socket_write(socket, (unsigned char *)body, bodyLength) < 0) {
                 LogError("M/Monit: error sending data to %s -- %s\n", C->url->url, STRERROR);
                 return false;
@@ -106,14 +159,22 @@ static boolean_t _send(Socket_T socket, Mmonit_T C, StringBuffer_T sb) {
 
 
 /**
- * Check that the server returns a valid HTTP response
+ * Check that the server returns a valid HTTP response. The complete response
+ * (headers and body) is consumed so the connection can be reused
  * @param C An mmonit object
+ * @param keepalive Set to true if the connection can be reused
+ * @param closed Set to true if the server closed the connection without any response
  * @return true if the response is valid otherwise false
  */
-static boolean_t _receive(Socket_T socket, Mmonit_T C) {
+static boolean_t _receive(Socket_T socket, Mmonit_T C, boolean_t *keepalive, boolean_t *closed) {
         int  status;
         char buf[STRLEN];
+        *keepalive = false;
+        *closed = false;
+        errno = 0;
         if (! Socket_readLine(socket, buf, sizeof(buf))) {
+                // A timeout leaves EAGAIN: the server may still be processing the request
+                *closed = ! (errno == EAGAIN || errno == EWOULDBLOCK);
                 LogError("M/Monit: error receiving data from %s -- %s\n", C->url->url, STRERROR);
                 return false;
         }
@@ -123,61 +184,148 @@ static boolean_t _receive(Socket_T socket, Mmonit_T C) {
                 LogError("M/Monit: failed to send message to %s -- %s\n", C->url->url, buf);
                 return false;
         }
-        if (C->compress == MmonitCompress_Init) {
-                C->compress = MmonitCompress_No;
+        boolean_t persistent = Str_startsWith(buf, "HTTP/1.1");
+        long long contentLength = -1;
+        MmonitCompress_Type compress = MmonitCompress_No;
+        while (Socket_readLine(socket, buf, sizeof(buf))) {
+                if ((buf[0] == '\r' && buf[1] == '\n') || (buf[0] == '\n'))
+                        break;
+                Str_chomp(buf);
+                if (Str_startsWith(buf, "Content-Length:")) {
+                        if (sscanf(buf + 15, "%lld", &contentLength) != 1)
+                                contentLength = -1;
+                } else if (Str_startsWith(buf, "Connection:")) {
+                        if (Str_sub(buf + 11, "close"))
+                                persistent = false;
+                } else if (Str_startsWith(buf, "Transfer-Encoding:")) {
+                        persistent = false; // Chunked body is not expected from the collector, don't try to skip it
 #ifdef HAVE_LIBZ
-                while (Socket_readLine(socket, buf, sizeof(buf))) {
-                        if ((buf[0] == '\r' && buf[1] == '\n') || (buf[0] == '\n'))
-                                break;
-                        Str_chomp(buf);
-                        if (Str_startsWith(buf, MMONIT_SERVER_HEADER)) {
-                                char *version = buf + strlen(MMONIT_SERVER_HEADER);
-                                if (*version) {
-                                        int major, minor;
-                                        if (sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 3 || (major == 3 && minor >= 6)))
-                                                C->compress = MmonitCompress_Yes;
-                                }
+                } else if (Str_startsWith(buf, MMONIT_SERVER_HEADER)) {
+                        char *version = buf + strlen(MMONIT_SERVER_HEADER);
+                        if (*version) {
+                                int major, minor;
+                                if (sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 3 || (major == 3 && minor >= 6)))
+                                        compress = MmonitCompress_Yes;
+                        }
+#endif
+                }
+        }
+        if (C->compress == MmonitCompress_Init)
+                C->compress = compress;
+        // Skip the response body so the next request starts on a clean stream
+        if (contentLength < 0) {
+                persistent = false;
+        } else {
+                for (char b[256]; contentLength > 0; ) {
+                        int r = Socket_read(socket, b, (int)MIN(contentLength, (long long)sizeof(b)));
+                        if (r <= 0) {
+                                persistent = false;
                                 break;
                         }
+                        contentLength -= r;
                 }
-#endif
         }
+        *keepalive = persistent;
         return true;
 }
 
 
+/**
+ * Send the event or status message to the collectors. If status is given,
+ * it is the prerendered status message, otherwise the message is rendered
+ * for every collector. Called with the M/Monit lock held
+ */
+static Handler_Type _post(Event_T E, StringBuffer_T status) {
+        Handler_Type rv = Handler_Mmonit;
+        StringBuffer_T sb = StringBuffer_create(256);
+        for (Mmonit_T C = Run.mmonits; C; C = C->next) {
+                boolean_t reused, started, closed, keepalive = false;
+                for (int attempt = 0; attempt < 2; attempt++) {
+                        Socket_T socket = _connect(C, &reused);
+                        if (! socket) {
+                                LogError("M/Monit: cannot open a connection to %s\n", C->url->url);
+                                break;
+                        }
+                        StringBuffer_clear(sb);
+                        if (status) {
+                                StringBuffer_appendString(sb, StringBuffer_toString(status));
+                                StringBuffer_replace(sb, MMONIT_LOCALHOST, Socket_getLocalHost(socket, (char[STRLEN]){}, STRLEN));
+                        } else {
+                                status_xml(sb, E, 2, Socket_getLocalHost(socket, (char[STRLEN]){}, STRLEN));
+                        }
+                        // The collector may have dropped an idle keep-alive connection just now: retry once with a fresh connection, but only
+                        // if the collector cannot have seen the request (nothing was sent, or the connection closed without any response)
+                        if (! _send(socket, C, sb, &started)) {
+                                _disconnect(C);
+                                if (reused && ! started)
+                                        continue;
+                                LogError("M/Monit: cannot send %s message to %s\n", E ? "event" : "status", C->url->url);
+                                break;
+                        }
+                        if (! _receive(socket, C, &keepalive, &closed)) {
+                                _disconnect(C);
+                                if (reused && closed)
+                                        continue;
+                                LogError("M/Monit: %s message to %s failed\n", E ? "event" : "status", C->url->url);
+                                break;
+                        }
+                        if (! keepalive)
+                                _disconnect(C);
+                        rv = Handler_Succeeded; // Return success if at least one M/Monit succeeded
+                        DEBUG("M/Monit: %s message sent to %s\n", E ? "event" : "status", C->url->url);
+                        break;
+                }
+        }
+        StringBuffer_free(&sb);
+        return rv;
+}
+
+
 /* ------------------------------------------------------------------ Public */
 
 
 Handler_Type MMonit_send(Event_T E) {
-        Handler_Type rv = Handler_Mmonit;
+        Handler_Type rv = Handler_Succeeded;
         /* The event is sent to mmonit just once - only in the case that the state changed */
         if (! Run.mmonits || (E && ! E->state_changed))
-                return Handler_Succeeded;
-        StringBuffer_T sb = StringBuffer_create(256);
-        for (Mmonit_T C = Run.mmonits; C; C = C->next) {
-                Socket_T  socket = Socket_create(C->url->hostname, C->url->port, Socket_Tcp, Socket_Ip, &(C->ssl), C->timeout);
-                if (! socket) {
-                        LogError("M/Monit: cannot open a connection to %s\n", C->url->url);
-                        goto error;
-                }
-                status_xml(sb, E, 2, Socket_getLocalHost(socket, (char[STRLEN]){}, STRLEN));
-                if (! _send(socket, C, sb)) {
-                        LogError("M/Monit: cannot send %s message to %s\n", E ? "event" : "status", C->url->url);
-                        goto error;
-                }
-                StringBuffer_clear(sb);
-                if (! _receive(socket, C)) {
-                        LogError("M/Monit: %s message to %s failed\n", E ? "event" : "status", C->url->url);
-                        goto error;
-                }
-                rv = Handler_Succeeded; // Return success if at least one M/Monit succeeded
-                DEBUG("M/Monit: %s message sent to %s\n", E ? "event" : "status", C->url->url);
-        error:
-                if (socket)
-                        Socket_free(&socket);
+                return rv;
+        LOCK(mutex)
+        {
+                rv = _post(E, NULL);
         }
-        StringBuffer_free(&sb);
+        END_LOCK;
         return rv;
 }
 
+
+boolean_t MMonit_heartbeat() {
+        boolean_t enabled;
+        StringBuffer_T status = StringBuffer_create(256);
+        // The status is rendered under the runtime lock, the collectors are contacted without it so a slow collector doesn't block the http server and the validator
+        LOCK(Run.mutex)
+        {
+                if ((enabled = (Run.mmonits != NULL)))
+                        status_xml(status, NULL, 2, MMONIT_LOCALHOST);
+        }
+        END_LOCK;
+        if (enabled) {
+                LOCK(mutex)
+                {
+                        _post(NULL, status);
+                }
+                END_LOCK;
+        }
+        StringBuffer_free(&status);
+        return enabled;
+}
+
+
+void MMonit_lock() {
+        Mutex_lock(mutex);
+}
+
+
+void MMonit_unlock() {
+        Mutex_unlock(mutex);
+}
+
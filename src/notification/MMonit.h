@@ -42,5 +42,27 @@
 Handler_Type MMonit_send(Event_T);
 
 
+/**
+ * Post the status message to M/Monit. The message is rendered under
+ * Run.mutex, the collectors are contacted after the lock was released.
+ * Called by the heartbeat thread
+ * @return false if no M/Monit is configured, otherwise true
+ */
+boolean_t MMonit_heartbeat();
+
+
+/**
+ * Lock the M/Monit collector list. The list is replaced on reload with
+ * this lock held, so it is not used by the heartbeat meanwhile
+ */
+void MMonit_lock();
+
+
+/**
+ * Unlock the M/Monit collector list
+ */
+void MMonit_unlock();
+
+
 #endif
 
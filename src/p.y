@@ -130,11 +130,16 @@
 #include "io/File.h"
 #include "util/Str.h"
 #include "thread/Thread.h"
+#include "system/Time.h"
 
 
 /* ------------------------------------------------------------- Definitions */
 
 
+/* Number of the slowest included files reported by "monit -t --timings" */
+#define PARSE_SLOWEST 10
+
+
 struct precedence_t {
         boolean_t daemon;
         boolean_t logfile;
@@ -172,6 +177,22 @@ static command_t command = NULL;
 static command_t command1 = NULL;
 static command_t command2 = NULL;
 static Service_T depend_list = NULL;
+static struct {
+        uint64_t preparse;                                      /**< Reset [us] */
+        uint64_t parse;           /**< Lexer and grammar actions incl. includes [us] */
+        uint64_t includes;                 /**< Time spent in included files [us] */
+        uint64_t depend;                             /**< Dependency sort [us] */
+        uint64_t postparse;           /**< Postparse without dependency sort [us] */
+        uint64_t total;                                     /**< Whole parse [us] */
+        int files;                                 /**< Number of included files */
+        int services;                                   /**< Number of services */
+        int groups;                               /**< Number of service groups */
+        int dependencies;                           /**< Number of dependencies */
+        struct {
+                char *path;
+                uint64_t duration;
+        } slowest[PARSE_SLOWEST];              /**< The slowest included files */
+} timings;
 static struct Uid_T uidset;
 static struct Gid_T gidset;
 static struct Pid_T pidset;
@@ -196,6 +217,7 @@ static struct MailServer_T mailserverset;
 static struct Mmonit_T mmonitset;
 static struct FileSystem_T filesystemset;
 static struct Resource_T resourceset;
+static struct Aggregate_T aggregateset;
 static struct Checksum_T checksumset;
 static struct Timestamp_T timestampset;
 static struct ActionRate_T actionrateset;
@@ -272,6 +294,7 @@ static void  reset_mailserverset();
 static void  reset_mmonitset();
 static void  reset_portset();
 static void  reset_resourceset();
+static void  reset_aggregateset();
 static void  reset_timestampset();
 static void  reset_actionrateset();
 static void  reset_sizeset();
@@ -297,12 +320,27 @@ static void  check_name(char *);
 static int   check_perm(int);
 static void  check_exec(char *);
 static int   cleanup_hash_string(char *);
+static void  sort_depend(Service_T, Service_T **, int, int);
 static void  check_depend();
 static void  setsyslog(char *);
 static command_t copycommand(command_t);
 static int verifyMaxForward(int);
 static void _setPEM(char **store, char *path, const char *description, boolean_t isFile);
 static void _setSSLOptions(SslOptions_T options);
+static boolean_t _parse(char *);
+static void _apply();
+
+
+/* The configuration which the parser fills: the runtime configuration, or the detached configuration parsed on reload (see parse_detached()). Run refers to the parsed setup */
+typedef struct ParseTarget_T {
+        struct Run_T *run;
+        Service_T *servicelist;
+        Service_T *servicelist_conf;
+        ServiceGroup_T *servicegrouplist;
+} ParseTarget_T;
+static const ParseTarget_T runtime = {&Run, &servicelist, &servicelist_conf, &servicegrouplist};
+static ParseTarget_T parsed = {&Run, &servicelist, &servicelist_conf, &servicegrouplist};
+#define Run              (*parsed.run)
 
 %}
 
@@ -336,6 +374,8 @@ static void _setSSLOptions(SslOptions_T options);
 %token CHECKPROC CHECKFILESYS CHECKFILE CHECKDIR CHECKHOST CHECKSYSTEM CHECKFIFO CHECKPROGRAM CHECKNET
 %token THREADS CHILDREN STATUS ORIGIN VERSIONOPT READ WRITE OPERATION SERVICETIME DISK
 %token RESOURCE MEMORY TOTALMEMORY LOADAVG1 LOADAVG5 LOADAVG15 SWAP
+%token MEMORYAVAILABLE MEMORYDIRTY MEMORYWRITEBACK SLABUNRECLAIMABLE HUGEPAGES
+%token AVERAGE MINIMUM MAXIMUM
 %token MODE ACTIVE PASSIVE MANUAL ONREBOOT NOSTART LASTSTATE CPU TOTALCPU CPUUSER CPUSYSTEM CPUWAIT
 %token GROUP REQUEST DEPENDS BASEDIR SLOT EVENTQUEUE SECRET HOSTHEADER
 %token UID EUID GID MMONIT INSTANCE USERNAME PASSWORD
@@ -351,6 +391,7 @@ static void _setSSLOptions(SslOptions_T options);
 %token <string> TARGET TIMESPEC HTTPHEADER
 %token <number> MAXFORWARD
 %token FIPS
+%token BUFFERED FLUSH FORMAT JSON
 
 %left GREATER GREATEROREQUAL LESS LESSOREQUAL EQUAL NOTEQUAL
 
@@ -463,6 +504,7 @@ optfilesys      : start
                 | depend
                 | inode
                 | space
+                | fsaggregate
                 | read
                 | write
                 | servicetime
@@ -700,7 +742,7 @@ setfips         : SET FIPS {
                   }
                 ;
 
-setlog          : SET LOGFILE PATH   {
+setlog          : SET LOGFILE PATH logoptlist {
                         if (! Run.files.log || ihp.logfile) {
                                 ihp.logfile = true;
                                 setlogfile($3);
@@ -708,14 +750,38 @@ setlog          : SET LOGFILE PATH   {
                                 Run.flags |= Run_Log;
                         }
                   }
-                | SET LOGFILE SYSLOG {
+                | SET LOGFILE SYSLOG logformat {
                         setsyslog(NULL);
                   }
-                | SET LOGFILE SYSLOG FACILITY STRING {
+                | SET LOGFILE SYSLOG FACILITY STRING logformat {
                         setsyslog($5); FREE($5);
                   }
                 ;
 
+logoptlist      : /* EMPTY */
+                | logoptlist logopt
+                ;
+
+logopt          : BUFFERED {
+                        Run.log.flush = LIMIT_LOGFLUSH;
+                  }
+                | BUFFERED FLUSH NUMBER MILLISECOND {
+                        Run.log.flush = $3;
+                  }
+                | BUFFERED FLUSH NUMBER SECOND {
+                        Run.log.flush = $3 * 1000;
+                  }
+                | FORMAT JSON {
+                        Run.log.format = LogFormat_Json;
+                  }
+                ;
+
+logformat       : /* EMPTY */
+                | FORMAT JSON {
+                        Run.log.format = LogFormat_Json;
+                  }
+                ;
+
 seteventqueue   : SET EVENTQUEUE BASEDIR PATH {
                         Run.eventlist_dir = $4;
                   }
@@ -2057,6 +2123,10 @@ resourceprocess : IF resourceprocesslist rate1 THEN action1 recovery {
                         addeventaction(&(resourceset).action, $<number>5, $<number>6);
                         addresource(&resourceset);
                    }
+                | IF aggregate resourceprocesslist window rate1 THEN action1 recovery {
+                        addeventaction(&(resourceset).action, $<number>7, $<number>8);
+                        addresource(&resourceset);
+                   }
                 ;
 
 resourceprocesslist : resourceprocessopt
@@ -2076,6 +2146,22 @@ resourcesystem  : IF resourcesystemlist rate1 THEN action1 recovery {
                         addeventaction(&(resourceset).action, $<number>5, $<number>6);
                         addresource(&resourceset);
                    }
+                | IF aggregate resourcesystemlist window rate1 THEN action1 recovery {
+                        addeventaction(&(resourceset).action, $<number>7, $<number>8);
+                        addresource(&resourceset);
+                   }
+                ;
+
+aggregate       : AVERAGE { aggregateset.type = Aggregate_Average; }
+                | MINIMUM { aggregateset.type = Aggregate_Minimum; }
+                | MAXIMUM { aggregateset.type = Aggregate_Maximum; }
+                ;
+
+window          : NUMBER totaltime {
+                        if ($1 <= 0 || (long long)$1 * $<number>2 > SERIES_MAX_RANGE)
+                                yyerror2("The window must be between 1 minute and 30 days");
+                        aggregateset.range = $1 * $<number>2;
+                  }
                 ;
 
 resourcesystemlist : resourcesystemopt
@@ -2084,6 +2170,7 @@ resourcesystemlist : resourcesystemopt
 
 resourcesystemopt  : resourceload
                    | resourcemem
+                   | resourcememsystem
                    | resourceswap
                    | resourcecpu
                    ;
@@ -2135,6 +2222,43 @@ resourcemem     : MEMORY operator value unit {
                   }
                 ;
 
+resourcememsystem : MEMORYAVAILABLE operator value unit {
+                        resourceset.resource_id = Resource_MemoryAvailableKbyte;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3 * $<number>4;
+                  }
+                | MEMORYAVAILABLE operator value PERCENT {
+                        resourceset.resource_id = Resource_MemoryAvailablePercent;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3;
+                  }
+                | MEMORYDIRTY operator value unit {
+                        resourceset.resource_id = Resource_MemoryDirty;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3 * $<number>4;
+                  }
+                | MEMORYWRITEBACK operator value unit {
+                        resourceset.resource_id = Resource_MemoryWriteback;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3 * $<number>4;
+                  }
+                | SLABUNRECLAIMABLE operator value unit {
+                        resourceset.resource_id = Resource_SlabUnreclaimable;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3 * $<number>4;
+                  }
+                | HUGEPAGES operator value unit {
+                        resourceset.resource_id = Resource_HugePagesKbyte;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3 * $<number>4;
+                  }
+                | HUGEPAGES operator value PERCENT {
+                        resourceset.resource_id = Resource_HugePagesPercent;
+                        resourceset.operator = $<number>2;
+                        resourceset.limit = $<real>3;
+                  }
+                ;
+
 resourceswap    : SWAP operator value unit {
                         resourceset.resource_id = Resource_SwapKbyte;
                         resourceset.operator = $<number>2;
@@ -2413,6 +2537,36 @@ inode           : IF INODE operator NUMBER rate1 THEN action1 recovery {
                   }
                 ;
 
+fsaggregate     : IF aggregate INODE operator value PERCENT window rate1 THEN action1 recovery {
+                        filesystemset.resource = Resource_Inode;
+                        filesystemset.operator = $<number>4;
+                        filesystemset.limit_percent = $<real>5;
+                        addeventaction(&(filesystemset).action, $<number>10, $<number>11);
+                        addfilesystem(&filesystemset);
+                  }
+                | IF aggregate INODE TFREE operator value PERCENT window rate1 THEN action1 recovery {
+                        filesystemset.resource = Resource_InodeFree;
+                        filesystemset.operator = $<number>5;
+                        filesystemset.limit_percent = $<real>6;
+                        addeventaction(&(filesystemset).action, $<number>11, $<number>12);
+                        addfilesystem(&filesystemset);
+                  }
+                | IF aggregate SPACE operator value PERCENT window rate1 THEN action1 recovery {
+                        filesystemset.resource = Resource_Space;
+                        filesystemset.operator = $<number>4;
+                        filesystemset.limit_percent = $<real>5;
+                        addeventaction(&(filesystemset).action, $<number>10, $<number>11);
+                        addfilesystem(&filesystemset);
+                  }
+                | IF aggregate SPACE TFREE operator value PERCENT window rate1 THEN action1 recovery {
+                        filesystemset.resource = Resource_SpaceFree;
+                        filesystemset.operator = $<number>5;
+                        filesystemset.limit_percent = $<real>6;
+                        addeventaction(&(filesystemset).action, $<number>11, $<number>12);
+                        addfilesystem(&filesystemset);
+                  }
+                ;
+
 space           : IF SPACE operator value unit rate1 THEN action1 recovery {
                         if (! filesystem_usage(current))
                                 yyerror2("Cannot read usage of filesystem %s", current->path);
@@ -2843,8 +2997,105 @@ void yywarning2(const char *s, ...) {
  */
 boolean_t parse(char *controlfile) {
         ASSERT(controlfile);
+        if (! _parse(controlfile))
+                return false;
+        _apply();
+        return true;
+}
 
-        servicelist = tail = current = NULL;
+
+/*
+ * Parse the control file into the detached configuration. The runtime
+ * configuration is left untouched, so the http interface and the heartbeat
+ * can keep using it while the file is parsed. Returns true if parsing
+ * succeeded, otherwise false. The configuration must be released with
+ * gc_configuration_detached() in both cases
+ */
+boolean_t parse_detached(char *controlfile, Configuration_T config) {
+        ASSERT(controlfile);
+        ASSERT(config);
+        memset(config, 0, sizeof(*config));
+        // Start from the current setup, the settings which the control file does not reset keep their values
+        LOCK(Run.mutex)
+        {
+                config->run = Run;
+        }
+        END_LOCK;
+        // The parser replaces the log and pid file names, the detached configuration owns its copies
+        config->run.files.log = Str_dup(config->run.files.log);
+        config->run.files.pid = Str_dup(config->run.files.pid);
+        config->run.mail_hostname = NULL;
+        parsed = (ParseTarget_T){&config->run, &config->servicelist, &config->servicelist_conf, &config->servicegrouplist};
+        Util_detachServiceIndex();
+        Engine_detachAllow();
+        boolean_t rv = _parse(controlfile);
+        parsed = runtime;
+        return rv;
+}
+
+
+/*
+ * Replace the runtime configuration with the detached configuration parsed by
+ * parse_detached(). The previous runtime setup and services are moved to the
+ * detached configuration, which the caller releases with
+ * gc_configuration_detached(). Must be called with Run.mutex and the M/Monit
+ * lock held
+ */
+void parse_commit(Configuration_T config) {
+        ASSERT(config);
+        struct Run_T *next = &config->run;
+#define EXCHANGE(a, b) do { __typeof__(a) _t = (a); (a) = (b); (b) = _t; } while (0)
+        EXCHANGE(Run.onreboot, next->onreboot);
+        EXCHANGE(Run.files.log, next->files.log);
+        EXCHANGE(Run.files.pid, next->files.pid);
+        EXCHANGE(Run.files.id, next->files.id);
+        EXCHANGE(Run.files.state, next->files.state);
+        EXCHANGE(Run.log, next->log);
+        EXCHANGE(Run.limits, next->limits);
+        EXCHANGE(Run.ssl, next->ssl);
+        EXCHANGE(Run.polltime, next->polltime);
+        EXCHANGE(Run.startdelay, next->startdelay);
+        EXCHANGE(Run.facility, next->facility);
+        EXCHANGE(Run.eventlist_slots, next->eventlist_slots);
+        EXCHANGE(Run.mailserver_timeout, next->mailserver_timeout);
+        EXCHANGE(Run.incarnation, next->incarnation);
+        EXCHANGE(Run.system, next->system);
+        EXCHANGE(Run.eventlist_dir, next->eventlist_dir);
+        EXCHANGE(Run.httpd, next->httpd);
+        EXCHANGE(Run.mail_hostname, next->mail_hostname);
+        EXCHANGE(Run.maillist, next->maillist);
+        EXCHANGE(Run.mailservers, next->mailservers);
+        EXCHANGE(Run.mmonits, next->mmonits);
+        EXCHANGE(Run.mmonitcredentials, next->mmonitcredentials);
+        EXCHANGE(Run.MailFormat, next->MailFormat);
+        EXCHANGE(servicelist, config->servicelist);
+        EXCHANGE(servicelist_conf, config->servicelist_conf);
+        EXCHANGE(servicegrouplist, config->servicegrouplist);
+#undef EXCHANGE
+        for (int i = 0; i <= Handler_Max; i++)
+                Run.handler_queue[i] = next->handler_queue[i];
+        // Replace only the flags set by the parser, the signal handlers may change the other flags concurrently
+        const Run_Flags parserFlags = Run_Daemon | Run_Foreground | Run_Batch | Run_FipsEnabled | Run_Log | Run_UseSyslog | Run_HandlerInit | Run_MmonitCredentials;
+        Run_Flags flags = Run.flags;
+        while (! __atomic_compare_exchange_n(&Run.flags, &flags, (flags & ~parserFlags) | (next->flags & parserFlags), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+                ;
+        Util_commitServiceIndex();
+        Engine_commitAllow();
+        _apply();
+}
+
+
+/*
+ * Parse the control file into the configuration which the parser fills
+ */
+static boolean_t _parse(char *controlfile) {
+        uint64_t start = Time_micro();
+        for (int i = 0; i < PARSE_SLOWEST; i++)
+                FREE(timings.slowest[i].path);
+        memset(&timings, 0, sizeof(timings));
+
+        *parsed.servicelist = tail = current = NULL;
+        Util_resetServiceIndex();
 
         if ((yyin = fopen(controlfile,"r")) == (FILE *)NULL) {
                 LogError("Cannot open the control file '%s' -- %s\n", controlfile, STRERROR);
@@ -2853,17 +3104,16 @@ boolean_t parse(char *controlfile) {
 
         currentfile = Str_dup(controlfile);
 
-        /*
-         * Creation of the global service list is synchronized
-         */
-        LOCK(Run.mutex)
-        {
-                preparse();
-                yyparse();
-                fclose(yyin);
-                postparse();
-        }
-        END_LOCK;
+        preparse();
+        uint64_t t = Time_micro();
+        timings.preparse = t - start;
+        yyparse();
+        fclose(yyin);
+        timings.parse = Time_micro() - t;
+        t = Time_micro();
+        postparse();
+        timings.postparse = Time_micro() - t - timings.depend;
+        timings.total = Time_micro() - start;
 
         FREE(currentfile);
 
@@ -2882,6 +3132,50 @@ boolean_t parse(char *controlfile) {
 }
 
 
+/*
+ * Record the time spent in the included file (excluding the files it
+ * includes). Called by the lexer when the file is closed
+ */
+void parse_timing(const char *path, uint64_t duration) {
+        timings.files++;
+        timings.includes += duration;
+        int i = PARSE_SLOWEST;
+        while (i > 0 && (! timings.slowest[i - 1].path || timings.slowest[i - 1].duration < duration))
+                i--;
+        if (i < PARSE_SLOWEST) {
+                FREE(timings.slowest[PARSE_SLOWEST - 1].path);
+                memmove(&timings.slowest[i + 1], &timings.slowest[i], (PARSE_SLOWEST - 1 - i) * sizeof(timings.slowest[0]));
+                timings.slowest[i].path = Str_dup(path);
+                timings.slowest[i].duration = duration;
+        }
+}
+
+
+/*
+ * Print the profile of the last parse (monit -t --timings)
+ */
+void parse_printTimings() {
+        printf("Control file parse timings:\n");
+        printf(" %-34s %10.3f ms\n", "Total", timings.total / 1000.);
+        printf(" %-34s %10.3f ms\n", "Reset", timings.preparse / 1000.);
+        printf(" %-34s %10.3f ms\n", "Parse", timings.parse / 1000.);
+        printf(" %-34s %10.3f ms\n", "   control file", (timings.parse - timings.includes) / 1000.);
+        char files[STRLEN];
+        snprintf(files, sizeof(files), "   %d included file%s", timings.files, timings.files == 1 ? "" : "s");
+        printf(" %-34s %10.3f ms\n", files, timings.includes / 1000.);
+        printf(" %-34s %10.3f ms\n", "Dependency sort", timings.depend / 1000.);
+        printf(" %-34s %10.3f ms\n", "Postparse", timings.postparse / 1000.);
+        printf(" %-34s %10d\n", "Services", timings.services);
+        printf(" %-34s %10d\n", "Service groups", timings.groups);
+        printf(" %-34s %10d\n", "Dependencies", timings.dependencies);
+        if (timings.slowest[0].path) {
+                printf("Slowest included files:\n");
+                for (int i = 0; i < PARSE_SLOWEST && timings.slowest[i].path; i++)
+                        printf(" %10.3f ms  %s\n", timings.slowest[i].duration / 1000., timings.slowest[i].path);
+        }
+}
+
+
 /* ----------------------------------------------------------------- Private */
 
 
@@ -2907,6 +3201,8 @@ static void preparse() {
         Run.limits.stopTimeout       = LIMIT_STOPTIMEOUT;
         Run.limits.startTimeout      = LIMIT_STARTTIMEOUT;
         Run.limits.restartTimeout    = LIMIT_RESTARTTIMEOUT;
+        Run.log.flush                = 0;
+        Run.log.format               = LogFormat_Text;
         Run.onreboot                 = Onreboot_Start;
         Run.mmonitcredentials        = NULL;
         Run.httpd.flags              = Httpd_Disabled | Httpd_Signature;
@@ -2951,6 +3247,7 @@ static void preparse() {
         reset_rateset(&rate2);
         reset_filesystemset();
         reset_resourceset();
+        reset_aggregateset();
         reset_checksumset();
         reset_timestampset();
         reset_actionrateset();
@@ -2984,7 +3281,7 @@ static void postparse() {
                         LogError("Cannot get system hostname -- please add 'check system <name>'\n");
                         cfg_errflag++;
                 }
-                if (Util_existService(hostname)) {
+                if (Util_getParsedService(hostname)) {
                         LogError("'check system' not defined in control file, failed to add automatic configuration (service name %s is used already) -- please add 'check system <name>' manually\n", hostname);
                         cfg_errflag++;
                 }
@@ -3015,12 +3312,19 @@ static void postparse() {
         }
 
         /* Check the sanity of any dependency graph */
+        uint64_t start = Time_micro();
         check_depend();
+        timings.depend = Time_micro() - start;
+}
+
 
+/*
+ * Apply the settings which take effect outside of the parsed configuration
+ */
+static void _apply() {
 #ifdef HAVE_OPENSSL
         Ssl_setFipsMode(Run.flags & Run_FipsEnabled);
 #endif
-
         Processor_setHttpPostLimit();
 }
 
@@ -3178,15 +3482,19 @@ static void addservice(Service_T s) {
                         break;
         }
 
+        /* Services with the same rules refer to one copy of the immutable rule chains */
+        gc_share_rules(s);
+
         /* Add the service to the end of the service list */
         if (tail != NULL) {
                 tail->next = s;
                 tail->next_conf = s;
         } else {
-                servicelist = s;
-                servicelist_conf = s;
+                *parsed.servicelist = s;
+                *parsed.servicelist_conf = s;
         }
         tail = s;
+        Util_indexService(s);
 }
 
 
@@ -3199,16 +3507,14 @@ static void addservicegroup(char *name) {
         ASSERT(name);
 
         /* Check if service group with the same name is defined already */
-        for (g = servicegrouplist; g; g = g->next)
-                if (IS(g->name, name))
-                        break;
-
-        if (! g) {
+        if (! (g = Util_getParsedServiceGroup(name))) {
                 NEW(g);
                 g->name = Str_dup(name);
                 g->members = List_new();
-                g->next = servicegrouplist;
-                servicegrouplist = g;
+                g->next = *parsed.servicegrouplist;
+                *parsed.servicegrouplist = g;
+                Util_indexServiceGroup(g);
+                timings.groups++;
         }
 
         List_append(g->members, current);
@@ -3231,6 +3537,7 @@ static void adddependant(char *dependant) {
 
         d->dependant = dependant;
         current->dependantlist = d;
+        timings.dependencies++;
 
 }
 
@@ -3341,12 +3648,14 @@ static void addresource(Resource_T rr) {
                 r->limit       = rr->limit;
                 r->action      = rr->action;
                 r->operator    = rr->operator;
+                r->aggregate   = aggregateset;
                 r->next        = current->resourcelist;
                 current->resourcelist = r;
         } else {
                 yywarning("Cannot activate service check. The process status engine was disabled. On certain systems you must run monit as root to utilize this feature)\n");
         }
         reset_resourceset();
+        reset_aggregateset();
 }
 
 
@@ -3849,13 +4158,14 @@ static void addfilesystem(FileSystem_T ds) {
         dev->operator           = ds->operator;
         dev->limit_absolute     = ds->limit_absolute;
         dev->limit_percent      = ds->limit_percent;
+        dev->aggregate          = aggregateset;
         dev->action             = ds->action;
 
         dev->next               = current->filesystemlist;
         current->filesystemlist = dev;
         
         reset_filesystemset();
-
+        reset_aggregateset();
 }
 
 
@@ -4473,6 +4783,16 @@ static void reset_resourceset() {
 }
 
 
+/*
+ * Reset the Aggregate set to default values
+ */
+static void reset_aggregateset() {
+        aggregateset.type = Aggregate_None;
+        aggregateset.range = 0;
+        aggregateset.series = NULL;
+}
+
+
 /*
  * Reset the Timestamp set to default values
  */
@@ -4672,7 +4992,7 @@ static void reset_rateset(struct rate_t *r) {
 static void check_name(char *name) {
         ASSERT(name);
 
-        if (Util_existService(name) || (current && IS(name, current->name)))
+        if (Util_getParsedService(name) || (current && IS(name, current->name)))
                 yyerror2("Service name conflict, %s already defined", name);
         if (name && *name == '/')
                 yyerror2("Service name '%s' must not start with '/' -- ", name);
@@ -4698,58 +5018,54 @@ static int check_perm(int perm) {
 }
 
 
+/*
+ * Append the service to the depend list after all services it depends
+ * on (depth first search). A dependency path longer than the number of
+ * services must contain a cycle.
+ */
+static void sort_depend(Service_T s, Service_T **tail, int depth, int count) {
+        if (s->visited)
+                return;
+        if (depth > count) {
+                LogError("Found a depend loop in the control file involving the service '%s'\n", s->name);
+                exit(1);
+        }
+        for (Dependant_T d = s->dependantlist; d; d = d->next) {
+                Service_T dp = Util_getParsedService(d->dependant);
+                if (! dp) {
+                        LogError("Depend service '%s' is not defined in the control file\n", d->dependant);
+                        exit(1);
+                }
+                d->service = dp;
+                sort_depend(dp, tail, depth + 1, count);
+        }
+        s->visited = true;
+        **tail = s;
+        *tail = &s->next_depend;
+}
+
+
 /*
  * Check the dependency graph for errors
  * by doing a topological sort, thereby finding any cycles.
  * Assures that graph is a Directed Acyclic Graph (DAG).
+ * The sort is linear in the number of services and dependencies.
  */
 static void check_depend() {
-        Service_T s;
-        Service_T depends_on = NULL;
-        Service_T* dlt = &depend_list; /* the current tail of it                                 */
-        boolean_t done;                /* no unvisited nodes left?                               */
-        boolean_t found_some;          /* last iteration found anything new ?                    */
-        depend_list = NULL;            /* depend_list will be the topological sorted servicelist */
+        int count = 0;
+        Service_T *tail = &depend_list; /* the current tail of the depend_list                   */
+        depend_list = NULL;             /* depend_list will be the topological sorted servicelist */
 
-        do {
-                done = true;
-                found_some = false;
-                for (s = servicelist; s; s = s->next) {
-                        Dependant_T d;
-                        if (s->visited)
-                                continue;
-                        done = false; // still unvisited nodes
-                        depends_on = NULL;
-                        for (d = s->dependantlist; d; d = d->next) {
-                                Service_T dp = Util_getService(d->dependant);
-                                if (! dp) {
-                                        LogError("Depend service '%s' is not defined in the control file\n", d->dependant);
-                                        exit(1);
-                                }
-                                if (! dp->visited) {
-                                        depends_on = dp;
-                                }
-                        }
-
-                        if (! depends_on) {
-                                s->visited = true;
-                                found_some = true;
-                                *dlt = s;
-                                dlt = &s->next_depend;
-                        }
-                }
-        } while (found_some && ! done);
-
-        if (! done) {
-                ASSERT(depends_on);
-                LogError("Found a depend loop in the control file involving the service '%s'\n", depends_on->name);
-                exit(1);
-        }
+        for (Service_T s = *parsed.servicelist; s; s = s->next)
+                count++;
+        for (Service_T s = *parsed.servicelist; s; s = s->next)
+                sort_depend(s, &tail, 0, count);
+        timings.services = count;
 
         ASSERT(depend_list);
-        servicelist = depend_list;
+        *parsed.servicelist = depend_list;
 
-        for (s = depend_list; s; s = s->next_depend)
+        for (Service_T s = depend_list; s; s = s->next_depend)
                 s->next = s->next_depend;
 }
 
@@ -73,6 +73,7 @@
 
 // libmonit
 #include "system/Time.h"
+#include "system/Arena.h"
 
 
 /**
@@ -87,6 +88,7 @@
 
 static int ptreesize = 0;
 static ProcessTree_T *ptree = NULL;
+static Arena_T children = NULL; // The children lists of the current ptree
 
 
 /* ----------------------------------------------------------------- Private */
@@ -96,10 +98,8 @@ static void _delete(ProcessTree_T **pt, int *size) {
         ASSERT(pt);
         ProcessTree_T *_pt = *pt;
         if (_pt) {
-                for (int i = 0; i < *size; i++) {
+                for (int i = 0; i < *size; i++)
                         FREE(_pt[i].cmdline);
-                        FREE(_pt[i].children.list);
-                }
                 FREE(_pt);
                 *pt = NULL;
                 *size = 0;
@@ -187,6 +187,49 @@ static int _match(regex_t *regex) {
 }
 
 
+/**
+ * Find the process of the service. The process tree is rebuilt for process
+ * matching unless the updated flag is set already, the flag is set if the
+ * tree was rebuilt
+ */
+static pid_t _lookup(Service_T s, boolean_t *updated) {
+        ASSERT(s);
+        // Test the cached PID first
+        if (s->inf.process->pid > 0) {
+                errno = 0;
+                if (getpgid(s->inf.process->pid) > -1 || errno == EPERM)
+                        return s->inf.process->pid;
+        }
+        // If the cached PID is not running, scan for the process again
+        if (s->matchlist) {
+                // Update the process tree including command line
+                if (! *updated) {
+                        ProcessTree_init(ProcessEngine_CollectCommandLine);
+                        *updated = true;
+                }
+                if (Run.flags & Run_ProcessEngineEnabled) {
+                        int pid = _match(s->matchlist->regex_comp);
+                        if (pid >= 0)
+                                return pid;
+                } else {
+                        DEBUG("Process information not available -- skipping service %s process existence check for this cycle\n", s->name);
+                        // Return value is NOOP - it is based on existing errors bitmap so we don't generate false recovery/failures
+                        return ! (s->error & Event_NonExist);
+                }
+        } else {
+                pid_t pid = Util_getPid(s->path);
+                if (pid > 0) {
+                        errno = 0;
+                        if (getpgid(pid) > -1 || errno == EPERM)
+                                return pid;
+                        DEBUG("'%s' process test failed [pid=%d] -- %s\n", s->name, pid, STRERROR);
+                }
+        }
+        Util_resetInfo(s);
+        return 0;
+}
+
+
 /* ------------------------------------------------------------------ Public */
 
 
@@ -201,11 +244,13 @@ int ProcessTree_init(ProcessEngine_Flags pflags) {
                 ptree = NULL;
                 ptreesize = 0;
                 // We need only process' cpu.time from the old ptree, so free dynamically allocated parts which we don't need before initializing new ptree (so the memory can be reused, otherwise the memory footprint will hold two ptrees)
-                for (int i = 0; i < oldptreesize; i++) {
+                for (int i = 0; i < oldptreesize; i++)
                         FREE(oldptree[i].cmdline);
-                        FREE(oldptree[i].children.list);
-                }
         }
+        if (children)
+                Arena_reset(children);
+        else
+                children = Arena_new(0);
 
         systeminfo.time_prev = systeminfo.time;
         systeminfo.time = Time_milli() / 100.;
@@ -244,12 +289,22 @@ int ProcessTree_init(ProcessEngine_Flags pflags) {
                                 root = pt[parent].ppid = pt[parent].pid = pt[i].ppid;
                         }
                         pt[i].parent = parent;
-                        // Connect the child (this process) to the parent
-                        RESIZE(pt[parent].children.list, sizeof(int) * (pt[parent].children.count + 1));
-                        pt[parent].children.list[pt[parent].children.count] = i;
                         pt[parent].children.count++;
                 }
         }
+        // Connect the children to the parents: the lists are sized by the count above and allocated from the arena, which is recycled with the tree
+        for (int i = 0; i < ptreesize; i++) {
+                if (pt[i].children.count) {
+                        pt[i].children.list = Arena_alloc(children, pt[i].children.count * sizeof(int));
+                        pt[i].children.count = 0;
+                }
+        }
+        for (int i = 0; i < ptreesize; i++) {
+                if (pt[i].parent != i) {
+                        ProcessTree_T *parent = &pt[pt[i].parent];
+                        parent->children.list[parent->children.count++] = i;
+                }
+        }
         FREE(oldptree); // Free the rest of old ptree
         if (root == -1) {
                 DEBUG("System statistic error -- cannot find root process id\n");
@@ -268,6 +323,8 @@ int ProcessTree_init(ProcessEngine_Flags pflags) {
  */
 void ProcessTree_delete() {
         _delete(&ptree, &ptreesize);
+        if (children)
+                Arena_free(&children);
 }
 
 
@@ -323,37 +380,16 @@ time_t ProcessTree_getProcessUptime(pid_t pid) {
 
 
 pid_t ProcessTree_findProcess(Service_T s) {
-        ASSERT(s);
-        // Test the cached PID first
-        if (s->inf.process->pid > 0) {
-                errno = 0;
-                if (getpgid(s->inf.process->pid) > -1 || errno == EPERM)
-                        return s->inf.process->pid;
-        }
-        // If the cached PID is not running, scan for the process again
-        if (s->matchlist) {
-                // Update the process tree including command line
-                ProcessTree_init(ProcessEngine_CollectCommandLine);
-                if (Run.flags & Run_ProcessEngineEnabled) {
-                        int pid = _match(s->matchlist->regex_comp);
-                        if (pid >= 0)
-                                return pid;
-                } else {
-                        DEBUG("Process information not available -- skipping service %s process existence check for this cycle\n", s->name);
-                        // Return value is NOOP - it is based on existing errors bitmap so we don't generate false recovery/failures
-                        return ! (s->error & Event_NonExist);
-                }
-        } else {
-                pid_t pid = Util_getPid(s->path);
-                if (pid > 0) {
-                        errno = 0;
-                        if (getpgid(pid) > -1 || errno == EPERM)
-                                return pid;
-                        DEBUG("'%s' process test failed [pid=%d] -- %s\n", s->name, pid, STRERROR);
-                }
-        }
-        Util_resetInfo(s);
-        return 0;
+        return _lookup(s, &(boolean_t){false});
+}
+
+
+void ProcessTree_findProcesses(Service_T services[], pid_t pids[], int count) {
+        ASSERT(services);
+        ASSERT(pids);
+        boolean_t updated = false;
+        for (int i = 0; i < count; i++)
+                pids[i] = _lookup(services[i], &updated);
 }
 
 
@@ -471,6 +507,10 @@ boolean_t update_system_info() {
                 }
                 systeminfo.memory.usage.percent  = systeminfo.memory.size > 0ULL ? (100. * (double)systeminfo.memory.usage.bytes / (double)systeminfo.memory.size) : 0.;
                 systeminfo.swap.usage.percent = systeminfo.swap.size > 0ULL ? (100. * (double)systeminfo.swap.usage.bytes / (double)systeminfo.swap.size) : 0.;
+                if (systeminfo.memory.extended) {
+                        systeminfo.memory.available.percent = systeminfo.memory.size > 0ULL ? (100. * (double)systeminfo.memory.available.bytes / (double)systeminfo.memory.size) : 0.;
+                        systeminfo.memory.hugepages.percent = systeminfo.memory.hugepages.size > 0ULL ? (100. * (double)systeminfo.memory.hugepages.bytes / (double)systeminfo.memory.hugepages.size) : 0.;
+                }
 
                 if (! used_system_cpu_sysdep(&systeminfo)) {
                         LogError("'%s' statistic error -- cpu usage data collection failed\n", Run.system->name);
@@ -489,6 +529,7 @@ error2:
         systeminfo.memory.usage.percent = 0.;
         systeminfo.swap.usage.bytes = 0ULL;
         systeminfo.swap.usage.percent = 0.;
+        systeminfo.memory.extended = false;
 error3:
         systeminfo.cpu.usage.user = 0.;
         systeminfo.cpu.usage.system = 0.;
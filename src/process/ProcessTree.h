@@ -108,6 +108,17 @@ time_t ProcessTree_getProcessUptime(pid_t pid);
 pid_t ProcessTree_findProcess(Service_T s);
 
 
+/**
+ * Find the processes of several services. Unlike calling ProcessTree_findProcess()
+ * for each service, the process tree is rebuilt at most once for all services
+ * which use process matching
+ * @param services The services being checked
+ * @param pids The PIDs of the running processes or 0 if the process is not running (output)
+ * @param count The number of services
+ */
+void ProcessTree_findProcesses(Service_T services[], pid_t pids[], int count);
+
+
 /**
  * Print a table with all processes matching a given pattern
  * @param pattern The process pattern
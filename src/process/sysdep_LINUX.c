@@ -61,6 +61,10 @@
 #include <string.h>
 #endif
 
+#ifdef HAVE_STDDEF_H
+#include <stddef.h>
+#endif
+
 #ifdef HAVE_ASM_PARAM_H
 #include <asm/param.h>
 #endif
@@ -95,6 +99,74 @@ static struct {
 } _statistics = {};
 
 
+/**
+ * System statistics files are kept open and re-read with pread() every cycle
+ */
+typedef struct ProcFile_T {
+        const char *path;
+        int fd;
+} ProcFile_T;
+
+
+static ProcFile_T _meminfo = {"/proc/meminfo", -1};
+static ProcFile_T _stat = {"/proc/stat", -1};
+
+
+typedef struct MemInfo_T {
+        uint64_t memTotal;
+        uint64_t memFree;
+        uint64_t memAvailable;
+        uint64_t buffers;
+        uint64_t cached;
+        uint64_t slabReclaimable;
+        uint64_t slabUnreclaimable;
+        uint64_t dirty;
+        uint64_t writeback;
+        uint64_t swapTotal;
+        uint64_t swapFree;
+        uint64_t hugePagesTotal;
+        uint64_t hugePagesFree;
+        uint64_t hugePageSize;
+} MemInfo_T;
+
+
+typedef enum {
+        MemInfo_MemTotal          = 0x1,
+        MemInfo_MemFree           = 0x2,
+        MemInfo_MemAvailable      = 0x4,
+        MemInfo_SwapTotal         = 0x8,
+        MemInfo_SwapFree          = 0x10,
+        MemInfo_Other             = 0x20
+} MemInfo_Flags;
+
+
+/**
+ * The /proc/meminfo fields we collect. The values are in kB, except of the
+ * huge pages counters which are number of pages
+ */
+static const struct {
+        const char *name;
+        size_t length;
+        size_t offset;
+        MemInfo_Flags flag;
+} _meminfoFields[] = {
+        {"MemTotal",          8, offsetof(MemInfo_T, memTotal),          MemInfo_MemTotal},
+        {"MemFree",           7, offsetof(MemInfo_T, memFree),           MemInfo_MemFree},
+        {"MemAvailable",     12, offsetof(MemInfo_T, memAvailable),      MemInfo_MemAvailable},
+        {"Buffers",           7, offsetof(MemInfo_T, buffers),           MemInfo_Other},
+        {"Cached",            6, offsetof(MemInfo_T, cached),            MemInfo_Other},
+        {"SwapTotal",         9, offsetof(MemInfo_T, swapTotal),         MemInfo_SwapTotal},
+        {"SwapFree",          8, offsetof(MemInfo_T, swapFree),          MemInfo_SwapFree},
+        {"Dirty",             5, offsetof(MemInfo_T, dirty),             MemInfo_Other},
+        {"Writeback",         9, offsetof(MemInfo_T, writeback),         MemInfo_Other},
+        {"SReclaimable",     12, offsetof(MemInfo_T, slabReclaimable),   MemInfo_Other},
+        {"SUnreclaim",       10, offsetof(MemInfo_T, slabUnreclaimable), MemInfo_Other},
+        {"HugePages_Total",  15, offsetof(MemInfo_T, hugePagesTotal),    MemInfo_Other},
+        {"HugePages_Free",   14, offsetof(MemInfo_T, hugePagesFree),     MemInfo_Other},
+        {"Hugepagesize",     12, offsetof(MemInfo_T, hugePageSize),      MemInfo_Other}
+};
+
+
 /* --------------------------------------- Static constructor and destructor */
 
 
@@ -118,6 +190,65 @@ static long page_size = 0;
 
 static double hz = 0.;
 
+/**
+ * Read the whole proc file into the buffer. The file descriptor is opened on
+ * first use and kept open, the content is re-generated by the kernel on every
+ * read from offset 0
+ * @param f The proc file
+ * @param buf The buffer
+ * @param size The buffer size
+ * @return The number of bytes read or -1 on error
+ */
+static ssize_t _readProcFile(ProcFile_T *f, char *buf, size_t size) {
+        if (f->fd < 0 && (f->fd = open(f->path, O_RDONLY | O_CLOEXEC)) < 0) {
+                DEBUG("system statistic error -- cannot open %s: %s\n", f->path, STRERROR);
+                return -1;
+        }
+        ssize_t n;
+        do {
+                n = pread(f->fd, buf, size - 1, 0);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+                DEBUG("system statistic error -- cannot read %s: %s\n", f->path, STRERROR);
+                close(f->fd);
+                f->fd = -1;
+                return -1;
+        }
+        buf[n] = 0;
+        return n;
+}
+
+
+/**
+ * Parse /proc/meminfo in one pass
+ * @param info The parsed values (output)
+ * @return The MemInfo_Flags bitmap of the fields found
+ */
+static int _parseMeminfo(MemInfo_T *info) {
+        char buf[8192];
+        int found = 0;
+        memset(info, 0, sizeof(MemInfo_T));
+        if (_readProcFile(&_meminfo, buf, sizeof(buf)) <= 0)
+                return 0;
+        for (char *line = buf, *next; line && *line; line = next) {
+                if ((next = strchr(line, '\n')))
+                        *next++ = 0;
+                char *colon = strchr(line, ':');
+                if (! colon)
+                        continue;
+                size_t length = colon - line;
+                for (int i = 0; i < sizeof(_meminfoFields) / sizeof(_meminfoFields[0]); i++) {
+                        if (_meminfoFields[i].length == length && ! strncmp(line, _meminfoFields[i].name, length)) {
+                                *(uint64_t *)((char *)info + _meminfoFields[i].offset) = strtoull(colon + 1, NULL, 10);
+                                found |= _meminfoFields[i].flag;
+                                break;
+                        }
+                }
+        }
+        return found;
+}
+
+
 /**
  * Get system start time
  * @return seconds since unix epoch
@@ -154,24 +285,13 @@ boolean_t init_process_info_sysdep(void) {
                 systeminfo.cpu.count = 1;
         }
 
-        FILE *f = fopen("/proc/meminfo", "r");
-        if (f) {
-                char line[STRLEN];
-                systeminfo.memory.size = 0L;
-                while (fgets(line, sizeof(line), f)) {
-                        if (sscanf(line, "MemTotal: %"PRIu64, &systeminfo.memory.size) == 1) {
-                                systeminfo.memory.size *= 1024;
-                                break;
-                        }
-                }
-                fclose(f);
-                if (! systeminfo.memory.size)
-                        DEBUG("system statistic error -- cannot get real memory amount\n");
-        } else {
-                DEBUG("system statistic error -- cannot open /proc/meminfo\n");
-        }
+        MemInfo_T meminfo;
+        if (_parseMeminfo(&meminfo) & MemInfo_MemTotal)
+                systeminfo.memory.size = meminfo.memTotal * 1024;
+        else
+                DEBUG("system statistic error -- cannot get real memory amount\n");
 
-        f = fopen("/proc/stat", "r");
+        FILE *f = fopen("/proc/stat", "r");
         if (f) {
                 char line[STRLEN];
                 systeminfo.booted = 0;
@@ -378,49 +498,46 @@ int getloadavg_sysdep(double *loadv, int nelem) {
  * @return: true if successful, false if failed
  */
 boolean_t used_system_memory_sysdep(SystemInfo_T *si) {
-        char          *ptr;
-        char           buf[2048];
-        unsigned long  mem_free = 0UL;
-        unsigned long  buffers = 0UL;
-        unsigned long  cached = 0UL;
-        unsigned long  slabreclaimable = 0UL;
-        unsigned long  swap_total = 0UL;
-        unsigned long  swap_free = 0UL;
-
-        if (! file_readProc(buf, sizeof(buf), "meminfo", -1, NULL)) {
-                LogError("system statistic error -- cannot get real memory free amount\n");
-                goto error;
-        }
+        MemInfo_T meminfo;
+        int found = _parseMeminfo(&meminfo);
 
         /* Memory */
-        if (! (ptr = strstr(buf, "MemFree:")) || sscanf(ptr + 8, "%ld", &mem_free) != 1) {
+        if (! (found & MemInfo_MemFree)) {
                 LogError("system statistic error -- cannot get real memory free amount\n");
                 goto error;
         }
-        if (! (ptr = strstr(buf, "Buffers:")) || sscanf(ptr + 8, "%ld", &buffers) != 1)
-                DEBUG("system statistic error -- cannot get real memory buffers amount\n");
-        if (! (ptr = strstr(buf, "Cached:")) || sscanf(ptr + 7, "%ld", &cached) != 1)
-                DEBUG("system statistic error -- cannot get real memory cache amount\n");
-        if (! (ptr = strstr(buf, "SReclaimable:")) || sscanf(ptr + 13, "%ld", &slabreclaimable) != 1)
-                DEBUG("system statistic error -- cannot get slab reclaimable memory amount\n");
-        si->memory.usage.bytes = systeminfo.memory.size - (uint64_t)(mem_free + buffers + cached + slabreclaimable) * 1024;
+        if (found & MemInfo_MemAvailable) {
+                // Linux >= 3.14: kernel's estimate of memory available for new workloads without swapping, accounts for the reclaimable page cache and slab
+                si->memory.available.bytes = meminfo.memAvailable * 1024;
+                si->memory.usage.bytes = si->memory.size > si->memory.available.bytes ? si->memory.size - si->memory.available.bytes : 0ULL;
+        } else {
+                si->memory.usage.bytes = si->memory.size - (uint64_t)(meminfo.memFree + meminfo.buffers + meminfo.cached + meminfo.slabReclaimable) * 1024;
+                si->memory.available.bytes = si->memory.size - si->memory.usage.bytes;
+        }
+        si->memory.dirty = meminfo.dirty * 1024;
+        si->memory.writeback = meminfo.writeback * 1024;
+        si->memory.slabUnreclaimable = meminfo.slabUnreclaimable * 1024;
+        si->memory.hugepages.size = meminfo.hugePagesTotal * meminfo.hugePageSize * 1024;
+        si->memory.hugepages.bytes = (meminfo.hugePagesTotal - meminfo.hugePagesFree) * meminfo.hugePageSize * 1024;
+        si->memory.extended = true;
 
         /* Swap */
-        if (! (ptr = strstr(buf, "SwapTotal:")) || sscanf(ptr + 10, "%ld", &swap_total) != 1) {
+        if (! (found & MemInfo_SwapTotal)) {
                 LogError("system statistic error -- cannot get swap total amount\n");
                 goto error;
         }
-        if (! (ptr = strstr(buf, "SwapFree:")) || sscanf(ptr + 9, "%ld", &swap_free) != 1) {
+        if (! (found & MemInfo_SwapFree)) {
                 LogError("system statistic error -- cannot get swap free amount\n");
                 goto error;
         }
-        si->swap.size = (uint64_t)swap_total * 1024;
-        si->swap.usage.bytes = (uint64_t)(swap_total - swap_free) * 1024;
+        si->swap.size = meminfo.swapTotal * 1024;
+        si->swap.usage.bytes = (meminfo.swapTotal - meminfo.swapFree) * 1024;
 
         return true;
 
 error:
         si->memory.usage.bytes = 0ULL;
+        si->memory.extended = false;
         si->swap.size = 0ULL;
         return false;
 }
@@ -442,7 +559,7 @@ boolean_t used_system_cpu_sysdep(SystemInfo_T *si) {
         unsigned long long cpu_softirq;
         char buf[STRLEN];
 
-        if (! file_readProc(buf, sizeof(buf), "stat", -1, NULL)) {
+        if (_readProcFile(&_stat, buf, sizeof(buf)) <= 0) {
                 LogError("system statistic error -- cannot read /proc/stat\n");
                 goto error;
         }
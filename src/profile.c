@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include "monit.h"
+#include "profile.h"
+
+// libmonit
+#include "system/Time.h"
+
+
+/* ------------------------------------------------------------- Definitions */
+
+
+Profile_T profile;
+char *phasenames[] = {"event queue", "system statistics", "process tree", "service checks", "state file"};
+
+
+static struct {
+        uint64_t cycle;                                  /**< Cycle start time */
+        uint64_t phase;                          /**< Current phase start time */
+        struct rusage usage;                   /**< Resource usage at the start */
+} start;
+
+
+/* ----------------------------------------------------------------- Private */
+
+
+static uint64_t _timevalToMicro(struct timeval *t) {
+        return (uint64_t)t->tv_sec * USEC_PER_SEC + t->tv_usec;
+}
+
+
+static uint64_t _elapsed(struct timeval *from, struct timeval *to) {
+        uint64_t a = _timevalToMicro(from);
+        uint64_t b = _timevalToMicro(to);
+        return b > a ? b - a : 0;
+}
+
+
+/* ------------------------------------------------------------------ Public */
+
+
+void Profile_start() {
+        profile.counters.checked = profile.counters.skipped = 0;
+        getrusage(RUSAGE_SELF, &start.usage);
+        start.cycle = start.phase = Time_micro();
+}
+
+
+void Profile_phase(Phase_Type phase) {
+        uint64_t now = Time_micro();
+        Profile_record(&profile.phase[phase], now > start.phase ? now - start.phase : 0);
+        start.phase = now;
+}
+
+
+void Profile_stop() {
+        struct rusage usage;
+        uint64_t now = Time_micro();
+        uint64_t duration = now > start.cycle ? now - start.cycle : 0;
+        Profile_record(&profile.cycle, duration);
+        if (duration > (uint64_t)Run.polltime * USEC_PER_SEC)
+                profile.overruns++;
+        profile.history.duration[profile.history.index] = duration;
+        profile.history.index = (profile.history.index + 1) % PROFILE_HISTORY;
+        if (profile.history.count < PROFILE_HISTORY)
+                profile.history.count++;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+                profile.counters.cpuUser = _elapsed(&start.usage.ru_utime, &usage.ru_utime);
+                profile.counters.cpuSystem = _elapsed(&start.usage.ru_stime, &usage.ru_stime);
+                profile.counters.minorFaults = usage.ru_minflt - start.usage.ru_minflt;
+                profile.counters.majorFaults = usage.ru_majflt - start.usage.ru_majflt;
+                profile.counters.contextSwitches = usage.ru_nvcsw - start.usage.ru_nvcsw;
+                profile.counters.preemptions = usage.ru_nivcsw - start.usage.ru_nivcsw;
+        }
+}
+
+
+void Profile_record(Timing_T *t, uint64_t duration) {
+        t->last = duration;
+        if (duration > t->max)
+                t->max = duration;
+        t->total += duration;
+        t->count++;
+}
+
+
+uint64_t Profile_average(Timing_T *t) {
+        return t->count ? t->total / t->count : 0;
+}
+
+
+int Profile_histogram(int buckets[PROFILE_BUCKETS]) {
+        memset(buckets, 0, PROFILE_BUCKETS * sizeof(int));
+        for (int i = 0; i < profile.history.count; i++) {
+                int bucket = 0;
+                for (uint64_t limit = 10000; bucket < PROFILE_BUCKETS - 1 && profile.history.duration[i] >= limit; limit *= 10)
+                        bucket++;
+                buckets[bucket]++;
+        }
+        return profile.history.count;
+}
+
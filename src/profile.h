@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#ifndef MONIT_PROFILE_H
+#define MONIT_PROFILE_H
+
+
+/**
+ * Monit self-profiling.
+ *
+ * Every poll cycle is split into phases (event queue processing, system
+ * statistics, process tree, service checks and state file update). The
+ * duration of each phase, the duration of every service check and a few
+ * cheap resource counters obtained with getrusage() are recorded, so the
+ * expensive parts of a cycle can be found without external tools. The
+ * data is reported by the http interface (/_runtime, service status and
+ * XML status).
+ *
+ * All durations are in microseconds.
+ *
+ *  @file
+ */
+
+
+/** Number of cycles kept for the rolling histogram */
+#define PROFILE_HISTORY 64
+
+
+/** Number of histogram buckets: <10ms, <100ms, <1s, <10s and more */
+#define PROFILE_BUCKETS 5
+
+
+typedef enum {
+        Phase_Events = 0,
+        Phase_SystemInfo,
+        Phase_ProcessTree,
+        Phase_Checks,
+        Phase_State,
+        Phase_Count
+} Phase_Type;
+
+
+/** The poll cycle profile */
+typedef struct Profile_T {
+        Timing_T cycle;                                /**< Whole cycle timing */
+        Timing_T phase[Phase_Count];                  /**< Timing of each phase */
+        unsigned long long overruns;  /**< Cycles which took longer than poll */
+        struct {
+                unsigned int checked;  /**< Services checked in the last cycle */
+                unsigned int skipped;  /**< Services skipped in the last cycle */
+                uint64_t cpuUser;         /**< User CPU used by last cycle [us] */
+                uint64_t cpuSystem;     /**< System CPU used by last cycle [us] */
+                long minorFaults;            /**< Minor page faults last cycle */
+                long majorFaults;            /**< Major page faults last cycle */
+                long contextSwitches; /**< Voluntary context switches last cycle */
+                long preemptions; /**< Involuntary context switches last cycle */
+        } counters;
+        struct {
+                int index;                            /**< Next slot to write */
+                int count;                          /**< Number of used slots */
+                uint64_t duration[PROFILE_HISTORY]; /**< Recent cycle durations */
+        } history;
+} Profile_T;
+
+
+extern Profile_T profile;
+extern char *phasenames[];
+
+
+/**
+ * Start profiling of a new poll cycle
+ */
+void Profile_start();
+
+
+/**
+ * Close the given phase of the current cycle. The phase duration is the
+ * time since the previous phase (or the cycle start) was closed
+ * @param phase The phase which just finished
+ */
+void Profile_phase(Phase_Type phase);
+
+
+/**
+ * Finish profiling of the current cycle
+ */
+void Profile_stop();
+
+
+/**
+ * Record a duration in the timing statistics
+ * @param t The timing statistics
+ * @param duration The measured duration [us]
+ */
+void Profile_record(Timing_T *t, uint64_t duration);
+
+
+/**
+ * Get the average duration
+ * @param t The timing statistics
+ * @return The average duration [us] or 0 if nothing was measured yet
+ */
+uint64_t Profile_average(Timing_T *t);
+
+
+/**
+ * Compute the histogram of the recent cycle durations. The buckets are
+ * <10ms, <100ms, <1s, <10s and >=10s
+ * @param buckets The histogram buckets (output)
+ * @return The number of cycles in the histogram
+ */
+int Profile_histogram(int buckets[PROFILE_BUCKETS]);
+
+
+#endif
+
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "monit.h"
+#include "snapshot.h"
+
+// libmonit
+#include "system/Time.h"
+
+
+/* ------------------------------------------------------------- Definitions */
+
+
+static struct {
+        volatile unsigned int sequence;
+        SystemInfo_T info;
+} published;
+
+
+/* ----------------------------------------------------------------- Private */
+
+
+/* The validator is the only writer, the sequence is odd while the record is being changed */
+static inline void _writeBegin(volatile unsigned int *sequence) {
+        __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static inline void _writeEnd(volatile unsigned int *sequence) {
+        __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+
+static inline unsigned int _readBegin(volatile unsigned int *sequence) {
+        unsigned int start;
+        while ((start = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1)
+                Time_usleep(10);
+        return start;
+}
+
+
+static inline boolean_t _readRetry(volatile unsigned int *sequence, unsigned int start) {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(sequence, __ATOMIC_RELAXED) != start;
+}
+
+
+static size_t _infoSize(Service_Type type) {
+        switch (type) {
+                case Service_Directory:
+                        return sizeof(struct DirectoryInfo_T);
+                case Service_Fifo:
+                        return sizeof(struct FifoInfo_T);
+                case Service_File:
+                        return sizeof(struct FileInfo_T);
+                case Service_Filesystem:
+                        return sizeof(struct FileSystemInfo_T);
+                case Service_Net:
+                        return sizeof(struct NetInfo_T);
+                case Service_Process:
+                        return sizeof(struct ProcessInfo_T);
+                default:
+                        return 0;
+        }
+}
+
+
+/* ------------------------------------------------------------------ Public */
+
+
+void Snapshot_publish(Service_T S) {
+        ASSERT(S);
+        size_t size = _infoSize(S->type);
+        if (size && ! S->published.inf.directory)
+                S->published.inf.directory = CALLOC(1, size);
+        if (S->type == Service_Program && ! S->published.output)
+                S->published.output = CALLOC(1, Run.limits.programOutput + 1);
+        _writeBegin(&S->published.sequence);
+        if (size)
+                memcpy(S->published.inf.directory, S->inf.directory, size);
+        S->published.timing = S->timing;
+        S->published.collected = S->collected;
+        if (S->type == Service_Program) {
+                S->published.started = S->program->started;
+                S->published.exitStatus = S->program->exitStatus;
+                snprintf(S->published.output, Run.limits.programOutput + 1, "%s", S->program->output ? StringBuffer_toString(S->program->output) : "");
+        }
+        _writeEnd(&S->published.sequence);
+}
+
+
+void Snapshot_publishSystem() {
+        _writeBegin(&published.sequence);
+        published.info = systeminfo;
+        _writeEnd(&published.sequence);
+}
+
+
+void Snapshot_publishAll() {
+        Snapshot_publishSystem();
+        for (Service_T s = servicelist; s; s = s->next)
+                Snapshot_publish(s);
+}
+
+
+Service_T Snapshot_get(Service_T S, Snapshot_T snapshot) {
+        ASSERT(S);
+        ASSERT(snapshot);
+        size_t size = _infoSize(S->type);
+        unsigned int start;
+        do {
+                start = _readBegin(&S->published.sequence);
+                snapshot->service = *S;
+                snapshot->service.timing = S->published.timing;
+                snapshot->service.collected = S->published.collected;
+                if (size && S->published.inf.directory) {
+                        memcpy(&snapshot->inf, S->published.inf.directory, size);
+                        snapshot->service.inf.directory = &snapshot->inf.directory;
+                }
+                if (S->type == Service_Program) {
+                        if (! snapshot->output)
+                                snapshot->output = StringBuffer_create(64);
+                        StringBuffer_clear(snapshot->output);
+                        // The buffer is terminated at its end, so a concurrent change cannot make the copy overrun it
+                        if (S->published.output)
+                                StringBuffer_append(snapshot->output, "%s", S->published.output);
+                        snapshot->program = *S->program;
+                        snapshot->program.started = S->published.started;
+                        snapshot->program.exitStatus = S->published.exitStatus;
+                        snapshot->program.output = snapshot->output;
+                        snapshot->service.program = &snapshot->program;
+                }
+        } while (_readRetry(&S->published.sequence, start));
+        return &snapshot->service;
+}
+
+
+void Snapshot_getSystem(SystemInfo_T *info) {
+        ASSERT(info);
+        unsigned int start;
+        do {
+                start = _readBegin(&published.sequence);
+                *info = published.info;
+        } while (_readRetry(&published.sequence, start));
+}
+
+
+void Snapshot_free(Snapshot_T snapshot) {
+        ASSERT(snapshot);
+        if (snapshot->output)
+                StringBuffer_free(&snapshot->output);
+}
+
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU Affero General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#ifndef MONIT_SNAPSHOT_H
+#define MONIT_SNAPSHOT_H
+
+
+/**
+ * Consistent copies of the service check results for the http and M/Monit
+ * heartbeat threads.
+ *
+ * The validator updates the check results of a service in place while the
+ * check runs. When the check finished, the validator publishes a copy of the
+ * results guarded by a sequence lock: the writer never waits, a reader copies
+ * the record again if it was changed meanwhile. The status pages are rendered
+ * from such a copy, so all values shown for a service come from one check.
+ * The system statistics are published the same way once per cycle.
+ *
+ * The single word fields (monitoring state, error flags) are read directly.
+ * The network link statistics are kept by the Link_T object and are not
+ * copied.
+ *
+ *  @file
+ */
+
+
+/** Reader side copy of a service */
+typedef struct Snapshot_T {
+        struct Service_T service;                         /**< Copy of the service */
+        struct Program_T program;                    /**< Copy of the program data */
+        StringBuffer_T output;                      /**< Copy of the program output */
+        union {
+                struct DirectoryInfo_T directory;
+                struct FifoInfo_T fifo;
+                struct FileInfo_T file;
+                struct FileSystemInfo_T filesystem;
+                struct NetInfo_T net;
+                struct ProcessInfo_T process;
+        } inf;                                       /**< Copy of the check result */
+} *Snapshot_T;
+
+
+/**
+ * Publish the check results of the service. Called by the validator when
+ * the service check finished
+ * @param S A Service object
+ */
+void Snapshot_publish(Service_T S);
+
+
+/**
+ * Publish the system statistics. Called by the validator when the
+ * statistics were updated
+ */
+void Snapshot_publishSystem();
+
+
+/**
+ * Publish the system statistics and the check results of all services.
+ * Called when the service list was created or replaced
+ */
+void Snapshot_publishAll();
+
+
+/**
+ * Get a consistent copy of the service with the last published check
+ * results. The copy can be used for reading only and is valid until the
+ * next call with the same snapshot object. The snapshot object has to be
+ * zero initialized before first use and released with Snapshot_free()
+ * @param S A Service object
+ * @param snapshot The snapshot object to fill
+ * @return The service copy
+ */
+Service_T Snapshot_get(Service_T S, Snapshot_T snapshot);
+
+
+/**
+ * Get a consistent copy of the last published system statistics
+ * @param info The system information object to fill
+ */
+void Snapshot_getSystem(SystemInfo_T *info);
+
+
+/**
+ * Release the resources held by the snapshot object
+ * @param snapshot The snapshot object
+ */
+void Snapshot_free(Snapshot_T snapshot);
+
+
+#endif
+
@@ -72,6 +72,10 @@
 #include <netdb.h>
 #endif
 
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
 #include "net.h"
 #include "monit.h"
 #include "socket.h"
@@ -106,6 +110,14 @@ typedef enum {
 #define RBUFFER_SIZE 1460
 
 
+// Maximum TLS record payload, the output is coalesced to full records
+#define WBUFFER_SIZE 16384
+
+
+// Maximum number of buffers passed to one writev call
+#define IOV_BATCH 16
+
+
 #define T Socket_T
 struct T {
         Socket_Type type;
@@ -507,6 +519,12 @@ Socket_Type Socket_getType(T S) {
 }
 
 
+Socket_Family Socket_getFamily(T S) {
+        ASSERT(S);
+        return S->family;
+}
+
+
 void *Socket_getPort(T S) {
         ASSERT(S);
         return S->Port;
@@ -704,6 +722,99 @@ int Socket_write(T S, void *b, size_t size) {
 }
 
 
+int Socket_writev(T S, const struct iovec *iov, int iovcnt) {
+        ASSERT(S);
+        ASSERT(iov);
+        size_t sent = 0;
+#ifdef HAVE_OPENSSL
+        if (S->ssl) {
+                unsigned char buffer[WBUFFER_SIZE];
+                size_t used = 0;
+                for (int i = 0; i < iovcnt; i++) {
+                        const unsigned char *p = iov[i].iov_base;
+                        size_t length = iov[i].iov_len;
+                        while (length > 0) {
+                                size_t n = length < WBUFFER_SIZE - used ? length : WBUFFER_SIZE - used;
+                                memcpy(buffer + used, p, n);
+                                used += n;
+                                p += n;
+                                length -= n;
+                                if (used == WBUFFER_SIZE) {
+                                        if (Socket_write(S, buffer, used) != (int)used)
+                                                return -1;
+                                        sent += used;
+                                        used = 0;
+                                }
+                        }
+                }
+                if (used) {
+                        if (Socket_write(S, buffer, used) != (int)used)
+                                return -1;
+                        sent += used;
+                }
+                return (int)sent;
+        }
+#endif
+        // Current position: the buffer index and the offset in it
+        int i = 0;
+        size_t offset = 0;
+        while (i < iovcnt) {
+                struct iovec batch[IOV_BATCH];
+                int count = 0;
+                for (int j = i; j < iovcnt && count < IOV_BATCH; j++, count++) {
+                        batch[count].iov_base = (char *)iov[j].iov_base + (j == i ? offset : 0);
+                        batch[count].iov_len = iov[j].iov_len - (j == i ? offset : 0);
+                }
+                ssize_t n = Net_writev(S->socket, batch, count, S->timeout);
+                if (n < 0)
+                        return -1;
+                else if (n == 0)
+                        break;
+                sent += n;
+                while (i < iovcnt && (size_t)n >= iov[i].iov_len - offset) {
+                        n -= iov[i].iov_len - offset;
+                        offset = 0;
+                        i++;
+                }
+                offset += n;
+        }
+        return (int)sent;
+}
+
+
+int Socket_sendfile(T S, int fd, off_t offset, size_t size) {
+        ASSERT(S);
+        ASSERT(fd >= 0);
+        size_t sent = 0;
+#ifdef HAVE_OPENSSL
+        if (S->ssl) {
+                unsigned char buffer[WBUFFER_SIZE];
+                while (sent < size) {
+                        ssize_t n = pread(fd, buffer, size - sent < WBUFFER_SIZE ? size - sent : WBUFFER_SIZE, offset);
+                        if (n < 0)
+                                return -1;
+                        else if (n == 0)
+                                break;
+                        if (Socket_write(S, buffer, n) != n)
+                                return -1;
+                        offset += n;
+                        sent += n;
+                }
+                return (int)sent;
+        }
+#endif
+        while (sent < size) {
+                ssize_t n = Net_sendfile(S->socket, fd, &offset, size - sent, S->timeout);
+                if (n < 0)
+                        return -1;
+                else if (n == 0)
+                        break;
+                sent += n;
+        }
+        return (int)sent;
+}
+
+
 int Socket_readByte(T S) {
         ASSERT(S);
         if (S->offset >= S->length)
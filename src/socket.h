@@ -53,6 +53,9 @@ typedef enum {
 typedef struct T *T;
 
 
+struct iovec;
+
+
 /**
  * Create a new Socket opened against host:port. The returned Socket
  * is a connected socket. This method can be used to create either TCP
@@ -160,6 +163,14 @@ int Socket_getSocket(T S);
 Socket_Type Socket_getType(T S);
 
 
+/**
+ * Get the family of this socket.
+ * @param S A Socket_T object
+ * @return The socket family
+ */
+Socket_Family Socket_getFamily(T S);
+
+
 /**
  * Get the Port object used to create this socket. If no Port object
  * was used this method returns NULL.
@@ -242,6 +253,33 @@ int Socket_print(T S, const char *m, ...) __attribute__((format (printf, 2, 3)))
 int Socket_write(T S, void *b, size_t size);
 
 
+/**
+ * Write the <code>iovcnt</code> buffers described by <code>iov</code>,
+ * in order. On a plain socket the buffers are written with one gather
+ * write (writev), so e.g. a HTTP response header and body are sent with
+ * one system call. On a SSL connection the buffers are coalesced into
+ * full TLS records instead of one record per buffer.
+ * @param S A Socket_T object
+ * @param iov The buffers to write
+ * @param iovcnt Number of buffers in iov
+ * @return The bytes sent or -1 if an error occurred
+ */
+int Socket_writev(T S, const struct iovec *iov, int iovcnt);
+
+
+/**
+ * Write <code>size</code> bytes of the file <code>fd</code> starting at
+ * <code>offset</code>. On a plain socket the data is sent by the kernel
+ * (sendfile) where supported, without copying it to user space.
+ * @param S A Socket_T object
+ * @param fd The file descriptor of a regular file
+ * @param offset The file offset to start at
+ * @param size Number of bytes to send
+ * @return The bytes sent or -1 if an error occurred
+ */
+int Socket_sendfile(T S, int fd, off_t offset, size_t size);
+
+
 /**
  * Read a single byte. The byte is returned as an int in the range 0
  * to 255.
@@ -93,6 +93,12 @@
  * The backward compatibility of monitoring state restore is very important if
  * Monit runs in cluster => keep previous formats compatibility.
  *
+ * The service states are saved at the end of every cycle, but usually only a
+ * few of them change. A copy of the records written to the file is cached, so
+ * State_save() rewrites in place (pwrite) only the records which differ and
+ * syncs the file only if something was written. The whole file is rewritten
+ * only if the service list changed (e.g. on reload) or after State_open().
+ *
  * @file
  */
 
@@ -185,6 +191,28 @@ static int file = -1;
 static uint64_t booted = 0ULL;
 
 
+/* Copy of the service records stored in the state file, indexed by the service position in servicelist */
+static struct {
+        int count;                        /**< Number of records, -1 if unknown */
+        State3_T *records;                             /**< The saved records */
+} cache = {.count = -1};
+
+
+/* Size of the V3 state file header: <MAGIC><VERSION><BOOTTIME> */
+#define STATE_HEADER_SIZE (sizeof(int) + sizeof(int) + sizeof(uint64_t))
+
+
+/* Event actions of the service rules in the order used by State_transfer() */
+typedef struct Rules_T {
+        int count;
+        int size;
+        EventAction_T *action;
+} Rules_T;
+
+
+#define _ADDRULES(type, list) for (type r = (list); r; r = r->next) _addRule(rules, r->action)
+
+
 /* ----------------------------------------------------------------- Private */
 
 
@@ -259,6 +287,221 @@ static void _updateLinkSpeed(Service_T S, int duplex, long long speed) {
 }
 
 
+static void _addRule(Rules_T *rules, EventAction_T action) {
+        if (action) {
+                if (rules->count == rules->size) {
+                        rules->size = rules->size ? rules->size * 2 : 32;
+                        RESIZE(rules->action, rules->size * sizeof(EventAction_T));
+                }
+                rules->action[rules->count++] = action;
+        }
+}
+
+
+static void _getRules(Service_T S, Rules_T *rules) {
+        _addRule(rules, S->action_DATA);
+        _addRule(rules, S->action_EXEC);
+        _addRule(rules, S->action_INVALID);
+        _addRule(rules, S->action_MONIT_START);
+        _addRule(rules, S->action_MONIT_STOP);
+        _addRule(rules, S->action_ACTION);
+        if (S->checksum)
+                _addRule(rules, S->checksum->action);
+        if (S->perm)
+                _addRule(rules, S->perm->action);
+        if (S->uid)
+                _addRule(rules, S->uid->action);
+        if (S->euid)
+                _addRule(rules, S->euid->action);
+        if (S->gid)
+                _addRule(rules, S->gid->action);
+        _ADDRULES(ActionRate_T, S->actionratelist);
+        _ADDRULES(FileSystem_T, S->filesystemlist);
+        _ADDRULES(Icmp_T, S->icmplist);
+        _ADDRULES(Port_T, S->portlist);
+        _ADDRULES(Port_T, S->socketlist);
+        _ADDRULES(Resource_T, S->resourcelist);
+        _ADDRULES(Size_T, S->sizelist);
+        _ADDRULES(Uptime_T, S->uptimelist);
+        _ADDRULES(Match_T, S->matchlist);
+        _ADDRULES(Match_T, S->matchignorelist);
+        _ADDRULES(Timestamp_T, S->timestamplist);
+        _ADDRULES(Pid_T, S->pidlist);
+        _ADDRULES(Pid_T, S->ppidlist);
+        _ADDRULES(Status_T, S->statuslist);
+        _ADDRULES(FsFlag_T, S->fsflaglist);
+        _ADDRULES(NonExist_T, S->nonexistlist);
+        _ADDRULES(Exist_T, S->existlist);
+        _ADDRULES(LinkStatus_T, S->linkstatuslist);
+        _ADDRULES(LinkSpeed_T, S->linkspeedlist);
+        _ADDRULES(LinkSaturation_T, S->linksaturationlist);
+        _ADDRULES(Bandwidth_T, S->uploadbyteslist);
+        _ADDRULES(Bandwidth_T, S->uploadpacketslist);
+        _ADDRULES(Bandwidth_T, S->downloadbyteslist);
+        _ADDRULES(Bandwidth_T, S->downloadpacketslist);
+}
+
+
+static boolean_t _isEqualAction(Action_T a, Action_T b) {
+        return a->id == b->id && a->count == b->count && a->cycles == b->cycles && a->repeat == b->repeat;
+}
+
+
+static int _findRule(Rules_T *rules, EventAction_T action) {
+        for (int i = 0; i < rules->count; i++)
+                if (rules->action[i] == action)
+                        return i;
+        return -1;
+}
+
+
+/**
+ * Move the event states of the previous service instance to the new one. The
+ * events are bound to the rule's event action, so they can be moved only if the
+ * service rules didn't change: the rules are paired by position and their
+ * actions must match. Otherwise the events start from scratch like on restart.
+ */
+static void _transferEvents(Service_T from, Service_T to) {
+        Rules_T old = {}, new = {};
+        _getRules(from, &old);
+        _getRules(to, &new);
+        boolean_t unchanged = old.count == new.count;
+        for (int i = 0; unchanged && i < old.count; i++)
+                unchanged = _isEqualAction(old.action[i]->failed, new.action[i]->failed) && _isEqualAction(old.action[i]->succeeded, new.action[i]->succeeded);
+        for (Event_T e = from->eventlist; unchanged && e; e = e->next)
+                unchanged = _findRule(&old, e->action) != -1;
+        if (unchanged) {
+                for (Event_T e = from->eventlist; e; e = e->next) {
+                        e->action = new.action[_findRule(&old, e->action)];
+                        e->source = to;
+                }
+                to->eventlist = from->eventlist;
+                from->eventlist = NULL;
+                to->error = from->error;
+                to->error_hint = from->error_hint;
+        }
+        FREE(old.action);
+        FREE(new.action);
+}
+
+
+/**
+ * Test if both service instances monitor the same object: the same path, or for a process matched by pattern, the same pattern
+ */
+static boolean_t _isSameObject(Service_T from, Service_T to) {
+        if (from->path || to->path)
+                return Str_isByteEqual(from->path, to->path);
+        if (from->matchlist || to->matchlist)
+                return from->matchlist && to->matchlist && Str_isByteEqual(from->matchlist->match_string, to->matchlist->match_string);
+        return true;
+}
+
+
+/**
+ * Carry the runtime data of the service over to its new instance after reload
+ */
+static void _transfer(Service_T from, Service_T to) {
+        to->monitor = from->monitor;
+        to->nstart = from->nstart;
+        to->ncycle = from->ncycle;
+        to->timing = from->timing;
+        to->doaction = from->doaction;
+        to->token = from->token;
+        from->token = NULL;
+        // The collected data describe the monitored object, keep them only if the object didn't change
+        if (_isSameObject(from, to)) {
+                union Info_T inf = to->inf;
+                to->inf = from->inf;
+                from->inf = inf;
+                to->collected = from->collected;
+                if (from->program && to->program) {
+                        Process_T P = to->program->P;
+                        to->program->P = from->program->P;
+                        from->program->P = P;
+                        StringBuffer_T output = to->program->output;
+                        to->program->output = from->program->output;
+                        from->program->output = output;
+                        to->program->started = from->program->started;
+                        to->program->exitStatus = from->program->exitStatus;
+                }
+        }
+        if (from->eventlist)
+                _transferEvents(from, to);
+}
+
+
+static void _serialize(Service_T service, State3_T *state) {
+        memset(state, 0, sizeof(*state));
+        snprintf(state->name, sizeof(state->name), "%s", service->name);
+        state->type = service->type;
+        state->monitor = service->monitor & ~Monitor_Waiting;
+        state->nstart = service->nstart;
+        state->ncycle = service->ncycle;
+        switch (service->type) {
+                case Service_Directory:
+                        state->priv.directory.timestamp = (unsigned long long)service->inf.directory->timestamp;
+                        if (service->perm)
+                                state->priv.directory.mode = service->perm->perm;
+                        break;
+
+                case Service_Fifo:
+                        state->priv.fifo.timestamp = (unsigned long long)service->inf.fifo->timestamp;
+                        if (service->perm)
+                                state->priv.fifo.mode = service->perm->perm;
+                        break;
+
+                case Service_File:
+                        state->priv.file.inode = service->inf.file->inode;
+                        state->priv.file.readpos = service->inf.file->readpos;
+                        state->priv.file.size = (unsigned long long)service->inf.file->size;
+                        state->priv.file.timestamp = (unsigned long long)service->inf.file->timestamp;
+                        if (service->checksum)
+                                strncpy(state->priv.file.hash, service->inf.file->cs_sum, sizeof(state->priv.file.hash) - 1);
+                        if (service->perm)
+                                state->priv.file.mode = service->perm->perm;
+                        break;
+
+                case Service_Filesystem:
+                        if (service->perm)
+                                state->priv.filesystem.mode = service->perm->perm;
+                        break;
+
+                case Service_Net:
+                        if (service->linkspeedlist) {
+                                state->priv.net.duplex = service->linkspeedlist->duplex;
+                                state->priv.net.speed = service->linkspeedlist->speed;
+                        }
+                        break;
+
+                default:
+                        break;
+        }
+}
+
+
+static void _writeHeader() {
+        if (ftruncate(file, 0L) == -1)
+                THROW(IOException, "Unable to truncate");
+        if (lseek(file, 0L, SEEK_SET) == -1)
+                THROW(IOException, "Unable to seek");
+        int magic = 0;
+        if (write(file, &magic, sizeof(magic)) != sizeof(magic))
+                THROW(IOException, "Unable to write magic");
+        // Save always using the latest format version
+        int version = StateVersion3;
+        if (write(file, &version, sizeof(version)) != sizeof(version))
+                THROW(IOException, "Unable to write format version");
+        if (write(file, &systeminfo.booted, sizeof(systeminfo.booted)) != sizeof(systeminfo.booted))
+                THROW(IOException, "Unable to write system boot time");
+}
+
+
+static void _resetCache() {
+        FREE(cache.records);
+        cache.count = -1;
+}
+
+
 static void _restoreV3() {
         // System header
         if (read(file, &booted, sizeof(booted)) != sizeof(booted))
@@ -389,6 +632,7 @@ static void _restoreV0(int services) {
 
 boolean_t State_open() {
         State_close();
+        _resetCache();
         if ((file = open(Run.files.state, O_RDWR | O_CREAT, 0600)) == -1) {
                 LogError("State file '%s': cannot open for write -- %s\n", Run.files.state, STRERROR);
                 return false;
@@ -405,77 +649,41 @@ void State_close() {
                 else
                         file = -1;
         }
+        _resetCache();
 }
 
 
 void State_save() {
         TRY
         {
-                if (ftruncate(file, 0L) == -1)
-                        THROW(IOException, "Unable to truncate");
-                if (lseek(file, 0L, SEEK_SET) == -1)
-                        THROW(IOException, "Unable to seek");
-                int magic = 0;
-                if (write(file, &magic, sizeof(magic)) != sizeof(magic))
-                        THROW(IOException, "Unable to write magic");
-                // Save always using the latest format version
-                int version = StateVersion3;
-                if (write(file, &version, sizeof(version)) != sizeof(version))
-                        THROW(IOException, "Unable to write format version");
-                if (write(file, &systeminfo.booted, sizeof(systeminfo.booted)) != sizeof(systeminfo.booted))
-                        THROW(IOException, "Unable to write system boot time");
-                for (Service_T service = servicelist; service; service = service->next) {
+                int count = 0;
+                for (Service_T service = servicelist; service; service = service->next)
+                        count++;
+                boolean_t rewrite = count != cache.count;
+                if (rewrite) {
+                        // Unknown file content or the service list changed => write the whole file
+                        _resetCache();
+                        cache.records = CALLOC(count ? count : 1, sizeof(State3_T));
+                        _writeHeader();
+                        cache.count = count;
+                }
+                int dirty = 0, slot = 0;
+                for (Service_T service = servicelist; service; service = service->next, slot++) {
                         State3_T state;
-                        memset(&state, 0, sizeof(state));
-                        snprintf(state.name, sizeof(state.name), "%s", service->name);
-                        state.type = service->type;
-                        state.monitor = service->monitor & ~Monitor_Waiting;
-                        state.nstart = service->nstart;
-                        state.ncycle = service->ncycle;
-                        switch (service->type) {
-                                case Service_Directory:
-                                        state.priv.directory.timestamp = (unsigned long long)service->inf.directory->timestamp;
-                                        if (service->perm)
-                                                state.priv.directory.mode = service->perm->perm;
-                                        break;
-
-                                case Service_Fifo:
-                                        state.priv.fifo.timestamp = (unsigned long long)service->inf.fifo->timestamp;
-                                        if (service->perm)
-                                                state.priv.fifo.mode = service->perm->perm;
-                                        break;
-
-                                case Service_File:
-                                        state.priv.file.inode = service->inf.file->inode;
-                                        state.priv.file.readpos = service->inf.file->readpos;
-                                        state.priv.file.size = (unsigned long long)service->inf.file->size;
-                                        state.priv.file.timestamp = (unsigned long long)service->inf.file->timestamp;
-                                        if (service->checksum)
-                                                strncpy(state.priv.file.hash, service->inf.file->cs_sum, sizeof(state.priv.file.hash) - 1);
-                                        if (service->perm)
-                                                state.priv.file.mode = service->perm->perm;
-                                        break;
-
-                                case Service_Filesystem:
-                                        if (service->perm)
-                                                state.priv.filesystem.mode = service->perm->perm;
-                                        break;
-
-                                case Service_Net:
-                                        if (service->linkspeedlist) {
-                                                state.priv.net.duplex = service->linkspeedlist->duplex;
-                                                state.priv.net.speed = service->linkspeedlist->speed;
-                                        }
-                                        break;
-
-                                default:
-                                        break;
+                        _serialize(service, &state);
+                        if (rewrite || memcmp(&state, &cache.records[slot], sizeof(state)) != 0) {
+                                if (pwrite(file, &state, sizeof(state), (off_t)(STATE_HEADER_SIZE + (size_t)slot * sizeof(state))) != sizeof(state)) {
+                                        _resetCache();
+                                        THROW(IOException, "Unable to write service state");
+                                }
+                                cache.records[slot] = state;
+                                dirty++;
                         }
-                        if (write(file, &state, sizeof(state)) != sizeof(state))
-                                THROW(IOException, "Unable to write service state");
                 }
-                if (fsync(file))
+                if ((rewrite || dirty) && fsync(file)) {
+                        _resetCache();
                         THROW(IOException, "Unable to sync -- %s", STRERROR);
+                }
         }
         ELSE
         {
@@ -485,6 +693,15 @@ void State_save() {
 }
 
 
+void State_transfer(Service_T previous) {
+        for (Service_T s = previous; s; s = s->next) {
+                Service_T service = Util_getService(s->name);
+                if (service && service->type == s->type)
+                        _transfer(s, service);
+        }
+}
+
+
 void State_restore() {
         /* Ignore empty state file */
         if ((lseek(file, 0L, SEEK_END) == 0))
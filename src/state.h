@@ -83,4 +83,17 @@ void State_save();
 void State_restore();
 
 
+/**
+ * Carry the runtime data of the services from the previous configuration
+ * over to the current service list on reload. The services are paired by
+ * name and type. The counters, monitoring state and check timing are always
+ * kept. The collected data (process CPU deltas, network link history,
+ * filesystem statistics, etc.) are kept if the monitored object (path) did
+ * not change and the event states if the service rules did not change, so
+ * the unchanged services continue as if no reload happened.
+ * @param previous The service list of the previous configuration
+ */
+void State_transfer(Service_T previous);
+
+
 #endif
@@ -85,48 +85,48 @@ struct T {
 
 
 static void _printBorderTop(T t) {
-        StringBuffer_append(t->b, COLOR_DARKGRAY BOX_DOWN_RIGHT BOX_HORIZONTAL);
+        StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_DOWN_RIGHT BOX_HORIZONTAL);
         for (int i = 0; i < t->columnsCount; i++) {
                 for (int j = 0; j < t->columns[i].width; j++)
-                        StringBuffer_append(t->b, BOX_HORIZONTAL);
+                        StringBuffer_appendString(t->b, BOX_HORIZONTAL);
                 if (i < t->columnsCount - 1)
-                        StringBuffer_append(t->b, BOX_HORIZONTAL BOX_HORIZONTAL_DOWN BOX_HORIZONTAL);
+                        StringBuffer_appendString(t->b, BOX_HORIZONTAL BOX_HORIZONTAL_DOWN BOX_HORIZONTAL);
         }
-        StringBuffer_append(t->b, BOX_HORIZONTAL BOX_DOWN_LEFT COLOR_RESET "\n");
+        StringBuffer_appendString(t->b, BOX_HORIZONTAL BOX_DOWN_LEFT COLOR_RESET "\n");
 }
 
 
 static void _printBorderMiddle(T t) {
-        StringBuffer_append(t->b, COLOR_DARKGRAY BOX_VERTICAL_RIGHT BOX_HORIZONTAL);
+        StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_VERTICAL_RIGHT BOX_HORIZONTAL);
         for (int i = 0; i < t->columnsCount; i++) {
                 for (int j = 0; j < t->columns[i].width; j++)
-                        StringBuffer_append(t->b, BOX_HORIZONTAL);
+                        StringBuffer_appendString(t->b, BOX_HORIZONTAL);
                 if (i < t->columnsCount - 1)
-                        StringBuffer_append(t->b, BOX_HORIZONTAL BOX_VERTICAL_HORIZONTAL BOX_HORIZONTAL);
+                        StringBuffer_appendString(t->b, BOX_HORIZONTAL BOX_VERTICAL_HORIZONTAL BOX_HORIZONTAL);
         }
-        StringBuffer_append(t->b, BOX_HORIZONTAL BOX_VERTICAL_LEFT COLOR_RESET "\n");
+        StringBuffer_appendString(t->b, BOX_HORIZONTAL BOX_VERTICAL_LEFT COLOR_RESET "\n");
 }
 
 
 static void _printBorderBottom(T t) {
-        StringBuffer_append(t->b, COLOR_DARKGRAY BOX_UP_RIGHT BOX_HORIZONTAL);
+        StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_UP_RIGHT BOX_HORIZONTAL);
         for (int i = 0; i < t->columnsCount; i++) {
                 for (int j = 0; j < t->columns[i].width; j++)
-                        StringBuffer_append(t->b, BOX_HORIZONTAL);
+                        StringBuffer_appendString(t->b, BOX_HORIZONTAL);
                 if (i < t->columnsCount - 1)
-                        StringBuffer_append(t->b, BOX_HORIZONTAL BOX_UP_HORIZONTAL BOX_HORIZONTAL);
+                        StringBuffer_appendString(t->b, BOX_HORIZONTAL BOX_UP_HORIZONTAL BOX_HORIZONTAL);
         }
-        StringBuffer_append(t->b, BOX_HORIZONTAL BOX_UP_LEFT COLOR_RESET "\n");
+        StringBuffer_appendString(t->b, BOX_HORIZONTAL BOX_UP_LEFT COLOR_RESET "\n");
 }
 
 
 static void _printHeader(T t) {
         for (int i = 0; i < t->columnsCount; i++) {
-                StringBuffer_append(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET " ");
+                StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET " ");
                 StringBuffer_append(t->b, "%s%-*s%s", t->options.header.color, t->columns[i].width, t->columns[i].name, COLOR_RESET);
-                StringBuffer_append(t->b, " ");
+                StringBuffer_appendString(t->b, " ");
         }
-        StringBuffer_append(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET "\n");
+        StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET "\n");
         t->index.row++;
 }
 
@@ -156,9 +156,9 @@ static void _cacheColor(BoxColumn_T *column) {
 static boolean_t _printRow(T t) {
         boolean_t repeat = false;
         for (int i = 0; i < t->columnsCount; i++) {
-                StringBuffer_append(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET " ");
+                StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET " ");
                 if (*(t->columns[i]._color))
-                        StringBuffer_append(t->b, "%s", t->columns[i]._color);
+                        StringBuffer_appendString(t->b, t->columns[i]._color);
                 if (! t->columns[i].value || t->columns[i]._cursor > strlen(t->columns[i].value) - 1) {
                         // Empty column pading
                         StringBuffer_append(t->b, "%*s", t->columns[i].width, " ");
@@ -167,7 +167,7 @@ static boolean_t _printRow(T t) {
                                 // The value exceeds the column width and should be wrapped
                                 int column = 0;
                                 for (; t->columns[i].value[t->columns[i]._cursor] && (column == 0 || t->columns[i]._cursor % t->columns[i].width > 0); t->columns[i]._cursor++, column++)
-                                        StringBuffer_append(t->b, "%c", t->columns[i].value[t->columns[i]._cursor]);
+                                        StringBuffer_appendChar(t->b, t->columns[i].value[t->columns[i]._cursor]);
                                 if (t->columns[i]._cursor < t->columns[i]._valueLength)
                                         repeat = true;
                         } else {
@@ -181,11 +181,11 @@ static boolean_t _printRow(T t) {
                         StringBuffer_append(t->b, t->columns[i].align == BoxAlign_Right ? "%*s" : "%-*s", t->columns[i].width, t->columns[i].value + t->columns[i]._cursor);
                         t->columns[i]._cursor = t->columns[i]._valueLength;
                 }
-                StringBuffer_append(t->b, " ");
+                StringBuffer_appendString(t->b, " ");
                 if (*(t->columns[i]._color))
-                        StringBuffer_append(t->b, COLOR_RESET);
+                        StringBuffer_appendString(t->b, COLOR_RESET);
         }
-        StringBuffer_append(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET "\n");
+        StringBuffer_appendString(t->b, COLOR_DARKGRAY BOX_VERTICAL COLOR_RESET "\n");
         t->index.row++;
         return repeat;
 }
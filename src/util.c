@@ -108,6 +108,10 @@
 #include <grp.h>
 #endif
 
+#ifdef HAVE_FNMATCH_H
+#include <fnmatch.h>
+#endif
+
 #include "monit.h"
 #include "engine.h"
 #include "md5.h"
@@ -123,6 +127,7 @@
 // libmonit
 #include "io/File.h"
 #include "system/Time.h"
+#include "system/System.h"
 #include "exceptions/AssertException.h"
 #include "exceptions/IOException.h"
 
@@ -133,6 +138,35 @@ struct ad_user {
 };
 
 
+/* Name index: open addressing hash table of the servicelist or servicegrouplist, filled by the parser and dropped with the list */
+typedef struct NameIndex_T {
+        int size;                                /**< Number of slots (power of 2) */
+        int count;                                   /**< Number of indexed objects */
+        void **slot;
+        const char *(*name)(void *);                   /**< Object name accessor */
+} NameIndex_T;
+
+
+static const char *_serviceName(void *object);
+static const char *_serviceGroupName(void *object);
+
+
+/* The service and service group name indexes of one configuration */
+typedef struct ServiceIndex_T {
+        NameIndex_T services;
+        NameIndex_T groups;
+} ServiceIndex_T;
+
+
+/* The index of the runtime configuration and the index filled by the parser. They are the same, except while reload parses the new configuration */
+static ServiceIndex_T serviceIndexes[2] = {
+        {.services = {.name = _serviceName}, .groups = {.name = _serviceGroupName}},
+        {.services = {.name = _serviceName}, .groups = {.name = _serviceGroupName}}
+};
+static ServiceIndex_T *serviceIndex = &serviceIndexes[0];
+static ServiceIndex_T *parsedIndex = &serviceIndexes[0];
+
+
 /* Unsafe URL characters: [00-1F, 7F-FF] <>\"#%}{|\\^[] ` */
 static const unsigned char urlunsafe[256] = {
         1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
@@ -221,6 +255,68 @@ static const unsigned char b2x[][256] = {
 /* ----------------------------------------------------------------- Private */
 
 
+/**
+ * Case insensitive hash of the service or group name (the names are compared with IS())
+ */
+static unsigned int _hashServiceName(const char *name) {
+        unsigned int h = 2166136261u;
+        for (; *name; name++)
+                h = (h ^ (unsigned char)toupper((unsigned char)*name)) * 16777619u;
+        return h;
+}
+
+
+static const char *_serviceName(void *object) {
+        return ((Service_T)object)->name;
+}
+
+
+static const char *_serviceGroupName(void *object) {
+        return ((ServiceGroup_T)object)->name;
+}
+
+
+static void _insertIndex(NameIndex_T *index, void *object) {
+        unsigned int i = _hashServiceName(index->name(object)) & (index->size - 1);
+        while (index->slot[i])
+                i = (i + 1) & (index->size - 1);
+        index->slot[i] = object;
+}
+
+
+static void *_getIndex(NameIndex_T *index, const char *name) {
+        if (index->count) {
+                for (unsigned int i = _hashServiceName(name) & (index->size - 1); index->slot[i]; i = (i + 1) & (index->size - 1))
+                        if (IS(index->name(index->slot[i]), name))
+                                return index->slot[i];
+        }
+        return NULL;
+}
+
+
+static void _addIndex(NameIndex_T *index, void *object) {
+        // Keep the load factor under 1/2
+        if ((index->count + 1) * 2 > index->size) {
+                void **old = index->slot;
+                int oldsize = index->size;
+                index->size = oldsize ? oldsize * 2 : 64;
+                index->slot = CALLOC(index->size, sizeof(void *));
+                for (int i = 0; i < oldsize; i++)
+                        if (old[i])
+                                _insertIndex(index, old[i]);
+                FREE(old);
+        }
+        _insertIndex(index, object);
+        index->count++;
+}
+
+
+static void _resetIndex(NameIndex_T *index) {
+        FREE(index->slot);
+        index->size = index->count = 0;
+}
+
+
 /**
  * Returns the value of the parameter if defined or the String "(not
  * defined)"
@@ -774,10 +870,58 @@ void Util_hmacMD5(const unsigned char *data, int datalen, const unsigned char *k
 
 Service_T Util_getService(const char *name) {
         ASSERT(name);
-        for (Service_T s = servicelist; s; s = s->next)
-                if (IS(s->name, name))
-                        return s;
-        return NULL;
+        return _getIndex(&(serviceIndex->services), name);
+}
+
+
+Service_T Util_getParsedService(const char *name) {
+        ASSERT(name);
+        return _getIndex(&(parsedIndex->services), name);
+}
+
+
+void Util_indexService(Service_T s) {
+        ASSERT(s);
+        ASSERT(s->name);
+        _addIndex(&(parsedIndex->services), s);
+}
+
+
+ServiceGroup_T Util_getServiceGroup(const char *name) {
+        ASSERT(name);
+        return _getIndex(&(serviceIndex->groups), name);
+}
+
+
+ServiceGroup_T Util_getParsedServiceGroup(const char *name) {
+        ASSERT(name);
+        return _getIndex(&(parsedIndex->groups), name);
+}
+
+
+void Util_indexServiceGroup(ServiceGroup_T g) {
+        ASSERT(g);
+        ASSERT(g->name);
+        _addIndex(&(parsedIndex->groups), g);
+}
+
+
+void Util_resetServiceIndex() {
+        _resetIndex(&(parsedIndex->services));
+        _resetIndex(&(parsedIndex->groups));
+}
+
+
+void Util_detachServiceIndex() {
+        parsedIndex = serviceIndex == &serviceIndexes[0] ? &serviceIndexes[1] : &serviceIndexes[0];
+        Util_resetServiceIndex();
+}
+
+
+void Util_commitServiceIndex() {
+        _resetIndex(&(serviceIndex->services));
+        _resetIndex(&(serviceIndex->groups));
+        serviceIndex = parsedIndex;
 }
 
 
@@ -796,6 +940,21 @@ boolean_t Util_existService(const char *name) {
 }
 
 
+boolean_t Util_matchService(Service_T s, const char *pattern) {
+        ASSERT(s);
+        ASSERT(pattern);
+#ifdef HAVE_FNMATCH_H
+        if (strpbrk(pattern, "*?["))
+#ifdef FNM_CASEFOLD
+                return fnmatch(pattern, s->name, FNM_CASEFOLD) == 0;
+#else
+                return fnmatch(pattern, s->name, 0) == 0;
+#endif
+#endif
+        return IS(s->name, pattern);
+}
+
+
 void Util_printRunList() {
         char buf[10];
         printf("Runtime constants:\n");
@@ -1226,6 +1385,8 @@ void Util_printService(Service_T s) {
 
         for (FileSystem_T o = s->filesystemlist; o; o = o->next) {
                 StringBuffer_clear(buf);
+                if (o->aggregate.type != Aggregate_None)
+                        StringBuffer_append(buf, "%s: ", Util_aggregateToString(&(o->aggregate), buffer, sizeof(buffer)));
                 if (o->resource == Resource_Inode) {
                         printf(" %-20s = %s\n", "Inodes usage limit",
                                o->limit_absolute > -1
@@ -1275,6 +1436,8 @@ void Util_printService(Service_T s) {
 
         for (Resource_T o = s->resourcelist; o; o = o->next) {
                 StringBuffer_clear(buf);
+                if (o->aggregate.type != Aggregate_None)
+                        StringBuffer_append(buf, "%s: ", Util_aggregateToString(&(o->aggregate), buffer, sizeof(buffer)));
                 switch (o->resource_id) {
                         case Resource_CpuPercent:
                                 printf(" %-20s = ", "CPU usage limit");
@@ -1356,6 +1519,34 @@ void Util_printService(Service_T s) {
                                 printf(" %-20s = ", "Disk write limit");
                                 break;
 
+                        case Resource_MemoryAvailablePercent:
+                                printf(" %-20s = ", "Available memory limit");
+                                break;
+
+                        case Resource_MemoryAvailableKbyte:
+                                printf(" %-20s = ", "Available memory limit");
+                                break;
+
+                        case Resource_MemoryDirty:
+                                printf(" %-20s = ", "Dirty memory limit");
+                                break;
+
+                        case Resource_MemoryWriteback:
+                                printf(" %-20s = ", "Writeback memory limit");
+                                break;
+
+                        case Resource_SlabUnreclaimable:
+                                printf(" %-20s = ", "Unreclaimable slab limit");
+                                break;
+
+                        case Resource_HugePagesPercent:
+                                printf(" %-20s = ", "Huge pages usage limit");
+                                break;
+
+                        case Resource_HugePagesKbyte:
+                                printf(" %-20s = ", "Huge pages amount limit");
+                                break;
+
                         default:
                                 break;
                 }
@@ -1368,12 +1559,19 @@ void Util_printService(Service_T s) {
                         case Resource_CpuWait:
                         case Resource_MemoryPercent:
                         case Resource_SwapPercent:
+                        case Resource_MemoryAvailablePercent:
+                        case Resource_HugePagesPercent:
                                 printf("%s", StringBuffer_toString(Util_printRule(buf, o->action, "if %s %.1f%%", operatornames[o->operator], o->limit)));
                                 break;
 
                         case Resource_MemoryKbyte:
                         case Resource_SwapKbyte:
                         case Resource_MemoryKbyteTotal:
+                        case Resource_MemoryAvailableKbyte:
+                        case Resource_MemoryDirty:
+                        case Resource_MemoryWriteback:
+                        case Resource_SlabUnreclaimable:
+                        case Resource_HugePagesKbyte:
                                 printf("%s", StringBuffer_toString(Util_printRule(buf, o->action, "if %s %s", operatornames[o->operator], Str_bytesToSize(o->limit, buffer))));
                                 break;
 
@@ -1607,14 +1805,7 @@ void Util_redirectStdFds() {
 
 
 void Util_closeFds() {
-        int i;
-#ifdef HAVE_UNISTD_H
-        int max_descriptors = getdtablesize();
-#else
-        int max_descriptors = 1024;
-#endif
-        for (i = 3; i < max_descriptors; i++)
-                close(i);
+        System_closeDescriptors(3);
         errno = 0;
 }
 
@@ -1945,6 +2136,20 @@ StringBuffer_T Util_printEventratio(Action_T action, StringBuffer_T buf) {
 }
 
 
+char *Util_aggregateToString(Aggregate_T *aggregate, char *s, int size) {
+        ASSERT(aggregate);
+        ASSERT(s);
+        int range = aggregate->range;
+        if (range % Time_Day == 0)
+                snprintf(s, size, "%s in last %d day%s", aggregatenames[aggregate->type], range / Time_Day, range > Time_Day ? "s" : "");
+        else if (range % Time_Hour == 0)
+                snprintf(s, size, "%s in last %d hour%s", aggregatenames[aggregate->type], range / Time_Hour, range > Time_Hour ? "s" : "");
+        else
+                snprintf(s, size, "%s in last %d minute%s", aggregatenames[aggregate->type], range / Time_Minute, range > Time_Minute ? "s" : "");
+        return s;
+}
+
+
 StringBuffer_T Util_printRule(StringBuffer_T buf, EventAction_T action, const char *rule, ...) {
         ASSERT(buf);
         ASSERT(action);
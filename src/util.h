@@ -131,6 +131,70 @@ void Util_hmacMD5(const unsigned char *data, int datalen, const unsigned char *k
 Service_T Util_getService(const char *name);
 
 
+/**
+ * Get the service of the configuration being parsed. Same as
+ * Util_getService() except while reload parses the new configuration
+ * @param name A service name as stated in the config file
+ * @return the named service or NULL if not found
+ */
+Service_T Util_getParsedService(const char *name);
+
+
+/**
+ * Add the service to the service name index of the configuration being
+ * parsed. Must be called for every service added to the servicelist
+ * @param s A Service object
+ */
+void Util_indexService(Service_T s);
+
+
+/**
+ * @param name A service group name as stated in the config file
+ * @return the named service group or NULL if not found
+ */
+ServiceGroup_T Util_getServiceGroup(const char *name);
+
+
+/**
+ * Get the service group of the configuration being parsed. Same as
+ * Util_getServiceGroup() except while reload parses the new configuration
+ * @param name A service group name as stated in the config file
+ * @return the named service group or NULL if not found
+ */
+ServiceGroup_T Util_getParsedServiceGroup(const char *name);
+
+
+/**
+ * Add the service group to the group name index of the configuration
+ * being parsed. Must be called for every group added to the
+ * servicegrouplist
+ * @param g A ServiceGroup object
+ */
+void Util_indexServiceGroup(ServiceGroup_T g);
+
+
+/**
+ * Drop the service and service group name indexes of the configuration
+ * being parsed, e.g. before the servicelist is released or created again
+ */
+void Util_resetServiceIndex();
+
+
+/**
+ * Let the parser fill a new name index, the index of the runtime
+ * configuration stays in use until Util_commitServiceIndex() (reload)
+ */
+void Util_detachServiceIndex();
+
+
+/**
+ * Replace the index of the runtime configuration with the index filled by
+ * the parser since Util_detachServiceIndex(). Must be called with
+ * Run.mutex locked
+ */
+void Util_commitServiceIndex();
+
+
 /**
  * @param name A service name as stated in the config file
  * @return true if the service name exist in the
@@ -139,6 +203,16 @@ Service_T Util_getService(const char *name);
 boolean_t Util_existService(const char *name);
 
 
+/**
+ * Test if the service name matches the pattern. The pattern is the service
+ * name or a shell wildcard pattern (e.g. "web*"), the match is case-insensitive
+ * @param s A Service_T object
+ * @param pattern The service name or pattern
+ * @return true if the service matches, otherwise false
+ */
+boolean_t Util_matchService(Service_T s, const char *pattern);
+
+
 /**
  * Get the length of the service list, that is; the number of services
  * managed by monit
@@ -347,6 +421,17 @@ StringBuffer_T Util_printAction(Action_T action, StringBuffer_T buf);
 StringBuffer_T Util_printEventratio(Action_T action, StringBuffer_T buf);
 
 
+/**
+ * Describe the windowed aggregate of a resource test (e.g. "average in last
+ * 10 minutes")
+ * @param aggregate The aggregate
+ * @param s A buffer for the description
+ * @param size The buffer size
+ * @return The buffer
+ */
+char *Util_aggregateToString(Aggregate_T *aggregate, char *s, int size);
+
+
 /**
  * Append a rule description to the given StringBuffer. The description
  * consists of the formatted string given by the rule argument and constant
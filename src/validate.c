@@ -69,6 +69,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
@@ -101,9 +105,13 @@
 #include "device.h"
 #include "ProcessTree.h"
 #include "protocol.h"
+#include "profile.h"
+#include "snapshot.h"
 
 // libmonit
 #include "system/Time.h"
+#include "system/Arena.h"
+#include "system/Net.h"
 #include "io/File.h"
 #include "io/InputStream.h"
 #include "exceptions/AssertException.h"
@@ -115,23 +123,93 @@
  */
 
 
+/* ------------------------------------------------------------- Definitions */
+
+
+/* Arena for the transient data of one validation cycle (line buffers and such), reset at the start of every cycle. The checks run in the main thread only */
+static Arena_T cycle = NULL;
+static struct {
+        char *buffer;
+        long size;
+} contentLine = {}; // The content match line buffer, allocated from the cycle arena once and shared by all checks in the cycle
+
+
+/* Out of band checks requested via http. The http thread flags the services, takes a ticket and waits, the validator runs the flagged checks and completes all tickets taken meanwhile, so the concurrent requests for the same service share one check. Guarded by Run.mutex */
+static struct {
+        unsigned long long requested;                       /**< The last ticket taken */
+        unsigned long long completed;                   /**< The last ticket completed */
+        unsigned int generation;     /**< Incremented when the requests were cancelled */
+        boolean_t serving;                /**< The validator runs and serves the requests */
+        int wakeup[2];           /**< Pipe to interrupt the validator sleep on request */
+        Sem_T done;                       /**< Signalled when the requests were handled */
+} checks = {.wakeup = {-1, -1}, .done = PTHREAD_COND_INITIALIZER};
+
+
 /* ----------------------------------------------------------------- Private */
 
 
+static Arena_T _cycleArena() {
+        if (! cycle)
+                cycle = Arena_new(0);
+        return cycle;
+}
+
+
+static void _resetCycleArena() {
+        Arena_reset(_cycleArena());
+        contentLine.buffer = NULL;
+        contentLine.size = 0;
+}
+
+
+static char *_contentLine() {
+        // Reallocate only if the limit was raised by reload since the buffer was allocated
+        if (contentLine.size < Run.limits.fileContentBuffer) {
+                contentLine.size = Run.limits.fileContentBuffer;
+                contentLine.buffer = Arena_alloc(_cycleArena(), contentLine.size);
+        }
+        return contentLine.buffer;
+}
+
+
+
 /**
- * Read program output into stringbuffer. Limit the output per Run.limits.programOutput
+ * Evaluate the exit status and output of the finished program against the
+ * status tests, post events and release the program's Process object
  */
-static void _programOutput(InputStream_T I, StringBuffer_T S) {
-        int n;
-        char buf[STRLEN];
-        InputStream_setTimeout(I, 0);
-        do {
-                n = InputStream_readBytes(I, buf, sizeof(buf) - 1);
-                if (n) {
-                        buf[n] = 0;
-                        StringBuffer_append(S, "%s", buf);
+static State_Type _programStatus(Service_T s) {
+        State_Type rv = State_Succeeded;
+        Process_T P = s->program->P;
+        s->program->exitStatus = Process_exitStatus(P); // Save exit status for web-view display
+        // Save program output
+        StringBuffer_clear(s->program->output);
+        StringBuffer_appendString(s->program->output, Process_getOutput(P));
+        StringBuffer_trim(s->program->output);
+        // Evaluate program's exit status against our status checks.
+        for (Status_T status = s->statuslist; status; status = status->next) {
+                if (status->operator == Operator_Changed) {
+                        if (status->initialized) {
+                                if (Util_evalQExpression(status->operator, s->program->exitStatus, status->return_value)) {
+                                        Event_post(s, Event_Status, State_Changed, status->action, "status changed (%d -> %d) -- %s", status->return_value, s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
+                                        status->return_value = s->program->exitStatus;
+                                } else {
+                                        Event_post(s, Event_Status, State_ChangedNot, status->action, "status didn't change (%d) -- %s", s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
+                                }
+                        } else {
+                                status->initialized = true;
+                                status->return_value = s->program->exitStatus;
+                        }
+                } else {
+                        if (Util_evalQExpression(status->operator, s->program->exitStatus, status->return_value)) {
+                                rv = State_Failed;
+                                Event_post(s, Event_Status, State_Failed, status->action, "status failed (%d) -- %s", s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
+                        } else {
+                                Event_post(s, Event_Status, State_Succeeded, status->action, "status succeeded (%d) -- %s", s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
+                        }
                 }
-        } while (n > 0 && StringBuffer_length(S) < Run.limits.programOutput);
+        }
+        Process_free(&s->program->P);
+        return rv;
 }
 
 
@@ -229,284 +307,555 @@ static State_Type _checkProcessPpid(Service_T s) {
 }
 
 
+/**
+ * Get the current value of the given resource. Returns false if the value is not available (yet)
+ */
+static boolean_t _getResourceValue(Service_T s, Resource_Type resource, double *value) {
+        switch (resource) {
+                case Resource_CpuPercent:
+                        if (s->type == Service_System) {
+                                *value =
+#ifdef HAVE_CPU_WAIT
+                                        (systeminfo.cpu.usage.wait > 0. ? systeminfo.cpu.usage.wait : 0.) +
+#endif
+                                        (systeminfo.cpu.usage.system > 0. ? systeminfo.cpu.usage.system : 0.) +
+                                        (systeminfo.cpu.usage.user > 0. ? systeminfo.cpu.usage.user : 0.);
+                        } else {
+                                *value = s->inf.process->cpu_percent;
+                        }
+                        return *value >= 0.;
+                case Resource_CpuPercentTotal:
+                        *value = s->inf.process->total_cpu_percent;
+                        return *value >= 0.;
+                case Resource_CpuUser:
+                        *value = systeminfo.cpu.usage.user;
+                        return *value >= 0.;
+                case Resource_CpuSystem:
+                        *value = systeminfo.cpu.usage.system;
+                        return *value >= 0.;
+                case Resource_CpuWait:
+                        *value = systeminfo.cpu.usage.wait;
+                        return *value >= 0.;
+                case Resource_MemoryPercent:
+                        *value = s->type == Service_System ? systeminfo.memory.usage.percent : s->inf.process->mem_percent;
+                        return *value >= 0.;
+                case Resource_MemoryKbyte:
+                        *value = s->type == Service_System ? systeminfo.memory.usage.bytes : s->inf.process->mem;
+                        return s->type == Service_System || *value > 0.;
+                case Resource_SwapPercent:
+                        *value = systeminfo.swap.usage.percent;
+                        return s->type == Service_System;
+                case Resource_SwapKbyte:
+                        *value = systeminfo.swap.usage.bytes;
+                        return s->type == Service_System;
+                case Resource_LoadAverage1m:
+                        *value = systeminfo.loadavg[0];
+                        return true;
+                case Resource_LoadAverage5m:
+                        *value = systeminfo.loadavg[1];
+                        return true;
+                case Resource_LoadAverage15m:
+                        *value = systeminfo.loadavg[2];
+                        return true;
+                case Resource_Threads:
+                        *value = s->inf.process->threads;
+                        return *value >= 0.;
+                case Resource_Children:
+                        *value = s->inf.process->children;
+                        return *value >= 0.;
+                case Resource_MemoryKbyteTotal:
+                        *value = s->inf.process->total_mem;
+                        return *value > 0.;
+                case Resource_MemoryPercentTotal:
+                        *value = s->inf.process->total_mem_percent;
+                        return *value >= 0.;
+                case Resource_ReadBytes:
+                        *value = Statistics_deltaNormalize(&(s->inf.process->read.bytes));
+                        return Statistics_initialized(&(s->inf.process->read.bytes));
+                case Resource_ReadOperations:
+                        *value = Statistics_deltaNormalize(&(s->inf.process->read.operations));
+                        return Statistics_initialized(&(s->inf.process->read.operations));
+                case Resource_WriteBytes:
+                        *value = Statistics_deltaNormalize(&(s->inf.process->write.bytes));
+                        return Statistics_initialized(&(s->inf.process->write.bytes));
+                case Resource_WriteOperations:
+                        *value = Statistics_deltaNormalize(&(s->inf.process->write.operations));
+                        return Statistics_initialized(&(s->inf.process->write.operations));
+                case Resource_MemoryAvailablePercent:
+                        *value = systeminfo.memory.available.percent;
+                        return systeminfo.memory.extended;
+                case Resource_MemoryAvailableKbyte:
+                        *value = systeminfo.memory.available.bytes;
+                        return systeminfo.memory.extended;
+                case Resource_MemoryDirty:
+                        *value = systeminfo.memory.dirty;
+                        return systeminfo.memory.extended;
+                case Resource_MemoryWriteback:
+                        *value = systeminfo.memory.writeback;
+                        return systeminfo.memory.extended;
+                case Resource_SlabUnreclaimable:
+                        *value = systeminfo.memory.slabUnreclaimable;
+                        return systeminfo.memory.extended;
+                case Resource_HugePagesPercent:
+                        *value = systeminfo.memory.hugepages.percent;
+                        return systeminfo.memory.extended;
+                case Resource_HugePagesKbyte:
+                        *value = systeminfo.memory.hugepages.bytes;
+                        return systeminfo.memory.extended;
+                case Resource_Inode:
+                        *value = s->inf.filesystem->inode_percent;
+                        return s->inf.filesystem->f_files > 0;
+                case Resource_InodeFree:
+                        *value = 100. - s->inf.filesystem->inode_percent;
+                        return s->inf.filesystem->f_files > 0;
+                case Resource_Space:
+                        *value = s->inf.filesystem->space_percent;
+                        return true;
+                case Resource_SpaceFree:
+                        *value = 100. - s->inf.filesystem->space_percent;
+                        return true;
+                default:
+                        return false;
+        }
+}
+
+
+static const char *_resourceName(Resource_Type resource) {
+        switch (resource) {
+                case Resource_CpuPercent:             return "cpu usage";
+                case Resource_CpuPercentTotal:        return "total cpu usage";
+                case Resource_CpuUser:                return "cpu user usage";
+                case Resource_CpuSystem:              return "cpu system usage";
+                case Resource_CpuWait:                return "cpu wait usage";
+                case Resource_MemoryPercent:          return "mem usage";
+                case Resource_MemoryKbyte:            return "mem amount";
+                case Resource_SwapPercent:            return "swap usage";
+                case Resource_SwapKbyte:              return "swap amount";
+                case Resource_LoadAverage1m:          return "loadavg(1min)";
+                case Resource_LoadAverage5m:          return "loadavg(5min)";
+                case Resource_LoadAverage15m:         return "loadavg(15min)";
+                case Resource_Threads:                return "threads";
+                case Resource_Children:               return "children";
+                case Resource_MemoryKbyteTotal:       return "total mem amount";
+                case Resource_MemoryPercentTotal:     return "total mem usage";
+                case Resource_ReadBytes:              return "read rate";
+                case Resource_ReadOperations:         return "read rate";
+                case Resource_WriteBytes:             return "write rate";
+                case Resource_WriteOperations:        return "write rate";
+                case Resource_MemoryAvailablePercent: return "available mem";
+                case Resource_MemoryAvailableKbyte:   return "available mem";
+                case Resource_MemoryDirty:            return "dirty mem";
+                case Resource_MemoryWriteback:        return "writeback mem";
+                case Resource_SlabUnreclaimable:      return "unreclaimable slab";
+                case Resource_HugePagesPercent:       return "hugepages usage";
+                case Resource_HugePagesKbyte:         return "hugepages amount";
+                case Resource_Inode:                  return "inode usage";
+                case Resource_InodeFree:              return "inode free";
+                case Resource_Space:                  return "space usage";
+                case Resource_SpaceFree:              return "space free";
+                default:                              return "resource";
+        }
+}
+
+
+static char *_formatResourceValue(Resource_Type resource, double value, char s[STRLEN]) {
+        switch (resource) {
+                case Resource_MemoryKbyte:
+                case Resource_SwapKbyte:
+                case Resource_MemoryKbyteTotal:
+                case Resource_MemoryAvailableKbyte:
+                case Resource_MemoryDirty:
+                case Resource_MemoryWriteback:
+                case Resource_SlabUnreclaimable:
+                case Resource_HugePagesKbyte:
+                        Str_bytesToSize(value, s);
+                        break;
+                case Resource_ReadBytes:
+                case Resource_WriteBytes:
+                        snprintf(s, STRLEN, "%s/s", Str_bytesToSize(value, (char[10]){}));
+                        break;
+                case Resource_ReadOperations:
+                case Resource_WriteOperations:
+                        snprintf(s, STRLEN, "%.1f operations/s", value);
+                        break;
+                case Resource_LoadAverage1m:
+                case Resource_LoadAverage5m:
+                case Resource_LoadAverage15m:
+                case Resource_Threads:
+                case Resource_Children:
+                        snprintf(s, STRLEN, "%.1f", value);
+                        break;
+                default:
+                        snprintf(s, STRLEN, "%.1f%%", value);
+                        break;
+        }
+        return s;
+}
+
+
+/**
+ * Add the current resource value to the resource time series and test the windowed aggregate
+ */
+static State_Type _checkAggregate(Service_T s, Resource_Type resource, Aggregate_T *aggregate, Operator_Type operator, double limit, EventAction_T action) {
+        double value;
+        if (! _getResourceValue(s, resource, &value)) {
+                DEBUG("'%s' %s check skipped (initializing)\n", s->name, _resourceName(resource));
+                return State_Init;
+        }
+        if (! aggregate->series)
+                aggregate->series = Series_new();
+        uint64_t now = Time_milli();
+        Series_add(aggregate->series, now, value);
+        boolean_t available;
+        switch (aggregate->type) {
+                case Aggregate_Minimum:
+                        available = Series_minimum(aggregate->series, now, aggregate->range, &value);
+                        break;
+                case Aggregate_Maximum:
+                        available = Series_maximum(aggregate->series, now, aggregate->range, &value);
+                        break;
+                default:
+                        available = Series_average(aggregate->series, now, aggregate->range, &value);
+                        break;
+        }
+        if (! available)
+                return State_Init;
+        char window[STRLEN], current[STRLEN], threshold[STRLEN];
+        const char *name = _resourceName(resource);
+        Util_aggregateToString(aggregate, window, sizeof(window));
+        _formatResourceValue(resource, value, current);
+        if (Util_evalDoubleQExpression(operator, value, limit)) {
+                Event_post(s, Event_Resource, State_Failed, action, "%s (%s) of %s matches resource limit [%s %s %s]", name, window, current, name, operatorshortnames[operator], _formatResourceValue(resource, limit, threshold));
+                return State_Failed;
+        }
+        Event_post(s, Event_Resource, State_Succeeded, action, "%s check succeeded [current %s (%s) = %s]", name, name, window, current);
+        return State_Succeeded;
+}
+
+
 /**
  * Check process resources
  */
 static State_Type _checkProcessResources(Service_T s, Resource_T r) {
         ASSERT(s);
         ASSERT(r);
+        if (r->aggregate.type != Aggregate_None)
+                return _checkAggregate(s, r->resource_id, &(r->aggregate), r->operator, r->limit, r->action);
         State_Type rv = State_Succeeded;
         char report[STRLEN] = {}, buf1[STRLEN], buf2[STRLEN];
+        double value;
+        boolean_t available = _getResourceValue(s, r->resource_id, &value);
         switch (r->resource_id) {
                 case Resource_CpuPercent:
-                        {
-                                float cpu;
-                                if (s->type == Service_System) {
-                                        cpu =
-#ifdef HAVE_CPU_WAIT
-                                                (systeminfo.cpu.usage.wait > 0. ? systeminfo.cpu.usage.wait : 0.) +
-#endif
-                                                (systeminfo.cpu.usage.system > 0. ? systeminfo.cpu.usage.system : 0.) +
-                                                (systeminfo.cpu.usage.user > 0. ? systeminfo.cpu.usage.user : 0.);
-                                } else {
-                                        cpu = s->inf.process->cpu_percent;
-                                }
-                                if (cpu < 0.) {
-                                        DEBUG("'%s' cpu usage check skipped (initializing)\n", s->name);
-                                        return State_Init;
-                                } else if (Util_evalDoubleQExpression(r->operator, cpu, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "cpu usage of %.1f%% matches resource limit [cpu usage %s %.1f%%]", cpu, operatorshortnames[r->operator], r->limit);
-                                } else {
-                                        snprintf(report, STRLEN, "cpu usage check succeeded [current cpu usage = %.1f%%]", cpu);
-                                }
+                        if (! available) {
+                                DEBUG("'%s' cpu usage check skipped (initializing)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "cpu usage of %.1f%% matches resource limit [cpu usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
+                        } else {
+                                snprintf(report, STRLEN, "cpu usage check succeeded [current cpu usage = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_CpuPercentTotal:
-                        if (s->inf.process->total_cpu_percent < 0.) {
+                        if (! available) {
                                 DEBUG("'%s' total cpu usage check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->total_cpu_percent, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "total cpu usage of %.1f%% matches resource limit [cpu usage %s %.1f%%]", s->inf.process->total_cpu_percent, operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "total cpu usage of %.1f%% matches resource limit [cpu usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "total cpu usage check succeeded [current cpu usage = %.1f%%]", s->inf.process->total_cpu_percent);
+                                snprintf(report, STRLEN, "total cpu usage check succeeded [current cpu usage = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_CpuUser:
-                        if (systeminfo.cpu.usage.user < 0.) {
+                        if (! available) {
                                 DEBUG("'%s' cpu user usage check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, systeminfo.cpu.usage.user, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "cpu user usage of %.1f%% matches resource limit [cpu user usage %s %.1f%%]", systeminfo.cpu.usage.user, operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "cpu user usage of %.1f%% matches resource limit [cpu user usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "cpu user usage check succeeded [current cpu user usage = %.1f%%]", systeminfo.cpu.usage.user);
+                                snprintf(report, STRLEN, "cpu user usage check succeeded [current cpu user usage = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_CpuSystem:
-                        if (systeminfo.cpu.usage.system < 0.) {
+                        if (! available) {
                                 DEBUG("'%s' cpu system usage check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, systeminfo.cpu.usage.system, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "cpu system usage of %.1f%% matches resource limit [cpu system usage %s %.1f%%]", systeminfo.cpu.usage.system, operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "cpu system usage of %.1f%% matches resource limit [cpu system usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "cpu system usage check succeeded [current cpu system usage = %.1f%%]", systeminfo.cpu.usage.system);
+                                snprintf(report, STRLEN, "cpu system usage check succeeded [current cpu system usage = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_CpuWait:
-                        if (systeminfo.cpu.usage.wait < 0.) {
+                        if (! available) {
                                 DEBUG("'%s' cpu wait usage check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, systeminfo.cpu.usage.wait, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "cpu wait usage of %.1f%% matches resource limit [cpu wait usage %s %.1f%%]", systeminfo.cpu.usage.wait, operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "cpu wait usage of %.1f%% matches resource limit [cpu wait usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "cpu wait usage check succeeded [current cpu wait usage = %.1f%%]", systeminfo.cpu.usage.wait);
+                                snprintf(report, STRLEN, "cpu wait usage check succeeded [current cpu wait usage = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_MemoryPercent:
-                        if (s->type == Service_System) {
-                                if (Util_evalDoubleQExpression(r->operator, systeminfo.memory.usage.percent, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "mem usage of %.1f%% matches resource limit [mem usage %s %.1f%%]", systeminfo.memory.usage.percent, operatorshortnames[r->operator], r->limit);
-                                } else {
-                                        snprintf(report, STRLEN, "mem usage check succeeded [current mem usage = %.1f%%]", systeminfo.memory.usage.percent);
-                                }
+                        if (! available) {
+                                DEBUG("'%s' memory usage check skipped (initializing)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "mem usage of %.1f%% matches resource limit [mem usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                if (s->inf.process->mem_percent < 0.) {
-                                        DEBUG("'%s' memory usage check skipped (initializing)\n", s->name);
-                                        return State_Init;
-                                } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->mem_percent, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "mem usage of %.1f%% matches resource limit [mem usage %s %.1f%%]", s->inf.process->mem_percent, operatorshortnames[r->operator], r->limit);
-                                } else {
-                                        snprintf(report, STRLEN, "mem usage check succeeded [current mem usage = %.1f%%]", s->inf.process->mem_percent);
-                                }
+                                snprintf(report, STRLEN, "mem usage check succeeded [current mem usage = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_MemoryKbyte:
-                        if (s->type == Service_System) {
-                                if (Util_evalDoubleQExpression(r->operator, systeminfo.memory.usage.bytes, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "mem amount of %s matches resource limit [mem amount %s %s]", Str_bytesToSize(systeminfo.memory.usage.bytes, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
-                                } else {
-                                        snprintf(report, STRLEN, "mem amount check succeeded [current mem amount = %s]", Str_bytesToSize(systeminfo.memory.usage.bytes, buf1));
-                                }
+                        if (! available) {
+                                DEBUG("'%s' process memory usage check skipped (initializing)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "mem amount of %s matches resource limit [mem amount %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
                         } else {
-                                if (s->inf.process->mem == 0) {
-                                        DEBUG("'%s' process memory usage check skipped (initializing)\n", s->name);
-                                        return State_Init;
-                                } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->mem, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "mem amount of %s matches resource limit [mem amount %s %s]", Str_bytesToSize(s->inf.process->mem, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
-                                } else {
-                                        snprintf(report, STRLEN, "mem amount check succeeded [current mem amount = %s]", Str_bytesToSize(s->inf.process->mem, buf1));
-                                }
+                                snprintf(report, STRLEN, "mem amount check succeeded [current mem amount = %s]", Str_bytesToSize(value, buf1));
                         }
                         break;
 
                 case Resource_SwapPercent:
-                        if (s->type == Service_System) {
-                                if (Util_evalDoubleQExpression(r->operator, systeminfo.swap.usage.percent, r->limit)) {
+                        if (available) {
+                                if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                         rv = State_Failed;
-                                        snprintf(report, STRLEN, "swap usage of %.1f%% matches resource limit [swap usage %s %.1f%%]", systeminfo.swap.usage.percent, operatorshortnames[r->operator], r->limit);
+                                        snprintf(report, STRLEN, "swap usage of %.1f%% matches resource limit [swap usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
                                 } else {
-                                        snprintf(report, STRLEN, "swap usage check succeeded [current swap usage = %.1f%%]", systeminfo.swap.usage.percent);
+                                        snprintf(report, STRLEN, "swap usage check succeeded [current swap usage = %.1f%%]", value);
                                 }
                         }
                         break;
 
                 case Resource_SwapKbyte:
-                        if (s->type == Service_System) {
-                                if (Util_evalDoubleQExpression(r->operator, systeminfo.swap.usage.bytes, r->limit)) {
+                        if (available) {
+                                if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                         rv = State_Failed;
-                                        snprintf(report, STRLEN, "swap amount of %s matches resource limit [swap amount %s %s]", Str_bytesToSize(systeminfo.swap.usage.bytes, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                                        snprintf(report, STRLEN, "swap amount of %s matches resource limit [swap amount %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
                                 } else {
-                                        snprintf(report, STRLEN, "swap amount check succeeded [current swap amount = %s]", Str_bytesToSize(systeminfo.swap.usage.bytes, buf1));
+                                        snprintf(report, STRLEN, "swap amount check succeeded [current swap amount = %s]", Str_bytesToSize(value, buf1));
                                 }
                         }
                         break;
 
                 case Resource_LoadAverage1m:
-                        if (Util_evalDoubleQExpression(r->operator, systeminfo.loadavg[0], r->limit)) {
+                        if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "loadavg(1min) of %.1f matches resource limit [loadavg(1min) %s %.1f]", systeminfo.loadavg[0], operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "loadavg(1min) of %.1f matches resource limit [loadavg(1min) %s %.1f]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "loadavg(1min) check succeeded [current loadavg(1min) = %.1f]", systeminfo.loadavg[0]);
+                                snprintf(report, STRLEN, "loadavg(1min) check succeeded [current loadavg(1min) = %.1f]", value);
                         }
                         break;
 
                 case Resource_LoadAverage5m:
-                        if (Util_evalDoubleQExpression(r->operator, systeminfo.loadavg[1], r->limit)) {
+                        if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "loadavg(5min) of %.1f matches resource limit [loadavg(5min) %s %.1f]", systeminfo.loadavg[1], operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "loadavg(5min) of %.1f matches resource limit [loadavg(5min) %s %.1f]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "loadavg(5min) check succeeded [current loadavg(5min) = %.1f]", systeminfo.loadavg[1]);
+                                snprintf(report, STRLEN, "loadavg(5min) check succeeded [current loadavg(5min) = %.1f]", value);
                         }
                         break;
 
                 case Resource_LoadAverage15m:
-                        if (Util_evalDoubleQExpression(r->operator, systeminfo.loadavg[2], r->limit)) {
+                        if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "loadavg(15min) of %.1f matches resource limit [loadavg(15min) %s %.1f]", systeminfo.loadavg[2], operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "loadavg(15min) of %.1f matches resource limit [loadavg(15min) %s %.1f]", value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "loadavg(15min) check succeeded [current loadavg(15min) = %.1f]", systeminfo.loadavg[2]);
+                                snprintf(report, STRLEN, "loadavg(15min) check succeeded [current loadavg(15min) = %.1f]", value);
                         }
                         break;
 
                 case Resource_Threads:
-                        if (s->inf.process->threads < 0) {
+                        if (! available) {
                                 DEBUG("'%s' process threads count check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->threads, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "threads count %i matches resource limit [threads %s %.0f]", s->inf.process->threads, operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "threads count %i matches resource limit [threads %s %.0f]", (int)value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "threads check succeeded [current threads = %i]", s->inf.process->threads);
+                                snprintf(report, STRLEN, "threads check succeeded [current threads = %i]", (int)value);
                         }
                         break;
 
                 case Resource_Children:
-                        if (s->inf.process->children < 0) {
+                        if (! available) {
                                 DEBUG("'%s' process children count check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->children, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "children count %i matches resource limit [children %s %.0f]", s->inf.process->children, operatorshortnames[r->operator], r->limit);
+                                snprintf(report, STRLEN, "children count %i matches resource limit [children %s %.0f]", (int)value, operatorshortnames[r->operator], r->limit);
                         } else {
-                                snprintf(report, STRLEN, "children check succeeded [current children = %i]", s->inf.process->children);
+                                snprintf(report, STRLEN, "children check succeeded [current children = %i]", (int)value);
                         }
                         break;
 
                 case Resource_MemoryKbyteTotal:
-                        if (s->inf.process->total_mem == 0) {
+                        if (! available) {
                                 DEBUG("'%s' process total memory usage check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->total_mem, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "total mem amount of %s matches resource limit [total mem amount %s %s]", Str_bytesToSize(s->inf.process->total_mem, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                                snprintf(report, STRLEN, "total mem amount of %s matches resource limit [total mem amount %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
                         } else {
-                                snprintf(report, STRLEN, "total mem amount check succeeded [current total mem amount = %s]", Str_bytesToSize(s->inf.process->total_mem, buf1));
+                                snprintf(report, STRLEN, "total mem amount check succeeded [current total mem amount = %s]", Str_bytesToSize(value, buf1));
                         }
                         break;
 
                 case Resource_MemoryPercentTotal:
-                        if (s->inf.process->total_mem_percent < 0.) {
+                        if (! available) {
                                 DEBUG("'%s' total memory usage check skipped (initializing)\n", s->name);
                                 return State_Init;
-                        } else if (Util_evalDoubleQExpression(r->operator, s->inf.process->total_mem_percent, r->limit)) {
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
                                 rv = State_Failed;
-                                snprintf(report, STRLEN, "total mem amount of %.1f%% matches resource limit [total mem amount %s %.1f%%]", (float)s->inf.process->total_mem_percent, operatorshortnames[r->operator], (float)r->limit);
+                                snprintf(report, STRLEN, "total mem amount of %.1f%% matches resource limit [total mem amount %s %.1f%%]", (float)value, operatorshortnames[r->operator], (float)r->limit);
                         } else {
-                                snprintf(report, STRLEN, "total mem amount check succeeded [current total mem amount = %.1f%%]", s->inf.process->total_mem_percent);
+                                snprintf(report, STRLEN, "total mem amount check succeeded [current total mem amount = %.1f%%]", value);
                         }
                         break;
 
                 case Resource_ReadBytes:
-                        if (Statistics_initialized(&(s->inf.process->read.bytes))) {
-                                double value = Statistics_deltaNormalize(&(s->inf.process->read.bytes));
-                                if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "read rate %s/s matches resource limit [read %s %s/s]", Str_bytesToSize(value, (char[10]){}), operatorshortnames[r->operator], Str_bytesToSize(r->limit, (char[10]){}));
-                                } else {
-                                        snprintf(report, STRLEN, "read rate test succeeded [current read = %s/s]", Str_bytesToSize(value, (char[10]){}));
-                                }
-                        } else {
+                        if (! available) {
                                 DEBUG("'%s' warning -- no data are available for bytes read rate test\n", s->name);
                                 return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "read rate %s/s matches resource limit [read %s %s/s]", Str_bytesToSize(value, (char[10]){}), operatorshortnames[r->operator], Str_bytesToSize(r->limit, (char[10]){}));
+                        } else {
+                                snprintf(report, STRLEN, "read rate test succeeded [current read = %s/s]", Str_bytesToSize(value, (char[10]){}));
                         }
                         break;
 
                 case Resource_ReadOperations:
-                        if (Statistics_initialized(&(s->inf.process->read.operations))) {
-                                double value = Statistics_deltaNormalize(&(s->inf.process->read.operations));
-                                if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "read rate %.1f operations/s matches resource limit [read %s %.0f operations/s]", value, operatorshortnames[r->operator], r->limit);
-                                } else {
-                                        snprintf(report, STRLEN, "read rate test succeeded [current read = %.1f operations/s]", value);
-                                }
-                        } else {
+                        if (! available) {
                                 DEBUG("'%s' warning -- no data are available for read rate test\n", s->name);
                                 return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "read rate %.1f operations/s matches resource limit [read %s %.0f operations/s]", value, operatorshortnames[r->operator], r->limit);
+                        } else {
+                                snprintf(report, STRLEN, "read rate test succeeded [current read = %.1f operations/s]", value);
                         }
                         break;
 
                 case Resource_WriteBytes:
-                        if (Statistics_initialized(&(s->inf.process->write.bytes))) {
-                                double value = Statistics_deltaNormalize(&(s->inf.process->write.bytes));
-                                if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "write rate %s/s matches resource limit [write %s %s/s]", Str_bytesToSize(value, (char[10]){}), operatorshortnames[r->operator], Str_bytesToSize(r->limit, (char[10]){}));
-                                } else {
-                                        snprintf(report, STRLEN, "write rate test succeeded [current write = %s/s]", Str_bytesToSize(value, (char[10]){}));
-                                }
-                        } else {
+                        if (! available) {
                                 DEBUG("'%s' warning -- no data are available for bytes write rate test\n", s->name);
                                 return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "write rate %s/s matches resource limit [write %s %s/s]", Str_bytesToSize(value, (char[10]){}), operatorshortnames[r->operator], Str_bytesToSize(r->limit, (char[10]){}));
+                        } else {
+                                snprintf(report, STRLEN, "write rate test succeeded [current write = %s/s]", Str_bytesToSize(value, (char[10]){}));
                         }
                         break;
 
                 case Resource_WriteOperations:
-                        if (Statistics_initialized(&(s->inf.process->write.operations))) {
-                                double value = Statistics_deltaNormalize(&(s->inf.process->write.operations));
-                                if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
-                                        rv = State_Failed;
-                                        snprintf(report, STRLEN, "write rate %.1f operations/s matches resource limit [write %s %.0f operations/s]", value, operatorshortnames[r->operator], r->limit);
-                                } else {
-                                        snprintf(report, STRLEN, "write rate test succeeded [current write = %.1f operations/s]", value);
-                                }
-                        } else {
+                        if (! available) {
                                 DEBUG("'%s' warning -- no data are available for write rate test\n", s->name);
                                 return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "write rate %.1f operations/s matches resource limit [write %s %.0f operations/s]", value, operatorshortnames[r->operator], r->limit);
+                        } else {
+                                snprintf(report, STRLEN, "write rate test succeeded [current write = %.1f operations/s]", value);
+                        }
+                        break;
+
+                case Resource_MemoryAvailablePercent:
+                        if (! available) {
+                                DEBUG("'%s' available mem check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "available mem of %.1f%% matches resource limit [available mem %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
+                        } else {
+                                snprintf(report, STRLEN, "available mem check succeeded [current available mem = %.1f%%]", value);
+                        }
+                        break;
+
+                case Resource_MemoryAvailableKbyte:
+                        if (! available) {
+                                DEBUG("'%s' available mem check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "available mem of %s matches resource limit [available mem %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                        } else {
+                                snprintf(report, STRLEN, "available mem check succeeded [current available mem = %s]", Str_bytesToSize(value, buf1));
+                        }
+                        break;
+
+                case Resource_MemoryDirty:
+                        if (! available) {
+                                DEBUG("'%s' dirty mem check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "dirty mem of %s matches resource limit [dirty mem %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                        } else {
+                                snprintf(report, STRLEN, "dirty mem check succeeded [current dirty mem = %s]", Str_bytesToSize(value, buf1));
+                        }
+                        break;
+
+                case Resource_MemoryWriteback:
+                        if (! available) {
+                                DEBUG("'%s' writeback mem check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "writeback mem of %s matches resource limit [writeback mem %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                        } else {
+                                snprintf(report, STRLEN, "writeback mem check succeeded [current writeback mem = %s]", Str_bytesToSize(value, buf1));
+                        }
+                        break;
+
+                case Resource_SlabUnreclaimable:
+                        if (! available) {
+                                DEBUG("'%s' unreclaimable slab check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "unreclaimable slab of %s matches resource limit [unreclaimable slab %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                        } else {
+                                snprintf(report, STRLEN, "unreclaimable slab check succeeded [current unreclaimable slab = %s]", Str_bytesToSize(value, buf1));
+                        }
+                        break;
+
+                case Resource_HugePagesPercent:
+                        if (! available) {
+                                DEBUG("'%s' hugepages usage check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "hugepages usage of %.1f%% matches resource limit [hugepages usage %s %.1f%%]", value, operatorshortnames[r->operator], r->limit);
+                        } else {
+                                snprintf(report, STRLEN, "hugepages usage check succeeded [current hugepages usage = %.1f%%]", value);
+                        }
+                        break;
+
+                case Resource_HugePagesKbyte:
+                        if (! available) {
+                                DEBUG("'%s' hugepages amount check skipped (not available)\n", s->name);
+                                return State_Init;
+                        } else if (Util_evalDoubleQExpression(r->operator, value, r->limit)) {
+                                rv = State_Failed;
+                                snprintf(report, STRLEN, "hugepages amount of %s matches resource limit [hugepages amount %s %s]", Str_bytesToSize(value, buf1), operatorshortnames[r->operator], Str_bytesToSize(r->limit, buf2));
+                        } else {
+                                snprintf(report, STRLEN, "hugepages amount check succeeded [current hugepages amount = %s]", Str_bytesToSize(value, buf1));
                         }
                         break;
 
@@ -804,11 +1153,10 @@ static State_Type _checkMatch(Service_T s) {
                         LogError("'%s' cannot open file %s: %s\n", s->name, s->path, STRERROR);
                         return State_Failed;
                 }
-                /* FIXME: Refactor: Initialize the filesystems table ahead of file and filesystems test and index it by device id + replace the Str_startsWith() with lookup to the table by device id (obtained via file's stat()).
-                 The central filesystems initialization will allow to reduce the statfs() calls in the case that there will be multiple file and/or filesystems tests for the same fs. Temporarily we go with
-                 dummy Str_startsWith() as quick fix which will cover 99.9% of use cases without rising the statfs overhead if statfs call would be inlined here.
-                 */
-                if (Str_startsWith(s->path, "/proc")) {
+                /* Pseudo filesystems (procfs, sysfs) report zero size and the content is generated on each read, so always read the whole file. The filesystem type is looked up in the shared
+                 mount table by the file's device id, if the table is not available fallback to the path prefix */
+                const char *fstype = Filesystem_getTypeByDeviceId(s->inf.file->device);
+                if (fstype ? (IS(fstype, "proc") || IS(fstype, "sysfs")) : Str_startsWith(s->path, "/proc")) {
                         s->inf.file->readpos = 0;
                 } else {
                         /* If inode changed or size shrinked -> set read position = 0 */
@@ -817,40 +1165,40 @@ static State_Type _checkMatch(Service_T s) {
                         /* Do we need to match? Even if not, go to final, so we can reset the content match error flags in this cycle */
                         if (s->inf.file->readpos == s->inf.file->size) {
                                 DEBUG("'%s' content match skipped - file size nor inode has not changed since last test\n", s->name);
-                                goto final1;
+                                goto final;
                         }
                 }
-                char *line = CALLOC(sizeof(unsigned char), Run.limits.fileContentBuffer);
+                char *line = _contentLine();
                 while (true) {
 next:
                         /* Seek to the read position */
                         if (fseek(file, (long)s->inf.file->readpos, SEEK_SET)) {
                                 rv = State_Failed;
                                 LogError("'%s' cannot seek file %s: %s\n", s->name, s->path, STRERROR);
-                                goto final2;
+                                goto final;
                         }
                         if (! fgets(line, Run.limits.fileContentBuffer, file)) {
                                 if (! feof(file)) {
                                         rv = State_Failed;
                                         LogError("'%s' cannot read file %s: %s\n", s->name, s->path, STRERROR);
                                 }
-                                goto final2;
+                                goto final;
                         }
                         size_t length = strlen(line);
                         if (length == 0) {
                                 /* No content: shouldn't happen - empty line will contain at least '\n' */
-                                goto final2;
+                                goto final;
                         } else if (line[length - 1] != '\n') {
                                 if (length < Run.limits.fileContentBuffer - 1) {
                                         /* Incomplete line: we gonna read it next time again, allowing the writer to complete the write */
                                         DEBUG("'%s' content match: incomplete line read - no new line at end. (retrying next cycle)\n", s->name);
-                                        goto final2;
+                                        goto final;
                                 } else if (length >= Run.limits.fileContentBuffer - 1) {
                                         /* Our read buffer is full: ignore the content past the Run.limits.fileContentBuffer */
                                         int _rv;
                                         do {
                                                 if ((_rv = fgetc(file)) == EOF)
-                                                        goto final2;
+                                                        goto final;
                                                 length++;
                                         } while (_rv != '\n');
                                 }
@@ -885,9 +1233,7 @@ next:
                                 }
                         }
                 }
-final2:
-                FREE(line);
-final1:
+final:
                 if (fclose(file)) {
                         rv = State_Failed;
                         LogError("'%s' cannot close file %s: %s\n", s->name, s->path, STRERROR);
@@ -937,6 +1283,8 @@ static State_Type _checkFilesystemResources(Service_T s, FileSystem_T td) {
                 LogError("'%s' error: filesystem limit not set\n", s->name);
                 return State_Failed;
         }
+        if (td->aggregate.type != Aggregate_None)
+                return _checkAggregate(s, td->resource, &(td->aggregate), td->operator, td->limit_percent, td->action);
         switch (td->resource) {
 
                 case Resource_Inode:
@@ -1087,17 +1435,21 @@ static State_Type _checkFilesystemResources(Service_T s, FileSystem_T td) {
                                         DEBUG("'%s' warning -- no data are available for service time test\n", s->name);
                                         return State_Succeeded;
                                 }
-                                if (hasReadTime) {
-                                        deltaTime += Statistics_delta(&(s->inf.filesystem->time.read));
-                                }
-                                if (hasWriteTime) {
-                                        deltaTime += Statistics_delta(&(s->inf.filesystem->time.write));
-                                }
-                                if (hasWaitTime) {
-                                        deltaTime += Statistics_delta(&(s->inf.filesystem->time.wait));
-                                }
-                                if (hasRunTime) {
-                                        deltaTime += Statistics_delta(&(s->inf.filesystem->time.run));
+                                if (hasReadTime || hasWriteTime) {
+                                        // The wait/run times overlap with the R/W times on platforms which provide both (Linux), use them only if the R/W times are not available
+                                        if (hasReadTime) {
+                                                deltaTime += Statistics_delta(&(s->inf.filesystem->time.read));
+                                        }
+                                        if (hasWriteTime) {
+                                                deltaTime += Statistics_delta(&(s->inf.filesystem->time.write));
+                                        }
+                                } else {
+                                        if (hasWaitTime) {
+                                                deltaTime += Statistics_delta(&(s->inf.filesystem->time.wait));
+                                        }
+                                        if (hasRunTime) {
+                                                deltaTime += Statistics_delta(&(s->inf.filesystem->time.run));
+                                        }
                                 }
                                 double deltaOperations = Statistics_delta(&(s->inf.filesystem->read.operations)) + Statistics_delta(&(s->inf.filesystem->write.operations));
                                 double serviceTime = deltaOperations > 0. ? deltaTime / deltaOperations : 0.;
@@ -1148,6 +1500,24 @@ static boolean_t _incron(Service_T s, time_t now) {
 }
 
 
+/**
+ * Returns true if validation should be skiped for this service because a required service is not initialized or has errors
+ */
+static boolean_t _checkParents(Service_T s) {
+        for (Dependant_T d = s->dependantlist; d; d = d->next ) {
+                Service_T parent = d->service;
+                if (parent->monitor != Monitor_Yes) {
+                        DEBUG("'%s' test skipped as required service '%s' is %s\n", s->name, parent->name, parent->monitor == Monitor_Init ? "initializing" : "not monitored");
+                        return true;
+                } else if (parent->error) {
+                        DEBUG("'%s' test skipped as required service '%s' has errors\n", s->name, parent->name);
+                        return true;
+                }
+        }
+        return false;
+}
+
+
 /**
  * Returns true if validation should be skiped for this service in this cycle, otherwise false. Handle every statement
  */
@@ -1172,18 +1542,7 @@ static boolean_t _checkSkip(Service_T s) {
                 return true;
         }
         s->monitor &= ~Monitor_Waiting;
-        // Skip if parent is not initialized
-        for (Dependant_T d = s->dependantlist; d; d = d->next ) {
-                Service_T parent = Util_getService(d->dependant);
-                if (parent->monitor != Monitor_Yes) {
-                        DEBUG("'%s' test skipped as required service '%s' is %s\n", s->name, parent->name, parent->monitor == Monitor_Init ? "initializing" : "not monitored");
-                        return true;
-                } else if (parent->error) {
-                        DEBUG("'%s' test skipped as required service '%s' has errors\n", s->name, parent->name);
-                        return true;
-                }
-        }
-        return false;
+        return _checkParents(s);
 }
 
 
@@ -1192,16 +1551,89 @@ static boolean_t _checkSkip(Service_T s) {
  */
 static boolean_t _doScheduledAction(Service_T s) {
         int rv = false;
-        Action_Type action = s->doaction;
-        if (action != Action_Ignored) {
-                rv = control_service(s->name, action);
-                Event_post(s, Event_Action, State_Changed, s->action_ACTION, "%s action %s", actionnames[action], rv ? "done" : "failed");
-                FREE(s->token);
+        Action_Type action = __atomic_load_n(&s->doaction, __ATOMIC_ACQUIRE); // Set by the http thread
+        if (action != Action_Ignored && ! s->busy) {
+                // The start, stop and restart actions run in the background, the action event is posted when done. Action requested for a busy service is postponed until the running action finishes
+                control_schedule(s, action, true);
+                rv = true;
         }
         return rv;
 }
 
 
+/**
+ * Run the service check and record its duration
+ */
+static State_Type _checkService(Service_T s) {
+        uint64_t started = Time_micro();
+        State_Type state = s->check(s);
+        uint64_t finished = Time_micro();
+        Profile_record(&s->timing, finished > started ? finished - started : 0);
+        if (state != State_Init && s->monitor != Monitor_Not) // The monitoring can be disabled by some matching rule in s->check so we have to check again before setting to Monitor_Yes
+                s->monitor = Monitor_Yes;
+        return state;
+}
+
+
+/**
+ * Flag the service and the services it depends on for the out of band check. The service list is sorted by dependencies, so the required services are checked first
+ */
+static void _requestCheck(Service_T s) {
+        if (! __atomic_exchange_n(&s->checkRequested, true, __ATOMIC_RELAXED))
+                for (Dependant_T d = s->dependantlist; d; d = d->next)
+                        _requestCheck(d->service);
+}
+
+
+/**
+ * Returns true if the service and the services it depends on are monitored and have no errors
+ */
+static boolean_t _isVerified(Service_T s) {
+        if (s->monitor != Monitor_Yes || s->error)
+                return false;
+        for (Dependant_T d = s->dependantlist; d; d = d->next)
+                if (! _isVerified(d->service))
+                        return false;
+        return true;
+}
+
+
+/**
+ * Run the checks requested via http out of band and wake up the waiting http thread. The system and process data are refreshed first, so the checks see the current state
+ */
+static void _checkRequested() {
+        RUN_CLEAR(Run_CheckPending);
+        unsigned long long ticket = __atomic_load_n(&checks.requested, __ATOMIC_ACQUIRE);
+        boolean_t refreshed = false;
+        for (Service_T s = servicelist; s && ! (Run.flags & Run_Stopped); s = s->next) {
+                if (__atomic_exchange_n(&s->checkRequested, false, __ATOMIC_RELAXED)) {
+                        if (! refreshed) {
+                                update_system_info();
+                                ProcessTree_init(ProcessEngine_None);
+                                // New collection cycle: the per-cycle caches (e.g. the disk statistics table) are keyed on it
+                                gettimeofday(&systeminfo.collected, NULL);
+                                Snapshot_publishSystem();
+                                refreshed = true;
+                        }
+                        if (s->busy || s->monitor == Monitor_Not) {
+                                DEBUG("'%s' requested test skipped as the service is %s\n", s->name, s->busy ? "busy" : "not monitored");
+                        } else if (! _checkParents(s)) {
+                                _checkService(s);
+                                gettimeofday(&s->collected, NULL);
+                                Snapshot_publish(s);
+                        }
+                }
+        }
+        LOCK(Run.mutex)
+        {
+                if (checks.completed < ticket)
+                        checks.completed = ticket;
+                Sem_broadcast(checks.done);
+        }
+        END_LOCK;
+}
+
+
 /* ---------------------------------------------------------------- Public */
 
 
@@ -1211,16 +1643,33 @@ static boolean_t _doScheduledAction(Service_T s) {
  *  they will pass all defined tests.
  */
 int validate() {
+        if (checks.wakeup[0] < 0) {
+                if (pipe(checks.wakeup) < 0) {
+                        LogError("Cannot create the check request pipe -- %s\n", STRERROR);
+                } else {
+                        for (int i = 0; i < 2; i++) {
+                                Net_setNonBlocking(checks.wakeup[i]);
+                                fcntl(checks.wakeup[i], F_SETFD, FD_CLOEXEC);
+                        }
+                }
+        }
+        __atomic_store_n(&checks.serving, true, __ATOMIC_RELEASE);
+        _resetCycleArena();
         Run.handler_flag = Handler_Succeeded;
         Event_queue_process();
+        control_progress();
+        Profile_phase(Phase_Events);
 
         update_system_info();
+        Snapshot_publishSystem();
+        Profile_phase(Phase_SystemInfo);
         ProcessTree_init(ProcessEngine_None);
+        Profile_phase(Phase_ProcessTree);
         gettimeofday(&systeminfo.collected, NULL);
 
         /* In the case that at least one action is pending, perform quick loop to handle the actions ASAP */
         if (Run.flags & Run_ActionPending) {
-                Run.flags &= ~Run_ActionPending;
+                RUN_CLEAR(Run_ActionPending);
                 for (Service_T s = servicelist; s; s = s->next)
                         _doScheduledAction(s);
         }
@@ -1230,23 +1679,140 @@ int validate() {
         for (Service_T s = servicelist; s; s = s->next) {
                 if (Run.flags & Run_Stopped)
                         break;
+                if (Run.flags & Run_CheckPending)
+                        _checkRequested();
                 // FIXME: The Service_Program must collect the exit value from last run, even if the program start should be skipped in this cycle => let check program always run the test (to be refactored with new scheduler)
-                if (! _doScheduledAction(s) && s->monitor && (s->type == Service_Program || ! _checkSkip(s))) {
+                if (! _doScheduledAction(s) && ! s->busy && s->monitor && (s->type == Service_Program || ! _checkSkip(s))) {
                         _checkTimeout(s); // Can disable monitoring => need to check s->monitor again
                         if (s->monitor) {
-                                State_Type state = s->check(s);
-                                if (state != State_Init && s->monitor != Monitor_Not) // The monitoring can be disabled by some matching rule in s->check so we have to check again before setting to Monitor_Yes
-                                        s->monitor = Monitor_Yes;
-                                if (state == State_Failed)
+                                // The check satisfies the pending out of band request for the service as well
+                                __atomic_store_n(&s->checkRequested, false, __ATOMIC_RELAXED);
+                                profile.counters.checked++;
+                                if (_checkService(s) == State_Failed)
                                         errors++;
                         }
                         gettimeofday(&s->collected, NULL);
+                        Snapshot_publish(s);
+                } else {
+                        profile.counters.skipped++;
                 }
         }
+        Profile_phase(Phase_Checks);
         return errors;
 }
 
 
+/**
+ * Sleep between the validation cycles. The output of running check programs
+ * is collected meanwhile and the status of a program is evaluated as soon as
+ * it exits, instead of in the next cycle. Start, stop and restart actions in
+ * progress are advanced as well and the checks requested via http are run.
+ * Returns after the given number of seconds or earlier if interrupted by a
+ * signal
+ */
+void validate_sleep(int seconds) {
+        int size = 0;
+        Service_T *service = NULL;
+        Process_T *process = NULL;
+        long long deadline = Time_milli() + seconds * 1000LL;
+        while (! (Run.flags & (Run_Stopped | Run_ActionPending | Run_DoReload | Run_DoWakeup))) {
+                // Drain the wakeups before testing the flag, a request set after the test writes a new one
+                for (char buf[64]; checks.wakeup[0] >= 0 && read(checks.wakeup[0], buf, sizeof(buf)) > 0;)
+                        ;
+                if (Run.flags & Run_CheckPending)
+                        _checkRequested();
+                control_progress();
+                long long remaining = deadline - Time_milli();
+                if (remaining <= 0)
+                        break;
+                int programs = 0;
+                for (Service_T s = servicelist; s; s = s->next)
+                        if (s->type == Service_Program && s->program->P && s->monitor != Monitor_Not && ! s->busy)
+                                programs++;
+                int count = programs + control_programs(NULL, 0);
+                int interval = control_interval();
+                // Wait for the programs, the next step of the actions in progress or the deadline. A signal or a check request (see validate_services()) interrupts the wait
+                int timeout = interval >= 0 && interval < remaining ? interval : (int)remaining;
+                if (count > size) {
+                        size = count;
+                        RESIZE(service, size * sizeof(Service_T));
+                        RESIZE(process, size * sizeof(Process_T));
+                }
+                programs = 0;
+                for (Service_T s = servicelist; s; s = s->next) {
+                        if (s->type == Service_Program && s->program->P && s->monitor != Monitor_Not && ! s->busy) {
+                                service[programs] = s;
+                                process[programs++] = s->program->P;
+                        }
+                }
+                control_programs(process + programs, count - programs);
+                if (Process_collectAllOrReadable(process, count, Run.limits.programOutput, timeout, checks.wakeup[0])) {
+                        for (int i = 0; i < programs; i++) {
+                                if (Process_exitStatus(process[i]) >= 0) {
+                                        _programStatus(service[i]);
+                                        if (service[i]->monitor != Monitor_Not) // The status evaluation may disable service monitoring
+                                                service[i]->monitor = Monitor_Yes;
+                                        gettimeofday(&service[i]->collected, NULL);
+                                        Snapshot_publish(service[i]);
+                                }
+                        }
+                }
+        }
+        FREE(process);
+        FREE(service);
+}
+
+
+/**
+ * Check the given services and the services they depend on now, out of
+ * band of the validation cycle, and wait for the results. Called by the
+ * http thread with Run.mutex locked. The lock is released while waiting.
+ * A service which is already flagged by another request is checked only
+ * once, a service checked by the running cycle meanwhile is not checked
+ * again. Returns the number of the given services which are not monitored,
+ * failed, or depend on a failed service, or -1 if the requests were
+ * cancelled by reload or stop, the services must not be used then
+ */
+int validate_services(List_T services) {
+        ASSERT(services);
+        if (! __atomic_load_n(&checks.serving, __ATOMIC_ACQUIRE))
+                return -1;
+        for (list_t m = services->head; m; m = m->next)
+                _requestCheck(m->e);
+        unsigned long long ticket = __atomic_add_fetch(&checks.requested, 1, __ATOMIC_RELEASE);
+        unsigned int generation = checks.generation;
+        RUN_SET(Run_CheckPending);
+        // The validator polls the flag between the checks, the sleep is interrupted via the pipe
+        if (checks.wakeup[1] >= 0 && write(checks.wakeup[1], "", 1) < 0 && errno != EAGAIN)
+                LogError("Cannot wake up the validator -- %s\n", STRERROR);
+        while (checks.completed < ticket && checks.generation == generation)
+                Sem_wait(checks.done, Run.mutex);
+        if (checks.generation != generation)
+                return -1;
+        int failed = 0;
+        for (list_t m = services->head; m; m = m->next)
+                if (! _isVerified(m->e))
+                        failed++;
+        return failed;
+}
+
+
+/**
+ * Cancel the waiting out of band check requests and refuse new ones until
+ * the next validation cycle starts. Called by the validator before reload
+ * and stop
+ */
+void validate_cancel() {
+        LOCK(Run.mutex)
+        {
+                checks.serving = false;
+                checks.generation++;
+                Sem_broadcast(checks.done);
+        }
+        END_LOCK;
+}
+
+
 /**
  * Validate a given process service s. Events are posted according to
  * its configuration. In case of a fatal event false is returned.
@@ -1397,6 +1963,7 @@ State_Type check_file(Service_T s) {
                         s->inf.file->inode_prev = stat_buf.st_ino;
                 }
                 s->inf.file->inode = stat_buf.st_ino;
+                s->inf.file->device = stat_buf.st_dev;
                 s->inf.file->uid = stat_buf.st_uid;
                 s->inf.file->gid = stat_buf.st_gid;
                 s->inf.file->size = stat_buf.st_size;
@@ -1540,13 +2107,14 @@ State_Type check_program(Service_T s) {
         time_t now = Time_now();
         Process_T P = s->program->P;
         if (P) {
-                if (Process_exitStatus(P) < 0) { // Program is still running
+                if (! Process_collect(P, Run.limits.programOutput, 0)) { // Program is still running
                         int64_t execution_time = (now - s->program->started) * 1000;
                         if (execution_time > s->program->timeout) { // Program timed out
                                 rv = State_Failed;
                                 LogError("'%s' program timed out after %s. Killing program with pid %ld\n", s->name, Str_milliToTime(execution_time, (char[23]){}), (long)Process_getPid(P));
                                 Process_kill(P);
                                 Process_waitFor(P); // Wait for child to exit to get correct exit value
+                                Process_collect(P, Run.limits.programOutput, 0);
                                 // Fall-through with P and evaluate exit value below.
                         } else {
                                 // Defer test of exit value until program exit or timeout
@@ -1554,36 +2122,8 @@ State_Type check_program(Service_T s) {
                                 return State_Init;
                         }
                 }
-                s->program->exitStatus = Process_exitStatus(P); // Save exit status for web-view display
-                // Save program output
-                StringBuffer_clear(s->program->output);
-                _programOutput(Process_getErrorStream(P), s->program->output);
-                _programOutput(Process_getInputStream(P), s->program->output);
-                StringBuffer_trim(s->program->output);
-                // Evaluate program's exit status against our status checks.
-                for (Status_T status = s->statuslist; status; status = status->next) {
-                        if (status->operator == Operator_Changed) {
-                                if (status->initialized) {
-                                        if (Util_evalQExpression(status->operator, s->program->exitStatus, status->return_value)) {
-                                                Event_post(s, Event_Status, State_Changed, status->action, "status changed (%d -> %d) -- %s", status->return_value, s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
-                                                status->return_value = s->program->exitStatus;
-                                        } else {
-                                                Event_post(s, Event_Status, State_ChangedNot, status->action, "status didn't change (%d) -- %s", s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
-                                        }
-                                } else {
-                                        status->initialized = true;
-                                        status->return_value = s->program->exitStatus;
-                                }
-                        } else {
-                                if (Util_evalQExpression(status->operator, s->program->exitStatus, status->return_value)) {
-                                        rv = State_Failed;
-                                        Event_post(s, Event_Status, State_Failed, status->action, "status failed (%d) -- %s", s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
-                                } else {
-                                        Event_post(s, Event_Status, State_Succeeded, status->action, "status succeeded (%d) -- %s", s->program->exitStatus, StringBuffer_length(s->program->output) ? StringBuffer_toString(s->program->output) : "no output");
-                                }
-                        }
-                }
-                Process_free(&s->program->P);
+                if (_programStatus(s) == State_Failed)
+                        rv = State_Failed;
         } else {
                 rv = State_Init;
         }